@@ -14,11 +14,15 @@ namespace algorithms {
 
 using namespace structures;
 
-void extract_containing_graph(const HandleGraph* source,
-                              MutableHandleGraph* into,
-                              const vector<pos_t>& positions,
-                              const vector<size_t>& forward_search_lengths,
-                              const vector<size_t>& backward_search_lengths) {
+/// Does the Dijkstra search for extract_containing_graph and containing_graph_node_ids, reporting
+/// each node found (with its handle in the source graph) once, and each edge traversed if an edge
+/// callback is given
+static void search_containing_graph(const HandleGraph* source,
+                                    const vector<pos_t>& positions,
+                                    const vector<size_t>& forward_search_lengths,
+                                    const vector<size_t>& backward_search_lengths,
+                                    const function<void(const handle_t&)>& found_node,
+                                    const function<void(const edge_t&)>* found_edge) {
     
     if (forward_search_lengths.size() != backward_search_lengths.size()
         || forward_search_lengths.size() != positions.size()) {
@@ -26,11 +30,6 @@ void extract_containing_graph(const HandleGraph* source,
         assert(false);
     }
     
-    if (into->node_size()) {
-        cerr << "error:[extract_containing_graph] must extract into an empty graph" << endl;
-        assert(false);
-    }
-    
 #ifdef debug_vg_algorithms
     cerr << "[extract_containing_graph] extracting containing graph from the following points:" << endl;
     for (size_t i = 0; i < positions.size(); i ++) {
@@ -54,7 +53,6 @@ void extract_containing_graph(const HandleGraph* source,
                                    *std::max_element(backward_search_lengths.begin(), backward_search_lengths.end()));
     
     unordered_set<id_t> observed_ids;
-    unordered_set<edge_t> observed_edges;
     
     // initialize the queue
     UpdateablePriorityQueue<Traversal, handle_t> queue([](const Traversal& item) {
@@ -68,7 +66,7 @@ void extract_containing_graph(const HandleGraph* source,
         
         // add all of the initial nodes to the graph
         if (!observed_ids.count(id(pos))) {
-            into->create_handle(source->get_sequence(source_handle), id(pos));
+            found_node(source_handle);
             observed_ids.insert(id(pos));
         }
         
@@ -98,11 +96,13 @@ void extract_containing_graph(const HandleGraph* source,
             id_t next_id = source->get_id(next);
             
             // record the edge
-            observed_edges.insert(source->edge_handle(trav.handle, next));
+            if (found_edge) {
+                (*found_edge)(source->edge_handle(trav.handle, next));
+            }
             
             // make sure the node is in the graph
             if (!observed_ids.count(next_id)) {
-                into->create_handle(source->get_sequence(source->forward(next)), next_id);
+                found_node(source->forward(next));
                 observed_ids.insert(next_id);
             }
             
@@ -115,6 +115,30 @@ void extract_containing_graph(const HandleGraph* source,
         });
     }
     
+}
+
+void extract_containing_graph(const HandleGraph* source,
+                              MutableHandleGraph* into,
+                              const vector<pos_t>& positions,
+                              const vector<size_t>& forward_search_lengths,
+                              const vector<size_t>& backward_search_lengths) {
+    
+    if (into->node_size()) {
+        cerr << "error:[extract_containing_graph] must extract into an empty graph" << endl;
+        assert(false);
+    }
+    
+    unordered_set<edge_t> observed_edges;
+    function<void(const edge_t&)> found_edge = [&](const edge_t& edge) {
+        observed_edges.insert(edge);
+    };
+    
+    search_containing_graph(source, positions, forward_search_lengths, backward_search_lengths,
+                            [&](const handle_t& handle) {
+                                into->create_handle(source->get_sequence(handle), source->get_id(handle));
+                            },
+                            &found_edge);
+    
     // add the edges to the graph
     for (const edge_t& edge : observed_edges) {
         into->create_edge(into->get_handle(source->get_id(edge.first), source->get_is_reverse(edge.first)),
@@ -122,6 +146,26 @@ void extract_containing_graph(const HandleGraph* source,
     }
 }
 
+vector<id_t> containing_graph_node_ids(const HandleGraph* source,
+                                       const vector<pos_t>& positions,
+                                       const vector<size_t>& forward_search_lengths,
+                                       const vector<size_t>& backward_search_lengths,
+                                       unordered_set<edge_t>* edges_out) {
+    
+    vector<id_t> node_ids;
+    function<void(const edge_t&)> found_edge = [&](const edge_t& edge) {
+        edges_out->insert(edge);
+    };
+    search_containing_graph(source, positions, forward_search_lengths, backward_search_lengths,
+                            [&](const handle_t& handle) {
+                                node_ids.push_back(source->get_id(handle));
+                            },
+                            edges_out ? &found_edge : nullptr);
+    
+    sort(node_ids.begin(), node_ids.end());
+    return node_ids;
+}
+
 void extract_containing_graph(const HandleGraph* source, MutableHandleGraph* into, const vector<pos_t>& positions,
                               size_t max_dist) {
     
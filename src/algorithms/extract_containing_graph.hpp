@@ -46,6 +46,15 @@ namespace algorithms {
     void extract_containing_graph(const HandleGraph* source, MutableHandleGraph* into, const vector<pos_t>& positions,
                                   const vector<size_t>& position_forward_max_dist,
                                   const vector<size_t>& position_backward_max_dist);
+    
+    /// Same search as the previous, but only returns the IDs of the nodes that would be extracted, in
+    /// ascending order, without copying anything out of the source graph. If edges_out is given, the
+    /// edges that would be extracted are added to it. The nodes and edges can be viewed in the source
+    /// with a SubHandleGraph.
+    vector<id_t> containing_graph_node_ids(const HandleGraph* source, const vector<pos_t>& positions,
+                                           const vector<size_t>& position_forward_max_dist,
+                                           const vector<size_t>& position_backward_max_dist,
+                                           unordered_set<edge_t>* edges_out = nullptr);
 
 }
 }
@@ -1,14 +1,24 @@
 #include "alignment.hpp"
 #include "stream.hpp"
+#include "fastq_reader.hpp"
 
 #include <regex>
 
 namespace vg {
 
+// Size of the htslib BGZF/CRAM decoding pool to run beside worker_threads
+// threads that consume the records. The pool sits on top of the workers, so
+// it is kept to a fraction of them to leave -t as the bound on CPU use.
+static int hts_decoding_threads(int worker_threads) {
+    return max(1, worker_threads / 4);
+}
+
 int hts_for_each(string& filename, function<void(Alignment&)> lambda, xg::XG* xgindex) {
 
     samFile *in = hts_open(filename.c_str(), "r");
     if (in == NULL) return 0;
+    // let htslib decompress BGZF/CRAM blocks ahead of us in its own thread pool
+    hts_set_threads(in, hts_decoding_threads(get_thread_count()));
     bam_hdr_t *hdr = sam_hdr_read(in);
     map<string, string> rg_sample;
     parse_rg_sample_map(hdr->text, rg_sample);
@@ -32,34 +42,53 @@ int hts_for_each_parallel(string& filename, function<void(Alignment&)> lambda, x
 
     samFile *in = hts_open(filename.c_str(), "r");
     if (in == NULL) return 0;
+    
+    int thread_count = get_thread_count();
+    // let htslib decompress BGZF/CRAM blocks ahead of the workers in its own thread pool
+    hts_set_threads(in, hts_decoding_threads(thread_count));
+    
     bam_hdr_t *hdr = sam_hdr_read(in);
     map<string, string> rg_sample;
     parse_rg_sample_map(hdr->text, rg_sample);
 
-    int thread_count = get_thread_count();
-    vector<bam1_t*> bs; bs.resize(thread_count);
-    for (auto& b : bs) {
-        b = bam_init1();
+    // each thread takes the input lock once per batch of records, and converts
+    // its batch to Alignments outside the lock
+    const size_t batch_size = 256;
+    vector<vector<bam1_t*>> batches(thread_count);
+    for (auto& batch : batches) {
+        batch.resize(batch_size);
+        for (auto& b : batch) {
+            b = bam_init1();
+        }
     }
 
     bool more_data = true;
-#pragma omp parallel shared(in, hdr, more_data, rg_sample)
+#pragma omp parallel shared(in, hdr, more_data, rg_sample, batches)
     {
-        int tid = omp_get_thread_num();
+        vector<bam1_t*>& batch = batches[omp_get_thread_num()];
         while (more_data) {
-            bam1_t* b = bs[tid];
+            size_t batch_filled = 0;
 #pragma omp critical (hts_input)
-            if (more_data) {
-                more_data = sam_read1(in, hdr, b) >= 0;
+            {
+                while (more_data && batch_filled < batch.size()) {
+                    more_data = sam_read1(in, hdr, batch[batch_filled]) >= 0;
+                    if (more_data) {
+                        batch_filled++;
+                    }
+                }
             }
-            if (more_data) {
-                Alignment a = bam_to_alignment(b, rg_sample, hdr, xgindex);
+            for (size_t i = 0; i < batch_filled; i++) {
+                Alignment a = bam_to_alignment(batch[i], rg_sample, hdr, xgindex);
                 lambda(a);
             }
         }
     }
 
-    for (auto& b : bs) bam_destroy1(b);
+    for (auto& batch : batches) {
+        for (auto& b : batch) {
+            bam_destroy1(b);
+        }
+    }
     bam_hdr_destroy(hdr);
     hts_close(in);
     return 1;
@@ -340,25 +369,13 @@ size_t paired_for_each_parallel_after_wait(function<bool(Alignment&, Alignment&)
 
 size_t fastq_unpaired_for_each_parallel(const string& filename, function<void(Alignment&)> lambda) {
     
-    gzFile fp = (filename != "-") ? gzopen(filename.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp) {
-        cerr << "[vg::alignment.cpp] couldn't open " << filename << endl; exit(1);
-    }
-    
-    size_t len = 2 << 22; // 4M
-    char* buf = new char[len];
+    FastqReader reader(filename, get_thread_count());
     
     function<bool(Alignment&)> get_read = [&](Alignment& aln) {
-        return get_next_alignment_from_fastq(fp, buf, len, aln);;
+        return reader.next(aln);
     };
     
-    
-    size_t nLines = unpaired_for_each_parallel(get_read, lambda);
-    
-    delete[] buf;
-    gzclose(fp);
-    return nLines;
-    
+    return unpaired_for_each_parallel(get_read, lambda);
 }
 
 size_t fastq_paired_interleaved_for_each_parallel(const string& filename, function<void(Alignment&, Alignment&)> lambda) {
@@ -373,111 +390,64 @@ size_t fastq_paired_interleaved_for_each_parallel_after_wait(const string& filen
                                                              function<void(Alignment&, Alignment&)> lambda,
                                                              function<bool(void)> single_threaded_until_true) {
     
-    gzFile fp = (filename != "-") ? gzopen(filename.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp) {
-        cerr << "[vg::alignment.cpp] couldn't open " << filename << endl; exit(1);
-    }
-    
-    size_t len = 1 << 18; // 256k
-    char* buf = new char[len];
+    FastqReader reader(filename, get_thread_count());
     
     function<bool(Alignment&, Alignment&)> get_pair = [&](Alignment& mate1, Alignment& mate2) {
-        return get_next_interleaved_alignment_pair_from_fastq(fp, buf, len, mate1, mate2);
+        return reader.next(mate1) && reader.next(mate2);
     };
     
-    size_t nLines = paired_for_each_parallel_after_wait(get_pair, lambda, single_threaded_until_true);
-    
-    delete[] buf;
-    gzclose(fp);
-    return nLines;
+    return paired_for_each_parallel_after_wait(get_pair, lambda, single_threaded_until_true);
 }
     
 size_t fastq_paired_two_files_for_each_parallel_after_wait(const string& file1, const string& file2,
                                                            function<void(Alignment&, Alignment&)> lambda,
                                                            function<bool(void)> single_threaded_until_true) {
     
-    gzFile fp1 = (file1 != "-") ? gzopen(file1.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp1) {
-        cerr << "[vg::alignment.cpp] couldn't open " << file1 << endl; exit(1);
-    }
-    gzFile fp2 = (file2 != "-") ? gzopen(file2.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp2) {
-        cerr << "[vg::alignment.cpp] couldn't open " << file2 << endl; exit(1);
-    }
-    
-    size_t len = 1 << 18; // 256k
-    char* buf = new char[len];
+    // the two files are only ever read from the batching thread, so they stay in sync without
+    // locking, and each gets half of the decompression threads
+    int decompression_threads = max(get_thread_count() / 2, 1);
+    FastqReader reader1(file1, decompression_threads);
+    FastqReader reader2(file2, decompression_threads);
     
     function<bool(Alignment&, Alignment&)> get_pair = [&](Alignment& mate1, Alignment& mate2) {
-        return get_next_alignment_pair_from_fastqs(fp1, fp2, buf, len, mate1, mate2);
+        return FastqReader::next_pair(reader1, reader2, mate1, mate2);
     };
     
-    size_t nLines = paired_for_each_parallel_after_wait(get_pair, lambda, single_threaded_until_true);
-    
-    delete[] buf;
-    gzclose(fp1);
-    gzclose(fp2);
-    return nLines;
+    return paired_for_each_parallel_after_wait(get_pair, lambda, single_threaded_until_true);
 }
 
 size_t fastq_unpaired_for_each(const string& filename, function<void(Alignment&)> lambda) {
-    gzFile fp = (filename != "-") ? gzopen(filename.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp) {
-        cerr << "[vg::alignment.cpp] couldn't open " << filename << endl; exit(1);
-    }
-    size_t len = 2 << 22; // 4M
+    FastqReader reader(filename);
     size_t nLines = 0;
-    char *buffer = new char[len];
     Alignment alignment;
-    while(get_next_alignment_from_fastq(fp, buffer, len, alignment)) {
+    while(reader.next(alignment)) {
         lambda(alignment);
         nLines++;
     }
-    gzclose(fp);
-    delete[] buffer;
     return nLines;
 }
 
 size_t fastq_paired_interleaved_for_each(const string& filename, function<void(Alignment&, Alignment&)> lambda) {
-    gzFile fp = (filename != "-") ? gzopen(filename.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp) {
-        cerr << "[vg::alignment.cpp] couldn't open " << filename << endl; exit(1);
-    }
-    size_t len = 2 << 18; // 256k
+    FastqReader reader(filename);
     size_t nLines = 0;
-    char *buffer = new char[len];
     Alignment mate1, mate2;
-    while(get_next_interleaved_alignment_pair_from_fastq(fp, buffer, len, mate1, mate2)) {
+    while(reader.next(mate1) && reader.next(mate2)) {
         lambda(mate1, mate2);
         nLines++;
     }
-    gzclose(fp);
-    delete[] buffer;
     return nLines;
 }
 
 size_t fastq_paired_two_files_for_each(const string& file1, const string& file2, function<void(Alignment&, Alignment&)> lambda) {
-    gzFile fp1 = (file1 != "-") ? gzopen(file1.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp1) {
-        cerr << "[vg::alignment.cpp] couldn't open " << file1 << endl; exit(1);
-    }
-    gzFile fp2 = (file2 != "-") ? gzopen(file2.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp2) {
-        cerr << "[vg::alignment.cpp] couldn't open " << file2 << endl; exit(1);
-    }
-    size_t len = 2 << 18; // 256k
+    FastqReader reader1(file1);
+    FastqReader reader2(file2);
     size_t nLines = 0;
-    char *buffer = new char[len];
     Alignment mate1, mate2;
-    while(get_next_alignment_pair_from_fastqs(fp1, fp2, buffer, len, mate1, mate2)) {
+    while(FastqReader::next_pair(reader1, reader2, mate1, mate2)) {
         lambda(mate1, mate2);
         nLines++;
     }
-    gzclose(fp1);
-    gzclose(fp2);
-    delete[] buffer;
     return nLines;
-
 }
 
 void parse_rg_sample_map(char* hts_header, map<string, string>& rg_sample) {
@@ -5,6 +5,15 @@
 #include <numeric>
 #include <cmath>
 #include <iomanip>
+#include <sstream>
+#include <limits>
+#include <stdexcept>
+#include <fstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
 
 /**
  * \file benchmark.hpp: implementations of benchmarking functions
@@ -81,6 +90,152 @@ ostream& operator<<(ostream& out, const BenchmarkResult& result) {
     return out;
 }
 
+double WorkloadResult::items_per_second() const {
+    return (double) items / chrono::duration_cast<chrono::duration<double>>(timing.test_mean).count();
+}
+
+double WorkloadResult::bytes_per_second() const {
+    return (double) bytes / chrono::duration_cast<chrono::duration<double>>(timing.test_mean).count();
+}
+
+ostream& operator<<(ostream& out, const WorkloadResult& result) {
+    // Start with the usual benchmark columns
+    out << result.timing;
+    
+    auto initial_precision = out.precision();
+    auto initial_flags = out.flags();
+    
+    out << fixed << setprecision(1);
+    out << "\t" << result.threads;
+    out << "\t" << result.items_per_second();
+    out << "\t" << result.bytes_per_second();
+    out << "\t";
+    if (result.peak_rss_kb != 0) {
+        out << result.peak_rss_kb;
+    } else {
+        // Memory use couldn't be measured
+        out << ".";
+    }
+    
+    out.precision(initial_precision);
+    out.flags(initial_flags);
+    
+    return out;
+}
+
+BenchmarkBaseline load_benchmark_baseline(istream& in) {
+    BenchmarkBaseline baseline;
+    
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            // Skip headers
+            continue;
+        }
+        
+        // Split on tabs. Columns are runs, test time and stddev, control
+        // time and stddev, score, error, and name, then possibly workload
+        // columns.
+        vector<string> columns;
+        stringstream line_stream(line);
+        string column;
+        while (getline(line_stream, column, '\t')) {
+            columns.push_back(column);
+        }
+        if (columns.size() < 8) {
+            throw runtime_error("Malformed benchmark report line: " + line);
+        }
+        baseline[columns[7]] = make_pair(stod(columns[5]), stod(columns[6]));
+    }
+    
+    return baseline;
+}
+
+double score_significance(const BenchmarkResult& result, const pair<double, double>& baseline) {
+    // Treat the score errors as independent and add them in quadrature
+    double combined_error = sqrt(pow(result.score_error(), 2) + pow(baseline.second, 2));
+    double difference = result.score() - baseline.first;
+    if (combined_error == 0) {
+        return difference == 0 ? 0 : copysign(numeric_limits<double>::infinity(), difference);
+    }
+    return difference / combined_error;
+}
+
+/// Get the peak resident set size in some resource usage, in kilobytes
+static size_t max_rss_kb(const struct rusage& usage) {
+#ifdef __APPLE__
+    // Mac reports bytes
+    return usage.ru_maxrss / 1024;
+#else
+    // Linux reports kilobytes
+    return usage.ru_maxrss;
+#endif
+}
+
+bool reset_peak_rss() {
+#ifdef __linux__
+    // Writing 5 here resets the high water mark that Linux reports as VmHWM
+    ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5" << flush;
+    return (bool) clear_refs;
+#else
+    return false;
+#endif
+}
+
+size_t peak_rss_kb() {
+#ifdef __linux__
+    // Unlike getrusage(), VmHWM follows resets
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return stoull(line.substr(6));
+        }
+    }
+#endif
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return max_rss_kb(usage);
+}
+
+int run_benchmark_command(const vector<string>& args, const string& out_file, size_t& child_peak_rss_kb) {
+    child_peak_rss_kb = 0;
+    
+    // Build the argument list before forking, so the child only has to exec
+    vector<char*> argv;
+    for (auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    
+    pid_t pid = fork();
+    if (pid < 0) {
+        return -1;
+    }
+    if (pid == 0) {
+        // We are the child
+        int out_fd = open(out_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out_fd < 0 || dup2(out_fd, STDOUT_FILENO) < 0) {
+            _exit(127);
+        }
+        close(out_fd);
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+    
+    // Wait for the child and collect its own resource usage
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid) {
+        return -1;
+    }
+    child_peak_rss_kb = max_rss_kb(usage);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
 void benchmark_control() {
     // We need to do something that takes time.
     
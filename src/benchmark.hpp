@@ -4,7 +4,9 @@
 #include <chrono>
 #include <functional>
 #include <iostream>
+#include <map>
 #include <string>
+#include <vector>
 
 /** 
  * \file benchmark.hpp
@@ -47,6 +49,72 @@ struct BenchmarkResult {
  */
 ostream& operator<<(ostream& out, const BenchmarkResult& result);
 
+/**
+ * Represents the results of an end-to-end workload benchmark: the run time
+ * statistics against the control, plus the throughput and memory use of the
+ * workload.
+ */
+struct WorkloadResult {
+    /// Run time statistics for the workload
+    BenchmarkResult timing;
+    /// How many threads the workload used
+    size_t threads;
+    /// How many items (usually reads) each run processed
+    size_t items;
+    /// How many bytes of input each run processed
+    size_t bytes;
+    /// What was the peak resident set size while the workload ran, in
+    /// kilobytes, or 0 if it could not be measured
+    size_t peak_rss_kb;
+    /// How many items per second did we process?
+    double items_per_second() const;
+    /// How many bytes per second did we process?
+    double bytes_per_second() const;
+};
+
+/**
+ * Workload results can be output to streams, as a benchmark result TSV line
+ * with extra columns for throughput and memory.
+ */
+ostream& operator<<(ostream& out, const WorkloadResult& result);
+
+/**
+ * The scores and score errors of a previous benchmark report, by benchmark name.
+ */
+using BenchmarkBaseline = map<string, pair<double, double>>;
+
+/**
+ * Load a baseline from a report written by vg benchmark.
+ */
+BenchmarkBaseline load_benchmark_baseline(istream& in);
+
+/**
+ * How many standard errors is the result's score above (faster) or below
+ * (slower) the given baseline score and error?
+ */
+double score_significance(const BenchmarkResult& result, const pair<double, double>& baseline);
+
+/**
+ * Start measuring the peak resident set size of this process afresh. Returns
+ * false if the peak can't be reset on this system, in which case
+ * peak_rss_kb() keeps reporting the peak since the process started.
+ */
+bool reset_peak_rss();
+
+/**
+ * Get the peak resident set size of this process, in kilobytes, since it
+ * started or since the last successful reset_peak_rss().
+ */
+size_t peak_rss_kb();
+
+/**
+ * Run a command in a child process with its standard output sent to the given
+ * file, and wait for it. Returns the command's exit status, or -1 if it could
+ * not be run or did not exit normally. The peak resident set size of the
+ * child, in kilobytes, is stored in child_peak_rss_kb.
+ */
+int run_benchmark_command(const vector<string>& args, const string& out_file, size_t& child_peak_rss_kb);
+
 /**
  * The benchmark control function, designed to take some amount of time that might vary with CPU load.
  */
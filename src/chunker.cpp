@@ -1,4 +1,5 @@
 #include <iostream>
+#include <set>
 #include <unordered_set>
 #include "stream.hpp"
 #include "chunker.hpp"
@@ -37,16 +38,151 @@ void PathChunker::extract_subgraph(const Region& region, int context, int length
         });
     
     // expand the context and get path information
-    // if forward_only true, then we only go forward.
-    xg->expand_context(g, context, true, true, true, !forward_only);
-    if (length) {
-        xg->expand_context(g, context, true, false, true, !forward_only);
-    }
+    expand_chunk(g, context, length, forward_only, true);
         
     // build the vg
     subgraph.extend(g);
     subgraph.remove_orphan_edges();
 
+    find_out_region(region, subgraph.paths.path(region.seq), out_region);
+}
+
+void PathChunker::extract_id_range(vg::id_t start, vg::id_t end, int context, int length,
+                                   bool forward_only, VG& subgraph, Region& out_region) {
+
+    Graph g;
+
+    for (vg::id_t i = start; i <= end; ++i) {
+        *g.add_node() = xg->node(i);
+    }
+    
+    // expand the context and get path information
+    expand_chunk(g, context, length, forward_only, true);
+
+    // build the vg
+    subgraph.extend(g);
+    subgraph.remove_orphan_edges();
+
+    out_region.start = subgraph.min_node_id();
+    out_region.end = subgraph.max_node_id();
+}
+
+void PathChunker::extract_subgraphs(const vector<Region>& regions, int context, int length, bool forward_only,
+                                    const function<void(size_t, VG&, Region&)>& lambda,
+                                    const function<void(const vector<Region>&)>& before_chunks) {
+
+    // we only keep the node IDs of all the chunks until they are finished
+    vector<vector<int64_t>> chunk_nodes(regions.size());
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < regions.size(); ++i) {
+        Graph g;
+        xg->for_path_range(regions[i].seq, regions[i].start, regions[i].end, [&](int64_t id) {
+                *g.add_node() = xg->node(id);
+            });
+        expand_chunk(g, context, length, forward_only, false);
+        get_chunk_nodes(g, chunk_nodes[i]);
+    }
+
+    ChunkPaths chunk_paths;
+    find_chunk_paths(chunk_nodes, chunk_paths);
+
+    vector<Region> out_regions(regions.size());
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < regions.size(); ++i) {
+        auto name = lower_bound(chunk_paths.names.begin(), chunk_paths.names.end(), regions[i].seq);
+        assert(name != chunk_paths.names.end() && *name == regions[i].seq);
+        const XGPath& path = xg->get_path(*name);
+        auto& hits = chunk_paths.hits[name - chunk_paths.names.begin()];
+        auto it = lower_bound(hits.begin(), hits.end(), make_pair(i, (size_t) 0));
+        assert(it != hits.end() && it->first == i);
+        int64_t first_node = path.node(it->second);
+        int64_t path_length = 0;
+        for (; it != hits.end() && it->first == i; ++it) {
+            path_length += xg->node_length(path.node(it->second));
+        }
+        find_out_region(regions[i], first_node, path_length, out_regions[i]);
+    }
+
+    finish_chunks(chunk_nodes, chunk_paths, out_regions, lambda, before_chunks);
+}
+
+void PathChunker::extract_id_ranges(const vector<Region>& regions, int context, int length, bool forward_only,
+                                    const function<void(size_t, VG&, Region&)>& lambda,
+                                    const function<void(const vector<Region>&)>& before_chunks) {
+
+    // we only keep the node IDs of all the chunks until they are finished
+    vector<vector<int64_t>> chunk_nodes(regions.size());
+    vector<Region> out_regions(regions.size());
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < regions.size(); ++i) {
+        Graph g;
+        for (vg::id_t id = regions[i].start; id <= regions[i].end; ++id) {
+            *g.add_node() = xg->node(id);
+        }
+        expand_chunk(g, context, length, forward_only, false);
+        get_chunk_nodes(g, chunk_nodes[i]);
+
+        // the chunk covers the range of IDs it ended up with
+        out_regions[i].seq = regions[i].seq;
+        out_regions[i].start = chunk_nodes[i].empty() ? numeric_limits<int64_t>::max() : chunk_nodes[i].front();
+        out_regions[i].end = chunk_nodes[i].empty() ? 0 : chunk_nodes[i].back();
+    }
+
+    ChunkPaths chunk_paths;
+    find_chunk_paths(chunk_nodes, chunk_paths);
+
+    finish_chunks(chunk_nodes, chunk_paths, out_regions, lambda, before_chunks);
+}
+
+void PathChunker::expand_chunk(Graph& g, int context, int length, bool forward_only, bool add_paths) {
+    // if forward_only true, then we only go forward.
+    xg->expand_context(g, context, add_paths, true, true, !forward_only);
+    if (length) {
+        xg->expand_context(g, context, add_paths, false, true, !forward_only);
+    }
+}
+
+void PathChunker::get_chunk_nodes(const Graph& g, vector<int64_t>& nodes) {
+    nodes.reserve(g.node_size());
+    for (size_t i = 0; i < g.node_size(); ++i) {
+        nodes.push_back(g.node(i).id());
+    }
+    sort(nodes.begin(), nodes.end());
+}
+
+void PathChunker::build_chunk(const vector<int64_t>& nodes, Graph& g) {
+    for (int64_t id : nodes) {
+        *g.add_node() = xg->node(id);
+    }
+    // each edge is found from both of its ends, so we only take it from one
+    // of them; reversing self loops can be found twice from the same end
+    set<pair<side_t, side_t>> seen_edges;
+    for (int64_t id : nodes) {
+        for (auto& edge : xg->edges_of(id)) {
+            int64_t other = edge.from() == id ? edge.to() : edge.from();
+            if (other < id || !binary_search(nodes.begin(), nodes.end(), other)) {
+                continue;
+            }
+            auto sides = make_pair(make_side(edge.from(), edge.from_start()), make_side(edge.to(), edge.to_end()));
+            if (seen_edges.insert(sides).second) {
+                *g.add_edge() = edge;
+            }
+        }
+    }
+}
+
+void PathChunker::find_out_region(const Region& region, const Path& path, Region& out_region) {
+    // Is there a better way to get path length? 
+    int64_t path_length = 0;
+    for (size_t j = 0; j < path.mapping_size(); ++j) {
+      path_length += xg->node_length(path.mapping(j).position().node_id());
+    }
+    find_out_region(region, path.mapping(0).position().node_id(), path_length, out_region);
+}
+
+void PathChunker::find_out_region(const Region& region, int64_t first_node, int64_t path_length,
+                                  Region& out_region) {
+
     // what node contains our input starting position?
     int64_t input_start_node = xg->node_at_path_position(region.seq, region.start);
 
@@ -59,8 +195,7 @@ void PathChunker::extract_subgraph(const Region& region, int context, int length
     // find out the start position of the first node in the path in the
     // subgraph.  take the last occurance before the input_start_pos
     // todo: there are probably some cases involving cycles where this breaks
-    Path path = subgraph.paths.path(region.seq);
-    int64_t chunk_start_node = path.mapping(0).position().node_id();    
+    int64_t chunk_start_node = first_node;
     int64_t chunk_start_pos = -1;
     int64_t best_delta = numeric_limits<int64_t>::max();
     vector<size_t> first_positions = xg->position_in_path(chunk_start_node, region.seq);
@@ -75,37 +210,83 @@ void PathChunker::extract_subgraph(const Region& region, int context, int length
 
     out_region.seq = region.seq;
     out_region.start = chunk_start_pos;
-    out_region.end = out_region.start - 1;
-    // Is there a better way to get path length? 
-    Path output_path = subgraph.paths.path(out_region.seq);
-    for (size_t j = 0; j < output_path.mapping_size(); ++j) {
-      int64_t op_node = output_path.mapping(j).position().node_id();
-      out_region.end += subgraph.get_node(op_node)->sequence().length();
-    }
+    out_region.end = out_region.start - 1 + path_length;
 }
 
-void PathChunker::extract_id_range(vg::id_t start, vg::id_t end, int context, int length,
-                                   bool forward_only, VG& subgraph, Region& out_region) {
+void PathChunker::find_chunk_paths(const vector<vector<int64_t>>& chunk_nodes, ChunkPaths& chunk_paths) {
 
-    Graph g;
+    // sorted (node ID, chunk) pairs, so we can look up the chunks containing each node
+    vector<pair<int64_t, size_t>> node_chunks;
+    for (size_t i = 0; i < chunk_nodes.size(); ++i) {
+        for (int64_t id : chunk_nodes[i]) {
+            node_chunks.emplace_back(id, i);
+        }
+    }
+    sort(node_chunks.begin(), node_chunks.end());
 
-    for (vg::id_t i = start; i <= end; ++i) {
-        *g.add_node() = xg->node(i);
+    // XG::add_paths_to_graph leaves the paths in name order, so we do too
+    auto& path_names = chunk_paths.names;
+    path_names.clear();
+    for (size_t rank = 1; rank <= xg->max_path_rank(); ++rank) {
+        path_names.push_back(xg->path_name(rank));
     }
-    
-    // expand the context and get path information
-    // if forward_only true, then we only go forward.
-    xg->expand_context(g, context, true, true, true, !forward_only);
-    if (length) {
-        xg->expand_context(g, context, true, false, true, !forward_only);
+    sort(path_names.begin(), path_names.end());
+
+    // sweep each path, finding the (chunk, offset in path) of every mapping
+    // that belongs in a chunk
+    chunk_paths.hits.assign(path_names.size(), vector<pair<size_t, size_t>>());
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < path_names.size(); ++i) {
+        const XGPath& path = xg->get_path(path_names[i]);
+        auto& hits = chunk_paths.hits[i];
+        for (size_t j = 0; j < path.ids.size(); ++j) {
+            int64_t id = path.node(j);
+            for (auto it = lower_bound(node_chunks.begin(), node_chunks.end(), make_pair(id, (size_t) 0));
+                 it != node_chunks.end() && it->first == id; ++it) {
+                hits.emplace_back(it->second, j);
+            }
+        }
+        // group by chunk, keeping path order within each
+        sort(hits.begin(), hits.end());
     }
+}
 
-    // build the vg
-    subgraph.extend(g);
-    subgraph.remove_orphan_edges();
+void PathChunker::add_chunk_paths(size_t chunk, const ChunkPaths& chunk_paths, Graph& g) {
+    function<int64_t(int64_t)> node_length = [&](int64_t id) { return xg->node_length(id); };
+    for (size_t i = 0; i < chunk_paths.names.size(); ++i) {
+        auto& hits = chunk_paths.hits[i];
+        auto it = lower_bound(hits.begin(), hits.end(), make_pair(chunk, (size_t) 0));
+        if (it == hits.end() || it->first != chunk) {
+            continue;
+        }
+        const XGPath& path = xg->get_path(chunk_paths.names[i]);
+        Path* graph_path = g.add_path();
+        graph_path->set_name(chunk_paths.names[i]);
+        for (; it != hits.end() && it->first == chunk; ++it) {
+            *graph_path->add_mapping() = path.mapping(it->second, node_length);
+        }
+    }
+}
 
-    out_region.start = subgraph.min_node_id();
-    out_region.end = subgraph.max_node_id();
+void PathChunker::finish_chunks(const vector<vector<int64_t>>& chunk_nodes, const ChunkPaths& chunk_paths,
+                                vector<Region>& out_regions,
+                                const function<void(size_t, VG&, Region&)>& lambda,
+                                const function<void(const vector<Region>&)>& before_chunks) {
+    if (before_chunks) {
+        before_chunks(out_regions);
+    }
+    // only the chunks being worked on are in memory at once
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < out_regions.size(); ++i) {
+        VG subgraph;
+        {
+            Graph g;
+            build_chunk(chunk_nodes[i], g);
+            add_chunk_paths(i, chunk_paths, g);
+            subgraph.extend(g);
+        }
+        lambda(i, subgraph, out_regions[i]);
+    }
 }
 
 }
@@ -48,6 +48,78 @@ public:
     void extract_id_range(vg::id_t start, vg::id_t end, int context, int length, bool forward_only,
                          VG& subgraph, Region& out_region);
 
+    /**
+     * Extract the subgraphs for many path regions at once, with the same
+     * results as extract_subgraph(). The node sets of all the chunks are found
+     * first, and then each path in the index is swept once to find which of
+     * its mappings fall in which chunks, instead of looking up the paths of
+     * each node of each chunk. Only the node IDs and those path offsets are
+     * kept for all the chunks; each chunk is then built from its nodes, the
+     * edges between them and its paths, passed to the callback with its index
+     * in regions, and freed, in parallel. If given, before_chunks is run
+     * first, with the output regions of all the chunks.
+     *
+     * Since a chunk gets all the edges between its nodes, it can have edges
+     * that extract_subgraph() would leave out: those that forward_only context
+     * expansion did not follow, and with no context, those between the nodes
+     * of the region itself.
+     */
+    void extract_subgraphs(const vector<Region>& regions, int context, int length, bool forward_only,
+                           const function<void(size_t, VG&, Region&)>& lambda,
+                           const function<void(const vector<Region>&)>& before_chunks = nullptr);
+
+    /**
+     * Like above, but use (inclusive) id ranges, stored as the start and end of
+     * the regions, instead of regions on paths.
+     */
+    void extract_id_ranges(const vector<Region>& regions, int context, int length, bool forward_only,
+                           const function<void(size_t, VG&, Region&)>& lambda,
+                           const function<void(const vector<Region>&)>& before_chunks = nullptr);
+
+private:
+
+    /// Expand a chunk's starting nodes into its context, optionally with paths
+    void expand_chunk(Graph& g, int context, int length, bool forward_only, bool add_paths);
+
+    /// Find the path region covered by a subgraph extracted for the given
+    /// region, given the subgraph's copy of the region's path
+    void find_out_region(const Region& region, const Path& path, Region& out_region);
+
+    /// Find the path region covered by a subgraph extracted for the given
+    /// region, given the first node and total length of its copy of the
+    /// region's path
+    void find_out_region(const Region& region, int64_t first_node, int64_t path_length, Region& out_region);
+
+    /// Where the paths of the index fall in a set of chunks
+    struct ChunkPaths {
+        /// The paths, in name order
+        vector<string> names;
+        /// For each path, the (chunk, offset in path) of each of its mappings
+        /// that is on a node in the chunk, sorted
+        vector<vector<pair<size_t, size_t>>> hits;
+    };
+
+    /// Get the sorted IDs of the nodes in a chunk's graph
+    void get_chunk_nodes(const Graph& g, vector<int64_t>& nodes);
+
+    /// Fill in a chunk's graph with the nodes with the given sorted IDs and
+    /// the edges between them, without paths
+    void build_chunk(const vector<int64_t>& nodes, Graph& g);
+
+    /// Find the mappings of every path in the index that fall in chunks with
+    /// the given node IDs, sweeping each path once
+    void find_chunk_paths(const vector<vector<int64_t>>& chunk_nodes, ChunkPaths& chunk_paths);
+
+    /// Add the paths found by find_chunk_paths to one chunk's graph
+    void add_chunk_paths(size_t chunk, const ChunkPaths& chunk_paths, Graph& g);
+
+    /// Build each chunk from its nodes, add its paths, and run a callback on
+    /// it in parallel with its output region, freeing it after
+    void finish_chunks(const vector<vector<int64_t>>& chunk_nodes, const ChunkPaths& chunk_paths,
+                       vector<Region>& out_regions,
+                       const function<void(size_t, VG&, Region&)>& lambda,
+                       const function<void(const vector<Region>&)>& before_chunks);
+
 };
 
 
@@ -4,6 +4,7 @@
 #include <cstring>
 
 #include "cluster.hpp"
+#include "stage_stats.hpp"
 
 //#define debug_od_clusterer
 
@@ -21,148 +22,215 @@ namespace vg {
 //size_t OrientedDistanceClusterer::PRE_SPLIT_CLUSTER_COUNTER = 0;
 //size_t OrientedDistanceClusterer::POST_SPLIT_CLUSTER_COUNTER = 0;
     
+thread_local vector<unique_ptr<MEMChainModel::Arena>> MEMChainModel::free_arenas;
+
 MEMChainModel::MEMChainModel(
     const vector<size_t>& aln_lengths,
     const vector<vector<MaximalExactMatch> >& matches,
     const function<int64_t(pos_t)>& approx_position,
     const function<map<string, vector<pair<size_t, bool> > >(pos_t)>& path_position,
-    const function<double(const MaximalExactMatch&, const MaximalExactMatch&)>& transition_weight,
+    const function<double(const MEMChainModel&, size_t, size_t)>& transition_weight,
     int band_width,
     int position_depth,
     int max_connections) {
+    VG_TIME_STAGE(STAGE_CLUSTERING);
+    // borrow the storage left behind by the last model built on this thread
+    if (free_arenas.empty()) {
+        arena = unique_ptr<Arena>(new Arena());
+    } else {
+        arena = move(free_arenas.back());
+        free_arenas.pop_back();
+    }
+    model.swap(arena->model);
+    mems.swap(arena->mems);
+    hit_positions.swap(arena->hit_positions);
+    transitions.swap(arena->transitions);
+    positions.swap(arena->positions);
+    redundant_vertexes.swap(arena->redundant_vertexes);
+    auto& path_names = arena->path_names;
+    const string* approx_path = &*path_names.insert("").first;
+    
     // store the MEMs in the model
     int frag_n = 0;
     for (auto& fragment : matches) {
         ++frag_n;
         for (auto& mem : fragment) {
-            // copy the MEM for each specific hit in the base graph
-            // and add it in as a vertex
+            // keep one copy of the MEM, without its hits
+            mems.emplace_back(mem.begin, mem.end, mem.range, mem.match_count);
+            mems.back().queried_count = mem.queried_count;
+            mems.back().primary = mem.primary;
+            mems.back().fragment = frag_n;
+            // make a vertex for each specific hit in the base graph
             for (auto& node : mem.nodes) {
-                //model.emplace_back();
-                //auto m = model.back();
                 auto pos = make_pos_t(node);
-                MEMChainModelVertex m;
-                m.mem = mem;
+                model.emplace_back();
+                auto& m = model.back();
+                m.mem = mems.size() - 1;
+                m.node = node;
+                m.positions_begin = hit_positions.size();
+                for (auto& chr : path_position(pos)) {
+                    const string* path = &*path_names.insert(chr.first).first;
+                    for (auto& path_pos : chr.second) {
+                        hit_positions.push_back(MEMChainModelHitPosition{path, (int64_t) path_pos.first, path_pos.second});
+                    }
+                }
+                hit_positions.push_back(MEMChainModelHitPosition{approx_path, approx_position(pos), is_rev(pos)});
+                m.positions_end = hit_positions.size();
                 m.weight = mem.length();
-                m.prev = nullptr;
                 m.score = 0;
-                m.mem.positions = path_position(pos);
-                m.mem.positions[""].push_back(make_pair(approx_position(pos), is_rev(pos)));
-                m.mem.nodes.clear();
-                m.mem.nodes.push_back(node);
-                m.mem.fragment = frag_n;
-                m.mem.match_count = mem.match_count;
-                model.push_back(m);
+                m.prev = no_vertex;
+                m.prev_begin = 0;
+                m.prev_end = 0;
+                m.prev_count = 0;
+                m.next_count = 0;
             }
         }
     }
+    redundant_vertexes.assign(model.size(), false);
+    
     // index the model with the positions
-    for (vector<MEMChainModelVertex>::iterator v = model.begin(); v != model.end(); ++v) {
-        for (auto& chr : v->mem.positions) {
-            auto& chr_positions = positions[chr.first];
-            for (auto& pos : chr.second) {
-                chr_positions[pos.first].push_back(v);
+    for (size_t i = 0; i < model.size(); ++i) {
+        for (size_t j = model[i].positions_begin; j < model[i].positions_end; ++j) {
+            positions.push_back(MEMChainModelPosition{hit_positions[j].path, hit_positions[j].offset, i});
+        }
+    }
+    // sort the vertexes at each approx position by their matches
+    std::stable_sort(positions.begin(), positions.end(),
+                     [&](const MEMChainModelPosition& p1, const MEMChainModelPosition& p2) {
+                         int cmp = p1.path->compare(*p2.path);
+                         if (cmp != 0) {
+                             return cmp < 0;
+                         }
+                         if (p1.offset != p2.offset) {
+                             return p1.offset < p2.offset;
+                         }
+                         return mem_of(p1.vertex).length() > mem_of(p2.vertex).length();
+                     });
+    // trim each approx position to the position depth, and remember where each one's vertexes are
+    auto& groups = arena->position_groups;
+    groups.clear();
+    size_t kept = 0;
+    for (size_t i = 0; i < positions.size();) {
+        size_t j = i + 1;
+        while (j < positions.size() && positions[j].offset == positions[i].offset
+               && positions[j].path == positions[i].path) {
+            ++j;
+        }
+        size_t group_begin = kept;
+        for (size_t k = i; k < j && k - i < (size_t) position_depth; ++k) {
+            positions[kept++] = positions[k];
+        }
+        if (kept > group_begin) {
+            groups.emplace_back(group_begin, kept);
+        }
+        i = j;
+    }
+    positions.resize(kept);
+    
+    auto same_path = [&](size_t g1, size_t g2) {
+        return positions[groups[g1].first].path == positions[groups[g2].first].path;
+    };
+    auto distance = [&](size_t g1, size_t g2) {
+        return abs(positions[groups[g1].first].offset - positions[groups[g2].first].offset);
+    };
+    // if v2 goes forward in the read as far as it goes forward in the positional space
+    // from a longer v1, fold it into v1
+    auto merge_redundant = [&](size_t v1, size_t v2, int64_t dist) {
+        auto& mem1 = mem_of(v1);
+        auto& mem2 = mem_of(v2);
+        if (mems_overlap(mem1, mem2)
+            && abs(mem2.begin - mem1.begin) == dist) {
+            if (mem2.length() < mem1.length()) {
+                redundant_vertexes[v2] = true;
+                if (mem2.end > mem1.end) {
+                    model[v1].weight += mem2.end - mem1.end;
+                }
             }
         }
-    }
-    // sort the vertexes at each approx position by their matches and trim
-    for (auto& chr : positions) {
-        for (auto& p : chr.second) {
-            auto& pos = p.second;
-            std::sort(pos.begin(), pos.end(), [](const vector<MEMChainModelVertex>::iterator& v1,
-                                                 const vector<MEMChainModelVertex>::iterator& v2) {
-                          return v1->mem.length() > v2->mem.length();
-                      });
-            pos.resize(min(pos.size(), (size_t)position_depth));
-        }
-    }
+    };
     // for each vertex merge if we go equivalently forward in the positional space and forward in the read to the next position
     // scan forward
-    for (map<string, map<int64_t, vector<vector<MEMChainModelVertex>::iterator> > >::iterator c = positions.begin(); c != positions.end(); ++c) {
-        for (map<int64_t, vector<vector<MEMChainModelVertex>::iterator> >::iterator p = c->second.begin(); p != c->second.end(); ++p) {
-            for (auto& v1 : p->second) {
-                if (redundant_vertexes.count(v1)) continue;
-                auto q = p;
-                while (++q != c->second.end() && abs(p->first - q->first) < band_width) {
-                    for (auto& v2 : q->second) {
-                        if (redundant_vertexes.count(v2)) continue;
-                        if (mems_overlap(v1->mem, v2->mem)
-                            && abs(v2->mem.begin - v1->mem.begin) == abs(q->first - p->first)) {
-                            if (v2->mem.length() < v1->mem.length()) {
-                                redundant_vertexes.insert(v2);
-                                if (v2->mem.end > v1->mem.end) {
-                                    v1->weight += v2->mem.end - v1->mem.end;
-                                }
-                            }
-                        }
-                    }
+    for (size_t p = 0; p < groups.size(); ++p) {
+        for (size_t i = groups[p].first; i < groups[p].second; ++i) {
+            size_t v1 = positions[i].vertex;
+            if (redundant_vertexes[v1]) continue;
+            for (size_t q = p + 1; q < groups.size() && same_path(p, q) && distance(p, q) < band_width; ++q) {
+                for (size_t j = groups[q].first; j < groups[q].second; ++j) {
+                    size_t v2 = positions[j].vertex;
+                    if (redundant_vertexes[v2]) continue;
+                    merge_redundant(v1, v2, distance(p, q));
                 }
             }
         }
     }
-    // scan reverse
-    for (map<string, map<int64_t, vector<vector<MEMChainModelVertex>::iterator> > >::iterator c = positions.begin(); c != positions.end(); ++c) {
-        for (map<int64_t, vector<vector<MEMChainModelVertex>::iterator> >::reverse_iterator p = c->second.rbegin(); p != c->second.rend(); ++p) {
-            for (auto& v1 : p->second) {
-                if (redundant_vertexes.count(v1)) continue;
-                auto q = p;
-                while (++q != c->second.rend() && abs(p->first - q->first) < band_width) {
-                    for (auto& v2 : q->second) {
-                        if (redundant_vertexes.count(v2)) continue;
-                        if (mems_overlap(v1->mem, v2->mem)
-                            && abs(v2->mem.begin - v1->mem.begin) == abs(p->first - q->first)) {
-                            if (v2->mem.length() < v1->mem.length()) {
-                                redundant_vertexes.insert(v2);
-                                if (v2->mem.end > v1->mem.end) {
-                                    v1->weight += v2->mem.end - v1->mem.end;
-                                }
-                            }
-                        }
+    // scan reverse, within each path
+    for (size_t path_begin = 0, path_end = 0; path_begin < groups.size(); path_begin = path_end) {
+        path_end = path_begin + 1;
+        while (path_end < groups.size() && same_path(path_begin, path_end)) {
+            ++path_end;
+        }
+        for (size_t p = path_end; p-- > path_begin;) {
+            for (size_t i = groups[p].first; i < groups[p].second; ++i) {
+                size_t v1 = positions[i].vertex;
+                if (redundant_vertexes[v1]) continue;
+                for (size_t q = p; q-- > path_begin && distance(p, q) < band_width;) {
+                    for (size_t j = groups[q].first; j < groups[q].second; ++j) {
+                        size_t v2 = positions[j].vertex;
+                        if (redundant_vertexes[v2]) continue;
+                        merge_redundant(v1, v2, distance(p, q));
                     }
                 }
             }
         }
     }
     // now build up the model using the positional bandwidth
-    set<pair<vector<MEMChainModelVertex>::iterator, vector<MEMChainModelVertex>::iterator> > seen;
-    for (map<string, map<int64_t, vector<vector<MEMChainModelVertex>::iterator> > >::iterator c = positions.begin(); c != positions.end(); ++c) {
-        for (map<int64_t, vector<vector<MEMChainModelVertex>::iterator> >::iterator p = c->second.begin(); p != c->second.end(); ++p) {
-            for (auto& v1 : p->second) {
-                // For each vertex...
-                if (redundant_vertexes.count(v1)) continue;
-                // ...that isn't redundant
-                auto q = p;
-                while (++q != c->second.end() && abs(p->first - q->first) < band_width) {
-                    for (auto& v2 : q->second) {
-                        // For each other vertex...
+    auto& seen = arena->seen;
+    seen.clear();
+    auto& made = arena->scratch_transitions;
+    made.clear();
+    auto connect = [&](size_t from, size_t to, double weight) {
+        made.push_back(MEMChainModelTransition{from, to, weight, false});
+        ++model[from].next_count;
+        ++model[to].prev_count;
+    };
+    for (size_t p = 0; p < groups.size(); ++p) {
+        for (size_t i = groups[p].first; i < groups[p].second; ++i) {
+            // For each vertex...
+            size_t v1 = positions[i].vertex;
+            if (redundant_vertexes[v1]) continue;
+            // ...that isn't redundant
+            for (size_t q = p + 1; q < groups.size() && same_path(p, q) && distance(p, q) < band_width; ++q) {
+                for (size_t j = groups[q].first; j < groups[q].second; ++j) {
+                    // For each other vertex...
+                    size_t v2 = positions[j].vertex;
+                    if (redundant_vertexes[v2]) continue;
+                    // ...that isn't redudnant
                     
-                        if (redundant_vertexes.count(v2)) continue;
-                        // ...that isn't redudnant
-                    
-                        // if this is an allowable transition, run the weighting function on it
-                        if (!seen.count(make_pair(v1, v2))
-                            && v1->next_cost.size() < max_connections
-                            && v2->prev_cost.size() < max_connections) {
-                            // There are not too many connections yet
-                            seen.insert(make_pair(v1, v2));
-                            if (v1->mem.fragment < v2->mem.fragment
-                                || v1->mem.fragment == v2->mem.fragment && v1->mem.begin < v2->mem.begin) {
-                                // Transition is allowable because the first comes before the second
+                    auto& m1 = model[v1];
+                    auto& m2 = model[v2];
+                    auto& mem1 = mem_of(v1);
+                    auto& mem2 = mem_of(v2);
+                    // if this is an allowable transition, run the weighting function on it
+                    if (!seen.count(make_pair(v1, v2))
+                        && m1.next_count < (size_t) max_connections
+                        && m2.prev_count < (size_t) max_connections) {
+                        // There are not too many connections yet
+                        seen.insert(make_pair(v1, v2));
+                        if (mem1.fragment < mem2.fragment
+                            || mem1.fragment == mem2.fragment && mem1.begin < mem2.begin) {
+                            // Transition is allowable because the first comes before the second
                             
-                                double weight = transition_weight(v1->mem, v2->mem);
-                                if (weight > -std::numeric_limits<double>::max()) {
-                                    v1->next_cost.push_back(make_pair(&*v2, weight));
-                                    v2->prev_cost.push_back(make_pair(&*v1, weight));
-                                }
-                            } else if (v1->mem.fragment > v2->mem.fragment
-                                       || v1->mem.fragment == v2->mem.fragment && v1->mem.begin > v2->mem.begin) {
-                                // Really we want to think about the transition going the other way
+                            double weight = transition_weight(*this, v1, v2);
+                            if (weight > -std::numeric_limits<double>::max()) {
+                                connect(v1, v2, weight);
+                            }
+                        } else if (mem1.fragment > mem2.fragment
+                                   || mem1.fragment == mem2.fragment && mem1.begin > mem2.begin) {
+                            // Really we want to think about the transition going the other way
                             
-                                double weight = transition_weight(v2->mem, v1->mem);
-                                if (weight > -std::numeric_limits<double>::max()) {
-                                    v2->next_cost.push_back(make_pair(&*v1, weight));
-                                    v1->prev_cost.push_back(make_pair(&*v2, weight));
-                                }
+                            double weight = transition_weight(*this, v2, v1);
+                            if (weight > -std::numeric_limits<double>::max()) {
+                                connect(v2, v1, weight);
                             }
                         }
                     }
@@ -170,30 +238,92 @@ MEMChainModel::MEMChainModel(
             }
         }
     }
+    // lay the transitions out grouped by the vertex they go into, in the order they were made
+    size_t offset = 0;
+    for (auto& m : model) {
+        m.prev_begin = offset;
+        m.prev_end = offset;
+        offset += m.prev_count;
+    }
+    transitions.resize(made.size());
+    for (auto& transition : made) {
+        transitions[model[transition.to].prev_end++] = transition;
+    }
+}
+
+MEMChainModel::~MEMChainModel(void) {
+    if (arena) {
+        // hand the storage back for the next model built on this thread
+        model.clear();
+        mems.clear();
+        hit_positions.clear();
+        transitions.clear();
+        positions.clear();
+        redundant_vertexes.clear();
+        model.swap(arena->model);
+        mems.swap(arena->mems);
+        hit_positions.swap(arena->hit_positions);
+        transitions.swap(arena->transitions);
+        positions.swap(arena->positions);
+        redundant_vertexes.swap(arena->redundant_vertexes);
+        free_arenas.push_back(move(arena));
+    }
+}
+
+const MaximalExactMatch& MEMChainModel::mem_of(size_t vertex) const {
+    return mems[model[vertex].mem];
+}
+
+pos_t MEMChainModel::position_of(size_t vertex) const {
+    return make_pos_t(model[vertex].node);
+}
+
+pair<int64_t, int64_t> MEMChainModel::min_oriented_distances(size_t v1, size_t v2) const {
+    int64_t distance_same = std::numeric_limits<int64_t>::max();
+    int64_t distance_diff = std::numeric_limits<int64_t>::max();
+    auto& m1 = model[v1];
+    auto& m2 = model[v2];
+    for (size_t i = m1.positions_begin; i < m1.positions_end; ++i) {
+        auto& p1 = hit_positions[i];
+        for (size_t j = m2.positions_begin; j < m2.positions_end; ++j) {
+            auto& p2 = hit_positions[j];
+            // path names are shared, so the same path is the same pointer
+            if (p1.path != p2.path) continue;
+            int64_t proposal = abs(p1.offset - p2.offset);
+            if (p1.is_rev == p2.is_rev) {
+                distance_same = min(distance_same, proposal);
+            } else {
+                distance_diff = min(distance_diff, proposal);
+            }
+        }
+    }
+    return make_pair(distance_same, distance_diff);
 }
 
-void MEMChainModel::score(const unordered_set<MEMChainModelVertex*>& exclude) {
+void MEMChainModel::score(const vector<bool>& exclude) {
     // propagate the scores in the model
-    for (auto& m : model) {
+    for (size_t i = 0; i < model.size(); ++i) {
+        auto& m = model[i];
         // score is equal to the max inbound + mem.weight
-        if (exclude.count(&m)) continue; // skip if vertex was whole cluster
+        if (exclude[i]) continue; // skip if vertex was whole cluster
         m.score = m.weight;
-        for (auto& p : m.prev_cost) {
-            if (p.first == nullptr) continue; // this transition is masked out
-            double proposal = m.weight + p.second + p.first->score;
+        for (size_t t = m.prev_begin; t < m.prev_end; ++t) {
+            auto& transition = transitions[t];
+            if (transition.masked) continue; // this transition is masked out
+            double proposal = m.weight + transition.weight + model[transition.from].score;
             if (proposal > m.score) {
-                m.prev = p.first;
+                m.prev = transition.from;
                 m.score = proposal;
             }
         }
     }
 }
 
-MEMChainModelVertex* MEMChainModel::max_vertex(void) {
-    MEMChainModelVertex* maxv = nullptr;
-    for (auto& m : model) {
-        if (maxv == nullptr || m.score > maxv->score) {
-            maxv = &m;
+size_t MEMChainModel::max_vertex(void) {
+    size_t maxv = no_vertex;
+    for (size_t i = 0; i < model.size(); ++i) {
+        if (maxv == no_vertex || model[i].score > model[maxv].score) {
+            maxv = i;
         }
     }
     return maxv;
@@ -202,15 +332,18 @@ MEMChainModelVertex* MEMChainModel::max_vertex(void) {
 void MEMChainModel::clear_scores(void) {
     for (auto& m : model) {
         m.score = 0;
-        m.prev = nullptr;
+        m.prev = no_vertex;
     }
 }
 
 vector<vector<MaximalExactMatch> > MEMChainModel::traceback(int alt_alns, bool paired, bool debug) {
+    VG_TIME_STAGE(STAGE_CLUSTERING);
     vector<vector<MaximalExactMatch> > traces;
     traces.reserve(alt_alns); // avoid reallocs so we can refer to pointers to the traces
-    unordered_set<MEMChainModelVertex*> exclude;
-    for (auto& v : redundant_vertexes) exclude.insert(&*v);
+    vector<bool> exclude = redundant_vertexes;
+    // fill this out when we're paired to help mask out in-fragment transitions
+    vector<bool> chain_members(paired ? model.size() : 0, false);
+    vector<size_t> vertex_trace;
     for (int i = 0; i < alt_alns; ++i) {
         // score the model, accounting for excluded traces
         clear_scores();
@@ -224,94 +357,89 @@ vector<vector<MaximalExactMatch> > MEMChainModel::traceback(int alt_alns, bool p
             }
         }
 #endif
-        vector<MEMChainModelVertex*> vertex_trace;
+        vertex_trace.clear();
         {
             // find the maximum score
-            auto* vertex = max_vertex();
+            size_t vertex = max_vertex();
             // check if we've exhausted our MEMs
-            if (vertex == nullptr || vertex->score == 0) break;
+            if (vertex == no_vertex || model[vertex].score == 0) break;
 #ifdef debug_mapper
 #pragma omp critical
             {
-                if (debug) cerr << "maximum score " << vertex->mem.sequence() << " " << vertex << ":" << vertex->score << endl;
+                if (debug) cerr << "maximum score " << mem_of(vertex).sequence() << " " << vertex << ":" << model[vertex].score << endl;
             }
 #endif
             // make trace
-            while (vertex != nullptr) {
+            while (vertex != no_vertex) {
                 vertex_trace.push_back(vertex);
-                if (vertex->prev != nullptr) {
-                    vertex = vertex->prev;
-                } else {
-                    break;
-                }
+                vertex = model[vertex].prev;
             }
         }
         // if we have a singular match or reads are not paired, record not to use it again
         if (paired && vertex_trace.size() == 1) {
-            exclude.insert(vertex_trace.front());
+            exclude[vertex_trace.front()] = true;
         }
-        // fill this out when we're paired to help mask out in-fragment transitions
-        unordered_set<MEMChainModelVertex*> chain_members;
-        if (paired) for (auto v : vertex_trace) chain_members.insert(v);
+        if (paired) for (auto v : vertex_trace) chain_members[v] = true;
         traces.emplace_back();
         auto& mem_trace = traces.back();
         for (auto v = vertex_trace.rbegin(); v != vertex_trace.rend(); ++v) {
-            auto& vertex = **v;
-            if (!paired) exclude.insert(&vertex);
+            auto& vertex = model[*v];
+            if (!paired) exclude[*v] = true;
             if (v != vertex_trace.rbegin()) {
                 auto y = v - 1;
-                MEMChainModelVertex* prev = *y;
+                size_t prev = *y;
                 // mask out used transitions
-                for (auto& p : vertex.prev_cost) {
-                    if (p.first == prev) {
-                        p.first = nullptr;
-                    } else if (paired && p.first != nullptr
-                               && p.first->mem.fragment != vertex.mem.fragment
-                               && chain_members.count(p.first)) {
-                        p.first = nullptr;
+                for (size_t t = vertex.prev_begin; t < vertex.prev_end; ++t) {
+                    auto& transition = transitions[t];
+                    if (transition.masked) continue;
+                    if (transition.from == prev) {
+                        transition.masked = true;
+                    } else if (paired
+                               && mem_of(transition.from).fragment != mem_of(*v).fragment
+                               && chain_members[transition.from]) {
+                        transition.masked = true;
                     }
                 }
             }
-            mem_trace.push_back(vertex.mem);
+            // only now give the MEM this vertex's hit and its path positions
+            mem_trace.push_back(mems[vertex.mem]);
+            auto& mem = mem_trace.back();
+            mem.nodes.push_back(vertex.node);
+            for (size_t j = vertex.positions_begin; j < vertex.positions_end; ++j) {
+                auto& hit_pos = hit_positions[j];
+                mem.positions[*hit_pos.path].push_back(make_pair((size_t) hit_pos.offset, hit_pos.is_rev));
+            }
         }
+        if (paired) for (auto v : vertex_trace) chain_members[v] = false;
     }
     return traces;
 }
 
 // show model
 void MEMChainModel::display(ostream& out) {
-    for (auto& vertex : model) {
-        out << vertex.mem.sequence() << ":" << vertex.mem.fragment << " " << &vertex << ":" << vertex.score << "@";
-        for (auto& node : vertex.mem.nodes) {
-            id_t id = gcsa::Node::id(node);
-            size_t offset = gcsa::Node::offset(node);
-            bool is_rev = gcsa::Node::rc(node);
-            out << id << (is_rev ? "-" : "+") << ":" << offset << " ";
-        }
+    auto show_nodes = [&](const MEMChainModelVertex& vertex) {
+        id_t id = gcsa::Node::id(vertex.node);
+        size_t offset = gcsa::Node::offset(vertex.node);
+        bool is_rev = gcsa::Node::rc(vertex.node);
+        out << id << (is_rev ? "-" : "+") << ":" << offset << " ";
+    };
+    for (size_t i = 0; i < model.size(); ++i) {
+        auto& vertex = model[i];
+        out << mem_of(i).sequence() << ":" << mem_of(i).fragment << " " << i << ":" << vertex.score << "@";
+        show_nodes(vertex);
         out << "prev: ";
-        for (auto& p : vertex.prev_cost) {
-            auto& next = p.first;
-            if (p.first == nullptr) continue;
-            out << p.first << ":" << p.second << "@";
-            for (auto& node : next->mem.nodes) {
-                id_t id = gcsa::Node::id(node);
-                size_t offset = gcsa::Node::offset(node);
-                bool is_rev = gcsa::Node::rc(node);
-                out << id << (is_rev ? "-" : "+") << ":" << offset << " ";
-            }
+        for (size_t t = vertex.prev_begin; t < vertex.prev_end; ++t) {
+            auto& transition = transitions[t];
+            if (transition.masked) continue;
+            out << transition.from << ":" << transition.weight << "@";
+            show_nodes(model[transition.from]);
             out << " ; ";
         }
         out << " next: ";
-        for (auto& p : vertex.next_cost) {
-            auto& next = p.first;
-            if (p.first == nullptr) continue;
-            out << p.first << ":" << p.second << "@";
-            for (auto& node : next->mem.nodes) {
-                id_t id = gcsa::Node::id(node);
-                size_t offset = gcsa::Node::offset(node);
-                bool is_rev = gcsa::Node::rc(node);
-                out << id << (is_rev ? "-" : "+") << ":" << offset << " ";
-            }
+        for (auto& transition : transitions) {
+            if (transition.from != i || transition.masked) continue;
+            out << transition.to << ":" << transition.weight << "@";
+            show_nodes(model[transition.to]);
             out << " ; ";
         }
         out << endl;
@@ -432,6 +560,7 @@ OrientedDistanceClusterer::OrientedDistanceClusterer(const Alignment& alignment,
                                                      paths_of_node_memo_t* paths_of_node_memo,
                                                      oriented_occurences_memo_t* oriented_occurences_memo,
                                                      handle_memo_t* handle_memo) : aligner(aligner), qual_adj_aligner(qual_adj_aligner) {
+    VG_TIME_STAGE(STAGE_CLUSTERING);
     
     // there generally will be at least as many nodes as MEMs, so we can speed up the reallocation
     nodes.reserve(mems.size());
@@ -1790,6 +1919,7 @@ vector<OrientedDistanceClusterer::cluster_t> OrientedDistanceClusterer::clusters
                                                                                  int32_t log_likelihood_approx_factor,
                                                                                  size_t min_median_mem_coverage_for_split,
                                                                                  double suboptimal_edge_pruning_factor) {
+    VG_TIME_STAGE(STAGE_CLUSTERING);
     
     vector<vector<pair<const MaximalExactMatch*, pos_t>>> to_return;
     if (nodes.size() == 0) {
@@ -1975,6 +2105,7 @@ vector<pair<pair<size_t, size_t>, int64_t>> OrientedDistanceClusterer::pair_clus
                                                                                      paths_of_node_memo_t* paths_of_node_memo,
                                                                                      oriented_occurences_memo_t* oriented_occurences_memo,
                                                                                      handle_memo_t* handle_memo) {
+    VG_TIME_STAGE(STAGE_CLUSTERING);
     
 #ifdef debug_od_clusterer
     cerr << "beginning clustering of MEM cluster pairs for " << left_clusters.size() << " left clusters and " << right_clusters.size() << " right clusters" << endl;
@@ -2600,6 +2731,7 @@ vector<pair<gcsa::node_type, size_t> > mem_node_start_positions(const xg::XG& xg
 }
 
 Graph cluster_subgraph_walk(const xg::XG& xg, const Alignment& aln, const vector<vg::MaximalExactMatch>& mems, double expansion) {
+    VG_TIME_STAGE(STAGE_SUBGRAPH_EXTRACTION);
     assert(mems.size());
     auto& start_mem = mems.front();
     auto start_pos = make_pos_t(start_mem.nodes.front());
@@ -2646,6 +2778,7 @@ Graph cluster_subgraph_walk(const xg::XG& xg, const Alignment& aln, const vector
 }
 
 Graph cluster_subgraph(const xg::XG& xg, const Alignment& aln, const vector<vg::MaximalExactMatch>& mems, double expansion) {
+    VG_TIME_STAGE(STAGE_SUBGRAPH_EXTRACTION);
     assert(mems.size());
     auto& start_mem = mems.front();
     auto start_pos = make_pos_t(start_mem.nodes.front());
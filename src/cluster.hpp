@@ -15,6 +15,10 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
+#include <memory>
+#include <limits>
+#include <unordered_set>
 
 
 /**
@@ -114,12 +118,23 @@ private:
 
 class MEMChainModelVertex {
 public:
-    MaximalExactMatch mem;
-    vector<pair<MEMChainModelVertex*, double> > next_cost; // for forward
-    vector<pair<MEMChainModelVertex*, double> > prev_cost; // for backward
+    /// Index of the MEM this vertex is a hit of in the model's mems
+    size_t mem;
+    /// The position of this hit in the graph
+    gcsa::node_type node;
+    /// Range of this hit's path positions in the model's hit_positions
+    size_t positions_begin;
+    size_t positions_end;
     double weight;
     double score;
-    MEMChainModelVertex* prev;
+    /// Index of the best previous vertex, or MEMChainModel::no_vertex
+    size_t prev;
+    /// Range of this vertex's inbound transitions in the model's transitions
+    size_t prev_begin;
+    size_t prev_end;
+    /// Number of transitions made into and out of this vertex
+    size_t prev_count;
+    size_t next_count;
     MEMChainModelVertex(void) = default;                                      // Copy constructor
     MEMChainModelVertex(const MEMChainModelVertex&) = default;               // Copy constructor
     MEMChainModelVertex(MEMChainModelVertex&&) = default;                    // Move constructor
@@ -128,25 +143,101 @@ public:
     virtual ~MEMChainModelVertex() { }                     // Destructor
 };
 
+/// A weighted transition between two vertexes of a MEMChainModel, by index
+struct MEMChainModelTransition {
+    size_t from;
+    size_t to;
+    double weight;
+    bool masked;
+};
+
+/// One offset of a hit along a path, or along the approximate linearization
+/// if the path name is empty
+struct MEMChainModelHitPosition {
+    const string* path;
+    int64_t offset;
+    bool is_rev;
+};
+
+/// One approximate position of a vertex along a path, or along the
+/// approximate linearization if the path name is empty
+struct MEMChainModelPosition {
+    const string* path;
+    int64_t offset;
+    size_t vertex;
+};
+
+/**
+ * Chains MEM hits using a banded scan over their positions.
+ *
+ * Vertexes, hits, transitions, and positions are kept in flat arrays and refer
+ * to each other by index. Each vertex is one hit of a MEM; the MEMs are stored
+ * once, without their hit lists, and the hits' path positions are stored in
+ * one array with a range per vertex. The arrays are borrowed from a per-thread arena when
+ * the model is built and handed back when it is destroyed, so mapping a stream
+ * of reads on a thread reuses the same allocations from read to read.
+ */
 class MEMChainModel {
 public:
+    /// Sentinel for the absence of a vertex
+    static const size_t no_vertex = numeric_limits<size_t>::max();
+    
     vector<MEMChainModelVertex> model;
-    map<string, map<int64_t, vector<vector<MEMChainModelVertex>::iterator> > > positions;
-    set<vector<MEMChainModelVertex>::iterator> redundant_vertexes;
+    /// The chained MEMs, without their hits, with their fragment set
+    vector<MaximalExactMatch> mems;
+    /// The path positions of all the hits, in ranges by vertex
+    vector<MEMChainModelHitPosition> hit_positions;
+    /// Transitions, grouped by the vertex they go into
+    vector<MEMChainModelTransition> transitions;
+    /// Vertex positions, sorted by path, offset, and descending MEM length,
+    /// and trimmed to the position depth at each offset
+    vector<MEMChainModelPosition> positions;
+    /// Is each vertex redundant with a longer overlapping one?
+    vector<bool> redundant_vertexes;
     MEMChainModel(
         const vector<size_t>& aln_lengths,
         const vector<vector<MaximalExactMatch> >& matches,
         const function<int64_t(pos_t)>& approx_position,
         const function<map<string, vector<pair<size_t, bool> > >(pos_t)>& path_position,
-        const function<double(const MaximalExactMatch&, const MaximalExactMatch&)>& transition_weight,
+        const function<double(const MEMChainModel&, size_t, size_t)>& transition_weight,
         int band_width = 10,
         int position_depth = 1,
         int max_connections = 20);
-    void score(const unordered_set<MEMChainModelVertex*>& exclude);
-    MEMChainModelVertex* max_vertex(void);
+    ~MEMChainModel(void);
+    /// Get the MEM that a vertex is a hit of. Its nodes are not filled in.
+    const MaximalExactMatch& mem_of(size_t vertex) const;
+    /// Get the position in the graph of a vertex's hit
+    pos_t position_of(size_t vertex) const;
+    /// Get the minimum distance between the hits of two vertexes along the
+    /// paths they share, in the same and in opposite orientations
+    pair<int64_t, int64_t> min_oriented_distances(size_t v1, size_t v2) const;
+    void score(const vector<bool>& exclude);
+    size_t max_vertex(void);
     vector<vector<MaximalExactMatch> > traceback(int alt_alns, bool paired, bool debug);
     void display(ostream& out);
     void clear_scores(void);
+    
+private:
+    
+    /// Reusable storage for the model's arrays
+    struct Arena {
+        vector<MEMChainModelVertex> model;
+        vector<MaximalExactMatch> mems;
+        vector<MEMChainModelHitPosition> hit_positions;
+        vector<MEMChainModelTransition> transitions;
+        vector<MEMChainModelPosition> positions;
+        vector<bool> redundant_vertexes;
+        vector<MEMChainModelTransition> scratch_transitions;
+        vector<pair<size_t, size_t>> position_groups;
+        unordered_set<pair<size_t, size_t>> seen;
+        /// Path names seen on this thread, so hits can point to them
+        set<string> path_names;
+    };
+    
+    /// Arenas that are not in use by any model on this thread
+    static thread_local vector<unique_ptr<Arena>> free_arenas;
+    
+    unique_ptr<Arena> arena;
 };
     
 class OrientedDistanceClusterer {
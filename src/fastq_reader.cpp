@@ -0,0 +1,153 @@
+#include "fastq_reader.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace vg {
+
+using namespace std;
+
+FastqReader::FastqReader(const string& filename, int decompression_threads, size_t buffer_size) :
+    filename(filename), buffer(max<size_t>(buffer_size, 1)) {
+
+    handle = (filename != "-") ? bgzf_open(filename.c_str(), "r") : bgzf_dopen(fileno(stdin), "r");
+    if (handle == nullptr) {
+        cerr << "[vg::fastq_reader.cpp] couldn't open " << filename << endl; exit(1);
+    }
+
+    if (decompression_threads > 1 && bgzf_compression(handle) == 2) {
+        // BGZF blocks are independent, so htslib can inflate them in parallel
+        bgzf_mt(handle, decompression_threads, 256);
+    }
+}
+
+FastqReader::~FastqReader() {
+    bgzf_close(handle);
+}
+
+bool FastqReader::refill() {
+    if (at_eof) {
+        return false;
+    }
+
+    // shift the unconsumed data to the front
+    if (buffer_begin > 0) {
+        memmove(buffer.data(), buffer.data() + buffer_begin, buffer_end - buffer_begin);
+        buffer_end -= buffer_begin;
+        buffer_begin = 0;
+    }
+    if (buffer_end == buffer.size()) {
+        // a single line fills the whole buffer
+        buffer.resize(buffer.size() * 2);
+    }
+
+    ssize_t bytes_read = bgzf_read(handle, buffer.data() + buffer_end, buffer.size() - buffer_end);
+    if (bytes_read < 0) {
+        cerr << "[vg::fastq_reader.cpp] error reading " << filename << endl; exit(1);
+    }
+    if (bytes_read == 0) {
+        at_eof = true;
+        return false;
+    }
+    buffer_end += bytes_read;
+    return true;
+}
+
+bool FastqReader::next_line(const char*& line, size_t& length) {
+
+    size_t search_from = buffer_begin;
+    while (true) {
+        // memchr is vectorized in any reasonable libc
+        const char* newline = (const char*) memchr(buffer.data() + search_from, '\n', buffer_end - search_from);
+        if (newline != nullptr) {
+            line = buffer.data() + buffer_begin;
+            length = newline - line;
+            buffer_begin += length + 1;
+            break;
+        }
+
+        // we don't need to search the bytes we already have again
+        size_t searched = buffer_end - buffer_begin;
+        if (!refill()) {
+            if (buffer_begin == buffer_end) {
+                return false;
+            }
+            // the last line has no terminator
+            line = buffer.data() + buffer_begin;
+            length = buffer_end - buffer_begin;
+            buffer_begin = buffer_end;
+            break;
+        }
+        search_from = buffer_begin + searched;
+    }
+
+    // tolerate DOS line endings
+    if (length > 0 && line[length - 1] == '\r') {
+        length--;
+    }
+    return true;
+}
+
+bool FastqReader::next(Alignment& alignment) {
+
+    const char* line;
+    size_t length;
+
+    // skip any blank lines between records
+    do {
+        if (!next_line(line, length)) {
+            return false;
+        }
+    } while (length == 0);
+
+    // clearing keeps the strings' allocations, so we can refill them without reallocating
+    alignment.Clear();
+
+    // handle name
+    bool is_fasta;
+    if (line[0] == '@') {
+        is_fasta = false;
+    } else if (line[0] == '>') {
+        is_fasta = true;
+    } else {
+        throw runtime_error("Found unexpected delimiter " + string(line, 1) + " in fastq/fasta input");
+    }
+    // trim off leading @ and things after the first whitespace (but keep trailing /1 /2)
+    size_t name_end = 1;
+    while (name_end < length && line[name_end] != ' ' && line[name_end] != '\t') {
+        name_end++;
+    }
+    alignment.set_name(line + 1, name_end - 1);
+
+    // handle sequence
+    if (!next_line(line, length)) {
+        cerr << "[vg::fastq_reader.cpp] error: incomplete fastq record in " << filename << endl; exit(1);
+    }
+    alignment.set_sequence(line, length);
+
+    if (!is_fasta) {
+        // handle "+" sep
+        if (!next_line(line, length)) {
+            cerr << "[vg::fastq_reader.cpp] error: incomplete fastq record in " << filename << endl; exit(1);
+        }
+        // handle quality, converting from Phred+33 in place in the reused string
+        if (!next_line(line, length)) {
+            cerr << "[vg::fastq_reader.cpp] error: incomplete fastq record in " << filename << endl; exit(1);
+        }
+        string& quality = *alignment.mutable_quality();
+        quality.resize(length);
+        for (size_t i = 0; i < length; i++) {
+            quality[i] = line[i] - 33;
+        }
+    }
+
+    return true;
+}
+
+bool FastqReader::next_pair(FastqReader& reader1, FastqReader& reader2, Alignment& mate1, Alignment& mate2) {
+    return reader1.next(mate1) && reader2.next(mate2);
+}
+
+}
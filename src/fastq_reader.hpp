@@ -0,0 +1,75 @@
+#ifndef VG_FASTQ_READER_HPP_INCLUDED
+#define VG_FASTQ_READER_HPP_INCLUDED
+
+/// \file fastq_reader.hpp
+/// Buffered FASTQ/FASTA record reader over (possibly compressed) files
+
+#include <string>
+#include <vector>
+
+#include <htslib/bgzf.h>
+
+#include "vg.pb.h"
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * Reads FASTQ (or single-line FASTA) records into Alignments. Input may be
+ * uncompressed, gzipped, or BGZF-compressed. BGZF input is decompressed by a
+ * pool of htslib worker threads, one block per thread. Records are sliced
+ * straight out of a large decompressed buffer, so no per-line copies or
+ * temporary strings are made, and an Alignment that is passed in repeatedly
+ * reuses its allocated fields.
+ */
+class FastqReader {
+public:
+
+    /// Open the given file ("-" for standard input). Exits with an error if it
+    /// cannot be opened. Up to decompression_threads threads will be used to
+    /// decompress BGZF input.
+    FastqReader(const string& filename, int decompression_threads = 1, size_t buffer_size = 1 << 22);
+    ~FastqReader();
+
+    // Owns a file handle, so can't be copied
+    FastqReader(const FastqReader& other) = delete;
+    FastqReader& operator=(const FastqReader& other) = delete;
+
+    /// Read the next record into the Alignment, replacing its contents.
+    /// Returns false if there are no more records.
+    bool next(Alignment& alignment);
+
+    /// Read the next record from each of two readers, for paired files.
+    /// Returns false if either runs out of records.
+    static bool next_pair(FastqReader& reader1, FastqReader& reader2, Alignment& mate1, Alignment& mate2);
+
+private:
+
+    /// Point at the next line (without its line terminator) in the buffer. The
+    /// line is only valid until the next call. Returns false at end of file.
+    bool next_line(const char*& line, size_t& length);
+
+    /// Move unconsumed data to the front of the buffer and read more after it,
+    /// growing the buffer if it is already full. Returns false if nothing more
+    /// could be read.
+    bool refill();
+
+    /// The open file
+    BGZF* handle = nullptr;
+
+    /// Name of the file, for error messages
+    string filename;
+
+    /// Decompressed data, of which [buffer_begin, buffer_end) is not yet consumed
+    vector<char> buffer;
+    size_t buffer_begin = 0;
+    size_t buffer_end = 0;
+
+    /// Have we read to the end of the file?
+    bool at_eof = false;
+};
+
+}
+
+#endif
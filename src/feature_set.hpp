@@ -79,6 +79,12 @@ public:
      * Get the features on a path. Generally used for testing.
      */
     const vector<Feature>& get_features(const string& path) const;
+    
+    /**
+     * Return true if there are any features on the given path, and false
+     * otherwise.
+     */
+    bool has_features(const string& path) const;
 
 private:
     /// Stores all the loaded features by path name
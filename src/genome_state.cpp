@@ -1,5 +1,6 @@
 #include "genome_state.hpp"
 #include "utility.hpp"
+#include "path.hpp"
 
 #include <signal.h>
 
@@ -12,15 +13,16 @@ SnarlState::SnarlState(const NetGraph* graph) : graph(graph) {
 }
 
 size_t SnarlState::size() const {
-    return haplotypes.size();
+    return lanes.size();
 
 }
 void SnarlState::dump() const {
     // First dump the haplotypes
-    for (size_t i = 0; i < haplotypes.size(); i++) {
+    for (size_t i = 0; i < lanes.size(); i++) {
         cerr << "Haplotype " << i << ":";
         
-        for (auto& record : haplotypes.at(i)) {
+        for (size_t j = lanes[i].first; j < lanes[i].first + lanes[i].second; j++) {
+            auto& record = visits[j];
             cerr << " " << graph->get_id(record.first) << " " << graph->get_is_reverse(record.first)
                 << " at lane " << record.second << ",";
         }
@@ -34,9 +36,9 @@ void SnarlState::dump() const {
         cerr << "Net node " << graph->get_id(kv.first) << " " << graph->get_is_reverse(kv.first) << " lanes:" << endl;
         
         for (size_t i = 0; i < kv.second.size(); i++) {
-            cerr << "\tLane " << i << ": " << graph->get_id(kv.second.at(i)->first)
-                << " " << graph->get_is_reverse(kv.second.at(i)->first)
-                << " at lane " << kv.second.at(i)->second << endl;
+            cerr << "\tLane " << i << ": " << graph->get_id(visits.at(kv.second.at(i)).first)
+                << " " << graph->get_is_reverse(visits.at(kv.second.at(i)).first)
+                << " at lane " << visits.at(kv.second.at(i)).second << endl;
         }
         
     }
@@ -44,23 +46,104 @@ void SnarlState::dump() const {
 }
 
 void SnarlState::trace(size_t overall_lane, bool backward, const function<void(const handle_t&, size_t)>& iteratee) const {
-    // Get the haplotype we want to loop over
-    auto& haplotype = haplotypes.at(overall_lane);
-    
-    auto process_traversal = [&](const pair<handle_t, size_t>& handle_and_lane) {
-        // For every handle in the haplotype, yield it either forward or
-        // backward as determined by our traversal direction.
-        iteratee(backward ? graph->flip(handle_and_lane.first) : handle_and_lane.first, handle_and_lane.second);
-    };
+    // Get the run of the haplotype we want to loop over
+    auto& run = lanes.at(overall_lane);
     
     if (backward) {
-        // If we're going backward, go in reverse order.
-        // See <https://stackoverflow.com/a/23094303>
-        for_each(haplotype.rbegin(), haplotype.rend(), process_traversal);
+        // If we're going backward, go in reverse order, and yield each handle
+        // flipped.
+        for (size_t i = run.first + run.second; i != run.first; i--) {
+            auto& handle_and_lane = visits[i - 1];
+            iteratee(graph->flip(handle_and_lane.first), handle_and_lane.second);
+        }
     } else {
         // Otherwise go in forward order
-        for_each(haplotype.begin(), haplotype.end(), process_traversal);
+        for (size_t i = run.first; i != run.first + run.second; i++) {
+            auto& handle_and_lane = visits[i];
+            iteratee(handle_and_lane.first, handle_and_lane.second);
+        }
+    }
+}
+
+void SnarlState::link(size_t overall_lane, const pair<size_t, size_t>& run) {
+    // TODO: all these inserts at indexes are O(N).
+    
+    // Put the run in at the appropriate index for the overall lane
+    lanes.emplace(lanes.begin() + overall_lane, run);
+    
+    for (size_t i = run.first; i != run.first + run.second; i++) {
+        // For each handle visit
+        auto& handle_visit = visits[i];
+        
+        // Insert the index record at the right place in net_node_lanes
+        auto& node_lanes = net_node_lanes[graph->forward(handle_visit.first)];
+        auto lane_iterator = node_lanes.emplace(node_lanes.begin() + handle_visit.second, i);
+    
+        // Look at whatever is after the lane we just inserted
+        ++lane_iterator;
+        while (lane_iterator != node_lanes.end()) {
+            // Update all the subsequent records in that net node's lane list
+            // and bump up their internal lane assignments
+            visits[*lane_iterator].second++;
+            
+            ++lane_iterator;
+        }
+    }
+}
+
+pair<size_t, size_t> SnarlState::unlink(size_t overall_lane) {
+    auto run = lanes.at(overall_lane);
+    
+    for (size_t i = run.first + run.second; i != run.first; i--) {
+        // Trace from end to start and remove from the net node lanes collections.
+        // We have to do it backward so we can handle duplicate visits properly.
+        auto& handle_visit = visits[i - 1];
+        auto& node_lanes = net_node_lanes[graph->forward(handle_visit.first)];
+        auto lane_iterator = node_lanes.erase(node_lanes.begin() + handle_visit.second);
+        
+        while (lane_iterator != node_lanes.end()) {
+            // Update all the subsequent records in that net node's lane list
+            // and bump down their internal lane assignments
+            visits[*lane_iterator].second--;
+            
+            ++lane_iterator;
+        }
+    }
+    
+    // Drop the lane
+    lanes.erase(lanes.begin() + overall_lane);
+    
+    return run;
+}
+
+void SnarlState::maybe_compact() {
+    if (recording || dead_visits < 1024 || dead_visits * 2 < visits.size()) {
+        // Not worth it, or we need the dead runs for undo
+        return;
+    }
+    
+    // Copy the live runs into a new vector in lane order, and remember where
+    // each visit went.
+    vector<pair<handle_t, size_t>> compacted;
+    compacted.reserve(visits.size() - dead_visits);
+    vector<size_t> new_index(visits.size(), numeric_limits<size_t>::max());
+    for (auto& run : lanes) {
+        size_t new_start = compacted.size();
+        for (size_t i = run.first; i != run.first + run.second; i++) {
+            new_index[i] = compacted.size();
+            compacted.push_back(visits[i]);
+        }
+        run.first = new_start;
+    }
+    
+    for (auto& kv : net_node_lanes) {
+        for (auto& index : kv.second) {
+            index = new_index[index];
+        }
     }
+    
+    visits = std::move(compacted);
+    dead_visits = 0;
 }
 
 void SnarlState::insert(const vector<pair<handle_t, size_t>>& haplotype) {
@@ -87,36 +170,20 @@ void SnarlState::insert(const vector<pair<handle_t, size_t>>& haplotype) {
         throw runtime_error("Tried to insert a haplotype with different lanes at the snarl start and end nodes.");
     }
 
-    // TODO: all these inserts at indexes are O(N).
-
-    // Insert the whole traversal into haplotypes at the appropriate index for the overall lane
+    // Store the whole traversal at the end of the visits, and link it in at
+    // the overall lane
     size_t overall_lane = haplotype.front().second;
     assert(overall_lane == haplotype.back().second);
-    auto inserted = haplotypes.emplace(haplotypes.begin() + overall_lane, haplotype);
+    pair<size_t, size_t> run(visits.size(), haplotype.size());
+    visits.insert(visits.end(), haplotype.begin(), haplotype.end());
+    link(overall_lane, run);
     
-    for (auto it = inserted->begin(); it != inserted->end(); ++it) {
-        // For each handle visit
-        auto& handle_visit = *it;
-        
-        // Insert the iterator record at the right place in net_node_lanes
-        auto& node_lanes = net_node_lanes[graph->forward(handle_visit.first)];
-        auto lane_iterator = node_lanes.emplace(node_lanes.begin() + handle_visit.second, it);
-    
-        // Look at whatever is after the lane we just inserted
-        ++lane_iterator;
-        while (lane_iterator != node_lanes.end()) {
-            // Update all the subsequent records in that net node's lane list and bump up their internal lane assignments
-            
-            // First dereference to get the iterator that points to the actual
-            // record, then dereference that, and increment the lane number.
-            (*(*lane_iterator)).second++;
-            
-            ++lane_iterator;
-        }
+    if (recording) {
+        undo_log.push_back(UndoRecord{UndoRecord::INSERTED, overall_lane, 0, run});
     }
 }
 
-const vector<pair<handle_t, size_t>>& SnarlState::append(const vector<handle_t>& haplotype, bool backward) {
+vector<pair<handle_t, size_t>> SnarlState::append(const vector<handle_t>& haplotype, bool backward) {
     assert(!haplotype.empty());
     
     if (backward) {
@@ -131,9 +198,11 @@ const vector<pair<handle_t, size_t>>& SnarlState::append(const vector<handle_t>&
         }
     }
     
-    // Make a new haplotype at the end of our haplotypes vector that's big enough.
-    haplotypes.emplace_back(haplotype.size());
-    auto& inserted = haplotypes.back();
+    // Make a new run at the end of our visits that's big enough, in a new
+    // last lane.
+    pair<size_t, size_t> run(visits.size(), haplotype.size());
+    visits.resize(visits.size() + haplotype.size());
+    lanes.push_back(run);
     
     for (size_t i = backward ? (haplotype.size() - 1) : 0;
         backward ? (i != (size_t) -1) : i < haplotype.size();
@@ -151,30 +220,35 @@ const vector<pair<handle_t, size_t>>& SnarlState::append(const vector<handle_t>&
         
         // Work out where we are putting it. We should insert left to right when
         // going forward, and right to left when going backward.
-        auto inserted_iterator = inserted.begin() + (backward ? haplotype.size() - 1 - i : i);
+        size_t inserted_index = run.first + (backward ? haplotype.size() - 1 - i : i);
+        auto& inserted = visits[inserted_index];
         
         // Save the handle
-        inserted_iterator->first = handle;
+        inserted.first = handle;
         
         // Find the appropriate node lanes collection
         auto& node_lanes = net_node_lanes[graph->forward(handle)];
         // Save the local lane assignment
-        inserted_iterator->second = node_lanes.size();
+        inserted.second = node_lanes.size();
         // And do the insert
-        node_lanes.emplace_back(inserted_iterator);
+        node_lanes.emplace_back(inserted_index);
         
 #ifdef debug
         cerr << "At haplotype position " << i << "/" << haplotype.size()
             << " inserted " << graph->get_id(handle) << " " << graph->get_is_reverse(handle)
-            << " at lane " << inserted_iterator->second << "/" << node_lanes.size() << endl;
+            << " at lane " << inserted.second << "/" << node_lanes.size() << endl;
 #endif
     }
     
-    // Return the completed vector with the lane annotations.
-    return inserted;
+    if (recording) {
+        undo_log.push_back(UndoRecord{UndoRecord::INSERTED, lanes.size() - 1, 0, run});
+    }
+    
+    // Return the completed haplotype with the lane annotations.
+    return vector<pair<handle_t, size_t>>(visits.begin() + run.first, visits.begin() + run.first + run.second);
 }
 
-const vector<pair<handle_t, size_t>>& SnarlState::insert(size_t overall_lane, const vector<handle_t>& haplotype, bool backward) {
+vector<pair<handle_t, size_t>> SnarlState::insert(size_t overall_lane, const vector<handle_t>& haplotype, bool backward) {
     assert(!haplotype.empty());
     
     if (backward) {
@@ -189,8 +263,11 @@ const vector<pair<handle_t, size_t>>& SnarlState::insert(size_t overall_lane, co
         }
     }
     
-    // Insert a haplotype record at the specified overall lane that's big enough.
-    auto& inserted = *haplotypes.emplace(haplotypes.begin() + overall_lane, haplotype.size());
+    // Make a new run at the end of our visits that's big enough, at the
+    // specified overall lane.
+    pair<size_t, size_t> run(visits.size(), haplotype.size());
+    visits.resize(visits.size() + haplotype.size());
+    lanes.emplace(lanes.begin() + overall_lane, run);
     
     for (size_t i = backward ? (haplotype.size() - 1) : 0;
         backward ? (i != (size_t) -1) : i < haplotype.size();
@@ -208,29 +285,29 @@ const vector<pair<handle_t, size_t>>& SnarlState::insert(size_t overall_lane, co
         
         // Work out where we are putting it. We should insert left to right when
         // going forward, and right to left when going backward.
-        auto inserted_iterator = inserted.begin() + + (backward ? haplotype.size() - 1 - i : i);
+        size_t offset = backward ? haplotype.size() - 1 - i : i;
+        size_t inserted_index = run.first + offset;
+        auto& inserted = visits[inserted_index];
         
         // Save the handle
-        inserted_iterator->first = handle;
+        inserted.first = handle;
         
         // Find the appropriate node lanes collection
         auto& node_lanes = net_node_lanes[graph->forward(handle)];
         
-        if (inserted_iterator == inserted.begin() || inserted_iterator + 1 == inserted.end()) {
+        if (offset == 0 || offset + 1 == run.second) {
             // Start and end visits get placed at the predetermined overall_lane
-            inserted_iterator->second = overall_lane;
+            inserted.second = overall_lane;
             
             // Insert at the correct offset
-            auto lane_iterator = node_lanes.emplace(node_lanes.begin() + overall_lane, inserted_iterator);
+            auto lane_iterator = node_lanes.emplace(node_lanes.begin() + overall_lane, inserted_index);
             
             // Look at whatever is after the lane we just inserted
             ++lane_iterator;
             while (lane_iterator != node_lanes.end()) {
-                // Update all the subsequent records in that net node's lane list and bump up their internal lane assignments
-                
-                // First dereference to get the iterator that points to the actual
-                // record, then dereference that, and increment the lane number.
-                (*(*lane_iterator)).second++;
+                // Update all the subsequent records in that net node's lane
+                // list and bump up their internal lane assignments
+                visits[*lane_iterator].second++;
                 
                 ++lane_iterator;
             }
@@ -239,42 +316,34 @@ const vector<pair<handle_t, size_t>>& SnarlState::insert(size_t overall_lane, co
             // Interior visits just get appended, which is simplest. No need to bump anything up.
             
             // Save the local lane assignment
-            inserted_iterator->second = node_lanes.size();
+            inserted.second = node_lanes.size();
             // And do the insert
-            node_lanes.emplace_back(inserted_iterator);
+            node_lanes.emplace_back(inserted_index);
         }
-        
-        // Insert the next handle in the next slot in the haplotype
-        ++inserted_iterator;
     } 
     
+    if (recording) {
+        undo_log.push_back(UndoRecord{UndoRecord::INSERTED, overall_lane, 0, run});
+    }
+    
     // Return the annotated haplotype.
-    return inserted;
+    return vector<pair<handle_t, size_t>>(visits.begin() + run.first, visits.begin() + run.first + run.second);
 }
 
 vector<pair<handle_t, size_t>> SnarlState::erase(size_t overall_lane) {
-    // Copy what we're erasing
-    auto copy = haplotypes.at(overall_lane);
+    // Take the haplotype out of the lanes
+    auto run = unlink(overall_lane);
+    dead_visits += run.second;
     
-    for (auto it = copy.rbegin(); it != copy.rend(); ++it) {
-        // Trace from end to start and remove from the net node lanes collections.
-        // We have to do it backward so we can handle duplicate visits properly.
-        auto& node_lanes = net_node_lanes[graph->forward(it->first)];
-        auto lane_iterator = node_lanes.erase(node_lanes.begin() + it->second);
-        
-        while (lane_iterator != node_lanes.end()) {
-            // Update all the subsequent records in that net node's lane list and bump down their internal lane assignments
-            
-            // First dereference to get the iterator that points to the actual
-            // record, then dereference that, and decrement the lane number.
-            (*(*lane_iterator)).second--;
-            
-            ++lane_iterator;
-        }
+    // Copy what we erased
+    vector<pair<handle_t, size_t>> copy(visits.begin() + run.first, visits.begin() + run.first + run.second);
+    
+    if (recording) {
+        // Keep the run around so we can put it back
+        undo_log.push_back(UndoRecord{UndoRecord::ERASED, overall_lane, 0, run});
+    } else {
+        maybe_compact();
     }
-
-    // Drop the actual haplotype
-    haplotypes.erase(haplotypes.begin() + overall_lane);
     
     // Return the copy
     return copy;
@@ -282,9 +351,12 @@ vector<pair<handle_t, size_t>> SnarlState::erase(size_t overall_lane) {
 
 void SnarlState::swap(size_t lane1, size_t lane2) {
     
+    auto& run1 = lanes.at(lane1);
+    auto& run2 = lanes.at(lane2);
+    
     // Swap the start and end annotation values
-    std::swap(haplotypes.at(lane1).front().second, haplotypes.at(lane2).front().second);
-    std::swap(haplotypes.at(lane1).back().second, haplotypes.at(lane2).back().second);
+    std::swap(visits[run1.first].second, visits[run2.first].second);
+    std::swap(visits[run1.first + run1.second - 1].second, visits[run2.first + run2.second - 1].second);
     
     // Swap the start net node index entries
     auto& start_node_lanes = net_node_lanes[graph->forward(graph->get_start())];
@@ -294,8 +366,50 @@ void SnarlState::swap(size_t lane1, size_t lane2) {
     auto& end_node_lanes = net_node_lanes[graph->forward(graph->get_end())];
     std::swap(end_node_lanes.at(lane1), end_node_lanes.at(lane2));
     
-    // Swap the actual haplotype vectors
-    std::swap(haplotypes.at(lane1), haplotypes.at(lane2));
+    // Swap the actual haplotype runs
+    std::swap(run1, run2);
+    
+    if (recording) {
+        undo_log.push_back(UndoRecord{UndoRecord::SWAPPED, lane1, lane2, make_pair(0, 0)});
+    }
+}
+
+void SnarlState::set_recording(bool recording) {
+    this->recording = recording;
+    if (!recording) {
+        undo_log.clear();
+        maybe_compact();
+    }
+}
+
+void SnarlState::undo() {
+    assert(!undo_log.empty());
+    UndoRecord record = undo_log.back();
+    undo_log.pop_back();
+    
+    switch (record.operation) {
+    case UndoRecord::INSERTED:
+        // Take the haplotype back out, and reclaim its visits if they are at the end
+        unlink(record.lane);
+        if (record.run.first + record.run.second == visits.size()) {
+            visits.resize(record.run.first);
+        } else {
+            dead_visits += record.run.second;
+        }
+        break;
+    case UndoRecord::ERASED:
+        // The visits are still stored with their lane annotations, so just
+        // put them back where they were
+        link(record.lane, record.run);
+        dead_visits -= record.run.second;
+        break;
+    case UndoRecord::SWAPPED:
+        // Swapping is its own inverse, but we don't want to log it
+        recording = false;
+        swap(record.lane, record.other_lane);
+        recording = true;
+        break;
+    }
 }
 
 GenomeStateCommand* InsertHaplotypeCommand::execute(GenomeState& state) const {
@@ -393,7 +507,7 @@ ReplaceLocalHaplotypeCommand GenomeState::replace_local_haplotype(const ReplaceL
 #endif
             
             // Remove the haplotype and save a copy
-            auto removed = state.at(snarl).erase(overall_lane);  
+            auto removed = modify(snarl).erase(overall_lane);  
             
             // Save the insertion to do by logging the haplotype with all its
             // tagged lane assignments.
@@ -420,7 +534,7 @@ ReplaceLocalHaplotypeCommand GenomeState::replace_local_haplotype(const ReplaceL
             // For each haplotype we want to add to this snarl, in order...
             
             // Insert the haplotype
-            state.at(snarl).insert(haplotype);  
+            modify(snarl).insert(haplotype);  
             
             // Save the deletion to do by logging the overall lane used.
             haplotype_deletions.emplace_back(haplotype.front().second); 
@@ -450,7 +564,7 @@ DeleteHaplotypeCommand GenomeState::insert_haplotype(const InsertHaplotypeComman
             // For each haplotype we want to add to this snarl, in order...
             
             // Insert the haplotype
-            state.at(snarl).insert(haplotype);  
+            modify(snarl).insert(haplotype);  
             
             // Save the deletion to do by logging the overall lane used.
             haplotype_deletions.emplace_back(haplotype.front().second); 
@@ -484,7 +598,7 @@ InsertHaplotypeCommand GenomeState::delete_haplotype(const DeleteHaplotypeComman
 #endif
             
             // Remove the haplotype and save a copy
-            auto removed = state.at(snarl).erase(overall_lane);  
+            auto removed = modify(snarl).erase(overall_lane);  
             
             // Save the insertion to do by logging the haplotype with all its
             // tagged lane assignments.
@@ -517,7 +631,7 @@ SwapHaplotypesCommand GenomeState::swap_haplotypes(const SwapHaplotypesCommand&
         bool backward = (here.node_id() != next->start().node_id());
         
         // Swap the lanes in this snarl
-        state.at(next).swap(c.to_swap.first, c.to_swap.second);
+        modify(next).swap(c.to_swap.first, c.to_swap.second);
         
         if (next == c.telomere_pair.second) {
             // We just did the last snarl on the chromosome so stop. Don't go
@@ -559,7 +673,7 @@ ReplaceLocalHaplotypeCommand GenomeState::replace_snarl_haplotype(const ReplaceS
 #endif
             
             // Remove the haplotype and save a copy
-            auto removed = state.at(snarl).erase(overall_lane);
+            auto removed = modify(snarl).erase(overall_lane);
             
             for (auto& handle_and_lane : removed) {
                 if (net_graphs.at(snarl).is_child(handle_and_lane.first)) {
@@ -787,6 +901,206 @@ void GenomeState::trace_haplotype(const pair<const Snarl*, const Snarl*>& telome
 }
 
 
+SnarlState& GenomeState::modify(const Snarl* snarl) {
+    if (recording) {
+        undo_log.push_back(snarl);
+    }
+    layout_current = false;
+    return state.at(snarl);
+}
+
+void GenomeState::start_recording() {
+    if (recording) {
+        return;
+    }
+    recording = true;
+    for (auto& kv : state) {
+        kv.second.set_recording(true);
+    }
+}
+
+void GenomeState::stop_recording() {
+    if (!recording) {
+        return;
+    }
+    recording = false;
+    undo_log.clear();
+    for (auto& kv : state) {
+        kv.second.set_recording(false);
+    }
+}
+
+size_t GenomeState::checkpoint() const {
+    assert(recording);
+    return undo_log.size();
+}
+
+void GenomeState::rollback(size_t checkpoint) {
+    assert(recording);
+    while (undo_log.size() > checkpoint) {
+        // Undo changes to snarls in the reverse of the order we made them
+        state.at(undo_log.back()).undo();
+        undo_log.pop_back();
+        layout_current = false;
+    }
+}
+
+vector<double> GenomeState::score_commands(const vector<const GenomeStateCommand*>& commands,
+    const function<double(const GenomeState&)>& score) {
+    
+    bool was_recording = recording;
+    start_recording();
+    
+    vector<double> scores;
+    scores.reserve(commands.size());
+    for (auto* command : commands) {
+        // Apply each command, score it, and roll it back. We don't need the
+        // inverse command it makes.
+        size_t before = checkpoint();
+        delete command->execute(*this);
+        scores.push_back(score(*this));
+        rollback(before);
+    }
+    
+    if (!was_recording) {
+        stop_recording();
+    }
+    
+    return scores;
+}
+
+void GenomeState::build_layout() {
+    layout.clear();
+    layout_bounds.clear();
+    layout_positions.clear();
+    
+    for (auto& telomere_pair : telomeres) {
+        for (size_t lane = 0; lane < count_haplotypes(telomere_pair); lane++) {
+            // Lay out each haplotype after the last
+            layout_bounds.push_back(layout.size());
+            trace_haplotype(telomere_pair, lane, [&](const handle_t& visit) {
+                layout_positions[backing_graph->get_id(visit)].push_back(layout.size());
+                layout.push_back(visit);
+            });
+        }
+    }
+    layout_bounds.push_back(layout.size());
+    
+    layout_current = true;
+}
+
+int32_t GenomeState::optimal_score_on_genome(const MultipathAlignment& multipath_aln) {
+    
+    // must have identified start subpaths before computing optimal score   
+    assert(multipath_aln.start_size() > 0);
+    
+    if (!layout_current) {
+        build_layout();
+    }
+    
+    int32_t optimal_score = 0;
+    
+    // find the places in the layout where the alignment might start, and
+    // whether the haplotype runs along the alignment forward there
+    map<pair<size_t, bool>, vector<int>> candidate_start_positions;
+    for (int i = 0; i < multipath_aln.start_size(); i++) {
+        // a starting subpath in the multipath alignment
+        const Subpath& start_subpath = multipath_aln.subpath(multipath_aln.start(i));
+        const Position& start_pos = start_subpath.path().mapping(0).position();
+        
+        auto found = layout_positions.find(start_pos.node_id());
+        if (found == layout_positions.end()) {
+            continue;
+        }
+        for (size_t position : found->second) {
+            // mark the start locations orientation relative to the start node
+            bool oriented_forward = backing_graph->get_is_reverse(layout[position]) == start_pos.is_reverse();
+            candidate_start_positions[make_pair(position, oriented_forward)].push_back(i);
+        }
+    }
+    
+    // check alignments starting at each position that has a source subpath starting on it
+    for (auto& path_starts : candidate_start_positions) {
+        int64_t start_position = path_starts.first.first;
+        bool oriented_forward = path_starts.first.second;
+        
+        // the alignment has to stay on the haplotype it starts on
+        size_t haplotype = upper_bound(layout_bounds.begin(), layout_bounds.end(), (size_t) start_position)
+            - layout_bounds.begin() - 1;
+        int64_t haplotype_begin = layout_bounds[haplotype];
+        int64_t haplotype_end = layout_bounds[haplotype + 1];
+        
+        // match up forward and backward traversal on the haplotype to forward
+        // and backward traversal through the multipath alignment
+        int64_t step = oriented_forward ? 1 : -1;
+        
+        // initialize dynamic programming structures:
+        // place in the layout corresponding to the beginning of a subpath
+        vector<int64_t> subpath_positions(multipath_aln.subpath_size(), 0);
+        vector<bool> subpath_reached(multipath_aln.subpath_size(), false);
+        // score of the best preceding path before this subpath
+        vector<int32_t> subpath_prefix_score(multipath_aln.subpath_size(), 0);
+        
+        // set DP base case with the subpaths that start at this position
+        for (int i : path_starts.second) {
+            subpath_positions[multipath_aln.start(i)] = start_position;
+            subpath_reached[multipath_aln.start(i)] = true;
+        }
+        
+        for (int i = 0; i < multipath_aln.subpath_size(); i++) {
+            // this subpath may be unreachable from subpaths consistent with the haplotype
+            if (!subpath_reached[i]) {
+                continue;
+            }
+            
+            const Subpath& subpath = multipath_aln.subpath(i);
+            int64_t position = subpath_positions[i];
+            
+            // iterate through mappings in this subpath (assumes one mapping per node)
+            bool subpath_follows_path = true;
+            for (int j = 0; j < subpath.path().mapping_size(); j++, position += step) {
+                // check if mapping corresponds to the next node in the
+                // haplotype in the correct orientation, without running off
+                // either end of it
+                const Position& mapping_pos = subpath.path().mapping(j).position();
+                if (position < haplotype_begin || position >= haplotype_end
+                    || mapping_pos.node_id() != backing_graph->get_id(layout[position])
+                    || ((mapping_pos.is_reverse() == backing_graph->get_is_reverse(layout[position])) != oriented_forward)) {
+                    subpath_follows_path = false;
+                    break;
+                }
+            }
+            
+            // if subpath followed haplotype, extend to subsequent subpaths or record completed alignment
+            if (subpath_follows_path) {
+                int32_t extended_prefix_score = subpath_prefix_score[i] + subpath.score();
+                if (subpath.next_size() == 0) {
+                    // reached a sink subpath (thereby completing an alignment), check for optimality
+                    optimal_score = max(optimal_score, extended_prefix_score);
+                }
+                else {
+                    // check if we moved past a node that the mapping ended in the middle of
+                    Position end_pos = last_path_position(subpath.path());
+                    if (end_pos.offset() != backing_graph->get_length(backing_graph->get_handle(end_pos.node_id()))) {
+                        position -= step;
+                    }
+                    
+                    // mark where the next subpath starts
+                    for (int j = 0; j < subpath.next_size(); j++) {
+                        if (subpath_prefix_score[subpath.next(j)] < extended_prefix_score) {
+                            subpath_prefix_score[subpath.next(j)] = extended_prefix_score;
+                            subpath_positions[subpath.next(j)] = position;
+                            subpath_reached[subpath.next(j)] = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    return optimal_score;
+}
+
 void GenomeState::dump() const {
     for (auto& kv : state) {
         cerr << "State of " << kv.first->start() << " -> " << kv.first->end() << ":" << endl;
@@ -842,7 +1156,7 @@ void GenomeState::insert_handles(const vector<handle_t>& to_add,
             stack.front().second.push_back(next_handle);
             
             // What state do we have to work on?
-            auto& snarl_state = state.at(last_snarl);
+            auto& snarl_state = modify(last_snarl);
             
             // Did we go backward or forward through this child snarl? This only
             // matters to make sure we get the lane assignments right for its
@@ -853,7 +1167,7 @@ void GenomeState::insert_handles(const vector<handle_t>& to_add,
             // Add in its haplotype, and get the resulting lane assignments.
             // Make sure to insert at the right lane if we are the last thing on
             // the stack (i.e. the top level snarl) and have a particular lane.
-            auto& embedded = (stack.size() == 1 && top_lane != numeric_limits<size_t>::max()) ?
+            auto embedded = (stack.size() == 1 && top_lane != numeric_limits<size_t>::max()) ?
                 snarl_state.insert(top_lane, stack.front().second, backward) :
                 snarl_state.append(stack.front().second, backward);
             
@@ -38,21 +38,58 @@ class SnarlState {
 
 protected:
     
-    // This stores, for each overall lane, the traversal in that lane, annotated with its internal lane assignments
-    vector<vector<pair<handle_t, size_t>>> haplotypes;
+    // This stores the visits of all the haplotypes, annotated with their
+    // internal lane assignments. Each haplotype occupies a contiguous run.
+    // Runs of erased haplotypes stay in place until we compact.
+    vector<pair<handle_t, size_t>> visits;
+    
+    // This stores, for each overall lane, the start and length of the run in
+    // visits for the traversal in that lane. Inserting, erasing, and swapping
+    // haplotypes only moves these small records around.
+    vector<pair<size_t, size_t>> lanes;
     
     // This stores, for each forward handle, a vector of all the lanes in order.
-    // Each lane is holding an iterator to the entry in the haplotyope that
-    // occupies that lane. When we insert into or delete out of the vectors in
-    // this map, we update the lane numbers where all the iterators point. TODO:
-    // really we need to hold skip lists or something; we need efficient insert
-    // at index. But since we still need to pay O(N) fixing up stuff after the
-    // insert, it might not be worth it.
-    unordered_map<handle_t, vector<decltype(haplotypes)::value_type::iterator>> net_node_lanes;
+    // Each lane is holding the index in visits of the visit that occupies that
+    // lane. When we insert into or delete out of the vectors in this map, we
+    // update the lane numbers of all the visits after. TODO: really we need to
+    // hold skip lists or something; we need efficient insert at index. But
+    // since we still need to pay O(N) fixing up stuff after the insert, it
+    // might not be worth it.
+    unordered_map<handle_t, vector<size_t>> net_node_lanes;
+    
+    /// How many entries in visits belong to erased haplotypes?
+    size_t dead_visits = 0;
+    
+    /// An operation that we can undo. Undoing an erase relinks the erased
+    /// run, so entries never hold copies of haplotypes.
+    struct UndoRecord {
+        enum {INSERTED, ERASED, SWAPPED} operation;
+        size_t lane;
+        size_t other_lane;
+        pair<size_t, size_t> run;
+    };
+    
+    /// The operations we can undo, most recent last
+    vector<UndoRecord> undo_log;
+    
+    /// Are we logging operations for undo?
+    bool recording = false;
     
     /// We need to keep track of the net graph, because we may need to traverse
     /// haplotypes forward or reverse and we need to flip things.
     const NetGraph* graph;
+    
+    /// Put the run of visits with the given start and length in the given
+    /// overall lane, at the internal lanes that the visits are annotated with.
+    void link(size_t overall_lane, const pair<size_t, size_t>& run);
+    
+    /// Take the haplotype in the given overall lane out of the lanes, leaving
+    /// its visits stored, and return its run.
+    pair<size_t, size_t> unlink(size_t overall_lane);
+    
+    /// Drop the stored visits of erased haplotypes, if there are enough of them
+    /// and we don't need them for undo.
+    void maybe_compact();
 
 public:
     
@@ -84,7 +121,7 @@ public:
     /// handle to the next available lane. Returns the haplotype annotated with
     /// lane assignments. If handles to the same node or child snarl appear more
     /// than once, their lane numbers will be strictly increasing.
-    const vector<pair<handle_t, size_t>>& append(const vector<handle_t>& haplotype, bool backward = false);
+    vector<pair<handle_t, size_t>> append(const vector<handle_t>& haplotype, bool backward = false);
     
     /// Insert the given traversal of this snarl from start to end or end to
     /// start (as determined by the backward flag), assigning it to the given
@@ -94,7 +131,7 @@ public:
     /// at the right lanes. If handles to the same node or child snarl appear
     /// more than once, their assigned lane numbers will be strictly increasing.
     /// Returns the haplotype annotated with lane assignments.
-    const vector<pair<handle_t, size_t>>& insert(size_t overall_lane, const vector<handle_t>& haplotype, bool backward = false);
+    vector<pair<handle_t, size_t>> insert(size_t overall_lane, const vector<handle_t>& haplotype, bool backward = false);
     
     // TODO: can we do an efficient replace? Or should we just drop and add.
     
@@ -108,6 +145,13 @@ public:
     /// affected.
     void swap(size_t lane1, size_t lane2);
     
+    /// Start or stop logging operations so they can be undone. Stopping
+    /// forgets the log.
+    void set_recording(bool recording);
+    
+    /// Undo the most recent logged operation.
+    void undo();
+    
 };
 
 class GenomeState;
@@ -283,6 +327,34 @@ public:
     /// handle.
     void trace_haplotype(const pair<const Snarl*, const Snarl*>& telomere_pair,
         size_t overall_lane, const function<void(const handle_t&)>& iteratee) const;
+    
+    // Changes can be rolled back cheaply while we are recording, without
+    // executing inverse commands.
+    
+    /// Start logging changes so that they can be rolled back.
+    void start_recording();
+    
+    /// Stop logging changes, and forget how to roll back the ones logged.
+    void stop_recording();
+    
+    /// Get a checkpoint to roll back to. Must be recording.
+    size_t checkpoint() const;
+    
+    /// Undo all the changes made since the given checkpoint.
+    void rollback(size_t checkpoint);
+    
+    /// Score the state that each of the given commands would produce, in turn,
+    /// with the given function, and leave the state as it was. Returns the
+    /// scores in the order of the commands. Use this to evaluate many proposed
+    /// swaps or local replacements in a batch.
+    vector<double> score_commands(const vector<const GenomeStateCommand*>& commands,
+        const function<double(const GenomeState&)>& score);
+    
+    /// Get the highest score of the multipath alignment along any haplotype
+    /// in the genome, following the same rules as
+    /// PhasedGenome::optimal_score_on_genome(). The haplotypes are traced into
+    /// a flat array for this, which is reused until the state changes.
+    int32_t optimal_score_on_genome(const MultipathAlignment& multipath_aln);
      
 protected:
     /// We keep track of pairs of telomere snarls. The haplotypes we work on
@@ -307,6 +379,30 @@ protected:
     /// snarl.
     const SnarlManager& manager;
     
+    /// Holds, in order, the snarls changed by each logged change
+    vector<const Snarl*> undo_log;
+    
+    /// Are we logging changes?
+    bool recording = false;
+    
+    /// Get the state of a snarl to change it once, logging the change
+    SnarlState& modify(const Snarl* snarl);
+    
+    /// All the haplotypes, traced into the backing graph and laid end to end
+    vector<handle_t> layout;
+    
+    /// Where each haplotype starts in the layout, with a past-the-end entry
+    vector<size_t> layout_bounds;
+    
+    /// Where each node ID is visited in the layout
+    unordered_map<id_t, vector<size_t>> layout_positions;
+    
+    /// Does the layout reflect the current haplotypes?
+    bool layout_current = false;
+    
+    /// Trace all the haplotypes into the layout
+    void build_layout();
+    
     /// We have a generic stack-based handle-vector-to-per-snarl-haplotypes
     /// insertion walker function. The handles to add have to span one or more
     /// entire snarls, and we specify the lane in the spanned snarls to put them
@@ -1131,4 +1131,356 @@ void graph_to_gfa(const VG* graph, ostream& out) {
     //gg.output_to_stream(cout);
 }
 
+/// One parsed line of a blunt-ended GFA, with names not yet translated to IDs
+struct BluntGFARecord {
+    /// 'S', 'L' or 'P' for records we use, 0 for lines we skip
+    char type = 0;
+    /// Segment name, link source, or path name
+    string name;
+    /// Segment sequence
+    string sequence;
+    /// Link sink
+    string sink_name;
+    bool source_reverse = false;
+    bool sink_reverse = false;
+    /// Path steps, with the rank of the first one
+    vector<pair<string, bool>> visits;
+    int64_t first_rank = 1;
+    /// Did we parse the line successfully?
+    bool valid = true;
+    /// Does the line need overlap resolution that we can't do in a stream?
+    bool blunt = true;
+};
+
+/// Is the given GFA overlap field blunt?
+static bool is_blunt_overlap(const string& overlap) {
+    return overlap.empty() || overlap == "*" || overlap == "0M";
+}
+
+/// Parse a line of GFA 1.0 (or the GFA 0.1 per-segment P lines) for streaming import
+static void parse_blunt_gfa_line(const string& line, BluntGFARecord& record) {
+    record = BluntGFARecord();
+    
+    vector<string> fields = split_delims(line, "\t");
+    if (fields.empty() || fields[0].size() != 1) {
+        return;
+    }
+    
+    switch (fields[0][0]) {
+    case 'S':
+        if (fields.size() < 3) {
+            record.valid = false;
+            return;
+        }
+        record.type = 'S';
+        record.name = move(fields[1]);
+        record.sequence = move(fields[2]);
+        break;
+    case 'L':
+        if (fields.size() < 5 || fields[2].size() != 1 || fields[4].size() != 1) {
+            record.valid = false;
+            return;
+        }
+        record.type = 'L';
+        record.name = move(fields[1]);
+        record.source_reverse = fields[2][0] == '-';
+        record.sink_name = move(fields[3]);
+        record.sink_reverse = fields[4][0] == '-';
+        record.blunt = fields.size() < 6 || is_blunt_overlap(fields[5]);
+        break;
+    case 'P':
+        record.type = 'P';
+        if (fields.size() >= 6 && fields[4].size() == 1 && (fields[4][0] == '+' || fields[4][0] == '-')
+            && !fields[3].empty() && all_of(fields[3].begin(), fields[3].end(), ::isdigit)) {
+            // GFA 0.1 has one line per path step: P segment path rank orientation overlap
+            record.name = move(fields[2]);
+            record.first_rank = stoll(fields[3]);
+            record.visits.emplace_back(move(fields[1]), fields[4][0] == '-');
+        }
+        else if (fields.size() >= 3) {
+            // GFA 1.0 has one line per path: P path 1+,2-,3+ overlaps
+            // We don't read the overlaps, since vg has traditionally written node lengths there.
+            record.name = move(fields[1]);
+            for (auto& step : split_delims(fields[2], ",")) {
+                if (step.size() < 2 || (step.back() != '+' && step.back() != '-')) {
+                    record.valid = false;
+                    return;
+                }
+                record.visits.emplace_back(step.substr(0, step.size() - 1), step.back() == '-');
+            }
+        }
+        else {
+            record.valid = false;
+        }
+        break;
+    case 'C':
+        // containment needs the pinch graph
+        record.blunt = false;
+        break;
+    default:
+        // headers, comments and anything else carry nothing we import
+        break;
+    }
+}
+
+/// Collect the names of all the segments in a GFA, reading to the end of the stream
+static vector<string> scan_gfa_segment_names(istream& in) {
+    vector<string> names;
+    string line;
+    while (getline(in, line)) {
+        if (line.size() > 2 && line[0] == 'S' && line[1] == '\t') {
+            size_t end = line.find('\t', 2);
+            names.push_back(line.substr(2, end == string::npos ? string::npos : end - 2));
+        }
+    }
+    return names;
+}
+
+/// Is the given GFA segment name one we can use as a node ID?
+static bool is_numeric_gfa_name(const string& name) {
+    return !name.empty() && name.size() < 19 && all_of(name.begin(), name.end(), ::isdigit) && stoll(name) > 0;
+}
+
+bool gfa_for_each_chunk(istream& in, const function<void(Graph&)>& lambda, size_t chunk_size) {
+    
+    // How many lines do we parse in parallel at once?
+    const size_t batch_size = max<size_t>(chunk_size, 1) * 16;
+    
+    // Where the GFA starts, in case we need to come back for the segment names
+    streampos start = in.tellg();
+    
+    // Segment names are either all positive integers, which we use as IDs, or
+    // all something else, which we number 1, 2, 3, ... in sorted order, like
+    // gfa_to_graph does.
+    bool decided_numeric = false;
+    bool numeric_names = false;
+    vector<string> sorted_names;
+    // With numeric names, the segment IDs we have seen, and the IDs links and
+    // paths refer to, to check at the end.
+    vector<id_t> segment_ids;
+    vector<id_t> referenced_ids;
+    size_t referenced_compacted = 0;
+    bool names_ok = true;
+    
+    auto get_id = [&](const string& name, bool is_segment) -> id_t {
+        if (numeric_names) {
+            if (!is_numeric_gfa_name(name)) {
+                // names must be all numeric or all not
+                names_ok = false;
+                return 0;
+            }
+            id_t id = stoll(name);
+            if (is_segment) {
+                segment_ids.push_back(id);
+            }
+            else {
+                referenced_ids.push_back(id);
+                if (referenced_ids.size() >= 2 * referenced_compacted + 1024) {
+                    // Paths visit the same nodes over and over, so keep this small
+                    sort(referenced_ids.begin(), referenced_ids.end());
+                    referenced_ids.erase(unique(referenced_ids.begin(), referenced_ids.end()), referenced_ids.end());
+                    referenced_compacted = referenced_ids.size();
+                }
+            }
+            return id;
+        }
+        auto found = lower_bound(sorted_names.begin(), sorted_names.end(), name);
+        if (found == sorted_names.end() || *found != name || is_numeric_gfa_name(name)) {
+            // the segment doesn't exist, or names are mixed
+            names_ok = false;
+            return 0;
+        }
+        return found - sorted_names.begin() + 1;
+    };
+    
+    // Work out how to name segments from the first one we see, given where to
+    // pick up reading if we have to go back for all the names.
+    auto decide_naming = [&](const string& name, bool at_end, streampos resume) {
+        decided_numeric = true;
+        numeric_names = is_numeric_gfa_name(name);
+        if (numeric_names) {
+            return true;
+        }
+        if (start == streampos(-1)) {
+            // We can't go back for the names on a pipe
+            return false;
+        }
+        in.clear();
+        in.seekg(start);
+        sorted_names = scan_gfa_segment_names(in);
+        sort(sorted_names.begin(), sorted_names.end());
+        sorted_names.erase(unique(sorted_names.begin(), sorted_names.end()), sorted_names.end());
+        if (!at_end) {
+            in.clear();
+            in.seekg(resume);
+        }
+        return true;
+    };
+    
+    Graph chunk;
+    size_t chunk_records = 0;
+    auto flush_chunk = [&]() {
+        if (chunk_records > 0) {
+            lambda(chunk);
+            chunk.Clear();
+            chunk_records = 0;
+        }
+    };
+    
+    vector<string> lines(batch_size);
+    vector<BluntGFARecord> records(batch_size);
+    while (in) {
+        // Read a batch of lines
+        size_t lines_read = 0;
+        while (lines_read < batch_size && getline(in, lines[lines_read])) {
+            lines_read++;
+        }
+        bool at_end = !in;
+        streampos after_batch = at_end ? streampos(-1) : in.tellg();
+        
+        // Parse them in parallel
+#pragma omp parallel for schedule(dynamic, 256)
+        for (size_t i = 0; i < lines_read; i++) {
+            parse_blunt_gfa_line(lines[i], records[i]);
+        }
+        
+        // Translate them into graph chunks in order
+        for (size_t i = 0; i < lines_read; i++) {
+            BluntGFARecord& record = records[i];
+            if (!record.valid || !record.blunt) {
+                // this GFA is malformed or needs overlap resolution
+                return false;
+            }
+            
+            if (!decided_numeric && (record.type == 'S' || record.type == 'L' ||
+                                     (record.type == 'P' && !record.visits.empty()))) {
+                if (!decide_naming(record.type == 'P' ? record.visits.front().first : record.name,
+                                   at_end, after_batch)) {
+                    return false;
+                }
+            }
+            
+            if (record.type == 'S') {
+                Node* node = chunk.add_node();
+                node->set_id(get_id(record.name, true));
+                node->set_sequence(move(record.sequence));
+            }
+            else if (record.type == 'L') {
+                Edge* edge = chunk.add_edge();
+                edge->set_from(get_id(record.name, false));
+                edge->set_from_start(record.source_reverse);
+                edge->set_to(get_id(record.sink_name, false));
+                edge->set_to_end(record.sink_reverse);
+            }
+            else if (record.type == 'P') {
+                Path* path = chunk.add_path();
+                path->set_name(record.name);
+                int64_t rank = record.first_rank;
+                for (auto& visit : record.visits) {
+                    Mapping* mapping = path->add_mapping();
+                    mapping->mutable_position()->set_node_id(get_id(visit.first, false));
+                    mapping->mutable_position()->set_is_reverse(visit.second);
+                    mapping->set_rank(rank++);
+                }
+            }
+            else {
+                continue;
+            }
+            
+            if (!names_ok) {
+                return false;
+            }
+            
+            chunk_records++;
+            if (chunk_records >= chunk_size) {
+                flush_chunk();
+            }
+        }
+    }
+    
+    if (numeric_names) {
+        // Links and paths may only visit segments that exist. We have to check
+        // before the last chunk goes out, so a consumer can't finish a graph
+        // with dangling edges.
+        sort(segment_ids.begin(), segment_ids.end());
+        sort(referenced_ids.begin(), referenced_ids.end());
+        referenced_ids.erase(unique(referenced_ids.begin(), referenced_ids.end()), referenced_ids.end());
+        if (!includes(segment_ids.begin(), segment_ids.end(), referenced_ids.begin(), referenced_ids.end())) {
+            return false;
+        }
+    }
+    
+    flush_chunk();
+    return true;
+}
+
+bool blunt_gfa_to_graph(istream& in, VG* graph) {
+    
+    bool success = gfa_for_each_chunk(in, [&](Graph& chunk) {
+        graph->extend(chunk);
+    });
+    
+    if (!success) {
+        return false;
+    }
+    
+    // Give the full-length mappings their lengths, now that all the nodes are known
+    graph->paths.for_each_mapping([&](mapping_t& mapping) {
+        if (mapping.length == 0) {
+            mapping.length = graph->get_node(mapping.node_id())->sequence().size();
+        }
+    });
+    
+    // Save the paths to the graph
+    graph->paths.sort_by_mapping_rank();
+    graph->paths.rebuild_mapping_aux();
+    graph->paths.to_graph(graph->graph);
+    
+    return true;
+}
+
+void graph_to_gfa(const PathHandleGraph* graph, ostream& out) {
+    out << "H\tVN:Z:1.0" << "\n";
+    
+    graph->for_each_handle([&](const handle_t& handle) {
+        out << "S\t" << graph->get_id(handle) << "\t" << graph->get_sequence(handle) << "\n";
+    });
+    
+    graph->for_each_path_handle([&](const path_handle_t& path_handle) {
+        out << "P\t" << graph->get_path_name(path_handle) << "\t";
+        if (graph->get_occurrence_count(path_handle) == 0) {
+            out << "\t" << "\n";
+            return;
+        }
+        // write the steps, and then the overlaps in the same form as the VG writer
+        stringstream overlaps;
+        occurrence_handle_t occurrence = graph->get_first_occurrence(path_handle);
+        while (true) {
+            handle_t handle = graph->get_occurrence(occurrence);
+            out << graph->get_id(handle) << (graph->get_is_reverse(handle) ? "-" : "+");
+            overlaps << graph->get_length(handle) << "M";
+            if (!graph->has_next_occurrence(occurrence)) {
+                break;
+            }
+            out << ",";
+            overlaps << ",";
+            occurrence = graph->get_next_occurrence(occurrence);
+        }
+        out << "\t" << overlaps.str() << "\n";
+    });
+    
+    graph->for_each_handle([&](const handle_t& handle) {
+        for (const handle_t& side : {handle, graph->flip(handle)}) {
+            graph->follow_edges(side, false, [&](const handle_t& next) {
+                // every edge is seen from both of its ends, so only write it from its canonical end
+                if (graph->edge_handle(side, next) == make_pair(side, next)) {
+                    out << "L\t" << graph->get_id(side) << "\t" << (graph->get_is_reverse(side) ? "-" : "+")
+                        << "\t" << graph->get_id(next) << "\t" << (graph->get_is_reverse(next) ? "-" : "+")
+                        << "\t0M\n";
+                }
+            });
+        }
+    });
+}
+
 }
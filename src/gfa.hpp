@@ -36,6 +36,35 @@ bool gfa_to_graph(istream& in, VG* graph, bool only_perfect_match = false);
 /// Export the given VG graph to the given GFA file.
 void graph_to_gfa(const VG* graph, ostream& out);
 
+/**
+ * Stream a blunt-ended GFA (all link overlaps 0M or *) from the given stream
+ * in one pass, without building an in-memory model of the whole file. Batches
+ * of lines are parsed in parallel and then handed in file order to the
+ * callback as Graph chunks of about chunk_size records, suitable for
+ * VG::extend or XG::from_callback. Path mappings are the full-length matches
+ * with no edits.
+ *
+ * If every segment name is a positive integer, names are used as node IDs.
+ * Otherwise the segments are numbered 1, 2, 3, ... in sorted order of name,
+ * as gfa_to_graph numbers them, which takes an extra pass over the segment
+ * lines and so needs a seekable stream.
+ *
+ * Returns false, after possibly having emitted some chunks, if the GFA has
+ * overlaps or containments that need gfa_to_graph's pinch-based resolution,
+ * if it is malformed, if links or paths refer to segments that it lacks, or
+ * if it has non-numeric names and the stream can't be rewound. Dangling
+ * references are always caught before the last chunk is emitted.
+ */
+bool gfa_for_each_chunk(istream& in, const function<void(Graph&)>& lambda, size_t chunk_size = 1000);
+
+/// Import a blunt-ended GFA into the given (empty) VG with gfa_for_each_chunk.
+/// Returns false if the GFA is not blunt-ended or is malformed.
+bool blunt_gfa_to_graph(istream& in, VG* graph);
+
+/// Export any graph with embedded paths to the given GFA file, one record at
+/// a time.
+void graph_to_gfa(const PathHandleGraph* graph, ostream& out);
+
 
 }
 
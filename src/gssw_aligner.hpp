@@ -147,7 +147,7 @@ namespace vg {
         virtual int32_t score_exact_match(string::const_iterator seq_begin, string::const_iterator seq_end,
                                           string::const_iterator base_qual_begin) const = 0;
         /// Compute the score of a path against the given range of subsequence with the given qualities.
-        virtual int32_t score_partial_alignment(const Alignment& alignment, VG& graph, const Path& path,
+        virtual int32_t score_partial_alignment(const Alignment& alignment, const HandleGraph& graph, const Path& path,
                                                 string::const_iterator seq_begin) const = 0;
         
         /// Returns the score of an insert or deletion of the given length
@@ -323,7 +323,7 @@ namespace vg {
         int32_t score_exact_match(const string& sequence) const;
         int32_t score_exact_match(string::const_iterator seq_begin, string::const_iterator seq_end) const;
 
-        int32_t score_partial_alignment(const Alignment& alignment, VG& graph, const Path& path,
+        int32_t score_partial_alignment(const Alignment& alignment, const HandleGraph& graph, const Path& path,
                                         string::const_iterator seq_begin) const;
     };
 
@@ -364,7 +364,7 @@ namespace vg {
         int32_t score_exact_match(string::const_iterator seq_begin, string::const_iterator seq_end,
                                   string::const_iterator base_qual_begin) const;
         
-        int32_t score_partial_alignment(const Alignment& alignment, VG& graph, const Path& path,
+        int32_t score_partial_alignment(const Alignment& alignment, const HandleGraph& graph, const Path& path,
                                         string::const_iterator seq_begin) const;
         
         uint8_t max_qual_score;
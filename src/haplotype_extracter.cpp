@@ -1,4 +1,5 @@
 #include <iostream>
+#include <algorithm>
 #include "vg.hpp"
 #include "haplotype_extracter.hpp"
 #include "json2pb.h"
@@ -34,7 +35,13 @@ void trace_haplotypes_and_paths(xg::XG& index, const gbwt::GBWT* haplotype_datab
     out_thread_frequencies[out_graph.path(i).name()] = 1;
   }
 
-  // add our haplotypes to the subgraph, naming ith haplotype "thread_i"
+  // add our haplotypes to the subgraph
+  embed_haplotypes(index, haplotypes, out_graph, out_thread_frequencies);
+}
+
+void embed_haplotypes(xg::XG& index, vector<pair<thread_t,int>>& haplotypes,
+                      Graph& out_graph, map<string, int>& out_thread_frequencies) {
+  // naming ith haplotype "thread_i"
   for (int i = 0; i < haplotypes.size(); ++i) {
     Path p = path_from_thread_t(haplotypes[i].first, index);
     p.set_name("thread_" + to_string(i));
@@ -299,4 +306,31 @@ vector<pair<thread_t,int> > list_haplotypes(xg::XG& index, const gbwt::GBWT& hap
   return search_results;
 }
 
+vector<vector<pair<thread_t,int>>> list_haplotypes(xg::XG& index, const gbwt::GBWT& haplotype_database,
+            const vector<pair<vg::id_t,int>>& queries) {
+
+  // chunks often ask the same query, so each distinct one is searched once
+  vector<pair<vg::id_t,int>> distinct_queries(queries);
+  sort(distinct_queries.begin(), distinct_queries.end());
+  distinct_queries.erase(unique(distinct_queries.begin(), distinct_queries.end()), distinct_queries.end());
+
+  vector<vector<pair<thread_t,int>>> distinct_results(distinct_queries.size());
+#pragma omp parallel for schedule(dynamic, 1)
+  for (size_t i = 0; i < distinct_queries.size(); i++) {
+    if (!haplotype_database.contains(gbwt::Node::encode(distinct_queries[i].first, false))) {
+      continue;
+    }
+    xg::XG::ThreadMapping start_node = {distinct_queries[i].first, false};
+    distinct_results[i] = list_haplotypes(index, haplotype_database, start_node, distinct_queries[i].second);
+    sort(distinct_results[i].begin(), distinct_results[i].end());
+  }
+
+  vector<vector<pair<thread_t,int>>> search_results(queries.size());
+  for (size_t i = 0; i < queries.size(); i++) {
+    size_t distinct = lower_bound(distinct_queries.begin(), distinct_queries.end(), queries[i]) - distinct_queries.begin();
+    search_results[i] = distinct_results[distinct];
+  }
+  return search_results;
+}
+
 }
@@ -29,6 +29,11 @@ void trace_haplotypes_and_paths(xg::XG& index, const gbwt::GBWT* haplotype_datab
                                 map<string, int>& out_thread_frequencies,
                                 bool expand_graph = true);
 
+// Embed haplotypes that have already been listed in a graph as Paths named
+// thread_i, recording their frequencies in out_thread_frequencies.
+void embed_haplotypes(xg::XG& index, vector<pair<thread_t,int>>& haplotypes,
+                      Graph& out_graph, map<string, int>& out_thread_frequencies);
+
 // Turns an (xg-based) thread_t into a (vg-based) Path
 Path path_from_thread_t(thread_t& t, xg::XG& index);
 
@@ -46,6 +51,13 @@ vector<pair<thread_t,int> > list_haplotypes(xg::XG& index,
 vector<pair<thread_t,int> > list_haplotypes(xg::XG& index, const gbwt::GBWT& haplotype_database,
             xg::XG::ThreadMapping start_node, int extend_distance);
 
+// For each of a batch of (start node, extend distance) queries, lists the
+// same sub-haplotypes as the single-query GBWT version above, with the same
+// counts, in sorted order. The distinct queries are searched in parallel, each
+// once, with the single-query version.
+vector<vector<pair<thread_t,int>>> list_haplotypes(xg::XG& index, const gbwt::GBWT& haplotype_database,
+            const vector<pair<vg::id_t,int>>& queries);
+
 // writes to subgraph_ostream the subgraph covered by
 // the haplotypes in haplotype_list, as well as these haplotypes embedded as
 // Paths.  Will output in JSON format if json set to true and Protobuf otherwise.
@@ -1,5 +1,9 @@
 #include "index.hpp"
 
+#include <queue>
+#include <fstream>
+#include <cstdlib>
+
 namespace vg {
 
 using namespace std;
@@ -7,6 +11,212 @@ using namespace std;
 // convenience macro for RocksDB error handling
 #define S(x) { rocksdb::Status __s = (x); if (!__s.ok()) throw std::runtime_error("RocksDB operation failed: " + __s.ToString()); }
 
+SSTIngester::SSTIngester(rocksdb::DB* db, const rocksdb::Options& options, const string& work_prefix,
+                         size_t max_buffer_bytes, size_t max_file_bytes) :
+    db(db), options(options), max_file_bytes(max_file_bytes), file_count(0), next_sequence(0) {
+
+    buffers.resize(omp_get_max_threads());
+    max_thread_bytes = max<size_t>(max_buffer_bytes / buffers.size(), 1);
+    string dir_template = work_prefix + ".XXXXXX";
+    if (mkdtemp(&dir_template[0]) == nullptr) {
+        throw std::runtime_error("couldn't create a temporary directory at " + work_prefix);
+    }
+    work_dir = dir_template;
+}
+
+SSTIngester::~SSTIngester(void) {
+    for (auto& class_runs : runs) {
+        for (auto& run_file : class_runs.second) {
+            std::remove(run_file.c_str());
+        }
+    }
+    rmdir(work_dir.c_str());
+}
+
+string SSTIngester::next_file_name(const string& suffix) {
+    return work_dir + "/" + to_string(file_count.fetch_add(1)) + suffix;
+}
+
+void SSTIngester::put(const string& key, const string& value) {
+    size_t thread_num = omp_get_thread_num();
+    if (thread_num >= buffers.size()) {
+        throw std::runtime_error("more threads putting entries than the ingester was created for");
+    }
+    Buffer& buffer = buffers[thread_num];
+    buffer.entries[key[1]].push_back(Entry{key, next_sequence.fetch_add(1), value});
+    buffer.bytes += key.size() + value.size();
+    if (buffer.bytes >= max_thread_bytes) {
+        spill(buffer);
+    }
+}
+
+void SSTIngester::spill(Buffer& buffer) {
+    for (auto& class_entries : buffer.entries) {
+        auto& entries = class_entries.second;
+        if (entries.empty()) {
+            continue;
+        }
+        sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return a.key < b.key || (a.key == b.key && a.sequence < b.sequence);
+        });
+
+        // runs are stored as length-prefixed keys and values, with the sequence
+        // number of each entry between them
+        string run_file = next_file_name(".run");
+        ofstream out(run_file, ios::binary);
+        for (auto& entry : entries) {
+            uint32_t key_size = entry.key.size();
+            uint32_t value_size = entry.value.size();
+            out.write((char*) &key_size, sizeof(uint32_t));
+            out.write(entry.key.data(), key_size);
+            out.write((char*) &entry.sequence, sizeof(uint64_t));
+            out.write((char*) &value_size, sizeof(uint32_t));
+            out.write(entry.value.data(), value_size);
+        }
+        if (!out) {
+            throw std::runtime_error("couldn't write " + run_file);
+        }
+        entries.clear();
+
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        runs[class_entries.first].push_back(run_file);
+    }
+    buffer.entries.clear();
+    buffer.bytes = 0;
+}
+
+vector<string> SSTIngester::merge_runs(const vector<string>& run_files) {
+
+    // a sorted run, read one entry at a time
+    struct Run {
+        ifstream in;
+        string key;
+        uint64_t sequence;
+        string value;
+        bool next(void) {
+            uint32_t size;
+            if (!in.read((char*) &size, sizeof(uint32_t))) {
+                return false;
+            }
+            key.resize(size);
+            in.read(&key[0], size);
+            in.read((char*) &sequence, sizeof(uint64_t));
+            in.read((char*) &size, sizeof(uint32_t));
+            value.resize(size);
+            in.read(&value[0], size);
+            return (bool) in;
+        }
+    };
+
+    vector<Run> sources(run_files.size());
+    // min-heap of the sources by their current key, and then by when it was put
+    auto later = [&](size_t a, size_t b) {
+        return sources[a].key > sources[b].key ||
+            (sources[a].key == sources[b].key && sources[a].sequence > sources[b].sequence);
+    };
+    priority_queue<size_t, vector<size_t>, decltype(later)> queue(later);
+    for (size_t i = 0; i < run_files.size(); ++i) {
+        sources[i].in.open(run_files[i], ios::binary);
+        if (sources[i].next()) {
+            queue.push(i);
+        }
+    }
+
+    vector<string> sst_files;
+    rocksdb::SstFileWriter writer(rocksdb::EnvOptions(), options);
+    size_t file_bytes = 0;
+    auto write = [&](const string& key, const string& value) {
+        if (sst_files.empty() || file_bytes >= max_file_bytes) {
+            if (!sst_files.empty()) {
+                S(writer.Finish());
+            }
+            sst_files.push_back(next_file_name(".sst"));
+            S(writer.Open(sst_files.back()));
+            file_bytes = 0;
+        }
+        S(writer.Put(key, value));
+        file_bytes += key.size() + value.size();
+    };
+
+    // keys must be strictly increasing, so hold each entry back until we know
+    // it isn't replaced by a later put of the same key
+    string held_key;
+    string held_value;
+    bool holding = false;
+    while (!queue.empty()) {
+        size_t i = queue.top();
+        queue.pop();
+        Run& source = sources[i];
+        if (holding && source.key != held_key) {
+            write(held_key, held_value);
+        }
+        held_key.swap(source.key);
+        held_value.swap(source.value);
+        holding = true;
+        if (source.next()) {
+            queue.push(i);
+        }
+    }
+    if (holding) {
+        write(held_key, held_value);
+    }
+    if (!sst_files.empty()) {
+        S(writer.Finish());
+    }
+    return sst_files;
+}
+
+void SSTIngester::ingest(void) {
+    for (auto& buffer : buffers) {
+        spill(buffer);
+    }
+    if (runs.empty()) {
+        return;
+    }
+
+    // the key classes cover disjoint ranges, so they can be merged independently
+    vector<char> key_classes;
+    for (auto& class_runs : runs) {
+        key_classes.push_back(class_runs.first);
+    }
+    vector<vector<string>> sst_files(key_classes.size());
+    vector<string> errors(key_classes.size());
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < key_classes.size(); ++i) {
+        try {
+            sst_files[i] = merge_runs(runs[key_classes[i]]);
+        } catch (const std::exception& e) {
+            errors[i] = e.what();
+        }
+    }
+    for (auto& error : errors) {
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+    }
+
+    for (auto& class_runs : runs) {
+        for (auto& run_file : class_runs.second) {
+            std::remove(run_file.c_str());
+        }
+    }
+    runs.clear();
+
+    // the files are sorted and don't overlap, so RocksDB can place them all at the
+    // bottom level without compacting them
+    vector<string> all_files;
+    for (auto& class_files : sst_files) {
+        all_files.insert(all_files.end(), class_files.begin(), class_files.end());
+    }
+    rocksdb::IngestExternalFileOptions ingest_options;
+    ingest_options.move_files = true;
+    S(db->IngestExternalFile(all_files, ingest_options));
+    for (auto& sst_file : all_files) {
+        // if the files couldn't be moved, they were copied
+        std::remove(sst_file.c_str());
+    }
+}
+
 Index::Index(void) {
 
     start_sep = '\x00';
@@ -159,6 +369,17 @@ void Index::open_for_bulk_load(string& dir) {
     open(dir, false);
 }
 
+void Index::open_for_ingest(string& dir) {
+    bulk_load = true;
+    open(dir, false);
+    // keep the temporary files next to the database, where RocksDB can move them in
+    string work_prefix = name;
+    while (work_prefix.size() > 1 && work_prefix.back() == '/') {
+        work_prefix.pop_back();
+    }
+    ingester = unique_ptr<SSTIngester>(new SSTIngester(db, db_options, work_prefix + ".ingest"));
+}
+
 Index::~Index(void) {
     if (db) {
         close();
@@ -180,14 +401,20 @@ void Index::close(void) {
             throw std::runtime_error("couldn't mark index closed");
         }
     }
+    ingester.reset();
     delete db;
     db = nullptr;
 }
 
 void Index::flush(void) {
+    if (ingester) {
+        ingester->ingest();
+    }
     db->Flush(rocksdb::FlushOptions());
 
-    if (bulk_load) {
+    // ingested files go straight to the bottom of the tree, so there's nothing
+    // to wait for when ingesting
+    if (bulk_load && !ingester) {
         // Wait for compactions to converge. Specifically, wait until
         // there's no more than one background compaction running.
         // Argument: once that's the case, the number of L0 files isn't
@@ -811,7 +1038,7 @@ void Index::put_node(const Node* node) {
     string data;
     node->SerializeToString(&data);
     string key = key_for_node(node->id());
-    S(db->Put(write_options, key, data));
+    put_entry(key, data);
 }
 
 void Index::batch_node(const Node* node, rocksdb::WriteBatch& batch) {
@@ -839,18 +1066,18 @@ void Index::put_edge(const Edge* edge) {
 
     if(edge->from_start()) {
         // On the from node, we're on the start
-        S(db->Put(write_options, key_for_edge_on_start(edge->from(), edge->to(), backward), from_data));
+        put_entry(key_for_edge_on_start(edge->from(), edge->to(), backward), from_data);
     } else {
         // On the from node, we're on the end
-        S(db->Put(write_options, key_for_edge_on_end(edge->from(), edge->to(), backward), from_data));
+        put_entry(key_for_edge_on_end(edge->from(), edge->to(), backward), from_data);
     }
 
     if(edge->to_end()) {
         // On the to node, we're on the end
-        S(db->Put(write_options, key_for_edge_on_end(edge->to(), edge->from(), backward), to_data));
+        put_entry(key_for_edge_on_end(edge->to(), edge->from(), backward), to_data);
     } else {
         // On the to node, we're on the start
-        S(db->Put(write_options, key_for_edge_on_start(edge->to(), edge->from(), backward), to_data));
+        put_entry(key_for_edge_on_start(edge->to(), edge->from(), backward), to_data);
     }
 }
 
@@ -907,25 +1134,33 @@ void Index::put_path_position(int64_t path_id, int64_t path_pos, bool backward,
 void Index::put_mapping(const Mapping& mapping) {
     string data;
     mapping.SerializeToString(&data);
-    S(db->Put(write_options, key_for_mapping(mapping), data));
+    put_entry(key_for_mapping(mapping), data);
 }
 
 void Index::put_alignment(const Alignment& alignment) {
     static std::atomic<bool> warned_unmapped(false);
     string data;
     alignment.SerializeToString(&data);
-    S(db->Put(write_options, key_for_alignment(alignment), data));
+    put_entry(key_for_alignment(alignment), data);
 }
 
 void Index::put_base(int64_t aln_id, const Alignment& alignment) {
     string data;
     alignment.SerializeToString(&data);
-    S(db->Put(write_options, key_for_base(aln_id), data));
+    put_entry(key_for_base(aln_id), data);
 }
 
 void Index::put_traversal(int64_t aln_id, const Mapping& mapping) {
     string data; // empty data
-    S(db->Put(write_options, key_for_traversal(aln_id, mapping), data));
+    put_entry(key_for_traversal(aln_id, mapping), data);
+}
+
+void Index::put_entry(const string& key, const string& value) {
+    if (ingester) {
+        ingester->put(key, value);
+    } else {
+        S(db->Put(write_options, key, value));
+    }
 }
 
 void Index::cross_alignment(int64_t aln_id, const Alignment& alignment) {
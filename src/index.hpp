@@ -5,6 +5,8 @@
 #include <exception>
 #include <sstream>
 #include <climits>
+#include <mutex>
+#include <memory>
 
 #include "rocksdb/db.h"
 #include "rocksdb/env.h"
@@ -16,6 +18,7 @@
 #include "rocksdb/slice_transform.h"
 #include "rocksdb/table.h"
 #include "rocksdb/filter_policy.h"
+#include "rocksdb/sst_file_writer.h"
 
 #include "json2pb.h"
 #include "vg.hpp"
@@ -82,6 +85,68 @@ namespace vg {
   +t+node_id+strand+align_id            alignment traversal // allows us to quickly go from node traversal to alignments
  */
 
+/**
+ * Loads entries into a RocksDB database without going through the memtable
+ * and compaction. Entries are buffered per thread, and spilled to disk as
+ * sorted runs. When ingesting, the runs for each key class (the character
+ * after the leading separator) are merged in parallel into sorted,
+ * non-overlapping SST files, which RocksDB then ingests as-is into the bottom
+ * of the tree. Entries are not visible to reads until they are ingested.
+ */
+class SSTIngester {
+
+public:
+
+    /// Ingest into the given open database, keeping temporary files in a new
+    /// directory named work_prefix plus a unique suffix. It should be on the
+    /// same filesystem as the database, but not inside its directory.
+    SSTIngester(rocksdb::DB* db, const rocksdb::Options& options, const string& work_prefix,
+                size_t max_buffer_bytes = size_t(1) << 30, size_t max_file_bytes = size_t(1) << 30);
+    ~SSTIngester(void);
+
+    /// Add an entry. May be called from several OpenMP threads at once. If a
+    /// key is added more than once, the value put last is kept.
+    void put(const string& key, const string& value);
+
+    /// Build SST files from all the entries added so far and ingest them into
+    /// the database.
+    void ingest(void);
+
+private:
+
+    // an entry, numbered in the order it was put
+    struct Entry {
+        string key;
+        uint64_t sequence;
+        string value;
+    };
+
+    // the entries buffered by one thread, by key class
+    struct Buffer {
+        map<char, vector<Entry>> entries;
+        size_t bytes = 0;
+    };
+
+    // sort a buffer and write it out as one run per key class
+    void spill(Buffer& buffer);
+    // merge the runs for one key class into SST files
+    vector<string> merge_runs(const vector<string>& run_files);
+    // get a new temporary file name
+    string next_file_name(const string& suffix);
+
+    rocksdb::DB* db;
+    rocksdb::Options options;
+    string work_dir;
+    size_t max_thread_bytes;
+    size_t max_file_bytes;
+
+    vector<Buffer> buffers;
+    map<char, vector<string>> runs;
+    std::mutex runs_mutex;
+    std::atomic<size_t> file_count;
+    std::atomic<uint64_t> next_sequence;
+};
+
 class Index {
 
 public:
@@ -95,6 +160,10 @@ public:
     void open_read_only(string& dir);
     void open_for_write(string& dir);
     void open_for_bulk_load(string& dir);
+    // Open the index for loading alignments, mappings, and graph elements
+    // through SST file ingestion. What is put is not visible until flush(),
+    // and the index is left fully compacted.
+    void open_for_ingest(string& dir);
 
     void reset_options(void);
     void flush(void);
@@ -113,6 +182,8 @@ public:
     rocksdb::ColumnFamilyOptions column_family_options;
     bool bulk_load;
     std::atomic<uint64_t> next_nonce;
+    // if set, entries are put through this rather than written to the db
+    unique_ptr<SSTIngester> ingester;
 
     void load_graph(VG& graph);
     void dump(std::ostream& out);
@@ -145,6 +216,8 @@ public:
 
     // cross-index alignment by aln_id and record its traversals
     void cross_alignment(int64_t aln_id, const Alignment& alignment);
+    // write a key/value pair to the db, or to the ingester if we have one
+    void put_entry(const string& key, const string& value);
 
     rocksdb::Status get_node(int64_t id, Node& node);
     // Takes the nodes and orientations and gets the Edge object with any associated edge data.
@@ -0,0 +1,245 @@
+#ifndef VG_INTERVAL_INDEX_HPP_INCLUDED
+#define VG_INTERVAL_INDEX_HPP_INCLUDED
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+
+/** \file
+ * A compact, static index of labeled intervals for overlap queries.
+ */
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * A static index of labeled, half-open intervals on a collection of contigs
+ * (paths, nodes, or anything else with a coordinate space), for finding the
+ * intervals that overlap a query interval.
+ *
+ * All the intervals live in one flat array, sorted by contig and then start.
+ * Over each contig's slice of the array we lay an implicit interval tree (as
+ * in cgranges), where the element at index i sits at a tree level given by the
+ * number of trailing 1 bits in i, and stores the greatest end in its subtree.
+ * Queries take O(log n + k) time and need no other memory.
+ *
+ * Add all the intervals, then call index() once. After that the index is
+ * read-only and can be queried from many threads at once.
+ */
+template<typename Contig, typename Label>
+class IntervalIndex {
+public:
+
+    /// Add an interval on the given contig, from start to past-end. Must be
+    /// called before index().
+    void add(const Contig& contig, size_t start, size_t end, const Label& label);
+
+    /// Sort the intervals and build the trees over them. Must be called once,
+    /// after all the intervals are added, and before any queries.
+    void index();
+
+    /// Call the given callback with the label of each interval on the given
+    /// contig that overlaps the start to past-end query interval, in no
+    /// particular order.
+    void for_each_overlap(const Contig& contig, size_t start, size_t end,
+                          const function<void(const Label&)>& callback) const;
+
+    /// Get the labels of all the intervals overlapping the query interval.
+    vector<Label> find_overlapping(const Contig& contig, size_t start, size_t end) const;
+
+    /// Return true if any intervals are on the given contig.
+    bool has_contig(const Contig& contig) const;
+
+    /// Return the number of intervals in the index.
+    size_t size() const;
+
+    /// Return true if there are no intervals in the index.
+    bool empty() const;
+
+private:
+
+    struct Interval {
+        Contig contig;
+        size_t start;
+        size_t end;
+        /// The greatest end of any interval in this one's subtree.
+        size_t max_end;
+        Label label;
+    };
+
+    /// Where each contig's intervals are, and the level of the root of their
+    /// tree, sorted by contig.
+    struct ContigSlice {
+        Contig contig;
+        size_t offset;
+        size_t count;
+        int root_level;
+    };
+
+    vector<Interval> intervals;
+    vector<ContigSlice> slices;
+
+    /// Find the slice for the given contig, or slices.end() if it has none.
+    typename vector<ContigSlice>::const_iterator find_slice(const Contig& contig) const;
+
+    /// Fill in max_end over the count intervals starting at the given one,
+    /// and return the level of the root of the tree.
+    static int build_tree(Interval* slice, size_t count);
+};
+
+/////////////
+// Template implementations
+/////////////
+
+template<typename Contig, typename Label>
+void IntervalIndex<Contig, Label>::add(const Contig& contig, size_t start, size_t end, const Label& label) {
+    intervals.push_back(Interval{contig, start, end, end, label});
+}
+
+template<typename Contig, typename Label>
+void IntervalIndex<Contig, Label>::index() {
+    std::sort(intervals.begin(), intervals.end(), [](const Interval& a, const Interval& b) {
+        return a.contig < b.contig || (!(b.contig < a.contig) && a.start < b.start);
+    });
+
+    slices.clear();
+    for (size_t i = 0; i < intervals.size();) {
+        // Find each contig's run of intervals
+        size_t j = i + 1;
+        while (j < intervals.size() && !(intervals[i].contig < intervals[j].contig)) {
+            j++;
+        }
+        slices.push_back(ContigSlice{intervals[i].contig, i, j - i, build_tree(&intervals[i], j - i)});
+        i = j;
+    }
+}
+
+template<typename Contig, typename Label>
+int IntervalIndex<Contig, Label>::build_tree(Interval* slice, size_t count) {
+    // The leaves (even indexes) just cover themselves. Remember the last one,
+    // and the greatest end under the last node on each level, since the
+    // right children of nodes near the end may be past the end.
+    size_t last_i = 0;
+    size_t last = 0;
+    for (size_t i = 0; i < count; i += 2) {
+        slice[i].max_end = slice[i].end;
+        last_i = i;
+        last = slice[i].max_end;
+    }
+
+    int level = 1;
+    for (; ((size_t) 1 << level) <= count; level++) {
+        // The nodes on this level are at (2^level - 1) + i * 2^(level + 1),
+        // and their children are 2^(level - 1) to either side.
+        size_t child_offset = (size_t) 1 << (level - 1);
+        for (size_t i = ((size_t) 1 << level) - 1; i < count; i += (size_t) 1 << (level + 1)) {
+            size_t left_end = slice[i - child_offset].max_end;
+            size_t right_end = i + child_offset < count ? slice[i + child_offset].max_end : last;
+            slice[i].max_end = max(slice[i].end, max(left_end, right_end));
+        }
+
+        // Move up to the parent of the last node
+        last_i = (last_i >> level & 1) ? last_i - child_offset : last_i + child_offset;
+        if (last_i < count && slice[last_i].max_end > last) {
+            last = slice[last_i].max_end;
+        }
+    }
+
+    return level - 1;
+}
+
+template<typename Contig, typename Label>
+void IntervalIndex<Contig, Label>::for_each_overlap(const Contig& contig, size_t start, size_t end,
+                                                    const function<void(const Label&)>& callback) const {
+
+    auto found = find_slice(contig);
+    if (found == slices.end()) {
+        // Nothing is on this contig
+        return;
+    }
+    const Interval* slice = &intervals[found->offset];
+    size_t count = found->count;
+
+    // Walk the tree with an explicit stack of (level, index, left child done)
+    struct StackFrame {
+        int level;
+        size_t index;
+        bool left_done;
+    };
+    StackFrame stack[64];
+    size_t stack_size = 0;
+    stack[stack_size++] = StackFrame{found->root_level, ((size_t) 1 << found->root_level) - 1, false};
+
+    while (stack_size) {
+        StackFrame frame = stack[--stack_size];
+
+        if (frame.level <= 3) {
+            // The subtree is small, so just scan it
+            size_t first = frame.index >> frame.level << frame.level;
+            size_t past_last = min(first + ((size_t) 1 << (frame.level + 1)) - 1, count);
+            for (size_t i = first; i < past_last && slice[i].start < end; i++) {
+                if (start < slice[i].end) {
+                    callback(slice[i].label);
+                }
+            }
+        } else if (!frame.left_done) {
+            // Come back to this node after its left child
+            size_t left = frame.index - ((size_t) 1 << (frame.level - 1));
+            stack[stack_size++] = StackFrame{frame.level, frame.index, true};
+            if (left >= count || slice[left].max_end > start) {
+                // The left child may be past the end, or may have overlaps
+                stack[stack_size++] = StackFrame{frame.level - 1, left, false};
+            }
+        } else if (frame.index < count && slice[frame.index].start < end) {
+            // This node starts before the query ends, so it and its right
+            // subtree may overlap.
+            if (start < slice[frame.index].end) {
+                callback(slice[frame.index].label);
+            }
+            stack[stack_size++] = StackFrame{frame.level - 1, frame.index + ((size_t) 1 << (frame.level - 1)), false};
+        }
+    }
+}
+
+template<typename Contig, typename Label>
+vector<Label> IntervalIndex<Contig, Label>::find_overlapping(const Contig& contig, size_t start, size_t end) const {
+    vector<Label> found;
+    for_each_overlap(contig, start, end, [&](const Label& label) {
+        found.push_back(label);
+    });
+    return found;
+}
+
+template<typename Contig, typename Label>
+typename vector<typename IntervalIndex<Contig, Label>::ContigSlice>::const_iterator
+IntervalIndex<Contig, Label>::find_slice(const Contig& contig) const {
+    auto found = std::lower_bound(slices.begin(), slices.end(), contig, [](const ContigSlice& slice, const Contig& c) {
+        return slice.contig < c;
+    });
+    if (found != slices.end() && contig < found->contig) {
+        return slices.end();
+    }
+    return found;
+}
+
+template<typename Contig, typename Label>
+bool IntervalIndex<Contig, Label>::has_contig(const Contig& contig) const {
+    return find_slice(contig) != slices.end();
+}
+
+template<typename Contig, typename Label>
+size_t IntervalIndex<Contig, Label>::size() const {
+    return intervals.size();
+}
+
+template<typename Contig, typename Label>
+bool IntervalIndex<Contig, Label>::empty() const {
+    return intervals.empty();
+}
+
+}
+
+#endif
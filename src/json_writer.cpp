@@ -0,0 +1,640 @@
+#include "json_writer.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace vg {
+
+using namespace std;
+
+const string& ProtoJSONWriter::str() const {
+    return buffer;
+}
+
+void ProtoJSONWriter::newline() {
+    buffer.push_back('\n');
+}
+
+void ProtoJSONWriter::clear() {
+    buffer.clear();
+}
+
+void ProtoJSONWriter::write(const Alignment& alignment) {
+    bool first = true;
+    buffer.push_back('{');
+    string_field("sequence", alignment.sequence(), first);
+    if (alignment.has_path()) {
+        key("path", first);
+        write_path(alignment.path());
+    }
+    string_field("name", alignment.name(), first);
+    bytes_field("quality", alignment.quality(), first);
+    int32_field("mapping_quality", alignment.mapping_quality(), first);
+    int32_field("score", alignment.score(), first);
+    int32_field("query_position", alignment.query_position(), first);
+    string_field("sample_name", alignment.sample_name(), first);
+    string_field("read_group", alignment.read_group(), first);
+    if (alignment.has_fragment_prev()) {
+        key("fragment_prev", first);
+        write(alignment.fragment_prev());
+    }
+    if (alignment.has_fragment_next()) {
+        key("fragment_next", first);
+        write(alignment.fragment_next());
+    }
+    bool_field("is_secondary", alignment.is_secondary(), first);
+    double_field("identity", alignment.identity(), first);
+    if (alignment.fragment_size() > 0) {
+        key("fragment", first);
+        buffer.push_back('[');
+        for (size_t i = 0; i < alignment.fragment_size(); i++) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            write_path(alignment.fragment(i));
+        }
+        buffer.push_back(']');
+    }
+    if (alignment.locus_size() > 0) {
+        key("locus", first);
+        buffer.push_back('[');
+        for (size_t i = 0; i < alignment.locus_size(); i++) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            write(alignment.locus(i));
+        }
+        buffer.push_back(']');
+    }
+    if (alignment.refpos_size() > 0) {
+        key("refpos", first);
+        buffer.push_back('[');
+        for (size_t i = 0; i < alignment.refpos_size(); i++) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            write_position(alignment.refpos(i));
+        }
+        buffer.push_back(']');
+    }
+    bool_field("read_paired", alignment.read_paired(), first);
+    bool_field("read_mapped", alignment.read_mapped(), first);
+    bool_field("mate_unmapped", alignment.mate_unmapped(), first);
+    bool_field("read_on_reverse_strand", alignment.read_on_reverse_strand(), first);
+    bool_field("mate_on_reverse_strand", alignment.mate_on_reverse_strand(), first);
+    bool_field("soft_clipped", alignment.soft_clipped(), first);
+    bool_field("discordant_insert_size", alignment.discordant_insert_size(), first);
+    double_field("uniqueness", alignment.uniqueness(), first);
+    double_field("correct", alignment.correct(), first);
+    if (alignment.secondary_score_size() > 0) {
+        key("secondary_score", first);
+        buffer.push_back('[');
+        for (size_t i = 0; i < alignment.secondary_score_size(); i++) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            buffer.append(to_string(alignment.secondary_score(i)));
+        }
+        buffer.push_back(']');
+    }
+    double_field("fragment_score", alignment.fragment_score(), first);
+    bool_field("mate_mapped_to_disjoint_subgraph", alignment.mate_mapped_to_disjoint_subgraph(), first);
+    string_field("fragment_length_distribution", alignment.fragment_length_distribution(), first);
+    double_field("time_used", alignment.time_used(), first);
+    if (alignment.has_to_correct()) {
+        key("to_correct", first);
+        write_position(alignment.to_correct());
+    }
+    bool_field("correctly_mapped", alignment.correctly_mapped(), first);
+    if (alignment.has_annotation()) {
+        key("annotation", first);
+        write_struct(alignment.annotation());
+    }
+    buffer.push_back('}');
+}
+
+void ProtoJSONWriter::write(const MultipathAlignment& multipath_alignment) {
+    bool first = true;
+    buffer.push_back('{');
+    string_field("sequence", multipath_alignment.sequence(), first);
+    bytes_field("quality", multipath_alignment.quality(), first);
+    string_field("name", multipath_alignment.name(), first);
+    string_field("sample_name", multipath_alignment.sample_name(), first);
+    string_field("read_group", multipath_alignment.read_group(), first);
+    if (multipath_alignment.subpath_size() > 0) {
+        key("subpath", first);
+        buffer.push_back('[');
+        for (size_t i = 0; i < multipath_alignment.subpath_size(); i++) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            write_subpath(multipath_alignment.subpath(i));
+        }
+        buffer.push_back(']');
+    }
+    int32_field("mapping_quality", multipath_alignment.mapping_quality(), first);
+    if (multipath_alignment.start_size() > 0) {
+        key("start", first);
+        buffer.push_back('[');
+        for (size_t i = 0; i < multipath_alignment.start_size(); i++) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            buffer.append(to_string(multipath_alignment.start(i)));
+        }
+        buffer.push_back(']');
+    }
+    string_field("paired_read_name", multipath_alignment.paired_read_name(), first);
+    if (multipath_alignment.has_annotation()) {
+        key("annotation", first);
+        write_struct(multipath_alignment.annotation());
+    }
+    buffer.push_back('}');
+}
+
+void ProtoJSONWriter::write(const Graph& graph) {
+    bool first = true;
+    buffer.push_back('{');
+    if (graph.node_size() > 0) {
+        key("node", first);
+        buffer.push_back('[');
+        for (size_t i = 0; i < graph.node_size(); i++) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            write_node(graph.node(i));
+        }
+        buffer.push_back(']');
+    }
+    if (graph.edge_size() > 0) {
+        key("edge", first);
+        buffer.push_back('[');
+        for (size_t i = 0; i < graph.edge_size(); i++) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            write_edge(graph.edge(i));
+        }
+        buffer.push_back(']');
+    }
+    if (graph.path_size() > 0) {
+        key("path", first);
+        buffer.push_back('[');
+        for (size_t i = 0; i < graph.path_size(); i++) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            write_path(graph.path(i));
+        }
+        buffer.push_back(']');
+    }
+    buffer.push_back('}');
+}
+
+void ProtoJSONWriter::write(const Snarl& snarl) {
+    bool first = true;
+    buffer.push_back('{');
+    if (snarl.type() != UNCLASSIFIED) {
+        key("type", first);
+        if (SnarlType_IsValid(snarl.type())) {
+            buffer.push_back('"');
+            buffer.append(SnarlType_Name(snarl.type()));
+            buffer.push_back('"');
+        } else {
+            // unknown enum values are written as numbers
+            buffer.append(to_string(snarl.type()));
+        }
+    }
+    if (snarl.has_start()) {
+        key("start", first);
+        write_visit(snarl.start());
+    }
+    if (snarl.has_end()) {
+        key("end", first);
+        write_visit(snarl.end());
+    }
+    if (snarl.has_parent()) {
+        key("parent", first);
+        write(snarl.parent());
+    }
+    string_field("name", snarl.name(), first);
+    bool_field("start_self_reachable", snarl.start_self_reachable(), first);
+    bool_field("end_self_reachable", snarl.end_self_reachable(), first);
+    bool_field("start_end_reachable", snarl.start_end_reachable(), first);
+    bool_field("directed_acyclic_net_graph", snarl.directed_acyclic_net_graph(), first);
+    buffer.push_back('}');
+}
+
+void ProtoJSONWriter::write(const Locus& locus) {
+    bool first = true;
+    buffer.push_back('{');
+    string_field("name", locus.name(), first);
+    if (locus.allele_size() > 0) {
+        key("allele", first);
+        buffer.push_back('[');
+        for (size_t i = 0; i < locus.allele_size(); i++) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            write_path(locus.allele(i));
+        }
+        buffer.push_back(']');
+    }
+    if (locus.support_size() > 0) {
+        key("support", first);
+        buffer.push_back('[');
+        for (size_t i = 0; i < locus.support_size(); i++) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            write_support(locus.support(i));
+        }
+        buffer.push_back(']');
+    }
+    if (locus.genotype_size() > 0) {
+        key("genotype", first);
+        buffer.push_back('[');
+        for (size_t i = 0; i < locus.genotype_size(); i++) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            write_genotype(locus.genotype(i));
+        }
+        buffer.push_back(']');
+    }
+    if (locus.has_overall_support()) {
+        key("overall_support", first);
+        write_support(locus.overall_support());
+    }
+    if (locus.allele_log_likelihood_size() > 0) {
+        key("allele_log_likelihood", first);
+        buffer.push_back('[');
+        for (size_t i = 0; i < locus.allele_log_likelihood_size(); i++) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            number(locus.allele_log_likelihood(i));
+        }
+        buffer.push_back(']');
+    }
+    buffer.push_back('}');
+}
+
+void ProtoJSONWriter::write_node(const Node& node) {
+    bool first = true;
+    buffer.push_back('{');
+    string_field("sequence", node.sequence(), first);
+    string_field("name", node.name(), first);
+    int64_field("id", node.id(), first);
+    buffer.push_back('}');
+}
+
+void ProtoJSONWriter::write_edge(const Edge& edge) {
+    bool first = true;
+    buffer.push_back('{');
+    int64_field("from", edge.from(), first);
+    int64_field("to", edge.to(), first);
+    bool_field("from_start", edge.from_start(), first);
+    bool_field("to_end", edge.to_end(), first);
+    int32_field("overlap", edge.overlap(), first);
+    buffer.push_back('}');
+}
+
+void ProtoJSONWriter::write_path(const Path& path) {
+    bool first = true;
+    buffer.push_back('{');
+    string_field("name", path.name(), first);
+    if (path.mapping_size() > 0) {
+        key("mapping", first);
+        buffer.push_back('[');
+        for (size_t i = 0; i < path.mapping_size(); i++) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            write_mapping(path.mapping(i));
+        }
+        buffer.push_back(']');
+    }
+    bool_field("is_circular", path.is_circular(), first);
+    int64_field("length", path.length(), first);
+    buffer.push_back('}');
+}
+
+void ProtoJSONWriter::write_mapping(const Mapping& mapping) {
+    bool first = true;
+    buffer.push_back('{');
+    if (mapping.has_position()) {
+        key("position", first);
+        write_position(mapping.position());
+    }
+    if (mapping.edit_size() > 0) {
+        key("edit", first);
+        buffer.push_back('[');
+        for (size_t i = 0; i < mapping.edit_size(); i++) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            write_edit(mapping.edit(i));
+        }
+        buffer.push_back(']');
+    }
+    int64_field("rank", mapping.rank(), first);
+    buffer.push_back('}');
+}
+
+void ProtoJSONWriter::write_position(const Position& position) {
+    bool first = true;
+    buffer.push_back('{');
+    int64_field("node_id", position.node_id(), first);
+    int64_field("offset", position.offset(), first);
+    bool_field("is_reverse", position.is_reverse(), first);
+    string_field("name", position.name(), first);
+    buffer.push_back('}');
+}
+
+void ProtoJSONWriter::write_edit(const Edit& edit) {
+    bool first = true;
+    buffer.push_back('{');
+    int32_field("from_length", edit.from_length(), first);
+    int32_field("to_length", edit.to_length(), first);
+    string_field("sequence", edit.sequence(), first);
+    buffer.push_back('}');
+}
+
+void ProtoJSONWriter::write_subpath(const Subpath& subpath) {
+    bool first = true;
+    buffer.push_back('{');
+    if (subpath.has_path()) {
+        key("path", first);
+        write_path(subpath.path());
+    }
+    if (subpath.next_size() > 0) {
+        key("next", first);
+        buffer.push_back('[');
+        for (size_t i = 0; i < subpath.next_size(); i++) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            buffer.append(to_string(subpath.next(i)));
+        }
+        buffer.push_back(']');
+    }
+    int32_field("score", subpath.score(), first);
+    buffer.push_back('}');
+}
+
+void ProtoJSONWriter::write_visit(const Visit& visit) {
+    bool first = true;
+    buffer.push_back('{');
+    int64_field("node_id", visit.node_id(), first);
+    if (visit.has_snarl()) {
+        key("snarl", first);
+        write(visit.snarl());
+    }
+    bool_field("backward", visit.backward(), first);
+    buffer.push_back('}');
+}
+
+void ProtoJSONWriter::write_support(const Support& support) {
+    bool first = true;
+    buffer.push_back('{');
+    double_field("quality", support.quality(), first);
+    double_field("forward", support.forward(), first);
+    double_field("reverse", support.reverse(), first);
+    double_field("left", support.left(), first);
+    double_field("right", support.right(), first);
+    buffer.push_back('}');
+}
+
+void ProtoJSONWriter::write_genotype(const Genotype& genotype) {
+    bool first = true;
+    buffer.push_back('{');
+    if (genotype.allele_size() > 0) {
+        key("allele", first);
+        buffer.push_back('[');
+        for (size_t i = 0; i < genotype.allele_size(); i++) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            buffer.append(to_string(genotype.allele(i)));
+        }
+        buffer.push_back(']');
+    }
+    bool_field("is_phased", genotype.is_phased(), first);
+    double_field("likelihood", genotype.likelihood(), first);
+    double_field("log_likelihood", genotype.log_likelihood(), first);
+    double_field("log_prior", genotype.log_prior(), first);
+    double_field("log_posterior", genotype.log_posterior(), first);
+    buffer.push_back('}');
+}
+
+void ProtoJSONWriter::write_struct(const google::protobuf::Struct& annotation) {
+    // Map iteration order isn't defined, so sort the keys to make the output stable
+    vector<const string*> keys;
+    keys.reserve(annotation.fields().size());
+    for (auto& entry : annotation.fields()) {
+        keys.push_back(&entry.first);
+    }
+    sort(keys.begin(), keys.end(), [](const string* a, const string* b) {
+        return *a < *b;
+    });
+
+    buffer.push_back('{');
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (i > 0) {
+            buffer.push_back(',');
+        }
+        escaped(*keys[i]);
+        buffer.push_back(':');
+        write_value(annotation.fields().at(*keys[i]));
+    }
+    buffer.push_back('}');
+}
+
+void ProtoJSONWriter::write_value(const google::protobuf::Value& value) {
+    switch (value.kind_case()) {
+    case google::protobuf::Value::kNumberValue:
+        number(value.number_value());
+        break;
+    case google::protobuf::Value::kStringValue:
+        escaped(value.string_value());
+        break;
+    case google::protobuf::Value::kBoolValue:
+        buffer.append(value.bool_value() ? "true" : "false");
+        break;
+    case google::protobuf::Value::kStructValue:
+        write_struct(value.struct_value());
+        break;
+    case google::protobuf::Value::kListValue:
+        buffer.push_back('[');
+        for (size_t i = 0; i < value.list_value().values_size(); i++) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            write_value(value.list_value().values(i));
+        }
+        buffer.push_back(']');
+        break;
+    default:
+        // null, or nothing set
+        buffer.append("null");
+        break;
+    }
+}
+
+void ProtoJSONWriter::key(const char* name, bool& first) {
+    if (!first) {
+        buffer.push_back(',');
+    }
+    first = false;
+    buffer.push_back('"');
+    buffer.append(name);
+    buffer.append("\":");
+}
+
+void ProtoJSONWriter::string_field(const char* name, const string& value, bool& first) {
+    if (!value.empty()) {
+        key(name, first);
+        escaped(value);
+    }
+}
+
+void ProtoJSONWriter::bytes_field(const char* name, const string& value, bool& first) {
+    if (!value.empty()) {
+        key(name, first);
+        base64(value);
+    }
+}
+
+void ProtoJSONWriter::int32_field(const char* name, int32_t value, bool& first) {
+    if (value != 0) {
+        key(name, first);
+        buffer.append(to_string(value));
+    }
+}
+
+void ProtoJSONWriter::uint32_field(const char* name, uint32_t value, bool& first) {
+    if (value != 0) {
+        key(name, first);
+        buffer.append(to_string(value));
+    }
+}
+
+void ProtoJSONWriter::int64_field(const char* name, int64_t value, bool& first) {
+    if (value != 0) {
+        // 64-bit integers don't fit in JSON numbers, so they are strings
+        key(name, first);
+        buffer.push_back('"');
+        buffer.append(to_string(value));
+        buffer.push_back('"');
+    }
+}
+
+void ProtoJSONWriter::bool_field(const char* name, bool value, bool& first) {
+    if (value) {
+        key(name, first);
+        buffer.append("true");
+    }
+}
+
+void ProtoJSONWriter::double_field(const char* name, double value, bool& first) {
+    // Protobuf only leaves out fields that are all zero bits, so -0 is written
+    if (value != 0.0 || signbit(value)) {
+        key(name, first);
+        number(value);
+    }
+}
+
+void ProtoJSONWriter::escaped(const string& value) {
+    static const char* hex = "0123456789abcdef";
+    buffer.push_back('"');
+    for (size_t i = 0; i < value.size(); i++) {
+        unsigned char c = value[i];
+        switch (c) {
+        case '"':
+            buffer.append("\\\"");
+            break;
+        case '\\':
+            buffer.append("\\\\");
+            break;
+        case '\b':
+            buffer.append("\\b");
+            break;
+        case '\f':
+            buffer.append("\\f");
+            break;
+        case '\n':
+            buffer.append("\\n");
+            break;
+        case '\r':
+            buffer.append("\\r");
+            break;
+        case '\t':
+            buffer.append("\\t");
+            break;
+        case '<':
+        case '>':
+            // Protobuf escapes these so the JSON can be embedded in HTML
+            buffer.append("\\u003");
+            buffer.push_back(c == '<' ? 'c' : 'e');
+            break;
+        default:
+            if (c < 0x20 || c == 0x7f) {
+                buffer.append("\\u00");
+                buffer.push_back(hex[c >> 4]);
+                buffer.push_back(hex[c & 0xf]);
+            } else {
+                buffer.push_back(c);
+            }
+            break;
+        }
+    }
+    buffer.push_back('"');
+}
+
+void ProtoJSONWriter::base64(const string& value) {
+    static const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    buffer.push_back('"');
+    size_t i = 0;
+    for (; i + 2 < value.size(); i += 3) {
+        uint32_t bits = ((unsigned char) value[i] << 16) | ((unsigned char) value[i + 1] << 8) | (unsigned char) value[i + 2];
+        buffer.push_back(alphabet[(bits >> 18) & 0x3f]);
+        buffer.push_back(alphabet[(bits >> 12) & 0x3f]);
+        buffer.push_back(alphabet[(bits >> 6) & 0x3f]);
+        buffer.push_back(alphabet[bits & 0x3f]);
+    }
+    if (i + 1 == value.size()) {
+        uint32_t bits = (unsigned char) value[i] << 16;
+        buffer.push_back(alphabet[(bits >> 18) & 0x3f]);
+        buffer.push_back(alphabet[(bits >> 12) & 0x3f]);
+        buffer.append("==");
+    } else if (i + 2 == value.size()) {
+        uint32_t bits = ((unsigned char) value[i] << 16) | ((unsigned char) value[i + 1] << 8);
+        buffer.push_back(alphabet[(bits >> 18) & 0x3f]);
+        buffer.push_back(alphabet[(bits >> 12) & 0x3f]);
+        buffer.push_back(alphabet[(bits >> 6) & 0x3f]);
+        buffer.push_back('=');
+    }
+    buffer.push_back('"');
+}
+
+void ProtoJSONWriter::number(double value) {
+    if (std::isnan(value)) {
+        buffer.append("\"NaN\"");
+    } else if (std::isinf(value)) {
+        buffer.append(value > 0 ? "\"Infinity\"" : "\"-Infinity\"");
+    } else {
+        // Use the shortest of the two precisions Protobuf tries that round-trips
+        char digits[32];
+        snprintf(digits, sizeof(digits), "%.*g", DBL_DIG, value);
+        if (strtod(digits, nullptr) != value) {
+            snprintf(digits, sizeof(digits), "%.*g", DBL_DIG + 2, value);
+        }
+        buffer.append(digits);
+    }
+}
+
+}
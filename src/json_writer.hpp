@@ -0,0 +1,136 @@
+#ifndef VG_JSON_WRITER_HPP_INCLUDED
+#define VG_JSON_WRITER_HPP_INCLUDED
+
+/// \file json_writer.hpp
+/// Reflection-free JSON serialization of the vg Protobuf types we dump in bulk
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+
+#include "vg.pb.h"
+#include "stream.hpp"
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * Appends JSON renderings of Protobuf messages to a reusable buffer. The output
+ * follows the same rules as pb2json (proto field names, default values
+ * omitted, 64-bit integers quoted, bytes in base64), but is produced by code
+ * that knows the message layouts instead of walking Protobuf reflection.
+ *
+ * Only the types that we commonly write in bulk are supported. Use pb2json for
+ * everything else.
+ */
+class ProtoJSONWriter {
+public:
+
+    /// Append the JSON for a message to the buffer, without a trailing newline
+    void write(const Alignment& alignment);
+    void write(const MultipathAlignment& multipath_alignment);
+    void write(const Graph& graph);
+    void write(const Snarl& snarl);
+    void write(const Locus& locus);
+
+    /// Get the JSON written so far
+    const string& str() const;
+
+    /// Append a newline, to separate messages in a stream
+    void newline();
+
+    /// Empty the buffer, keeping its allocation
+    void clear();
+
+private:
+
+    // Writers for the nested message types
+    void write_node(const Node& node);
+    void write_edge(const Edge& edge);
+    void write_path(const Path& path);
+    void write_mapping(const Mapping& mapping);
+    void write_position(const Position& position);
+    void write_edit(const Edit& edit);
+    void write_subpath(const Subpath& subpath);
+    void write_visit(const Visit& visit);
+    void write_support(const Support& support);
+    void write_genotype(const Genotype& genotype);
+    void write_struct(const google::protobuf::Struct& annotation);
+    void write_value(const google::protobuf::Value& value);
+
+    // Writers for a field's key, which take care of the separating comma
+    // given whether it is the first field in its object
+    void key(const char* name, bool& first);
+
+    // Writers for scalar fields, which skip fields with default values
+    void string_field(const char* name, const string& value, bool& first);
+    void bytes_field(const char* name, const string& value, bool& first);
+    void int32_field(const char* name, int32_t value, bool& first);
+    void uint32_field(const char* name, uint32_t value, bool& first);
+    void int64_field(const char* name, int64_t value, bool& first);
+    void bool_field(const char* name, bool value, bool& first);
+    void double_field(const char* name, double value, bool& first);
+
+    // Writers for bare values
+    void escaped(const string& value);
+    void base64(const string& value);
+    void number(double value);
+
+    string buffer;
+};
+
+/**
+ * Convert a stream of serialized messages to JSON lines, in the original
+ * order. Batches of messages are rendered in parallel, with each thread
+ * writing a contiguous run of the batch into its own reused buffer. The
+ * optional fixup function is applied to each message before it is rendered.
+ */
+template<typename Message>
+void stream_to_json(istream& in, ostream& out, const function<void(Message&)>& fixup = nullptr,
+                    size_t batch_size = 1024) {
+
+    int thread_count = omp_get_max_threads();
+    vector<ProtoJSONWriter> writers(thread_count);
+    vector<Message> batch;
+    batch.reserve(batch_size);
+
+    auto write_batch = [&]() {
+#pragma omp parallel num_threads(thread_count)
+        {
+            int thread_num = omp_get_thread_num();
+            int used_threads = omp_get_num_threads();
+            ProtoJSONWriter& writer = writers[thread_num];
+            writer.clear();
+            size_t begin = batch.size() * thread_num / used_threads;
+            size_t end = batch.size() * (thread_num + 1) / used_threads;
+            for (size_t i = begin; i < end; i++) {
+                if (fixup) {
+                    fixup(batch[i]);
+                }
+                writer.write(batch[i]);
+                writer.newline();
+            }
+        }
+        for (auto& writer : writers) {
+            out << writer.str();
+            writer.clear();
+        }
+        batch.clear();
+    };
+
+    function<void(Message&)> lambda = [&](Message& message) {
+        batch.emplace_back(move(message));
+        if (batch.size() >= batch_size) {
+            write_batch();
+        }
+    };
+    stream::for_each(in, lambda);
+    write_batch();
+}
+
+}
+
+#endif
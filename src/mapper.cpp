@@ -1,5 +1,6 @@
 #include <unordered_set>
 #include "mapper.hpp"
+#include "stage_stats.hpp"
 #include "haplotypes.hpp"
 #include "annotation.hpp"
 #include "algorithms/extract_containing_graph.hpp"
@@ -11,6 +12,43 @@ namespace vg {
 // init the static memo
 thread_local vector<size_t> BaseMapper::adaptive_reseed_length_memo;
 
+BackwardSearchCache::BackwardSearchCache(const gcsa::GCSA* gcsa, string::const_iterator seq_begin,
+                                         string::const_iterator seq_end) :
+    gcsa(gcsa), seq_begin(seq_begin), seq_end(seq_end), steps_by_end(seq_end - seq_begin + 1) {
+    // nothing else to do
+}
+
+vector<BackwardSearchCache::SearchStep>& BackwardSearchCache::extend(string::const_iterator begin,
+                                                                     string::const_iterator end) {
+    assert(begin >= seq_begin && end <= seq_end && begin < end);
+
+    vector<SearchStep>& steps = steps_by_end[end - seq_begin];
+    // continue the search from the longest substring we've already searched
+    for (int64_t length = steps.size() + 1; length <= end - begin; ++length) {
+        gcsa::range_type prev_range = steps.empty() ? gcsa::range_type(0, gcsa->size() - 1) : steps.back().range;
+        steps.push_back(SearchStep{gcsa->LF(prev_range, gcsa->alpha.char2comp[*(end - length)]),
+                                   numeric_limits<size_t>::max()});
+        ++num_lf;
+    }
+    return steps;
+}
+
+gcsa::range_type BackwardSearchCache::range(string::const_iterator begin, string::const_iterator end) {
+    return extend(begin, end)[end - begin - 1].range;
+}
+
+size_t BackwardSearchCache::count(string::const_iterator begin, string::const_iterator end) {
+    SearchStep& step = extend(begin, end)[end - begin - 1];
+    if (step.count == numeric_limits<size_t>::max()) {
+        step.count = gcsa->count(step.range);
+    }
+    return step.count;
+}
+
+size_t BackwardSearchCache::lf_operations() const {
+    return num_lf;
+}
+
 BaseMapper::BaseMapper(xg::XG* xidex,
                        gcsa::GCSA* g,
                        gcsa::LCPArray* a,
@@ -206,6 +244,11 @@ BaseMapper::find_mems_simple(string::const_iterator seq_begin,
             } else {
                 gcsa->locate(mem.range, mem.nodes);
             }
+            if (translate_gcsa_hit) {
+                for (auto& node : mem.nodes) {
+                    node = translate_gcsa_hit(node);
+                }
+            }
         }
     }
     
@@ -271,6 +314,7 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
                                                      bool include_parent_in_sub_mem_count,
                                                      bool record_max_lcp,
                                                      int reseed_below) {
+    VG_TIME_STAGE(STAGE_MEM_FINDING);
 #ifdef debug_mapper
 #pragma omp critical
     {
@@ -295,6 +339,9 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
     vector<MaximalExactMatch> mems;
     
     gcsa::range_type full_range = gcsa::range_type(0, gcsa->size() - 1);
+    
+    // remembers the backward searches from each end position so reseeding can reuse them
+    BackwardSearchCache search_cache(gcsa, seq_begin, seq_end);
 
     // an empty sequence matches the entire bwt
     if (seq_begin == seq_end) {
@@ -327,6 +374,9 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
     
     // did we move the cursor or the end of the match last iteration?
     bool prev_iter_jumped_lcp = false;
+    
+    // is the current match range the result of a search from the full range (rather than an LCP jump)?
+    bool searched_from_full_range = true;
 
     int filtered_mems = 0;
     int total_mems = 0;
@@ -373,6 +423,7 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
             --cursor;
             
             prev_iter_jumped_lcp = false;
+            searched_from_full_range = true;
 
             max_lcp = 0;
 
@@ -383,8 +434,13 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
         // hold onto our previous range
         last_range = match.range;
         
-        // execute one step of LF mapping
-        match.range = gcsa->LF(match.range, gcsa->alpha.char2comp[*cursor]);
+        // execute one step of LF mapping, keeping it in the cache if the reseeding could reuse it
+        if (searched_from_full_range) {
+            match.range = search_cache.range(cursor, match.end);
+        }
+        else {
+            match.range = gcsa->LF(match.range, gcsa->alpha.char2comp[*cursor]);
+        }
         
         if (gcsa::Range::empty(match.range)
             || (max_mem_length && match.end - cursor > max_mem_length)
@@ -412,6 +468,7 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
                 
                 // don't reseed in empty MEMs
                 prev_iter_jumped_lcp = false;
+                searched_from_full_range = true;
                 max_lcp = 0;
             }
             else {
@@ -451,6 +508,7 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
                 // record our max lcp
                 if (record_max_lcp) max_lcp = (int)parent.lcp();
                 prev_iter_jumped_lcp = true;
+                searched_from_full_range = false;
             }
         }
         else {
@@ -558,11 +616,11 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
                     if (fast_reseed) {
                         find_sub_mems_fast(mems, layer_begin, layer_end, i,
                                            possible_containment_boundary, seed_boundary,
-                                           min_sub_mem_length, sub_mems);
+                                           min_sub_mem_length, search_cache, sub_mems);
                     }
                     else {
                         find_sub_mems(mems, layer_begin, layer_end, i, seed_boundary,
-                                      min_sub_mem_length, sub_mems);
+                                      min_sub_mem_length, search_cache, sub_mems);
                     }
                     
                     for (pair<MaximalExactMatch, vector<size_t>>& sub_mem_and_parents : sub_mems) {
@@ -585,9 +643,15 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
         }
     }
     
-    // query the locations of the hits
+#ifdef debug_mapper
+#pragma omp critical
+    cerr << "used " << search_cache.lf_operations() << " cached LF operations for MEMs and sub-MEMs" << endl;
+#endif
+    
+    // decide which MEMs have hits we need to query
     // note: iterate in reverse so we remove the parent count from the children MEMs before decrementing
     // the parent count itself
+    vector<size_t> mems_to_locate;
     for (int64_t i = mems.size() - 1; i >= 0; i--) {
         
         MaximalExactMatch& mem = mems[i];
@@ -600,19 +664,29 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
         }
         
         if (mem.match_count > 0) {
-            if (hit_max) {
-                gcsa->locate(mem.range, hit_max, mem.nodes);
-                
-            } else {
-                gcsa->locate(mem.range, mem.nodes);
+            mems_to_locate.push_back(i);
+        }
+    }
+    
+    // query the locations of the hits all together
+    locate_mem_hits(mems, mems_to_locate);
+    
+    for (size_t i : mems_to_locate) {
+        
+        MaximalExactMatch& mem = mems[i];
+        
+        if (translate_gcsa_hit) {
+            for (auto& node : mem.nodes) {
+                node = translate_gcsa_hit(node);
             }
-            // keep track of the initial number of hits we query in case the nodes vector is
-            // modified later (e.g. by prefiltering)
-            mem.queried_count = mem.nodes.size();
-            
-            filtered_mems += mem.match_count - mem.nodes.size();
-            total_mems += mem.nodes.size();
         }
+        // keep track of the initial number of hits we query in case the nodes vector is
+        // modified later (e.g. by prefiltering)
+        mem.queried_count = mem.nodes.size();
+        
+        filtered_mems += mem.match_count - mem.nodes.size();
+        total_mems += mem.nodes.size();
+        
 #ifdef debug_mapper
 #pragma omp critical
         {
@@ -632,6 +706,79 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
         prefilter_redundant_sub_mems(mems, sub_mem_containment_graph);
     }
 
+    if (overlay_mapper) {
+        // add the MEMs from the index of the sequence added since our GCSA index was built
+        double overlay_lcp, overlay_filtered;
+        vector<MaximalExactMatch> overlay_mems = overlay_mapper->find_mems_deep(seq_begin, seq_end,
+                                                                                overlay_lcp, overlay_filtered,
+                                                                                max_mem_length, min_mem_length,
+                                                                                reseed_length,
+                                                                                use_lcp_reseed_heuristic,
+                                                                                use_diff_based_fast_reseed,
+                                                                                include_parent_in_sub_mem_count,
+                                                                                record_max_lcp, reseed_below);
+        if (record_max_lcp) longest_lcp = max(longest_lcp, overlay_lcp);
+        
+        // the overlay also indexes some context from our graph, so it can find hits that place
+        // the read where one of our MEMs already does, even with different MEM bounds
+        size_t num_base_mems = mems.size();
+        map<pair<size_t, size_t>, vector<set<pos_t>>> base_hit_positions;
+        auto is_base_placement = [&](const MaximalExactMatch& overlay_mem, pos_t hit_pos) {
+            for (size_t i = 0; i < num_base_mems; i++) {
+                MaximalExactMatch& mem = mems[i];
+                if (mem.begin > overlay_mem.begin || mem.end < overlay_mem.end) {
+                    continue;
+                }
+                size_t offset = overlay_mem.begin - mem.begin;
+                for (size_t j = 0; j < mem.nodes.size(); j++) {
+                    auto key = make_pair(i, j);
+                    if (!base_hit_positions.count(key)) {
+                        mem_positions_by_index(mem, make_pos_t(mem.nodes[j]), base_hit_positions[key]);
+                    }
+                    if (base_hit_positions[key][offset].count(hit_pos)) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        };
+        
+        // keep only the overlay hits that are new, merging them into our MEM over the same
+        // part of the read if there is one
+        map<pair<string::const_iterator, string::const_iterator>, size_t> mem_with_interval;
+        for (size_t i = 0; i < num_base_mems; i++) {
+            mem_with_interval[make_pair(mems[i].begin, mems[i].end)] = i;
+        }
+        for (auto& overlay_mem : overlay_mems) {
+            vector<gcsa::node_type> new_hits;
+            for (auto node : overlay_mem.nodes) {
+                if (!is_base_placement(overlay_mem, make_pos_t(node))) {
+                    new_hits.push_back(node);
+                }
+            }
+            if (new_hits.empty()) {
+                continue;
+            }
+            total_mems += new_hits.size();
+            
+            auto found = mem_with_interval.find(make_pair(overlay_mem.begin, overlay_mem.end));
+            if (found == mem_with_interval.end()) {
+                size_t num_redundant = overlay_mem.nodes.size() - new_hits.size();
+                overlay_mem.match_count -= num_redundant;
+                overlay_mem.queried_count -= num_redundant;
+                overlay_mem.nodes = move(new_hits);
+                mems.push_back(move(overlay_mem));
+                continue;
+            }
+            MaximalExactMatch& mem = mems[found->second];
+            for (auto node : new_hits) {
+                mem.nodes.push_back(node);
+                mem.match_count++;
+                mem.queried_count++;
+            }
+        }
+    }
+
     // TODO: uhhh... if we're actually producing these it's kind of a problem
     // remove strange MEMs
     mems.erase(std::remove_if(mems.begin(), mems.end(),
@@ -659,13 +806,88 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
     return mems;
 }
 
+void BaseMapper::locate_mem_hits(vector<MaximalExactMatch>& mems, const vector<size_t>& mem_idxs) {
+    
+    // group the MEMs by range, ordering outer ranges before the ranges nested inside them
+    vector<size_t> order;
+    for (size_t i : mem_idxs) {
+        if (!gcsa::Range::empty(mems[i].range)) {
+            order.push_back(i);
+        }
+    }
+    std::sort(order.begin(), order.end(), [&](const size_t& i, const size_t& j) {
+        return (mems[i].range.first < mems[j].range.first ||
+                (mems[i].range.first == mems[j].range.first && mems[i].range.second > mems[j].range.second));
+    });
+    
+    // the distinct ranges, in that order, and the MEMs that have each one
+    vector<gcsa::range_type> ranges;
+    vector<vector<size_t>> mems_with_range;
+    for (size_t i : order) {
+        if (ranges.empty() || mems[i].range != ranges.back()) {
+            ranges.push_back(mems[i].range);
+            mems_with_range.emplace_back();
+        }
+        mems_with_range.back().push_back(i);
+    }
+    
+    vector<vector<gcsa::node_type>> hits(ranges.size());
+    
+    if (hit_max) {
+        // we only take a sample of the hits in each range, so we can't combine nested ranges
+        for (size_t i = 0; i < ranges.size(); i++) {
+            gcsa->locate(ranges[i], hit_max, hits[i]);
+        }
+    }
+    else {
+        // find the largest ranges that are nested directly inside each range, which are disjoint
+        vector<vector<size_t>> nested(ranges.size());
+        vector<size_t> stack;
+        for (size_t i = 0; i < ranges.size(); i++) {
+            while (!stack.empty() && ranges[stack.back()].second < ranges[i].first) {
+                stack.pop_back();
+            }
+            if (!stack.empty() && ranges[i].second <= ranges[stack.back()].second) {
+                nested[stack.back()].push_back(i);
+            }
+            stack.push_back(i);
+        }
+        
+        // locate the innermost ranges first so the ranges that contain them can reuse their hits
+        for (int64_t i = ranges.size() - 1; i >= 0; i--) {
+            gcsa::size_type next = ranges[i].first;
+            for (size_t j : nested[i]) {
+                for (; next < ranges[j].first; next++) {
+                    gcsa->locate(next, hits[i], true, false);
+                }
+                hits[i].insert(hits[i].end(), hits[j].begin(), hits[j].end());
+                next = ranges[j].second + 1;
+            }
+            for (; next <= ranges[i].second; next++) {
+                gcsa->locate(next, hits[i], true, false);
+            }
+            gcsa::removeDuplicates(hits[i], false);
+        }
+    }
+    
+    // give each MEM its hits
+    for (size_t i = 0; i < ranges.size(); i++) {
+        for (size_t j = 0; j + 1 < mems_with_range[i].size(); j++) {
+            mems[mems_with_range[i][j]].nodes = hits[i];
+        }
+        mems[mems_with_range[i].back()].nodes = move(hits[i]);
+    }
+}
+
 void BaseMapper::find_sub_mems(const vector<MaximalExactMatch>& mems,
                                int parent_layer_begin,
                                int parent_layer_end,
                                int mem_idx,
                                string::const_iterator next_mem_end,
                                int min_sub_mem_length,
+                               BackwardSearchCache& search_cache,
                                vector<pair<MaximalExactMatch, vector<size_t>>>& sub_mems_out) {
+    VG_TIME_STAGE(STAGE_SUBMEM_RESEEDING);
     
     // get the most recently added MEM
     const MaximalExactMatch& mem = mems[mem_idx];
@@ -696,6 +918,10 @@ void BaseMapper::find_sub_mems(const vector<MaximalExactMatch>& mems,
     // did we move the cursor or the end of the match last iteration?
     bool prev_iter_jumped_lcp = false;
     
+    // until the first LCP jump we are repeating the search that found the parent MEM, which
+    // the cache already holds
+    bool searched_from_full_range = true;
+    
     // look for matches that are contained in this MEM and not contained in the next MEM
     while (cursor >= mem.begin && sub_mem_end > next_mem_end) {
         // Note: there should be no need to handle N's or whole-index mismatches in this
@@ -705,9 +931,17 @@ void BaseMapper::find_sub_mems(const vector<MaximalExactMatch>& mems,
         // hold onto our previous range
         gcsa::range_type last_range = range;
         // execute one step of LF mapping
-        range = gcsa->LF(range, gcsa->alpha.char2comp[*cursor]);
+        size_t range_count;
+        if (searched_from_full_range) {
+            range = search_cache.range(cursor, sub_mem_end);
+            range_count = search_cache.count(cursor, sub_mem_end);
+        }
+        else {
+            range = gcsa->LF(range, gcsa->alpha.char2comp[*cursor]);
+            range_count = gcsa->count(range);
+        }
         
-        if (gcsa->count(range) <= parent_count) {
+        if (range_count <= parent_count) {
             // there are no more hits outside of parent MEM hits, record the previous
             // interval as a sub MEM
             string::const_iterator sub_mem_begin = cursor + 1;
@@ -769,6 +1003,7 @@ void BaseMapper::find_sub_mems(const vector<MaximalExactMatch>& mems,
             range = parent.range();
             
             prev_iter_jumped_lcp = true;
+            searched_from_full_range = false;
         }
         else {
             cursor--;
@@ -831,7 +1066,9 @@ void BaseMapper::find_sub_mems_fast(const vector<MaximalExactMatch>& mems,
                                     string::const_iterator leftmost_guaranteed_disjoint_bound,
                                     string::const_iterator leftmost_seeding_bound,
                                     int min_sub_mem_length,
+                                    BackwardSearchCache& search_cache,
                                     vector<pair<MaximalExactMatch, vector<size_t>>>& sub_mems_out) {
+    VG_TIME_STAGE(STAGE_SUBMEM_RESEEDING);
     
 #ifdef debug_mapper
 #pragma omp critical
@@ -845,6 +1082,12 @@ void BaseMapper::find_sub_mems_fast(const vector<MaximalExactMatch>& mems,
     // how many times does the parent MEM occur in the index?
     size_t parent_range_count = use_approx_sub_mem_count ? gcsa::Range::length(mems[mem_idx].range) : mems[mem_idx].match_count;
     
+    // how many times does a substring of the read occur in the index? all of the backward searches
+    // go through the cache, so the ones that start from the same end share their LF steps
+    auto substring_count = [&](string::const_iterator begin, string::const_iterator end) {
+        return use_approx_sub_mem_count ? gcsa::Range::length(search_cache.range(begin, end)) : search_cache.count(begin, end);
+    };
+    
     // the end of the leftmost substring that is at least the minimum length and not contained
     // in the next SMEM
     string::const_iterator probe_string_end = mems[mem_idx].begin + min_sub_mem_length;
@@ -877,7 +1120,7 @@ void BaseMapper::find_sub_mems_fast(const vector<MaximalExactMatch>& mems,
         bool probe_string_more_frequent = true;
         while (cursor >= probe_string_begin) {
             
-            range = gcsa->LF(range, gcsa->alpha.char2comp[*cursor]);
+            range = search_cache.range(cursor, probe_string_end);
             
             // do a count operation if we've reached the beginning of the probe string or at invervals of the thinning parameter
             // past the burn-in parameter
@@ -885,7 +1128,7 @@ void BaseMapper::find_sub_mems_fast(const vector<MaximalExactMatch>& mems,
             if (cursor == probe_string_begin ||
                 (relative_idx >= sub_mem_thinning_burn_in && (relative_idx - sub_mem_thinning_burn_in) % sub_mem_count_thinning == 0)) {
                 
-                if ((use_approx_sub_mem_count ? gcsa::Range::length(range) : gcsa->count(range)) <= parent_range_count) {
+                if (substring_count(cursor, probe_string_end) <= parent_range_count) {
                     probe_string_more_frequent = false;
                     break;
                 }
@@ -904,13 +1147,10 @@ void BaseMapper::find_sub_mems_fast(const vector<MaximalExactMatch>& mems,
                 
                 // extend match until beginning of SMEM or until the end of the independent hit
                 while (cursor >= leftmost_extension_bound) {
-                    gcsa::range_type last_range = range;
-                    range = gcsa->LF(range, gcsa->alpha.char2comp[*cursor]);
-                    
-                    if ((use_approx_sub_mem_count ? gcsa::Range::length(range) : gcsa->count(range)) <= parent_range_count) {
-                        range = last_range;
+                    if (substring_count(cursor, probe_string_end) <= parent_range_count) {
                         break;
                     }
+                    range = search_cache.range(cursor, probe_string_end);
                     
                     cursor--;
                 }
@@ -953,14 +1193,14 @@ void BaseMapper::find_sub_mems_fast(const vector<MaximalExactMatch>& mems,
                 bool contained_in_independent_match = true;
                 while (cursor >= probe_string_begin) {
                     
-                    range = gcsa->LF(range, gcsa->alpha.char2comp[*cursor]);
+                    range = search_cache.range(cursor, middle);
                     
                     // do count operations on the final index and on intervals of the thinning parameter once we pass the
                     // burn in parameter
                     int64_t relative_idx = middle - cursor - 1;
                     if (cursor == probe_string_begin ||
                         (relative_idx >= sub_mem_thinning_burn_in && (relative_idx - sub_mem_thinning_burn_in) % sub_mem_count_thinning == 0)) {
-                        if ((use_approx_sub_mem_count ? gcsa::Range::length(range) : gcsa->count(range)) <= parent_range_count) {
+                        if (substring_count(cursor, middle) <= parent_range_count) {
                             // this probe is too long and it no longer is contained in the indendent hit
                             // that we detected
                             contained_in_independent_match = false;
@@ -998,19 +1238,17 @@ void BaseMapper::find_sub_mems_fast(const vector<MaximalExactMatch>& mems,
 #endif
                 
                 // the count of the current sub-MEM
-                size_t current_count = use_approx_sub_mem_count ? gcsa::Range::length(sub_mem_range) : gcsa->count(sub_mem_range);
+                size_t current_count = substring_count(probe_string_begin, right_search_bound);
                 
                 // get the GCSA range of the current sub-MEM extended one base past the end of the current parent MEM
+                // (which must be inside the read, since the next MEM to the right extends past it)
                 cursor = right_search_bound;
-                range = gcsa::range_type(0, gcsa->size() - 1);
                 size_t extended_count = numeric_limits<size_t>::max();
-                bool contained_in_independent_match = true;
                 while (cursor >= probe_string_begin) {
-                    range = gcsa->LF(range, gcsa->alpha.char2comp[*cursor]);
                     int64_t relative_idx = right_search_bound - cursor + 1;
                     if (cursor == probe_string_begin ||
                         (relative_idx >= sub_mem_thinning_burn_in && (relative_idx - sub_mem_thinning_burn_in) % sub_mem_count_thinning == 0)) {
-                        extended_count = use_approx_sub_mem_count ? gcsa::Range::length(range) : gcsa->count(range);
+                        extended_count = substring_count(cursor, right_search_bound + 1);
                         if (extended_count < current_count) {
                             // the count of the full lengthened sub-MEM will be fewer than the one we just found
                             break;
@@ -1591,6 +1829,10 @@ bool BaseMapper::has_fixed_fragment_length_distr() {
 void BaseMapper::force_fragment_length_distr(double mean, double stddev) {
     fragment_length_distr.force_parameters(mean, stddev);
 }
+
+void BaseMapper::set_xg(xg::XG* new_xindex) {
+    xindex = new_xindex;
+}
     
 BaseAligner* BaseMapper::get_aligner(bool have_qualities) const {
     return (have_qualities && adjust_alignments_for_base_quality) ?
@@ -1873,6 +2115,7 @@ Alignment Mapper::align_to_graph(const Alignment& aln,
                                  bool banded_global,
                                  int xdrop_alignment,
                                  bool keep_bonuses) {
+    VG_TIME_STAGE(STAGE_ALIGNMENT);
     // check if we need to make a vg graph to handle this graph
     Alignment aligned;
     if (!acyclic_and_sorted) { //!is_id_sortable(graph) || has_inversion(graph)) {
@@ -2064,6 +2307,7 @@ vector<pos_t> Mapper::likely_mate_positions(const Alignment& aln, bool is_first_
 pair<bool, bool> Mapper::pair_rescue(Alignment& mate1, Alignment& mate2,
                                      bool& tried1, bool& tried2,
                                      int match_score, int full_length_bonus, bool traceback, bool xdrop_alignment) {
+    VG_TIME_STAGE(STAGE_RESCUE);
     auto pair_sig = signature(mate1, mate2);
     // bail out if we can't figure out how far to go
     bool rescued1 = false;
@@ -2387,7 +2631,9 @@ pair<vector<Alignment>, vector<Alignment>> Mapper::align_paired_multi(
     if (debug) cerr << "mems for read 1 " << mems_to_json(mems1) << endl;
     if (debug) cerr << "mems for read 2 " << mems_to_json(mems2) << endl;
 
-    auto transition_weight = [&](const MaximalExactMatch& m1, const MaximalExactMatch& m2) {
+    auto transition_weight = [&](const MEMChainModel& chainer, size_t v1, size_t v2) {
+        auto& m1 = chainer.mem_of(v1);
+        auto& m2 = chainer.mem_of(v2);
 
 #ifdef debug_mapper
 #pragma omp critical
@@ -2397,14 +2643,14 @@ pair<vector<Alignment>, vector<Alignment>> Mapper::align_paired_multi(
 #endif
 
         // set up positions for distance query
-        pos_t m1_pos = make_pos_t(m1.nodes.front());
-        pos_t m2_pos = make_pos_t(m2.nodes.front());
+        pos_t m1_pos = chainer.position_of(v1);
+        pos_t m2_pos = chainer.position_of(v2);
 
         // are the two mems in a different fragment?
         // we handle the distance metric differently in these cases
         if (m1.fragment < m2.fragment) {
             int64_t max_length = frag_stats.fragment_max;
-            pair<int64_t, int64_t> d = mem_min_oriented_distances(m1, m2);
+            pair<int64_t, int64_t> d = chainer.min_oriented_distances(v1, v2);
             // if we have a cached fragment orientation, use it to pick the min distance with the correct path relative orientation
             int64_t approx_dist = (!frag_stats.fragment_size ? min(d.first, d.second)
                                    : (frag_stats.cached_fragment_orientation_same ? d.first : d.second));
@@ -2425,11 +2671,11 @@ pair<vector<Alignment>, vector<Alignment>> Mapper::align_paired_multi(
             // don't allow going backwards in the threads
             return -std::numeric_limits<double>::max();
         } else {
-            pos_t m1_pos = make_pos_t(m1.nodes.front());
-            pos_t m2_pos = make_pos_t(m2.nodes.front());
+            pos_t m1_pos = chainer.position_of(v1);
+            pos_t m2_pos = chainer.position_of(v2);
             int max_length = max(read1.sequence().size(), read2.sequence().size());
             double overlap_length = mems_overlap_length(m1, m2);
-            pair<int64_t, int64_t> distances = mem_min_oriented_distances(m1, m2);
+            pair<int64_t, int64_t> distances = chainer.min_oriented_distances(v1, v2);
             int64_t dist_fwd = distances.first; // use only the forward orientation
             //int64_t dist_inv = distances.second;
             if (dist_fwd > max_length) {
@@ -3142,12 +3388,14 @@ Mapper::align_mem_multi(const Alignment& aln,
     // go through the ordered single-hit MEMs
     // build the clustering model
     // find the alignments that are the best-scoring walks through it
-    auto transition_weight = [&](const MaximalExactMatch& m1, const MaximalExactMatch& m2) {
-        pos_t m1_pos = make_pos_t(m1.nodes.front());
-        pos_t m2_pos = make_pos_t(m2.nodes.front());
+    auto transition_weight = [&](const MEMChainModel& chainer, size_t v1, size_t v2) {
+        auto& m1 = chainer.mem_of(v1);
+        auto& m2 = chainer.mem_of(v2);
+        pos_t m1_pos = chainer.position_of(v1);
+        pos_t m2_pos = chainer.position_of(v2);
         int64_t max_length = aln.sequence().size();
         double overlap_length = mems_overlap_length(m1, m2);
-        pair<int64_t, int64_t> distances = mem_min_oriented_distances(m1, m2);
+        pair<int64_t, int64_t> distances = chainer.min_oriented_distances(v1, v2);
         int64_t dist_fwd = distances.first; // use only the forward orientation
         //int64_t dist_inv = distances.second;
         if (dist_fwd > max_length) {
@@ -3464,6 +3712,7 @@ Alignment Mapper::align_cluster(const Alignment& aln, const vector<MaximalExactM
 }
 
 VG Mapper::cluster_subgraph_strict(const Alignment& aln, const vector<MaximalExactMatch>& mems) {
+    VG_TIME_STAGE(STAGE_SUBGRAPH_EXTRACTION);
 #ifdef debug_mapper
 #pragma omp critical
     {
@@ -4078,6 +4327,7 @@ bool Mapper::adjacent_positions(const Position& pos1, const Position& pos2) {
 }
 
 void Mapper::compute_mapping_qualities(vector<Alignment>& alns, double cluster_mq, double mq_estimate, double mq_cap) {
+    VG_TIME_STAGE(STAGE_MAPQ);
     if (alns.empty()) return;
     double max_mq = min(mq_cap, (double)max_mapping_quality);
     BaseAligner* aligner = get_aligner();
@@ -4095,6 +4345,7 @@ void Mapper::compute_mapping_qualities(vector<Alignment>& alns, double cluster_m
 }
     
 void Mapper::compute_mapping_qualities(pair<vector<Alignment>, vector<Alignment>>& pair_alns, double cluster_mq, double mq_estimate1, double mq_estimate2, double mq_cap1, double mq_cap2) {
+    VG_TIME_STAGE(STAGE_MAPQ);
     if (pair_alns.first.empty() || pair_alns.second.empty()) return;
     double max_mq1 = min(mq_cap1, (double)max_mapping_quality);
     double max_mq2 = min(mq_cap2, (double)max_mapping_quality);
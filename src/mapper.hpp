@@ -42,6 +42,50 @@ enum MappingQualityMethod { Approx, Exact, Adaptive, None };
 
 class Mapper;
 
+/**
+ * Memoizes the GCSA backward searches made while finding the MEMs of a read
+ * and reseeding them. For each end position in the read, it remembers the
+ * ranges (and, once asked for, the counts) of the substrings that end there,
+ * by length, so that a later search from the same end resumes where an
+ * earlier one stopped instead of repeating its LF steps.
+ */
+class BackwardSearchCache {
+public:
+    BackwardSearchCache(const gcsa::GCSA* gcsa, string::const_iterator seq_begin,
+                        string::const_iterator seq_end);
+
+    /// Get the GCSA range of the read substring [begin, end), extending the
+    /// search from end as far as necessary
+    gcsa::range_type range(string::const_iterator begin, string::const_iterator end);
+
+    /// Get the number of occurrences of the read substring [begin, end)
+    size_t count(string::const_iterator begin, string::const_iterator end);
+
+    /// The number of LF operations this cache has performed
+    size_t lf_operations() const;
+
+private:
+
+    /// A memoized range and its count, if it has been computed
+    struct SearchStep {
+        gcsa::range_type range;
+        size_t count;
+    };
+
+    /// The steps of the search from the given end, extended to the given length
+    vector<SearchStep>& extend(string::const_iterator begin, string::const_iterator end);
+
+    const gcsa::GCSA* gcsa;
+    string::const_iterator seq_begin;
+    string::const_iterator seq_end;
+
+    /// For each end offset in the read, the steps of the search ending there,
+    /// indexed by length - 1
+    vector<vector<SearchStep>> steps_by_end;
+
+    size_t num_lf = 0;
+};
+
 // for banded long read alignment resolution
 
 class AlignmentChainModelVertex {
@@ -184,6 +228,12 @@ public:
     /// estimating them.
     void force_fragment_length_distr(double mean, double stddev);
     
+    /// Replace the XG index with one for an edited version of the graph,
+    /// keeping the GCSA index. Set translate_gcsa_hit to move GCSA hits into
+    /// the edited graph, and overlay_mapper to seed sequence added since the
+    /// GCSA index was built.
+    void set_xg(xg::XG* new_xindex);
+    
     // MEM-based mapping
     // find maximal exact matches
     // These are SMEMs by definition when shorter than the max_mem_length or GCSA2 order.
@@ -245,6 +295,15 @@ public:
     int unpaired_penalty = 17;
     bool precollapse_order_length_hits = true;
     
+    // If set, applied to every GCSA hit, to translate hits in the graph the GCSA was built from
+    // into the graph the XG describes
+    function<gcsa::node_type(gcsa::node_type)> translate_gcsa_hit;
+    
+    // If set, find_mems_deep also queries this mapper, whose GCSA index covers sequence added to the
+    // graph since our own GCSA index was built, and merges the MEMs it finds into ours. Its hits must
+    // already be in the graph the XG describes.
+    BaseMapper* overlay_mapper = nullptr;
+    
     // The recombination rate (negative log per-base recombination probability) for haplotype-aware mapping
     double recombination_penalty = 20.7; // 9 * 2.3 = 20.7
     
@@ -270,8 +329,9 @@ protected:
                        int mem_idx,
                        string::const_iterator next_mem_end,
                        int min_mem_length,
+                       BackwardSearchCache& search_cache,
                        vector<pair<MaximalExactMatch, vector<size_t>>>& sub_mems_out);
-    
+
     /// Provides same semantics as find_sub_mems but with a different algorithm. This algorithm uses the
     /// min_mem_length as a pruning tool instead of the LCP index. It can be expected to be faster when both
     /// the min_mem_length reasonably large relative to the reseed_length (e.g. 1/2 of SMEM size or similar).
@@ -282,8 +342,14 @@ protected:
                             string::const_iterator leftmost_guaranteed_disjoint_bound,
                             string::const_iterator leftmost_seeding_bound,
                             int min_sub_mem_length,
+                            BackwardSearchCache& search_cache,
                             vector<pair<MaximalExactMatch, vector<size_t>>>& sub_mems_out);
-    
+
+    /// Locate the hits of the MEMs at the given indexes in one batch. MEMs with the same GCSA range
+    /// share a single locate, and without a hit_max each row of the GCSA is located at most once,
+    /// since GCSA ranges are always either nested or disjoint.
+    void locate_mem_hits(vector<MaximalExactMatch>& mems, const vector<size_t>& mem_idxs);
+
     /// finds the nodes of sub MEMs that do not occur inside parent MEMs, each sub MEM should be associated
     /// with a vector of the indices of the SMEMs that contain it in the parent MEMs vector
     void fill_nonredundant_sub_mem_nodes(vector<MaximalExactMatch>& parent_mems,
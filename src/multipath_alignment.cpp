@@ -103,51 +103,33 @@ namespace vg {
         }
     }
     
-    /// We define this struct for holding the dynamic programming problem for a
-    /// multipath alignment, which we use for finding the optimal alignment,
-    /// scoring the optimal alignment, and enumerating the top alignments.
-    struct MultipathProblem {
-        // Score of the optimal alignment ending immediately before this
-        // subpath. To get the score of the optimal alignment ending with the
-        // subpath, add the subpath's score.
-        vector<int32_t> prefix_score;
-        // previous subpath for traceback (we refer to subpaths by their index)
-        vector<int64_t> prev_subpath;
-        // the length of read sequence preceding this subpath
-        vector<int64_t> prefix_length;
-        
-        /// Make a new MultipathProblem over the given number of subpaths with scores
-        /// initialized according to whether we're doing a local or global traceback
-        MultipathProblem(const MultipathAlignment& multipath_aln, bool subpath_global)
-            : prefix_score(multipath_aln.subpath_size(), subpath_global ? numeric_limits<int32_t>::min() / 2 : 0),
-              prev_subpath(multipath_aln.subpath_size(), -1), prefix_length(multipath_aln.subpath_size(), 0) {
-            
-            if (subpath_global) {
-                // set the starting score at sources to 0 so that alignments can only start there
-                for (const auto& i : multipath_aln.start()) {
-                    prefix_score[i] = 0;
-                }
+    MultipathProblem::MultipathProblem(const MultipathAlignment& multipath_aln, const vector<int64_t>& starts,
+                                       bool subpath_global)
+        : prefix_score(multipath_aln.subpath_size(), subpath_global ? numeric_limits<int32_t>::min() / 2 : 0),
+          prev_subpath(multipath_aln.subpath_size(), -1), prefix_length(multipath_aln.subpath_size(), 0) {
+        
+        if (subpath_global) {
+            // set the starting score at sources to 0 so that alignments can only start there
+            for (const auto& i : starts) {
+                prefix_score[i] = 0;
             }
         }
-    };
+    }
     
     /// Internal helper function for running the dynamic programming problem
-    /// represented by a multipath alignment. Returns the filled DP problem,
-    /// the optimal ending subpath, or -1 if no subpath is optimal, and the
-    /// optimal score, or 0 if no score is optimal. An option toggles whether
-    /// the traceback should be global (a source to a sink in the multipath DAG)
-    /// or local (starting and ending at any subpath)
-    tuple<MultipathProblem, int64_t, int32_t> run_multipath_dp(const MultipathAlignment& multipath_aln,
-                                                               bool subpath_global = false) {
-        
-        // Create and unpack the return value (including setting up the DP table)
-        tuple<MultipathProblem, int64_t, int32_t> to_return(MultipathProblem(multipath_aln, subpath_global),
-                                                            -1, 0);
-        auto& problem = get<0>(to_return);
-        auto& opt_subpath = get<1>(to_return);
-        auto& opt_score = get<2>(to_return);
+    /// represented by a multipath alignment, visiting the subpaths in the given
+    /// topological order. Fills the DP problem, the optimal ending subpath, or -1
+    /// if no subpath is optimal, and the optimal score, or 0 if no score is optimal.
+    /// An option toggles whether the traceback should be global (a source to a sink
+    /// in the multipath DAG) or local (starting and ending at any subpath)
+    void run_multipath_dp(const MultipathAlignment& multipath_aln, const vector<int64_t>& order,
+                          MultipathProblem& problem, int64_t& opt_subpath, int32_t& opt_score,
+                          bool subpath_global) {
+        
+        opt_subpath = -1;
+        opt_score = 0;
     
-        for (size_t i = 0; i < multipath_aln.subpath_size(); i++) {
+        for (const int64_t& i : order) {
             const Subpath& subpath = multipath_aln.subpath(i);
             int32_t extended_score = problem.prefix_score[i] + subpath.score();
             // carry DP forward
@@ -172,9 +154,6 @@ namespace vg {
                 opt_subpath = i;
             }
         }
-                
-        return to_return;
-    
     }
     
     /// We define this helper to turn tracebacks through a DP problem into
@@ -288,146 +267,248 @@ namespace vg {
         }
     }
     
-    int32_t optimal_alignment_internal(const MultipathAlignment& multipath_aln, Alignment* aln_out,
-                                       bool subpath_global) {
+    void optimal_alignment(const MultipathAlignment& multipath_aln, Alignment& aln_out, bool subpath_global) {
+        MultipathAlignmentCache cache(multipath_aln);
+        cache.optimal_alignment(aln_out, subpath_global);
+    }
+    
+    int32_t optimal_alignment_score(const MultipathAlignment& multipath_aln, bool subpath_global){
+        // do dynamic programming without traceback
+        MultipathAlignmentCache cache(multipath_aln);
+        return cache.optimal_alignment_score(subpath_global);
+    }
+    
+    vector<Alignment> optimal_alignments(const MultipathAlignment& multipath_aln, size_t count) {
+        MultipathAlignmentCache cache(multipath_aln, count);
+        return cache.optimal_alignments(count);
+    }
+    
+    vector<Alignment> optimal_alignments_with_disjoint_subpaths(const MultipathAlignment& multipath_aln, size_t count) {
+        MultipathAlignmentCache cache(multipath_aln);
+        return cache.optimal_alignments_with_disjoint_subpaths(count);
+    }
+    
+    MultipathAlignmentCache::MultipathAlignmentCache(const MultipathAlignment& multipath_aln, size_t max_alignments)
+        : multipath_aln(&multipath_aln), num_subpaths(multipath_aln.subpath_size()), top_limit(max_alignments) {
+        // nothing else to do, everything is computed on demand
+    }
+    
+    const MultipathAlignment& MultipathAlignmentCache::multipath_alignment() const {
+        return *multipath_aln;
+    }
+    
+    void MultipathAlignmentCache::invalidate() {
+        num_subpaths = multipath_aln->subpath_size();
+        
+        have_order = false;
+        order.clear();
+        have_starts = false;
+        starts.clear();
+        
+        local_dp = DPResult();
+        global_dp = DPResult();
+        
+        have_traceback_ends = false;
+        prev_subpaths.clear();
+        traceback_ends.clear();
+        
+        top_seeded = false;
+        top_trimmed = false;
+        top_queue = queue_t();
+        top_alns.clear();
+        
+        disjoint_seeded = false;
+        disjoint_end_queue = queue_t();
+        subpath_is_used.clear();
+        disjoint_alns.clear();
+    }
+    
+    void MultipathAlignmentCache::check_validity() {
+        if (multipath_aln->subpath_size() != num_subpaths) {
+            invalidate();
+        }
+    }
+    
+    const vector<int64_t>& MultipathAlignmentCache::topological_order() {
+        check_validity();
+        if (have_order) {
+            return order;
+        }
         
-        // Run the dynamic programming
-        auto dp_result = run_multipath_dp(multipath_aln, subpath_global);
+        // multipath alignments are almost always stored in topological order already,
+        // which we can check without doing the sort
+        bool is_ordered = true;
+        for (size_t i = 0; i < num_subpaths && is_ordered; i++) {
+            for (const auto& next : multipath_aln->subpath(i).next()) {
+                if (next <= i) {
+                    is_ordered = false;
+                    break;
+                }
+            }
+        }
         
-        // C++17 finally gets http://en.cppreference.com/w/cpp/language/structured_binding
-        // Until then we have to unpack tuples like this.
+        order.clear();
+        order.reserve(num_subpaths);
+        if (is_ordered) {
+            for (int64_t i = 0; i < num_subpaths; i++) {
+                order.push_back(i);
+            }
+        }
+        else {
+            // Kahn's algorithm, as in topologically_order_subpaths but without permuting
+            vector<size_t> in_degree(num_subpaths, 0);
+            for (const Subpath& subpath : multipath_aln->subpath()) {
+                for (const auto& next : subpath.next()) {
+                    in_degree[next]++;
+                }
+            }
+            
+            vector<int64_t> stack;
+            for (int64_t i = 0; i < num_subpaths; i++) {
+                if (!in_degree[i]) {
+                    stack.push_back(i);
+                }
+            }
+            
+            while (!stack.empty()) {
+                int64_t here = stack.back();
+                stack.pop_back();
+                order.push_back(here);
+                
+                for (const auto& next : multipath_aln->subpath(here).next()) {
+                    in_degree[next]--;
+                    if (!in_degree[next]) {
+                        stack.push_back(next);
+                    }
+                }
+            }
+        }
         
-        // Get the filled DP problem
-        MultipathProblem& problem = get<0>(dp_result);
-        // And the optimal final subpath
-        int64_t& opt_subpath = get<1>(dp_result);
-        // And the optimal score
-        int32_t& opt_score = get<2>(dp_result);
+        have_order = true;
+        return order;
+    }
+    
+    const vector<int64_t>& MultipathAlignmentCache::start_subpaths() {
+        check_validity();
+        if (have_starts) {
+            return starts;
+        }
         
-        // are we constructing the alignment, or just getting the score?
-        if (aln_out && opt_subpath >= 0) {
-            
+        // label nodes with incoming edges
+        vector<bool> has_incoming_edge(num_subpaths, false);
+        for (const Subpath& subpath : multipath_aln->subpath()) {
+            for (const auto& next : subpath.next()) {
+                has_incoming_edge[next] = true;
+            }
+        }
+        
+        starts.clear();
+        for (int64_t i = 0; i < num_subpaths; i++) {
+            if (!has_incoming_edge[i]) {
+                starts.push_back(i);
+            }
+        }
+        
+        have_starts = true;
+        return starts;
+    }
+    
+    MultipathAlignmentCache::DPResult& MultipathAlignmentCache::dp(bool subpath_global) {
+        check_validity();
+        DPResult& result = subpath_global ? global_dp : local_dp;
+        if (result.filled) {
+            return result;
+        }
+        
+        vector<int64_t> identified_starts(multipath_aln->start().begin(), multipath_aln->start().end());
+        result.problem = MultipathProblem(*multipath_aln, identified_starts, subpath_global);
+        
+        run_multipath_dp(*multipath_aln, topological_order(), result.problem, result.opt_subpath, result.opt_score,
+                         subpath_global);
+        dp_fills++;
+        
+        result.filled = true;
+        return result;
+    }
+    
+    MultipathAlignmentCache::DPResult& MultipathAlignmentCache::traced_dp(bool subpath_global) {
+        DPResult& result = dp(subpath_global);
+        if (result.traced) {
+            return result;
+        }
+        
+        if (result.opt_subpath >= 0) {
             // traceback the optimal subpaths until hitting sentinel (-1)
             list<int64_t> opt_traceback;
-            int64_t curr = opt_subpath;
+            int64_t curr = result.opt_subpath;
             while (curr >= 0) {
                 opt_traceback.push_front(curr);
-                curr = problem.prev_subpath[curr];
+                curr = result.problem.prev_subpath[curr];
             }
             
-            Path* opt_path = aln_out->mutable_path();
-            
-            // Fill in the path in the alignment with the alignment represented
-            // by this traceback in this DP problem for this multipath
-            // alignment.
-            populate_path_from_traceback(multipath_aln, problem, opt_traceback.begin(), opt_traceback.end(), opt_path);
-            
-            
+            // Fill in the path with the alignment represented by this traceback
+            populate_path_from_traceback(*multipath_aln, result.problem, opt_traceback.begin(), opt_traceback.end(),
+                                         &result.opt_path);
         }
         
-        // Return the optimal score, or 0 if unaligned.
-        return opt_score;
+        result.traced = true;
+        return result;
     }
     
-    void optimal_alignment(const MultipathAlignment& multipath_aln, Alignment& aln_out, bool subpath_global) {
-
-        // transfer read information over to alignment
-        transfer_read_metadata(multipath_aln, aln_out);
-        aln_out.set_mapping_quality(multipath_aln.mapping_quality());
-        
-        // do dynamic programming and traceback the optimal alignment
-        int32_t score = optimal_alignment_internal(multipath_aln, &aln_out, subpath_global);
-        
-        aln_out.set_score(score);
+    int32_t MultipathAlignmentCache::optimal_alignment_score(bool subpath_global) {
+        // Return the optimal score, or 0 if unaligned.
+        return dp(subpath_global).opt_score;
     }
     
-    int32_t optimal_alignment_score(const MultipathAlignment& multipath_aln, bool subpath_global){
-        // do dynamic programming without traceback
-        return optimal_alignment_internal(multipath_aln, nullptr, subpath_global);
+    const Path& MultipathAlignmentCache::optimal_path(bool subpath_global) {
+        return traced_dp(subpath_global).opt_path;
     }
     
-    vector<Alignment> optimal_alignments(const MultipathAlignment& multipath_aln, size_t count) {
-        
-#ifdef debug_multiple_tracebacks
-        cerr << "Computing top " << count << " alignments" << endl;
-#endif
+    void MultipathAlignmentCache::optimal_alignment(Alignment& aln_out, bool subpath_global) {
         
-        // Keep a list of what we're going to emit.
-        vector<Alignment> to_return;
+        // transfer read information over to alignment
+        transfer_read_metadata(*multipath_aln, aln_out);
+        aln_out.set_mapping_quality(multipath_aln->mapping_quality());
         
-        // Fill out the dynamic programming problem
-        auto dp_result = run_multipath_dp(multipath_aln);
-        // Get the filled DP problem
-        MultipathProblem& problem = get<0>(dp_result);
-        // And the optimal final subpath
-        int64_t& opt_subpath = get<1>(dp_result);
-        // And the optimal score
-        int32_t& opt_score = get<2>(dp_result);
+        // do dynamic programming and traceback the optimal alignment
+        DPResult& result = traced_dp(subpath_global);
+        if (result.opt_subpath >= 0) {
+            *aln_out.mutable_path() = result.opt_path;
+        }
         
-        // Keep lists of DP steps, which are subpath numbers to visit.
-        // Even going to the end subpath (where prefix length + subpath length = read length) is a DP step
-        // We never deal with empty lists; we always seed with the traceback start node.
-        using step_list_t = ImmutableList<int64_t>;
-        
-        // Put them in a size-limited priority queue by score difference (positive) from optimal
-        MinMaxHeap<pair<int32_t, step_list_t>> queue;
-        
-        // We define a function to put stuff in the queue and limit its size to
-        // the (count - to_return.size()) items with lowest penalty.
-        auto try_enqueue = [&](const pair<int32_t, step_list_t>& item) {
-            auto max_size = count - to_return.size();
-            if (queue.size() < max_size || item < queue.max()) {
-                // The item belongs in the queue because it fits or it beats
-                // the current worst thing.
-                queue.push(item);
-            } else {
-#ifdef debug_multiple_tracebacks
-                cerr << "Rejected! Queue is full!" << endl;
-#endif
-            }
-            
-            while(queue.size() > max_size) {
-                // We have more possibilities than we need to consider to emit
-                // the top count alignments. Get rid of the worst one.
-                queue.pop_max();
-#ifdef debug_multiple_tracebacks
-                cerr << "Existing item displaced!" << endl;
-#endif
-            }
-        };
+        aln_out.set_score(result.opt_score);
+    }
+    
+    void MultipathAlignmentCache::find_traceback_ends() {
+        check_validity();
+        if (have_traceback_ends) {
+            return;
+        }
         
-        // Also, subpaths only keep track of their nexts, so we need to invert
+        // Subpaths only keep track of their nexts, so we need to invert
         // that so we can get all valid prev subpaths.
-        vector<vector<int64_t>> prev_subpaths;
+        prev_subpaths.clear();
+        prev_subpaths.resize(num_subpaths);
+        traceback_ends.clear();
         
         // We want to be able to start the traceback only from places where we
         // won't get shorter versions of same- or higher-scoring alignments.
         // This means that we want exactly the subpaths that have no successors
-        // with nonnegative subpath score.
-        
-        // So we go through all the subpaths, check all their successors, and
-        // add starting points for all satisfactory subpaths to the queue.
-        // Sinks in the graphs will always be in here, as will the starting
-        // point for tracing back the optimal alignment.
-        
-        // We know what the penalty from optimal is for each, because we know
-        // the optimal score overall and the score we would get for the optimal
-        // alignment ending at each.
-        
-        prev_subpaths.resize(multipath_aln.subpath_size());
-        for (int64_t i = 0; i < multipath_aln.subpath_size(); i++) {
+        // with nonnegative subpath score. Sinks in the graphs will always be in
+        // here, as will the starting point for tracing back the optimal alignment.
+        for (int64_t i = 0; i < num_subpaths; i++) {
             // For each subpath
             
             // If it has no successors, we can start a traceback here
             bool valid_traceback_start = true;
             
-            for (auto& next_subpath : multipath_aln.subpath(i).next()) {
+            for (auto& next_subpath : multipath_aln->subpath(i).next()) {
                 // For each next subpath it lists
                 
                 // Register this subpath as a predecessor of the next
                 prev_subpaths[next_subpath].push_back(i);
                 
-                if (multipath_aln.subpath(next_subpath).score() >= 0) {
+                if (multipath_aln->subpath(next_subpath).score() >= 0) {
                     // This successor has a nonnegative score, so taking it
                     // after us would generate a longer, same- or
                     // higher-scoring alignment. So we shouldn't start a
@@ -437,10 +518,70 @@ namespace vg {
             }
             
             if (valid_traceback_start) {
-                // We can start a traceback here.
+                traceback_ends.push_back(i);
+            }
+        }
+        
+        have_traceback_ends = true;
+    }
+    
+    vector<Alignment> MultipathAlignmentCache::annotated(const vector<Alignment>& alns, size_t count) const {
+        vector<Alignment> to_return(alns.begin(), alns.begin() + min(count, alns.size()));
+        for (Alignment& aln : to_return) {
+            // Set up read info and MAPQ
+            // TODO: MAPQ on secondaries?
+            transfer_read_metadata(*multipath_aln, aln);
+            aln.set_mapping_quality(multipath_aln->mapping_quality());
+        }
+        return to_return;
+    }
+    
+    vector<Alignment> MultipathAlignmentCache::optimal_alignments(size_t count) {
+        
+#ifdef debug_multiple_tracebacks
+        cerr << "Computing top " << count << " alignments" << endl;
+#endif
+        
+        check_validity();
+        
+        if (top_alns.size() >= count) {
+            // we already found these alignments
+            return annotated(top_alns, count);
+        }
+        
+        // Fill out the dynamic programming problem
+        DPResult& result = dp(false);
+        MultipathProblem& problem = result.problem;
+        int32_t& opt_score = result.opt_score;
+        
+        // Keep lists of DP steps, which are subpath numbers to visit.
+        // Even going to the end subpath (where prefix length + subpath length = read length) is a DP step
+        // We never deal with empty lists; we always seed with the traceback start node.
+        // They go in a size-limited priority queue by score difference (positive) from optimal.
+        // The queue is trimmed to what the largest count asked for so far can use, so if this
+        // call wants more than that and something was dropped, we have to start over.
+        
+        if (count > top_limit) {
+            if (top_trimmed) {
+                top_seeded = false;
+                top_trimmed = false;
+                top_queue = queue_t();
+                top_alns.clear();
+            }
+            top_limit = count;
+        }
+        
+        if (!top_seeded) {
+            // Add starting points for all of the subpaths a traceback can start from to the queue.
+            
+            // We know what the penalty from optimal is for each, because we know
+            // the optimal score overall and the score we would get for the optimal
+            // alignment ending at each.
+            find_traceback_ends();
+            for (const int64_t& i : traceback_ends) {
                 
                 // The score penalty for starting here is the optimal score minus the optimal score starting here
-                auto penalty = opt_score - (problem.prefix_score[i] + multipath_aln.subpath(i).score());
+                auto penalty = opt_score - (problem.prefix_score[i] + multipath_aln->subpath(i).score());
                 
                 // The path is just to be here
                 step_list_t starting_path{i};
@@ -449,18 +590,20 @@ namespace vg {
                 cerr << "Could end at subpath " << i << " with penalty " << penalty << endl;
 #endif
                 
-                try_enqueue(make_pair(penalty, starting_path));
+                enqueue_top(make_pair(penalty, starting_path));
             }
+            top_seeded = true;
         }
         
-        while (!queue.empty() && to_return.size() < count) {
+        while (!top_queue.empty() && top_alns.size() < count) {
             // Each iteration
             
             // Grab the best list as our basis
             int32_t basis_score_difference;
             step_list_t basis;
-            tie(basis_score_difference, basis) = queue.min();
-            queue.pop_min();
+            tie(basis_score_difference, basis) = top_queue.min();
+            top_queue.pop_min();
+            traceback_steps++;
             
             assert(!basis.empty());
             
@@ -471,23 +614,18 @@ namespace vg {
             }
             cerr << "Consider " << basis_size << " element traceback to " << basis.front() << " with penalty "
                  << basis_score_difference << endl;
-            cerr << "\t" << pb2json(multipath_aln.subpath(basis.front()).path()) << endl;
+            cerr << "\t" << pb2json(multipath_aln->subpath(basis.front()).path()) << endl;
 #endif
             
             if (problem.prev_subpath[basis.front()] == -1) {
                 // If it leads all the way to a subpath that is optimal as a start
                 
-                // Make an Alignment to emit it in
-                to_return.emplace_back();
-                Alignment& aln_out = to_return.back();
-                
-                // Set up read info and MAPQ
-                // TODO: MAPQ on secondaries?
-                transfer_read_metadata(multipath_aln, aln_out);
-                aln_out.set_mapping_quality(multipath_aln.mapping_quality());
+                // Make an Alignment to emit it in, the read info gets added on the way out
+                top_alns.emplace_back();
+                Alignment& aln_out = top_alns.back();
                 
                 // Populate path
-                populate_path_from_traceback(multipath_aln, problem, basis.begin(), basis.end(), aln_out.mutable_path());
+                populate_path_from_traceback(*multipath_aln, problem, basis.begin(), basis.end(), aln_out.mutable_path());
                 
                 // Set score
                 aln_out.set_score(opt_score - basis_score_difference);
@@ -505,7 +643,6 @@ namespace vg {
                 // came from each.
                 // Note that we will only do this once per subpath, when we are
                 // working on the optimal alignment going through that subpath.
-                list<pair<int64_t, int32_t>> destinations;
                 
                 // The destinations will be all places we could have arrived here from
                 auto& here = basis.front();
@@ -515,23 +652,11 @@ namespace vg {
                 
                 for (auto& prev : prev_subpaths[here]) {
                     // For each, compute the score of the optimal alignment ending at that predecessor
-                    auto prev_opt_score = problem.prefix_score[prev] + multipath_aln.subpath(prev).score();
+                    auto prev_opt_score = problem.prefix_score[prev] + multipath_aln->subpath(prev).score();
                     
                     // What's the difference we would take if we went with this predecessor?
                     auto additional_penalty = best_prefix_score - prev_opt_score;
                     
-                    destinations.emplace_back(prev, additional_penalty);
-                }
-                
-                // TODO: unify loops!
-                
-                for (auto& destination : destinations) {
-                    // Prepend each of the things that can be prepended
-                    
-                    // Unpack
-                    auto& prev = destination.first;
-                    auto& additional_penalty = destination.second;
-                    
                     // Make an extended path
                     auto extended_path = basis.push_front(prev);
                     
@@ -543,71 +668,53 @@ namespace vg {
 #endif
                     
                     // Put them in the priority queue
-                    try_enqueue(make_pair(total_penalty, extended_path));
+                    enqueue_top(make_pair(total_penalty, extended_path));
                 }
-                
             }
         }
         
-        return to_return;
+        return annotated(top_alns, count);
+    }
+    
+    void MultipathAlignmentCache::enqueue_top(const pair<int32_t, step_list_t>& item) {
+        // limit the queue to the (top_limit - top_alns.size()) items with lowest penalty
+        auto max_size = top_limit - top_alns.size();
+        if (top_queue.size() < max_size || item < top_queue.max()) {
+            // The item belongs in the queue because it fits or it beats
+            // the current worst thing.
+            top_queue.push(item);
+        } else {
+            top_trimmed = true;
+        }
         
+        while (top_queue.size() > max_size) {
+            // We have more possibilities than we need to consider to emit
+            // the top alignments. Get rid of the worst one.
+            top_queue.pop_max();
+            top_trimmed = true;
+        }
     }
     
-    vector<Alignment> optimal_alignments_with_disjoint_subpaths(const MultipathAlignment& multipath_aln, size_t count) {
+    vector<Alignment> MultipathAlignmentCache::optimal_alignments_with_disjoint_subpaths(size_t count) {
         
 #ifdef debug_multiple_tracebacks
         cerr << "Computing top " << count << " alignments with disjoint subpaths" << endl;
 #endif
         
-        // Keep a list of what we're going to emit.
-        vector<Alignment> to_return;
+        check_validity();
         
         // Fill out the dynamic programming problem
-        auto dp_result = run_multipath_dp(multipath_aln);
-        // Get the filled DP problem
-        MultipathProblem& problem = get<0>(dp_result);
-        // And the optimal final subpath
-        int64_t& opt_subpath = get<1>(dp_result);
-        // And the optimal score
-        int32_t& opt_score = get<2>(dp_result);
-        
-        // Keep lists of DP steps
-        using step_list_t = ImmutableList<int64_t>;
-        
-        // Have a queue just for end positions
-        MinMaxHeap<pair<int32_t, step_list_t>> end_queue;
-        
-        // Also, subpaths only keep track of their nexts, so we need to invert
-        // that so we can get all valid prev subpaths.
-        vector<vector<int64_t>> prev_subpaths;
-        
-        prev_subpaths.resize(multipath_aln.subpath_size());
-        for (int64_t i = 0; i < multipath_aln.subpath_size(); i++) {
-            // For each subpath
-            
-            // If it has no successors, we can start a traceback here
-            bool valid_traceback_start = true;
-            
-            for (auto& next_subpath : multipath_aln.subpath(i).next()) {
-                // For each next subpath it lists
-                
-                // Register this subpath as a predecessor of the next
-                prev_subpaths[next_subpath].push_back(i);
-                
-                if (multipath_aln.subpath(next_subpath).score() >= 0) {
-                    // This successor has a nonnegative score, so taking it
-                    // after us would generate a longer, same- or
-                    // higher-scoring alignment. So we shouldn't start a
-                    // traceback from subpath i.
-                    valid_traceback_start = false;
-                }
-            }
-            
-            if (valid_traceback_start) {
-                // We can start a traceback here.
+        DPResult& result = dp(false);
+        MultipathProblem& problem = result.problem;
+        int32_t& opt_score = result.opt_score;
+        
+        if (!disjoint_seeded) {
+            // Have a queue just for end positions
+            find_traceback_ends();
+            for (const int64_t& i : traceback_ends) {
                 
                 // The score penalty for starting here is the optimal score minus the optimal score starting here
-                auto penalty = opt_score - (problem.prefix_score[i] + multipath_aln.subpath(i).score());
+                auto penalty = opt_score - (problem.prefix_score[i] + multipath_aln->subpath(i).score());
                 
                 // The path is just to be here
                 step_list_t starting_path{i};
@@ -616,28 +723,30 @@ namespace vg {
                 cerr << "Could end at subpath " << i << " with penalty " << penalty << endl;
 #endif
                 
-                end_queue.push(make_pair(penalty, starting_path));
+                disjoint_end_queue.push(make_pair(penalty, starting_path));
             }
+            
+            // Keep a bit vector of the subpaths that have been used, so we can reject
+            // them. TODO: We get the optimal alignment for each end, subject to
+            // the constraint, but any other subpath may be used in a suboptimal
+            // alignment for that subpath, and we may never see its optimal
+            // alignment.
+            subpath_is_used.assign(num_subpaths, false);
+            
+            disjoint_seeded = true;
         }
         
-        // Keep a bit vector of the subpaths that have been used, so we can reject
-        // them. TODO: We get the optimal alignment for each end, subject to
-        // the constraint, but any other subpath may be used in a suboptimal
-        // alignment for that subpath, and we may never see its optimal
-        // alignment.
-        vector<bool> subpath_is_used(multipath_aln.subpath_size(), false);
-        
-        while (!end_queue.empty() && to_return.size() < count) {
+        while (!disjoint_end_queue.empty() && disjoint_alns.size() < count) {
             // For each distinct ending subpath in the multipath
             
 #ifdef debug_multiple_tracebacks
-            cerr << "Look for alignment " << to_return.size() << " ending with " << end_queue.min().second.front() << endl;
+            cerr << "Look for alignment " << disjoint_alns.size() << " ending with " << disjoint_end_queue.min().second.front() << endl;
 #endif
             
             // Make a real queue for starting from it
-            MinMaxHeap<pair<int32_t, step_list_t>> queue;
-            queue.push(end_queue.min());
-            end_queue.pop_min();
+            queue_t queue;
+            queue.push(disjoint_end_queue.min());
+            disjoint_end_queue.pop_min();
             
             if (subpath_is_used[queue.min().second.front()]) {
                 // We shouldn't ever have the place we want to trace back from already used, but if it is already used we don't want to use it.
@@ -653,15 +762,15 @@ namespace vg {
             // subpath has been queued, so we can do a real Dijkstra traversal
             // and not waste all our time on combinatorial paths to get places
             // with the same or higher penalty.
-            vector<size_t> min_penalty_for_subpath(multipath_aln.subpath_size(), numeric_limits<size_t>::max());
+            vector<size_t> min_penalty_for_subpath(num_subpaths, numeric_limits<size_t>::max());
             // Seed with the end we are starting with.
             min_penalty_for_subpath[queue.min().second.front()] = queue.min().first;
             
             // We also track visited-ness, so we don;t query edges for the same thing twice.
             // TODO: This is the world's most hacky Dijkstra and needs to be rewritten from the top with an understanding of what it is supposed to be doing.
-            vector<bool> subpath_is_visited(multipath_aln.subpath_size(), false);
+            vector<bool> subpath_is_visited(num_subpaths, false);
         
-            while (!queue.empty() && to_return.size() < count) {
+            while (!queue.empty() && disjoint_alns.size() < count) {
                 // Each iteration
                 
                 // Grab the best list as our basis
@@ -669,6 +778,7 @@ namespace vg {
                 step_list_t basis;
                 tie(basis_score_difference, basis) = queue.min();
                 queue.pop_min();
+                traceback_steps++;
                 
                 assert(!basis.empty());
                 
@@ -679,7 +789,7 @@ namespace vg {
                 }
                 cerr << "Consider " << basis_size << " element traceback to " << basis.front() << " with penalty "
                      << basis_score_difference << endl;
-                cerr << "\t" << pb2json(multipath_aln.subpath(basis.front()).path()) << endl;
+                cerr << "\t" << pb2json(multipath_aln->subpath(basis.front()).path()) << endl;
 #endif
 
                 if (subpath_is_used[basis.front()]) {
@@ -707,17 +817,12 @@ namespace vg {
                 if (problem.prev_subpath[basis.front()] == -1) {
                     // If it leads all the way to a subpath that is optimal as a start
                     
-                    // Make an Alignment to emit it in
-                    to_return.emplace_back();
-                    Alignment& aln_out = to_return.back();
-                    
-                    // Set up read info and MAPQ
-                    // TODO: MAPQ on secondaries?
-                    transfer_read_metadata(multipath_aln, aln_out);
-                    aln_out.set_mapping_quality(multipath_aln.mapping_quality());
+                    // Make an Alignment to emit it in, the read info gets added on the way out
+                    disjoint_alns.emplace_back();
+                    Alignment& aln_out = disjoint_alns.back();
                     
                     // Populate path
-                    populate_path_from_traceback(multipath_aln, problem, basis.begin(), basis.end(), aln_out.mutable_path());
+                    populate_path_from_traceback(*multipath_aln, problem, basis.begin(), basis.end(), aln_out.mutable_path());
                     
                     // Set score
                     aln_out.set_score(opt_score - basis_score_difference);
@@ -757,7 +862,7 @@ namespace vg {
                         }
                         
                         // For each, compute the score of the optimal alignment ending at that predecessor
-                        auto prev_opt_score = problem.prefix_score[prev] + multipath_aln.subpath(prev).score();
+                        auto prev_opt_score = problem.prefix_score[prev] + multipath_aln->subpath(prev).score();
                         
                         // What's the difference we would take if we went with this predecessor?
                         auto additional_penalty = best_prefix_score - prev_opt_score;
@@ -795,10 +900,22 @@ namespace vg {
             }
         }
         
-        return to_return;
+        return annotated(disjoint_alns, count);
         
     }
     
+    size_t MultipathAlignmentCache::dp_fill_count() const {
+        return dp_fills;
+    }
+    
+    size_t MultipathAlignmentCache::traceback_step_count() const {
+        return traceback_steps;
+    }
+    
+    size_t MultipathAlignmentCache::queued_traceback_count() const {
+        return top_queue.size();
+    }
+    
     /// Stores the reverse complement of a Subpath in another Subpath
     ///
     /// note: this is not included in the header because reversing a subpath without going through
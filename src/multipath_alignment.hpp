@@ -18,6 +18,9 @@
 #include "utility.hpp"
 #include "handle.hpp"
 
+#include <structures/immutable_list.hpp>
+#include <structures/min_max_heap.hpp>
+
 namespace vg {
     
     /// Put subpaths in topological order (assumed to be true for other algorithms)
@@ -86,6 +89,155 @@ namespace vg {
     ///
     vector<Alignment> optimal_alignments_with_disjoint_subpaths(const MultipathAlignment& multipath_aln, size_t count);
     
+    /// We define this struct for holding the dynamic programming problem for a
+    /// multipath alignment, which we use for finding the optimal alignment,
+    /// scoring the optimal alignment, and enumerating the top alignments.
+    struct MultipathProblem {
+        // Score of the optimal alignment ending immediately before this
+        // subpath. To get the score of the optimal alignment ending with the
+        // subpath, add the subpath's score.
+        vector<int32_t> prefix_score;
+        // previous subpath for traceback (we refer to subpaths by their index)
+        vector<int64_t> prev_subpath;
+        // the length of read sequence preceding this subpath
+        vector<int64_t> prefix_length;
+        
+        MultipathProblem() = default;
+        
+        /// Make a new MultipathProblem over the given number of subpaths with scores
+        /// initialized according to whether we're doing a local or global traceback
+        /// from the given start subpaths
+        MultipathProblem(const MultipathAlignment& multipath_aln, const vector<int64_t>& starts,
+                         bool subpath_global);
+    };
+    
+    /// A lazily filled cache of the dynamic programming over one MultipathAlignment.
+    /// The topological order, the DP tables, the optimal tracebacks and the top-k
+    /// enumeration state are computed on first use and kept, so repeated queries on
+    /// the same alignment (scores, optimal alignments, more top alignments) only pay
+    /// for work that has not been done yet.
+    ///
+    /// The cache refers to the MultipathAlignment rather than copying it, so the alignment
+    /// must outlive the cache and must not be moved while the cache is in use. Changes to
+    /// the number of subpaths are noticed automatically; any other change to the subpaths
+    /// requires a call to invalidate(). Changes to the read metadata and mapping quality
+    /// do not, they are copied onto the returned Alignments at query time.
+    ///
+    /// The top-k enumeration keeps only as many partial tracebacks as the largest count
+    /// asked for so far can use. Asking for more than that after some were dropped starts
+    /// the enumeration over, unless max_alignments was given at construction to keep room
+    /// for that many from the start.
+    ///
+    /// Not thread safe: use one cache per thread.
+    class MultipathAlignmentCache {
+    public:
+        explicit MultipathAlignmentCache(const MultipathAlignment& multipath_aln, size_t max_alignments = 0);
+        
+        /// The MultipathAlignment this cache is for
+        const MultipathAlignment& multipath_alignment() const;
+        
+        /// Discard everything computed so far
+        void invalidate();
+        
+        /// The subpath indexes in a topological order of the multipath DAG
+        const vector<int64_t>& topological_order();
+        
+        /// The source subpaths of the multipath DAG (as identify_start_subpaths would find them)
+        const vector<int64_t>& start_subpaths();
+        
+        /// Same as the free function optimal_alignment_score
+        int32_t optimal_alignment_score(bool subpath_global = false);
+        
+        /// Same as the free function optimal_alignment
+        void optimal_alignment(Alignment& aln_out, bool subpath_global = false);
+        
+        /// The path of the highest scoring alignment, as optimal_alignment would produce it
+        const Path& optimal_path(bool subpath_global = false);
+        
+        /// Same as the free function optimal_alignments. Asking for more alignments than a
+        /// previous call resumes the enumeration where that call left off.
+        vector<Alignment> optimal_alignments(size_t count);
+        
+        /// Same as the free function optimal_alignments_with_disjoint_subpaths. Asking for more
+        /// alignments than a previous call resumes the enumeration where that call left off.
+        vector<Alignment> optimal_alignments_with_disjoint_subpaths(size_t count);
+        
+        /// The number of times a DP problem has been filled for this cache
+        size_t dp_fill_count() const;
+        
+        /// The number of partial tracebacks taken off a queue while enumerating alignments
+        size_t traceback_step_count() const;
+        
+        /// The number of partial tracebacks waiting in the top alignment queue
+        size_t queued_traceback_count() const;
+        
+    private:
+        
+        using step_list_t = structures::ImmutableList<int64_t>;
+        using queue_t = structures::MinMaxHeap<pair<int32_t, step_list_t>>;
+        
+        /// A filled DP problem along with its optimal end
+        struct DPResult {
+            bool filled = false;
+            MultipathProblem problem;
+            int64_t opt_subpath = -1;
+            int32_t opt_score = 0;
+            bool traced = false;
+            Path opt_path;
+        };
+        
+        /// Invalidate if the number of subpaths has changed since the cache was filled
+        void check_validity();
+        
+        /// Fill the local or global DP if necessary and return it
+        DPResult& dp(bool subpath_global);
+        
+        /// Fill the optimal traceback of the local or global DP if necessary and return it
+        DPResult& traced_dp(bool subpath_global);
+        
+        /// Compute the predecessor lists and the subpaths that tracebacks may start from
+        void find_traceback_ends();
+        
+        /// Copy cached unannotated alignments and add the read's metadata to them
+        vector<Alignment> annotated(const vector<Alignment>& alns, size_t count) const;
+        
+        /// Add a partial traceback to the top alignment queue, dropping any that cannot
+        /// be among the top_limit alignments
+        void enqueue_top(const pair<int32_t, step_list_t>& item);
+        
+        const MultipathAlignment* multipath_aln;
+        size_t num_subpaths;
+        
+        bool have_order = false;
+        vector<int64_t> order;
+        bool have_starts = false;
+        vector<int64_t> starts;
+        
+        DPResult local_dp;
+        DPResult global_dp;
+        
+        bool have_traceback_ends = false;
+        vector<vector<int64_t>> prev_subpaths;
+        vector<int64_t> traceback_ends;
+        
+        // state of the top alignment enumeration
+        bool top_seeded = false;
+        size_t top_limit = 0;
+        bool top_trimmed = false;
+        queue_t top_queue;
+        vector<Alignment> top_alns;
+        
+        // state of the disjoint subpath enumeration
+        bool disjoint_seeded = false;
+        queue_t disjoint_end_queue;
+        vector<bool> subpath_is_used;
+        vector<Alignment> disjoint_alns;
+        
+        // how much work has been done, kept across invalidation
+        size_t dp_fills = 0;
+        size_t traceback_steps = 0;
+    };
+    
     /// Stores the reverse complement of a MultipathAlignment in another MultipathAlignment
     ///
     ///  Args:
@@ -11,6 +11,7 @@
 //#define debug_pretty_print_alignments
 
 #include "multipath_mapper.hpp"
+#include "stage_stats.hpp"
 #include "multipath_alignment_graph.hpp"
 
 #include "algorithms/topological_sort.hpp"
@@ -195,7 +196,7 @@ namespace vg {
             }
             
 #ifdef debug_multipath_mapper_alignment
-            cerr << "performing alignment to subgraph " << pb2json(get<0>(cluster_graph)->graph) << endl;
+            cerr << "performing alignment to subgraph of " << get<0>(cluster_graph)->node_size() << " nodes" << endl;
 #endif
             
             multipath_alns_out.emplace_back();
@@ -353,6 +354,7 @@ namespace vg {
     
     bool MultipathMapper::attempt_rescue(const MultipathAlignment& multipath_aln, const Alignment& other_aln,
                                          bool rescue_forward, MultipathAlignment& rescue_multipath_aln) {
+        VG_TIME_STAGE(STAGE_RESCUE);
         
 #ifdef debug_multipath_mapper
         cerr << "attemping pair rescue in " << (rescue_forward ? "forward" : "backward") << " direction from " << pb2json(multipath_aln) << endl;
@@ -476,21 +478,31 @@ namespace vg {
     }
     
     bool MultipathMapper::likely_mismapping(const MultipathAlignment& multipath_aln) {
+        MultipathAlignmentCache multipath_aln_cache(multipath_aln);
+        return likely_mismapping(multipath_aln_cache);
+    }
+    
+    bool MultipathMapper::likely_mismapping(MultipathAlignmentCache& multipath_aln_cache) {
     
+        const MultipathAlignment& multipath_aln = multipath_aln_cache.multipath_alignment();
+        
         // empirically, we get better results by scaling the pseudo-length down, I have no good explanation for this probabilistically
-        auto p_val = random_match_p_value(pseudo_length(multipath_aln) / 3, multipath_aln.sequence().size());
+        auto p_val = random_match_p_value(pseudo_length(multipath_aln_cache) / 3, multipath_aln.sequence().size());
     
 #ifdef debug_multipath_mapper
-        cerr << "effective match length of read " << multipath_aln.name() << " is " << pseudo_length(multipath_aln) / 3 << " in read length " << multipath_aln.sequence().size() << ", yielding p-value " << p_val << endl;
+        cerr << "effective match length of read " << multipath_aln.name() << " is " << pseudo_length(multipath_aln_cache) / 3 << " in read length " << multipath_aln.sequence().size() << ", yielding p-value " << p_val << endl;
 #endif
         
         return p_val > max_mapping_p_value;
     }
     
     size_t MultipathMapper::pseudo_length(const MultipathAlignment& multipath_aln) const {
-        Alignment alignment;
-        optimal_alignment(multipath_aln, alignment);
-        const Path& path = alignment.path();
+        MultipathAlignmentCache multipath_aln_cache(multipath_aln);
+        return pseudo_length(multipath_aln_cache);
+    }
+    
+    size_t MultipathMapper::pseudo_length(MultipathAlignmentCache& multipath_aln_cache) const {
+        const Path& path = multipath_aln_cache.optimal_path();
         
         int64_t net_matches = 0;
         for (size_t i = 0; i < path.mapping_size(); i++) {
@@ -630,17 +642,172 @@ namespace vg {
         
         adjust_alignments_for_base_quality = reset_quality_adjustments;
     }
-    
+
+    // mix a value into a running checksum (deterministic across runs, unlike std::hash for floating points)
+    static inline void checksum_combine(size_t& checksum, size_t value) {
+        checksum ^= wang_hash_64(value) + 0x9e3779b97f4a7c15ull + (checksum << 6) + (checksum >> 2);
+    }
+
+    static inline void checksum_combine(size_t& checksum, double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        checksum_combine(checksum, (size_t) bits);
+    }
+
+    size_t MultipathMapper::calibration_checksum(bool calibrate_mismapping_detection, size_t num_simulations,
+                                                 size_t simulated_read_length) const {
+        size_t checksum = 0;
+
+        // fingerprint the XG with its summary statistics and an evenly spaced sample of its packed sequence
+        checksum_combine(checksum, xindex->seq_length);
+        checksum_combine(checksum, xindex->node_count);
+        checksum_combine(checksum, xindex->edge_count);
+        checksum_combine(checksum, xindex->path_count);
+        checksum_combine(checksum, (size_t) xindex->get_min_id());
+        checksum_combine(checksum, (size_t) xindex->get_max_id());
+        const uint64_t* seq_data = xindex->sequence_data();
+        size_t num_seq_words = (xindex->sequence_bit_size() + 63) / 64;
+        size_t sample_stride = max<size_t>(num_seq_words / 4096, 1);
+        for (size_t i = 0; i < num_seq_words; i += sample_stride) {
+            checksum_combine(checksum, (size_t) seq_data[i]);
+        }
+
+        // fingerprint the GCSA and LCP array by their dimensions
+        checksum_combine(checksum, (size_t) gcsa->size());
+        checksum_combine(checksum, (size_t) gcsa->order());
+        checksum_combine(checksum, (size_t) lcp->size());
+
+        // the scoring parameters
+        Aligner* aligner = get_regular_aligner();
+        for (size_t i = 0; i < 25; i++) {
+            checksum_combine(checksum, (size_t) aligner->score_matrix[i]);
+        }
+        checksum_combine(checksum, (size_t) aligner->gap_open);
+        checksum_combine(checksum, (size_t) aligner->gap_extension);
+        checksum_combine(checksum, (size_t) aligner->full_length_bonus);
+
+        // the parameters that the calibration mappings depend on
+        checksum_combine(checksum, band_padding_multiplier);
+        checksum_combine(checksum, band_padding_memo_size);
+        checksum_combine(checksum, min_clustering_mem_length);
+        checksum_combine(checksum, (size_t) min_mem_length);
+        checksum_combine(checksum, (size_t) mem_reseed_length);
+        checksum_combine(checksum, fast_reseed_length_diff);
+        checksum_combine(checksum, (size_t) hit_max);
+        checksum_combine(checksum, max_mapping_p_value);
+        checksum_combine(checksum, (size_t) num_mapping_attempts);
+        checksum_combine(checksum, (size_t) num_alt_alns);
+        checksum_combine(checksum, (size_t) max_snarl_cut_size);
+        checksum_combine(checksum, max_suboptimal_path_score_ratio);
+        checksum_combine(checksum, mem_coverage_min_ratio);
+        checksum_combine(checksum, log_likelihood_approx_factor);
+
+        // how the mismapping detection is calibrated, if it is
+        checksum_combine(checksum, (size_t) calibrate_mismapping_detection);
+        if (calibrate_mismapping_detection) {
+            checksum_combine(checksum, num_simulations);
+            checksum_combine(checksum, simulated_read_length);
+        }
+
+        return checksum;
+    }
+
+    void MultipathMapper::save_calibration(ostream& out, size_t checksum) const {
+        out << "#vg mpmap calibration profile" << endl;
+        out << "checksum\t" << checksum << endl;
+        out.precision(17);
+        out << "pseudo_length_multiplier\t" << pseudo_length_multiplier << endl;
+        out << "min_clustering_mem_length\t" << min_clustering_mem_length << endl;
+        out << "band_padding_memo\t" << band_padding_memo.size();
+        for (size_t padding : band_padding_memo) {
+            out << "\t" << padding;
+        }
+        out << endl;
+        if (fragment_length_distr.is_finalized()) {
+            out << "fragment_length_distr\t" << fragment_length_distr.mean() << "\t" << fragment_length_distr.stdev() << endl;
+        }
+    }
+
+    bool MultipathMapper::load_calibration(istream& in, size_t checksum) {
+
+        bool found_checksum = false;
+        double loaded_multiplier = pseudo_length_multiplier;
+        size_t loaded_min_clustering_length = min_clustering_mem_length;
+        vector<size_t> loaded_padding_memo = band_padding_memo;
+        bool loaded_fixed_fragment_distr = false;
+        double loaded_frag_mean = 0.0, loaded_frag_stddev = 1.0;
+
+        string line;
+        while (getline(in, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            stringstream strm(line);
+            string key;
+            strm >> key;
+            if (key == "checksum") {
+                size_t loaded_checksum;
+                strm >> loaded_checksum;
+                if (!strm || loaded_checksum != checksum) {
+                    return false;
+                }
+                found_checksum = true;
+            }
+            else if (key == "pseudo_length_multiplier") {
+                strm >> loaded_multiplier;
+            }
+            else if (key == "min_clustering_mem_length") {
+                strm >> loaded_min_clustering_length;
+            }
+            else if (key == "band_padding_memo") {
+                size_t memo_size;
+                strm >> memo_size;
+                loaded_padding_memo.resize(memo_size);
+                for (size_t i = 0; i < memo_size; i++) {
+                    strm >> loaded_padding_memo[i];
+                }
+            }
+            else if (key == "fragment_length_distr") {
+                strm >> loaded_frag_mean >> loaded_frag_stddev;
+                loaded_fixed_fragment_distr = true;
+            }
+            if (!strm) {
+                cerr << "error:[MultipathMapper] malformed line in calibration profile: " << line << endl;
+                return false;
+            }
+        }
+
+        if (!found_checksum) {
+            return false;
+        }
+
+        pseudo_length_multiplier = loaded_multiplier;
+        min_clustering_mem_length = loaded_min_clustering_length;
+        band_padding_memo = move(loaded_padding_memo);
+        if (loaded_fixed_fragment_distr) {
+            force_fragment_length_distr(loaded_frag_mean, loaded_frag_stddev);
+        }
+        // p-values computed before loading used the old multiplier
+        p_value_memo.clear();
+
+        return true;
+    }
+
     int64_t MultipathMapper::distance_between(const MultipathAlignment& multipath_aln_1,
                                               const MultipathAlignment& multipath_aln_2,
                                               bool full_fragment, bool forward_strand) const {
-        Alignment aln_1;
-        optimal_alignment(multipath_aln_1, aln_1);
-        pos_t pos_1 = initial_position(aln_1.path());
+        MultipathAlignmentCache multipath_aln_cache_1(multipath_aln_1);
+        MultipathAlignmentCache multipath_aln_cache_2(multipath_aln_2);
+        return distance_between(multipath_aln_cache_1, multipath_aln_cache_2, full_fragment, forward_strand);
+    }
+    
+    int64_t MultipathMapper::distance_between(MultipathAlignmentCache& multipath_aln_cache_1,
+                                              MultipathAlignmentCache& multipath_aln_cache_2,
+                                              bool full_fragment, bool forward_strand) const {
+        pos_t pos_1 = initial_position(multipath_aln_cache_1.optimal_path());
         
-        Alignment aln_2;
-        optimal_alignment(multipath_aln_2, aln_2);
-        pos_t pos_2 = full_fragment ? final_position(aln_2.path()) : initial_position(aln_2.path());
+        const Path& path_2 = multipath_aln_cache_2.optimal_path();
+        pos_t pos_2 = full_fragment ? final_position(path_2) : initial_position(path_2);
 #ifdef debug_multipath_mapper
         cerr << "measuring left-to-" << (full_fragment ? "right" : "left") << " end distance between " << pos_1 << " and " << pos_2 << endl;
 #endif
@@ -805,21 +972,33 @@ namespace vg {
         
         int32_t max_score_diff = get_aligner()->mapping_quality_score_diff(max_mapping_quality);
         
-        int32_t top_score_1 = multipath_alns_1.empty() ? 0 : optimal_alignment_score(multipath_alns_1.front());
-        int32_t top_score_2 = multipath_alns_2.empty() ? 0 : optimal_alignment_score(multipath_alns_2.front());
+        // the same alignments get scored, traced back and compared to each other several times below,
+        // so we keep their DP results around (the vectors are not resized while these are in use)
+        vector<MultipathAlignmentCache> multipath_aln_caches_1, multipath_aln_caches_2;
+        multipath_aln_caches_1.reserve(multipath_alns_1.size());
+        multipath_aln_caches_2.reserve(multipath_alns_2.size());
+        for (const MultipathAlignment& multipath_aln : multipath_alns_1) {
+            multipath_aln_caches_1.emplace_back(multipath_aln);
+        }
+        for (const MultipathAlignment& multipath_aln : multipath_alns_2) {
+            multipath_aln_caches_2.emplace_back(multipath_aln);
+        }
+        
+        int32_t top_score_1 = multipath_alns_1.empty() ? 0 : multipath_aln_caches_1.front().optimal_alignment_score();
+        int32_t top_score_2 = multipath_alns_2.empty() ? 0 : multipath_aln_caches_2.front().optimal_alignment_score();
         
         size_t num_rescuable_alns_1 = block_rescue_from_1 ? 0 : min(multipath_alns_1.size(), max_rescue_attempts);
         size_t num_rescuable_alns_2 = block_rescue_from_2 ? 0 : min(multipath_alns_2.size(), max_rescue_attempts);
         for (size_t i = 0; i < num_rescuable_alns_1; i++){
-            if (likely_mismapping(multipath_alns_1[i]) ||
-                (i > 0 ? optimal_alignment_score(multipath_alns_1[i]) < top_score_1 - max_score_diff : false)) {
+            if (likely_mismapping(multipath_aln_caches_1[i]) ||
+                (i > 0 ? multipath_aln_caches_1[i].optimal_alignment_score() < top_score_1 - max_score_diff : false)) {
                 num_rescuable_alns_1 = i;
                 break;
             }
         }
         for (size_t i = 0; i < num_rescuable_alns_2; i++){
-            if (likely_mismapping(multipath_alns_2[i]) ||
-                (i > 0 ? optimal_alignment_score(multipath_alns_2[i]) < top_score_2 - max_score_diff : false)) {
+            if (likely_mismapping(multipath_aln_caches_2[i]) ||
+                (i > 0 ? multipath_aln_caches_2[i].optimal_alignment_score() < top_score_2 - max_score_diff : false)) {
                 num_rescuable_alns_2 = i;
                 break;
             }
@@ -849,6 +1028,16 @@ namespace vg {
             }
         }
         
+        vector<MultipathAlignmentCache> rescue_multipath_aln_caches_1, rescue_multipath_aln_caches_2;
+        rescue_multipath_aln_caches_1.reserve(rescue_multipath_alns_1.size());
+        rescue_multipath_aln_caches_2.reserve(rescue_multipath_alns_2.size());
+        for (const MultipathAlignment& multipath_aln : rescue_multipath_alns_1) {
+            rescue_multipath_aln_caches_1.emplace_back(multipath_aln);
+        }
+        for (const MultipathAlignment& multipath_aln : rescue_multipath_alns_2) {
+            rescue_multipath_aln_caches_2.emplace_back(multipath_aln);
+        }
+        
         bool found_consistent = false;
         if (!rescued_from_1.empty() && !rescued_from_2.empty()) {
 #ifdef debug_multipath_mapper
@@ -868,11 +1057,11 @@ namespace vg {
 #ifdef debug_multipath_mapper
                     cerr << "checking duplication between mapped read1 " << i << " and rescued read1 " << j << endl;
 #endif
-                    if (abs(distance_between(multipath_alns_1[i], rescue_multipath_alns_1[j])) < 20) {
+                    if (abs(distance_between(multipath_aln_caches_1[i], rescue_multipath_aln_caches_1[j])) < 20) {
 #ifdef debug_multipath_mapper
                         cerr << "found duplicate, now checking rescued read2 " << i << " and mapped read2 " << j << endl;
 #endif
-                        if (abs(distance_between(rescue_multipath_alns_2[i], multipath_alns_2[j])) < 20) {
+                        if (abs(distance_between(rescue_multipath_aln_caches_2[i], multipath_aln_caches_2[j])) < 20) {
 #ifdef debug_multipath_mapper
                             cerr << "found duplicate, marking entire pair as duplicate" << endl;
 #endif
@@ -881,7 +1070,7 @@ namespace vg {
                             found_duplicate.insert(j);
                             
                             // move the original mappings
-                            int64_t dist = distance_between(multipath_alns_1[i], multipath_alns_2[j], true);
+                            int64_t dist = distance_between(multipath_aln_caches_1[i], multipath_aln_caches_2[j], true);
                             if (dist != numeric_limits<int64_t>::max() && dist >= 0) {
                                 multipath_aln_pairs_out.emplace_back(move(multipath_alns_1[i]), move(multipath_alns_2[j]));
                                 pair_distances.emplace_back(make_pair(cluster_idxs_1[i], cluster_idxs_2[j]), dist);
@@ -895,7 +1084,7 @@ namespace vg {
                 
                 // if we haven't already moved the pair and marked it as a duplicate, move the rescued pair into the output vector
                 if (!duplicate) {
-                    int64_t dist = distance_between(multipath_alns_1[i], rescue_multipath_alns_2[i], true);
+                    int64_t dist = distance_between(multipath_aln_caches_1[i], rescue_multipath_aln_caches_2[i], true);
                     if (dist != numeric_limits<int64_t>::max() && dist >= 0) {
 #ifdef debug_multipath_mapper
                         cerr << "adding read1 and rescued read2 " << i << " to output vector" << endl;
@@ -913,7 +1102,7 @@ namespace vg {
                     // we already moved it as part of a duplicate pair
                     continue;
                 }
-                int64_t dist = distance_between(rescue_multipath_alns_1[j], multipath_alns_2[j], true);
+                int64_t dist = distance_between(rescue_multipath_aln_caches_1[j], multipath_aln_caches_2[j], true);
                 if (dist != numeric_limits<int64_t>::max() && dist >= 0) {
 #ifdef debug_multipath_mapper
                     cerr << "adding rescued read1 and read2 " << j << " to output vector" << endl;
@@ -929,7 +1118,7 @@ namespace vg {
             cerr << "successfully rescued from only read 1" << endl;
 #endif
             for (size_t i: rescued_from_1) {
-                int64_t dist = distance_between(multipath_alns_1[i], rescue_multipath_alns_2[i], true);
+                int64_t dist = distance_between(multipath_aln_caches_1[i], rescue_multipath_aln_caches_2[i], true);
                 if (dist != numeric_limits<int64_t>::max() && dist >= 0) {
                     multipath_aln_pairs_out.emplace_back(move(multipath_alns_1[i]), move(rescue_multipath_alns_2[i]));
                     pair_distances.emplace_back(make_pair(cluster_idxs_1[i], cluster_graphs2.size()), dist);
@@ -942,7 +1131,7 @@ namespace vg {
             cerr << "successfully rescued from only read 2" << endl;
 #endif
             for (size_t i : rescued_from_2) {
-                int64_t dist = distance_between(rescue_multipath_alns_1[i], multipath_alns_2[i], true);
+                int64_t dist = distance_between(rescue_multipath_aln_caches_1[i], multipath_aln_caches_2[i], true);
                 if (dist != numeric_limits<int64_t>::max() && dist >= 0) {
                     multipath_aln_pairs_out.emplace_back(move(rescue_multipath_alns_1[i]), move(multipath_alns_2[i]));
                     pair_distances.emplace_back(make_pair(cluster_graphs1.size(), cluster_idxs_2[i]), dist);
@@ -1676,14 +1865,22 @@ namespace vg {
     
     void MultipathMapper::reduce_to_single_path(const MultipathAlignment& multipath_aln, vector<Alignment>& alns_out,
                                                 size_t max_alt_mappings) const {
+        MultipathAlignmentCache multipath_aln_cache(multipath_aln);
+        reduce_to_single_path(multipath_aln_cache, alns_out, max_alt_mappings);
+    }
     
+    void MultipathMapper::reduce_to_single_path(MultipathAlignmentCache& multipath_aln_cache, vector<Alignment>& alns_out,
+                                                size_t max_alt_mappings) const {
+    
+        const MultipathAlignment& multipath_aln = multipath_aln_cache.multipath_alignment();
+        
 #ifdef debug_multipath_mapper
         cerr << "linearizing multipath alignment" << endl;
 #endif        
         // Compute a few optimal alignments using disjoint sets of subpaths.
         // This hopefully gives us a feel for the positional diversity of the MultipathMapping.
         // But we still may have duplicates or overlaps in vg node space.
-        auto alns = optimal_alignments_with_disjoint_subpaths(multipath_aln, max_alt_mappings + 1);
+        auto alns = multipath_aln_cache.optimal_alignments_with_disjoint_subpaths(max_alt_mappings + 1);
         
         if (alns.empty()) {
             // This happens only if the read is totally unmapped
@@ -2428,14 +2625,14 @@ namespace vg {
             auto prev_1 = previous_multipath_alns_1.find(cluster_pair.first.first);
             if (prev_1 == previous_multipath_alns_1.end()) {
                 // we haven't done this alignment yet, so we have to complete it for the first time
-                VG* vg1 = get<0>(cluster_graphs1[cluster_pair.first.first]);
+                SubHandleGraph* graph1 = get<0>(cluster_graphs1[cluster_pair.first.first]);
                 memcluster_t& graph_mems1 = get<1>(cluster_graphs1[cluster_pair.first.first]);
                 
 #ifdef debug_multipath_mapper
-                cerr << "performing alignment to subgraph " << pb2json(vg1->graph) << endl;
+                cerr << "performing alignment to subgraph of " << graph1->node_size() << " nodes" << endl;
 #endif
                 
-                multipath_align(alignment1, vg1, graph_mems1, multipath_aln_pairs_out.back().first);
+                multipath_align(alignment1, graph1, graph_mems1, multipath_aln_pairs_out.back().first);
                 
                 // keep track of the fact that we have completed this multipath alignment
                 previous_multipath_alns_1[cluster_pair.first.first] = i;
@@ -2453,14 +2650,14 @@ namespace vg {
             auto prev_2 = previous_multipath_alns_2.find(cluster_pair.first.second);
             if (prev_2 == previous_multipath_alns_2.end()) {
                 // we haven't done this alignment yet, so we have to complete it for the first time
-                VG* vg2 = get<0>(cluster_graphs2[cluster_pair.first.second]);
+                SubHandleGraph* graph2 = get<0>(cluster_graphs2[cluster_pair.first.second]);
                 memcluster_t& graph_mems2 = get<1>(cluster_graphs2[cluster_pair.first.second]);
                 
 #ifdef debug_multipath_mapper
-                cerr << "performing alignment to subgraph " << pb2json(vg2->graph) << endl;
+                cerr << "performing alignment to subgraph of " << graph2->node_size() << " nodes" << endl;
 #endif
                 
-                multipath_align(alignment2, vg2, graph_mems2, multipath_aln_pairs_out.back().second);
+                multipath_align(alignment2, graph2, graph_mems2, multipath_aln_pairs_out.back().second);
                 
                 // keep track of the fact that we have completed this multipath alignment
                 previous_multipath_alns_2[cluster_pair.first.second] = i;
@@ -2517,6 +2714,7 @@ namespace vg {
     auto MultipathMapper::query_cluster_graphs(const Alignment& alignment,
                                                const vector<MaximalExactMatch>& mems,
                                                const vector<memcluster_t>& clusters) -> vector<clustergraph_t> {
+        VG_TIME_STAGE(STAGE_SUBGRAPH_EXTRACTION);
         
         // Figure out the aligner to use
         BaseAligner* aligner = get_aligner();
@@ -2529,7 +2727,7 @@ namespace vg {
         unordered_map<id_t, size_t> node_id_to_cluster;
         
         // to hold the clusters as they are (possibly) merged
-        unordered_map<size_t, VG*> cluster_graphs;
+        unordered_map<size_t, SubHandleGraph*> cluster_graphs;
         
         // to keep track of which clusters have been merged
         UnionFind union_find(clusters.size());
@@ -2569,21 +2767,22 @@ namespace vg {
             // TODO: a progressive expansion of the subgraph if the MEM hit is already contained in
             // a cluster graph somewhere?
             
-            // extract the subgraph within the search distance
+            // find the subgraph within the search distance, which we only view in the XG rather than copy,
+            // keeping only the edges that the search traversed
+            
+            unordered_set<edge_t> traversed_edges;
+            vector<id_t> reached_node_ids = algorithms::containing_graph_node_ids(xindex, positions,
+                                                                                  forward_max_dist,
+                                                                                  backward_max_dist,
+                                                                                  &traversed_edges);
+            SubHandleGraph* cluster_graph = new SubHandleGraph(xindex, move(reached_node_ids), traversed_edges);
             
-            VG* cluster_graph = new VG();
-            algorithms::extract_containing_graph(xindex, cluster_graph, positions, forward_max_dist,
-                                                 backward_max_dist);
-            Graph& graph = cluster_graph->graph;
-
-                                                 
             // check if this subgraph overlaps with any previous subgraph (indicates a probable clustering failure where
             // one cluster was split into multiple clusters)
             unordered_set<size_t> overlapping_graphs;
             
             if (!suppress_cluster_merging) {
-                for (size_t j = 0; j < graph.node_size(); j++) {
-                    id_t node_id = graph.node(j).id();
+                for (const id_t& node_id : cluster_graph->node_ids()) {
                     if (node_id_to_cluster.count(node_id)) {
                         overlapping_graphs.insert(node_id_to_cluster[node_id]);
                     }
@@ -2627,7 +2826,7 @@ namespace vg {
                 cerr << "merging as cluster " << remaining_idx << endl;
 #endif
                 
-                VG* merging_graph;
+                SubHandleGraph* merging_graph;
                 if (remaining_idx == i) {
                     // the new graph was chosen to remain, so add it to the record
                     cluster_graphs[i] = cluster_graph;
@@ -2636,23 +2835,22 @@ namespace vg {
                 else {
                     // the new graph will be merged into an existing graph
                     merging_graph = cluster_graphs[remaining_idx];
-                    merging_graph->extend(graph);
+                    merging_graph->extend(*cluster_graph);
                     delete cluster_graph;
                 }
                 
                 // merge any other chained graphs into the remaining graph
                 for (size_t j : overlapping_graphs) {
                     if (j != remaining_idx) {
-                        VG* removing_graph = cluster_graphs[j];
-                        merging_graph->extend(removing_graph->graph);
+                        SubHandleGraph* removing_graph = cluster_graphs[j];
+                        merging_graph->extend(*removing_graph);
                         delete removing_graph;
                         cluster_graphs.erase(j);
                     }
                 }
                 
-                Graph& merged_graph = merging_graph->graph;
-                for (size_t j = 0; j < merged_graph.node_size(); j++) {
-                    node_id_to_cluster[merged_graph.node(j).id()] = remaining_idx;
+                for (const id_t& node_id : merging_graph->node_ids()) {
+                    node_id_to_cluster[node_id] = remaining_idx;
                 }
             }
         }
@@ -2665,7 +2863,7 @@ namespace vg {
         unordered_map<size_t, vector<size_t>> multicomponent_splits;
         
         size_t max_graph_idx = 0;
-        for (const pair<size_t, VG*> cluster_graph : cluster_graphs) {
+        for (const pair<size_t, SubHandleGraph*> cluster_graph : cluster_graphs) {
             vector<unordered_set<id_t>> connected_components = algorithms::weakly_connected_components(cluster_graph.second);
             if (connected_components.size() > 1) {
                 multicomponent_graphs.emplace_back(cluster_graph.first, std::move(connected_components));
@@ -2688,46 +2886,20 @@ namespace vg {
             }
 #endif
             
+            // divvy up the nodes (the edges between them come along in the view)
+            SubHandleGraph* splitting_graph = cluster_graphs[multicomponent_graph.first];
             for (size_t i = 0; i < multicomponent_graph.second.size(); i++) {
-                cluster_graphs[max_graph_idx + i] = new VG();
-            }
-            
-            Graph& joined_graph = cluster_graphs[multicomponent_graph.first]->graph;
-            
-            // divvy up the nodes
-            for (size_t i = 0; i < joined_graph.node_size(); i++) {
-                const Node& node = joined_graph.node(i);
-                for (size_t j = 0; j < multicomponent_graph.second.size(); j++) {
-                    if (multicomponent_graph.second[j].count(node.id())) {
-                        cluster_graphs[max_graph_idx + j]->add_node(node);
-                        // if we're suppressing cluster merging, we don't maintain this index
-                        if (!suppress_cluster_merging) {
-                            node_id_to_cluster[node.id()] = max_graph_idx + j;
-                        }
-                        break;
-                    }
-                }
-            }
-            
-            // divvy up the edges
-            for (size_t i = 0; i < joined_graph.edge_size(); i++) {
-                const Edge& edge = joined_graph.edge(i);
-                for (size_t j = 0; j < multicomponent_graph.second.size(); j++) {
-                    if (multicomponent_graph.second[j].count(edge.from())) {
-                        cluster_graphs[max_graph_idx + j]->add_edge(edge);
-                        break;
+                const unordered_set<id_t>& component = multicomponent_graph.second[i];
+                vector<id_t> component_ids(component.begin(), component.end());
+                cluster_graphs[max_graph_idx + i] = new SubHandleGraph(splitting_graph->subgraph(move(component_ids)));
+                // if we're suppressing cluster merging, we don't maintain this index
+                if (!suppress_cluster_merging) {
+                    for (const id_t& node_id : component) {
+                        node_id_to_cluster[node_id] = max_graph_idx + i;
                     }
                 }
             }
             
-#ifdef debug_multipath_mapper
-            cerr << "split graphs:" << endl;
-            for (size_t i = 0; i < multicomponent_graph.second.size(); i++) {
-                cerr << "component " << max_graph_idx + i << ":" << endl;
-                cerr << pb2json(cluster_graphs[max_graph_idx + i]->graph) << endl;
-            }
-#endif
-            
             // remove the old graph
             delete cluster_graphs[multicomponent_graph.first];
             cluster_graphs.erase(multicomponent_graph.first);
@@ -2791,9 +2963,8 @@ namespace vg {
             // identify all of the clusters that contain each node
             unordered_map<id_t, vector<size_t>> node_id_to_cluster_idxs;
             for (size_t i = 0; i < cluster_graphs_out.size(); i++) {
-                Graph& graph = get<0>(cluster_graphs_out[i])->graph;
-                for (size_t j = 0; j < graph.node_size(); j++) {
-                    node_id_to_cluster_idxs[graph.node(j).id()].push_back(i);
+                for (const id_t& node_id : get<0>(cluster_graphs_out[i])->node_ids()) {
+                    node_id_to_cluster_idxs[node_id].push_back(i);
                 }
             }
             
@@ -2844,7 +3015,7 @@ namespace vg {
             
         // find the node ID range for the cluster graphs to help set up a stable, system-independent ordering
         // note: technically this is not quite a total ordering, but it should be close to one
-        unordered_map<VG*, pair<id_t, id_t>> node_range;
+        unordered_map<SubHandleGraph*, pair<id_t, id_t>> node_range;
         node_range.reserve(cluster_graphs_out.size());
         for (const auto& cluster_graph : cluster_graphs_out) {
             node_range[get<0>(cluster_graph)] = make_pair(get<0>(cluster_graph)->min_node_id(),
@@ -2865,9 +3036,10 @@ namespace vg {
         
     }
     
-    void MultipathMapper::multipath_align(const Alignment& alignment, VG* vg,
+    void MultipathMapper::multipath_align(const Alignment& alignment, const SubHandleGraph* graph,
                                           memcluster_t& graph_mems,
                                           MultipathAlignment& multipath_aln_out) const {
+        VG_TIME_STAGE(STAGE_ALIGNMENT);
 
 #ifdef debug_multipath_mapper_alignment
         cerr << "constructing alignment graph" << endl;
@@ -2878,10 +3050,9 @@ namespace vg {
         
         // convert from bidirected to directed
         unordered_map<id_t, pair<id_t, bool> > node_trans;
-        VG align_graph;
         
         // check if we can get away with using only one strand of the graph
-        bool use_single_stranded = algorithms::is_single_stranded(vg);
+        bool use_single_stranded = algorithms::is_single_stranded(graph);
         bool mem_strand = false;
         if (use_single_stranded) {
             mem_strand = is_rev(graph_mems[0].second);
@@ -2892,39 +3063,54 @@ namespace vg {
                 }
             }
         }
+        bool is_dag = algorithms::is_directed_acyclic(graph);
         
         // make the graph we need to align to
 #ifdef debug_multipath_mapper_alignment
-        cerr << "use_single_stranded: " << use_single_stranded << " mem_strand: " << mem_strand << endl;
-#endif
-        if (use_single_stranded) {
-            if (mem_strand) {
-                align_graph = vg->reverse_complement_graph(node_trans);
+        cerr << "use_single_stranded: " << use_single_stranded << " mem_strand: " << mem_strand << " is_dag: " << is_dag << endl;
+#endif
+        VG split_graph;
+        const HandleGraph* align_graph = &split_graph;
+        if (use_single_stranded && !mem_strand && is_dag) {
+            // the MEMs are all on the forward strand of a single-stranded DAG, so we can align
+            // to the view itself with a trivial node translation
+            align_graph = graph;
+            graph->for_each_handle([&](const handle_t& handle) {
+                id_t node_id = graph->get_id(handle);
+                node_trans[node_id] = make_pair(node_id, false);
+            });
+        }
+        else {
+            if (use_single_stranded) {
+                // copy only the strand of the view that the MEMs are on out of the XG, keeping the node IDs and
+                // making a trivial (or reversing) node translation so the later code's expectations are met
+                graph->for_each_handle([&](const handle_t& handle) {
+                    id_t node_id = graph->get_id(handle);
+                    split_graph.create_handle(graph->get_sequence(mem_strand ? graph->flip(handle) : handle), node_id);
+                    node_trans[node_id] = make_pair(node_id, mem_strand);
+                });
+                graph->for_each_handle([&](const handle_t& handle) {
+                    handle_t from = split_graph.get_handle(graph->get_id(handle));
+                    // there are no reversing edges, so this strand only leads to the same strand
+                    graph->follow_edges(mem_strand ? graph->flip(handle) : handle, false, [&](const handle_t& next) {
+                        split_graph.create_edge(from, split_graph.get_handle(graph->get_id(next)));
+                    });
+                });
             }
             else {
-                // if we are using only the forward strand of the current graph, a make trivial node translation so
-                // the later code's expectations are met
-                // TODO: can we do this without the copy constructor?
-                align_graph = *vg;
-                vg->identity_translation(node_trans);
+                node_trans = algorithms::split_strands(graph, &split_graph);
+            }
+            
+            // if necessary, convert from cyclic to acylic
+            if (!is_dag) {
+                unordered_map<id_t, pair<id_t, bool> > dagify_trans;
+                split_graph = split_graph.dagify(target_length, // high enough that num SCCs is never a limiting factor
+                                                 dagify_trans,
+                                                 target_length,
+                                                 0); // no maximum on size of component
+                node_trans = split_graph.overlay_node_translations(dagify_trans, node_trans);
             }
         }
-        else {
-            node_trans = algorithms::split_strands(vg, &align_graph);
-        }
-
-        // if necessary, convert from cyclic to acylic
-        if (!algorithms::is_directed_acyclic(vg)) {
-            unordered_map<id_t, pair<id_t, bool> > dagify_trans;
-            align_graph = align_graph.dagify(target_length, // high enough that num SCCs is never a limiting factor
-                                             dagify_trans,
-                                             target_length,
-                                             0); // no maximum on size of component
-            node_trans = align_graph.overlay_node_translations(dagify_trans, node_trans);
-        }
-        
-        // put the internal graph in topological order for the MultipathAlignmentGraph algorithm
-        algorithms::lazier_sort(&align_graph);
         
 #ifdef debug_multipath_mapper_alignment
         cerr << "making multipath alignment MEM graph" << endl;
@@ -2933,7 +3119,7 @@ namespace vg {
         // construct a graph that summarizes reachability between MEMs
         // First we need to reverse node_trans
         auto node_inj = MultipathAlignmentGraph::create_injection_trans(node_trans);
-        MultipathAlignmentGraph multi_aln_graph(align_graph, graph_mems, node_trans, node_inj, gcsa);
+        MultipathAlignmentGraph multi_aln_graph(*align_graph, graph_mems, node_trans, node_inj, gcsa);
         
         {
             // Compute a topological order over the graph
@@ -2975,7 +3161,7 @@ namespace vg {
         };
         
         // do the connecting alignments and fill out the MultipathAlignment object
-        multi_aln_graph.align(alignment, align_graph, get_aligner(), true, num_alt_alns, dynamic_max_alt_alns, choose_band_padding, multipath_aln_out);
+        multi_aln_graph.align(alignment, *align_graph, get_aligner(), true, num_alt_alns, dynamic_max_alt_alns, choose_band_padding, multipath_aln_out);
         
         
 #ifdef debug_multipath_mapper_alignment
@@ -3135,6 +3321,7 @@ namespace vg {
     void MultipathMapper::sort_and_compute_mapping_quality(vector<MultipathAlignment>& multipath_alns,
                                                            MappingQualityMethod mapq_method,
                                                            vector<size_t>* cluster_idxs) const {
+        VG_TIME_STAGE(STAGE_MAPQ);
         if (multipath_alns.empty()) {
             return;
         }
@@ -3173,7 +3360,8 @@ namespace vg {
             // alignments if we are doing multiple alignments for population
             // scoring.
             auto wanted_alignments = query_population ? population_max_paths : 1;
-            auto alignments = optimal_alignments(multipath_alns[i], wanted_alignments);
+            MultipathAlignmentCache multipath_aln_cache(multipath_alns[i]);
+            auto alignments = multipath_aln_cache.optimal_alignments(wanted_alignments);
             assert(!alignments.empty());
             
 #ifdef debug_multipath_mapper
@@ -3342,7 +3530,7 @@ namespace vg {
         cerr << "scores obtained of multi-mappings:" << endl;
         for (size_t i = 0; i < scores.size(); i++) {
             Alignment aln;
-            optimal_alignment(multipath_alns[i], aln);
+            MultipathAlignmentCache(multipath_alns[i]).optimal_alignment(aln);
             cerr << "\t" << scores[i] << " " << make_pos_t(aln.path().mapping(0).position()) << endl;
         }
 #endif
@@ -3359,6 +3547,7 @@ namespace vg {
     void MultipathMapper::sort_and_compute_mapping_quality(vector<pair<MultipathAlignment, MultipathAlignment>>& multipath_aln_pairs,
                                                            vector<pair<pair<size_t, size_t>, int64_t>>& cluster_pairs,
                                                            vector<pair<size_t, size_t>>* duplicate_pairs_out) const {
+        VG_TIME_STAGE(STAGE_MAPQ);
         
 #ifdef debug_multipath_mapper
         cerr << "Sorting and computing mapping qualities for paired reads" << endl;
@@ -3401,8 +3590,10 @@ namespace vg {
             // Generate the top alignments on each side, or the top
             // population_max_paths alignments if we are doing multiple
             // alignments for population scoring.
-            auto alignments1 = optimal_alignments(multipath_aln_pair.first, query_population ? population_max_paths : 1);
-            auto alignments2 = optimal_alignments(multipath_aln_pair.second, query_population ? population_max_paths : 1);
+            MultipathAlignmentCache multipath_aln_cache_1(multipath_aln_pair.first);
+            MultipathAlignmentCache multipath_aln_cache_2(multipath_aln_pair.second);
+            auto alignments1 = multipath_aln_cache_1.optimal_alignments(query_population ? population_max_paths : 1);
+            auto alignments2 = multipath_aln_cache_2.optimal_alignments(query_population ? population_max_paths : 1);
             assert(!alignments1.empty());
             assert(!alignments2.empty());
             
@@ -3547,14 +3738,17 @@ namespace vg {
 #ifdef debug_multipath_mapper
         cerr << "scores and distances obtained of multi-mappings:" << endl;
         for (int i = 0; i < multipath_aln_pairs.size(); i++) {
+            // the scores come from the same DPs as the alignments
+            MultipathAlignmentCache multipath_aln_cache_1(multipath_aln_pairs[i].first);
+            MultipathAlignmentCache multipath_aln_cache_2(multipath_aln_pairs[i].second);
             Alignment aln1, aln2;
-            optimal_alignment(multipath_aln_pairs[i].first, aln1);
-            optimal_alignment(multipath_aln_pairs[i].second, aln2);
+            multipath_aln_cache_1.optimal_alignment(aln1);
+            multipath_aln_cache_2.optimal_alignment(aln2);
             auto start1 = aln1.path().mapping(0).position().node_id();
             auto start2 = aln2.path().mapping(0).position().node_id();
         
             cerr << "\tpos:" << start1 << "(" << aln1.score() << ")-" << start2 << "(" << aln2.score() << ")"
-                << " align:" << optimal_alignment_score(multipath_aln_pairs[i].first) + optimal_alignment_score(multipath_aln_pairs[i].second)
+                << " align:" << multipath_aln_cache_1.optimal_alignment_score() + multipath_aln_cache_2.optimal_alignment_score()
             << ", length: " << cluster_pairs[i].second;
             if (include_population_component && all_paths_pop_consistent) {
                 cerr << ", pop: " << scores[i] - base_scores[i];
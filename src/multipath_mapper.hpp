@@ -20,6 +20,7 @@
 #include "edit.hpp"
 #include "snarls.hpp"
 #include "haplotypes.hpp"
+#include "sub_handle_graph.hpp"
 
 #include "algorithms/extract_containing_graph.hpp"
 #include "algorithms/extract_connecting_graph.hpp"
@@ -74,6 +75,10 @@ namespace vg {
         /// Even if the read is unmapped, there will always be at least one (possibly score 0) output alignment.
         void reduce_to_single_path(const MultipathAlignment& multipath_aln, vector<Alignment>& alns_out, size_t max_alt_mappings) const;
         
+        /// Same as above, but reusing whatever DP the cache has already filled for the MultipathAlignment
+        void reduce_to_single_path(MultipathAlignmentCache& multipath_aln_cache, vector<Alignment>& alns_out,
+                                   size_t max_alt_mappings) const;
+        
         /// Sets the minimum clustering MEM length to the approximate length that a MEM would have to be to
         /// have at most the given probability of occurring in random sequence of the same size as the graph
         void set_automatic_min_clustering_length(double random_mem_probability = 0.5);
@@ -84,7 +89,22 @@ namespace vg {
         
         /// Should be called once after construction, or any time the band padding multiplier is changed
         void init_band_padding_memo();
-        
+
+        /// Returns a checksum of the indexes, of the current parameters that the startup calibration
+        /// depends on, and of the settings the mismapping detection will be calibrated with. Should be
+        /// computed after setting parameters but before any automatic calibration.
+        size_t calibration_checksum(bool calibrate_mismapping_detection = true, size_t num_simulations = 1000,
+                                    size_t simulated_read_length = 150) const;
+
+        /// Write the results of startup calibration (mismapping detection parameter, band padding memo,
+        /// minimum clustering MEM length and a fixed fragment length distribution, if any) to a profile
+        /// that can be reloaded in later runs against the same indexes with the same parameters
+        void save_calibration(ostream& out, size_t checksum) const;
+
+        /// Load a calibration profile written by save_calibration instead of computing it. Returns false
+        /// and leaves the mapper unchanged if the profile's checksum does not match.
+        bool load_calibration(istream& in, size_t checksum);
+
         // parameters
         
         int64_t max_snarl_cut_size = 5;
@@ -135,11 +155,11 @@ namespace vg {
         /// We often pass around clusters of MEMs and their graph positions.
         using memcluster_t = vector<pair<const MaximalExactMatch*, pos_t>>;
         
-        /// This represents a graph for a cluster, and holds a pointer to the
-        /// actual extracted graph, a list of assigned MEMs, and the number of
-        /// bases of read coverage that that MEM cluster provides (which serves
-        /// as a priority).
-        using clustergraph_t = tuple<VG*, memcluster_t, size_t>;
+        /// This represents a graph for a cluster, and holds a pointer to a
+        /// view of the cluster's subgraph in the XG, a list of assigned MEMs,
+        /// and the number of bases of read coverage that that MEM cluster
+        /// provides (which serves as a priority).
+        using clustergraph_t = tuple<SubHandleGraph*, memcluster_t, size_t>;
         
     protected:
         
@@ -232,7 +252,7 @@ namespace vg {
         /// are merged into one subgraph. Returns a vector of all the merged
         /// cluster subgraphs, their MEMs assigned from the mems vector
         /// according to the MEMs' hits, and their read coverages in bp. The
-        /// caller must delete the VG objects produced!
+        /// caller must delete the SubHandleGraph objects produced!
         vector<clustergraph_t> query_cluster_graphs(const Alignment& alignment,
                                                     const vector<MaximalExactMatch>& mems,
                                                     const vector<memcluster_t>& clusters);
@@ -251,7 +271,7 @@ namespace vg {
         
         /// Make a multipath alignment of the read against the indicated graph and add it to
         /// the list of multimappings.
-        void multipath_align(const Alignment& alignment, VG* vg,
+        void multipath_align(const Alignment& alignment, const SubHandleGraph* graph,
                              memcluster_t& graph_mems,
                              MultipathAlignment& multipath_aln_out) const;
         
@@ -313,9 +333,11 @@ namespace vg {
         
         /// Would an alignment this good be expected against a graph this big by chance alone
         bool likely_mismapping(const MultipathAlignment& multipath_aln);
+        bool likely_mismapping(MultipathAlignmentCache& multipath_aln_cache);
         
         /// A scaling of a score so that it approximately follows the distribution of the longest match in p-value test
         size_t pseudo_length(const MultipathAlignment& multipath_aln) const;
+        size_t pseudo_length(MultipathAlignmentCache& multipath_aln_cache) const;
         
         /// The approximate p-value for a match length of the given size against the current graph
         double random_match_p_value(size_t match_length, size_t read_length);
@@ -324,6 +346,11 @@ namespace vg {
         int64_t distance_between(const MultipathAlignment& multipath_aln_1, const MultipathAlignment& multipath_aln_2,
                                  bool full_fragment = false, bool forward_strand = false) const;
         
+        /// Compute the approximate distance between two multipath alignments, reusing the optimal
+        /// alignments already traced back in their caches
+        int64_t distance_between(MultipathAlignmentCache& multipath_aln_cache_1, MultipathAlignmentCache& multipath_aln_cache_2,
+                                 bool full_fragment = false, bool forward_strand = false) const;
+        
         /// Are two multipath alignments consistently placed based on the learned fragment length distribution?
         bool are_consistent(const MultipathAlignment& multipath_aln_1, const MultipathAlignment& multipath_aln_2) const;
         
@@ -0,0 +1,29 @@
+#ifndef VG_RANDOM_GRAPH_HPP_INCLUDED
+#define VG_RANDOM_GRAPH_HPP_INCLUDED
+
+#include "vg.hpp"
+#include <random>
+#include <string>
+
+/** \file
+ * random_graph.hpp: generate random variation graphs, for tests and benchmarks
+ */
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * Make a random graph from a sequence of length seqSize, with variantCount
+ * variants (SNPs, short and long indels, copy number changes and inversions)
+ * whose lengths have mean variantLen, drawing from the given generator. Without
+ * randomBases the sequence is all As and SNPs are Gs. If refPathName is set,
+ * a path with that name is threaded through the original sequence.
+ */
+VG random_graph(int64_t seqSize, int64_t variantLen, int64_t variantCount,
+                default_random_engine& generator, bool randomBases = true,
+                const string& refPathName = "");
+
+}
+
+#endif
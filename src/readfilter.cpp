@@ -806,7 +806,9 @@ int ReadFilter::filter(istream* alignment_stream, xg::XG* xindex) {
             update_buffers(tid, aln, aln_chunks);
         }
     };
-    stream::for_each_parallel(*alignment_stream, lambda);
+    stream::ParallelStreamStats stream_stats;
+    function<void(size_t)> no_count = [](size_t) {};
+    stream::for_each_parallel(*alignment_stream, lambda, no_count, &stream_stats);
 
     for (int tid = 0; tid < buffer.size(); ++tid) {
         for (int chunk = 0; chunk < buffer[tid].size(); ++chunk) {
@@ -847,7 +849,12 @@ int ReadFilter::filter(istream* alignment_stream, xg::XG* xindex) {
              << "Random Filter (secondary):         " << counts.random[1] << endl
                         
             
-             << endl;
+             << endl
+             << "Input Batches:                     " << stream_stats.batches << endl
+             << "Max Batches Queued:                " << stream_stats.max_batches_outstanding << endl
+             << "Max Bytes Queued:                  " << stream_stats.max_bytes_outstanding << endl
+             << "Input Stalls:                      " << stream_stats.stalls << " ("
+             << stream_stats.stall_seconds << " s)" << endl;
     }
     
     return 0;
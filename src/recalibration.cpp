@@ -0,0 +1,93 @@
+#include "recalibration.hpp"
+
+#include <sstream>
+
+/**
+ * \file recalibration.cpp: implementations of mapping quality recalibration features
+ */
+
+namespace vg {
+
+using namespace std;
+
+const char* RECALIBRATION_FEATURE_NAMES[NUM_RECALIBRATION_FEATURES] = {
+    "origMapq", "score", "secondaryScore", "secondaryCount", "identity"
+};
+
+AlignmentFeatures alignment_to_features(const Alignment& aln) {
+    AlignmentFeatures features;
+    
+    // Original MAPQ is a feature
+    features.values[0] = aln.mapping_quality();
+    // As is score
+    features.values[1] = aln.score();
+    // And the top secondary alignment score
+    features.values[2] = aln.secondary_score_size() > 0 ? aln.secondary_score(0) : 0;
+    // Count the secondary alignments
+    features.values[3] = aln.secondary_score_size();
+    // Also do the identity
+    features.values[4] = aln.identity();
+    
+    // TODO: more features
+    
+    features.correct = aln.correctly_mapped();
+    return features;
+}
+
+string alignment_to_example_string(const Alignment& aln, bool train) {
+    // We will dump it to a string stream
+    stringstream s;
+    
+    if (train) {
+        // First is the class; 1 for correct or -1 for wrong
+        s << (aln.correctly_mapped() ? "1 " : "-1 ");
+    }
+    
+    // Drop all the features into the empty-string namespace
+    s << "| ";
+    
+    // Original MAPQ is a feature
+    s << "origMapq:" << to_string(aln.mapping_quality()) << " ";
+    
+    // As is score
+    s << "score:" << to_string(aln.score()) << " ";
+    
+    // And the top secondary alignment score
+    double secondary_score = 0;
+    if (aln.secondary_score_size() > 0) {
+        secondary_score = aln.secondary_score(0);
+    }
+    s << "secondaryScore:" << to_string(secondary_score) << " ";
+    
+    // Count the secondary alignments
+    s << "secondaryCount:" << aln.secondary_score_size() << " ";
+    
+    // Also do the identity
+    s << "identity:" << aln.identity() << " ";
+    
+    // TODO: more features
+    return s.str();
+}
+
+ExampleBuilder::ExampleBuilder(vw& model) : model(model) {
+    uint64_t namespace_hash = VW::hash_space(model, "");
+    for (size_t i = 0; i < NUM_RECALIBRATION_FEATURES; i++) {
+        feature_space[i].weight_index = VW::hash_feature(model, RECALIBRATION_FEATURE_NAMES[i], namespace_hash);
+    }
+}
+
+example* ExampleBuilder::make_example(const AlignmentFeatures& features, bool train) {
+    for (size_t i = 0; i < NUM_RECALIBRATION_FEATURES; i++) {
+        feature_space[i].x = features.values[i];
+    }
+    // Drop all the features into the empty-string namespace
+    VW::primitive_feature_space space;
+    space.name = ' ';
+    space.fs = feature_space;
+    space.len = NUM_RECALIBRATION_FEATURES;
+    // The class is 1 for correct or -1 for wrong
+    string label = train ? (features.correct ? "1" : "-1") : "";
+    return VW::import_example(model, label, &space, 1);
+}
+
+}
@@ -0,0 +1,62 @@
+#ifndef VG_RECALIBRATION_HPP_INCLUDED
+#define VG_RECALIBRATION_HPP_INCLUDED
+
+/** \file
+ * recalibration.hpp: turn Alignments into Vowpal Wabbit examples, for
+ * learning and predicting mapping qualities
+ */
+
+#include <string>
+
+#include "vg.pb.h"
+
+#include <vowpalwabbit/vw.h>
+
+namespace vg {
+
+using namespace std;
+
+/// The number of features we extract for each alignment
+const size_t NUM_RECALIBRATION_FEATURES = 5;
+
+/// The names of the features, which are what VW hashes into weight indexes
+extern const char* RECALIBRATION_FEATURE_NAMES[NUM_RECALIBRATION_FEATURES];
+
+/// The features of an Alignment, in the order of RECALIBRATION_FEATURE_NAMES,
+/// and whether it was mapped correctly.
+struct AlignmentFeatures {
+    float values[NUM_RECALIBRATION_FEATURES];
+    bool correct;
+};
+
+/// Extract the features of an Alignment. This touches no VW state, so it is
+/// safe to do from many threads.
+AlignmentFeatures alignment_to_features(const Alignment& aln);
+
+/// Turn an Alignment into a Vowpal Wabbit format example line, with the same
+/// features as alignment_to_features(). If train is true, give it a label so
+/// that VW will train on it. ExampleBuilder makes the same examples without
+/// going through text.
+string alignment_to_example_string(const Alignment& aln, bool train);
+
+/**
+ * Builds VW examples directly from feature values, without writing and
+ * parsing VW's text format. The feature names are hashed once, up front,
+ * exactly as VW's text parser would hash them in the default namespace.
+ */
+class ExampleBuilder {
+public:
+    ExampleBuilder(vw& model);
+    
+    /// Make an example from the features. If train is true, label it so that
+    /// VW will train on it. The caller must VW::finish_example() it.
+    example* make_example(const AlignmentFeatures& features, bool train);
+    
+private:
+    vw& model;
+    feature feature_space[NUM_RECALIBRATION_FEATURES];
+};
+
+}
+
+#endif
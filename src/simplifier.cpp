@@ -25,7 +25,7 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
     }
 
     // Make a list of leaf sites
-    list<const Snarl*> leaves;
+    vector<const Snarl*> leaves;
     
     if (show_progress) {
         cerr << "Iteration " << iteration << ": Scanning " << graph.node_count() << " nodes and "
@@ -40,7 +40,12 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
             queue.pop_front();
             
             if (site_manager.is_leaf(site)) {
-                // It's a leaf. Filter it out if it is trivial
+                // It's a leaf. Filter it out if it is trivial, or if nothing
+                // can have changed about it since we last looked.
+                
+                if (settled_leaves.count(site)) {
+                    continue;
+                }
                 
                 if (site->type() == ULTRABUBBLE) {
                     auto contents = site_manager.shallow_contents(site, graph, false);
@@ -65,77 +70,110 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
         cerr << "Found " << leaves.size() << " leaves" << endl;
     }
     
-    // Index all the graph paths
-    map<string, unique_ptr<PathIndex>> path_indexes;
-    graph.paths.for_each_name([&](const string& name) {
-        // For every path name, go index it and put it in this collection
-        path_indexes.insert(make_pair(name, move(unique_ptr<PathIndex>(new PathIndex(graph, name)))));
-    });
-    
     // Now we have a list of all the leaf sites.
     create_progress("simplifying leaves", leaves.size());
     
     // We can't use the SnarlManager after we modify the graph, so we load the
     // contents of all the leaves we're going to modify first.
-    map<const Snarl*, pair<unordered_set<Node*>, unordered_set<Edge*>>> leaf_contents;
+    vector<pair<unordered_set<Node*>, unordered_set<Edge*>>> leaf_contents(leaves.size());
     
     // How big is each leaf in bp
-    map<const Snarl*, size_t> leaf_sizes;
+    vector<size_t> leaf_sizes(leaves.size(), 0);
     
     // We also need to pre-calculate the traversals for the snarls that are the
     // right size, since the traversal finder uses the snarl manager amd might
     // not work if we modify the graph.
-    map<const Snarl*, vector<SnarlTraversal>> leaf_traversals;
+    vector<vector<SnarlTraversal>> leaf_traversals(leaves.size());
     
-    for (const Snarl* leaf : leaves) {
+    // The leaves are disjoint and nothing is modified yet, so we can look at
+    // them all in parallel.
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < leaves.size(); i++) {
         // Look at all the leaves
+        const Snarl* leaf = leaves[i];
         
         // Get the contents of the bubble, excluding the boundary nodes
-        leaf_contents[leaf] = site_manager.deep_contents(leaf, graph, false);
+        leaf_contents[i] = site_manager.deep_contents(leaf, graph, false);
         
         // For each leaf, calculate its total size.
-        unordered_set<Node*>& nodes = leaf_contents[leaf].first;
-        size_t& total_size = leaf_sizes[leaf];
-        for (Node* node : nodes) {
+        size_t& total_size = leaf_sizes[i];
+        for (Node* node : leaf_contents[i].first) {
             // For each node include it in the size figure
             total_size += node->sequence().size();
         }
         
-        if (total_size == 0) {
-            // This site is just the start and end nodes, so it doesn't make
-            // sense to try and remove it.
-            continue;
-        }
-        
-        if (total_size >= min_size) {
-            // This site is too big to remove
+        if (total_size == 0 || total_size >= min_size) {
+            // This site is just the start and end nodes, or it is too big to
+            // remove.
             continue;
         }
         
         // Identify the replacement traversal for the bubble if it's the right size.
         // We can't necessarily do this after we've modified the graph.
-        vector<SnarlTraversal>& traversals = leaf_traversals[leaf];
-        traversals = traversal_finder.find_traversals(*leaf);
+        leaf_traversals[i] = traversal_finder.find_traversals(*leaf);
+        
+        for (auto& traversal : leaf_traversals[i]) {
+            // The traversal runs from boundary to boundary, but we splice in
+            // and keep only the visits inside the site.
+            SnarlTraversal inside;
+            for (size_t j = 1; j + 1 < traversal.visit_size(); j++) {
+                *inside.add_visit() = traversal.visit(j);
+            }
+            traversal = inside;
+        }
     }
     
-    for (const Snarl* leaf : leaves) {
+    // We decide what to do with every leaf before we change anything, and
+    // then apply all the edits together. The leaves are disjoint, so the
+    // decisions for one leaf don't depend on the edits to another, and the
+    // paths and graph stay as they were while we look.
+    
+    // Mappings to drop from each path
+    map<string, vector<mapping_t*>> mappings_to_remove;
+    
+    // Runs of mappings to add to each path, as the mapping to insert before
+    // and the new mappings in the order they are to be inserted (right to
+    // left along the path).
+    map<string, vector<pair<mapping_t*, vector<mapping_t>>>> mappings_to_insert;
+    
+    // Paths that can't be represented after popping, which we drop entirely
+    set<string> paths_to_kill;
+    
+    // Edges and nodes to delete
+    vector<Edge*> edges_to_destroy;
+    vector<Node*> nodes_to_destroy;
+    
+    // Positions along paths are only needed to keep features up to date, so
+    // we only index the paths that have features, when we first need them.
+    // Since no path changes until the end, one index per path serves for the
+    // whole round.
+    map<string, unique_ptr<PathIndex>> path_indexes;
+    
+    // Feature edits that we have yet to apply, as start, old length, and new
+    // length in the coordinates of the path's index.
+    map<string, vector<tuple<size_t, size_t, size_t>>> pending_edits;
+    
+    for (size_t leaf_number = 0; leaf_number < leaves.size(); leaf_number++) {
         // Look at all the leaves
+        const Snarl* leaf = leaves[leaf_number];
         
         // Get the contents of the bubble, excluding the boundary nodes
-        unordered_set<Node*>& nodes = leaf_contents[leaf].first;
-        unordered_set<Edge*>& edges = leaf_contents[leaf].second;
+        unordered_set<Node*>& nodes = leaf_contents[leaf_number].first;
+        unordered_set<Edge*>& edges = leaf_contents[leaf_number].second;
         
         // For each leaf, grab its total size.
-        size_t& total_size = leaf_sizes[leaf];
+        size_t& total_size = leaf_sizes[leaf_number];
         
         if (total_size == 0) {
             // This site is just the start and end nodes, so it doesn't make
             // sense to try and remove it.
+            settled_leaves.insert(leaf);
             continue;
         }
         
         if (total_size >= min_size) {
             // This site is too big to remove
+            settled_leaves.insert(leaf);
             continue;
         }
         
@@ -149,10 +187,11 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
         // Otherwise we want to simplify this site away
         
         // Grab the replacement traversal for the bubble
-        vector<SnarlTraversal>& traversals = leaf_traversals[leaf];
+        vector<SnarlTraversal>& traversals = leaf_traversals[leaf_number];
         
         if (traversals.empty()) {
             // We couldn't find any paths through the site.
+            settled_leaves.insert(leaf);
             continue;
         }
         
@@ -161,7 +200,7 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
         
         // Determine the length of the new traversal
         size_t new_site_length = 0;
-        for (size_t i = 1; i < traversal.visit_size() - 1; i++) {
+        for (size_t i = 0; i < traversal.visit_size(); i++) {
             // For every non-anchoring node
             const Visit& visit = traversal.visit(i);
             // Total up the lengths of all the nodes that are newly visited.
@@ -187,6 +226,12 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
         // never hit the start. So we're going to trim those back before we delete nodes and edges.
         map<string, set<mapping_t*> > end_mappings_by_path = graph.paths.get_node_mapping_by_path_name(graph.get_node(leaf->end().node_id()));
         
+        for (auto& path_name : paths_to_kill) {
+            // Paths we are already dropping are no concern of this site
+            mappings_by_path.erase(path_name);
+            end_mappings_by_path.erase(path_name);
+        }
+        
         if (!drop_hairpin_paths) {
             // We shouldn't drop paths if they hairpin and can't be represented
             // in a simplified bubble. So we instead have to not simplify
@@ -307,6 +352,15 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
             
         }
         
+        // If popping this site deletes nothing, popping it again won't either
+        size_t deleted_before = deleted_nodes + deleted_edges;
+        
+        // Paths we find we have to drop at this site
+        set<string> site_paths_to_kill;
+        
+        // Mappings we trim off of paths that leave the site without entering it
+        unordered_set<mapping_t*> site_trimmed_mappings;
+        
         // We'll keep a set of the end mappings we managed to find, starting from the start
         set<mapping_t*> found_end_mappings;
         
@@ -442,7 +496,7 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
                                  
                     for(auto* mapping : existing_mappings) {
                         // Trim the path out of the site
-                        graph.paths.remove_mapping(mapping);
+                        mappings_to_remove[path_name].push_back(mapping);
                     }
                     
                     // TODO: update feature positions if we trim off the start of a path
@@ -461,69 +515,65 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
                     existing_mappings.reverse();
                 }
                 
-                // Where does the variable region of the site start for this
-                // traversal of the path? If there are no existing mappings,
-                // it's the start mapping's position if we traverse the site
-                // backwards and the end mapping's position if we traverse
-                // the site forwards. If there are existing mappings, it's
-                // the first existing mapping's position in the path. TODO:
-                // This is super ugly. Can we view the site in path
-                // coordinates or something?
-                PathIndex& path_index = *path_indexes.at(path_name).get();
-                mapping_t* mapping_after_first = existing_mappings.empty() ?
-                    (backward ? start_mapping : end_mapping) : existing_mappings.front();
-                assert(path_index.mapping_positions.count(mapping_after_first));
-                size_t variable_start = path_index.mapping_positions.at(mapping_after_first); 
-                
-                
-                
-                // Determine the total length of the old traversal of the site
-                size_t old_site_length = 0;
-                for (auto* mapping : existing_mappings) {
-                    // Add in the lengths of all the mappings that will get
-                    // removed.
-                    old_site_length += mapping->length;
-                }
+                if (features.has_features(path_name)) {
+                    // Where does the variable region of the site start for this
+                    // traversal of the path? If there are no existing mappings,
+                    // it's the start mapping's position if we traverse the site
+                    // backwards and the end mapping's position if we traverse
+                    // the site forwards. If there are existing mappings, it's
+                    // the first existing mapping's position in the path. TODO:
+                    // This is super ugly. Can we view the site in path
+                    // coordinates or something?
+                    mapping_t* mapping_after_first = existing_mappings.empty() ?
+                        (backward ? start_mapping : end_mapping) : existing_mappings.front();
+                    
+                    auto& path_index = path_indexes[path_name];
+                    if (!path_index) {
+                        // The path isn't indexed yet
+                        path_index.reset(new PathIndex(graph, path_name));
+                    }
+                    assert(path_index->mapping_positions.count(mapping_after_first));
+                    size_t variable_start = path_index->mapping_positions.at(mapping_after_first); 
+                    
+                    // Determine the total length of the old traversal of the site
+                    size_t old_site_length = 0;
+                    for (auto* mapping : existing_mappings) {
+                        // Add in the lengths of all the mappings that will get
+                        // removed.
+                        old_site_length += mapping->length;
+                    }
 #ifdef debug
-                cerr << "Replacing " << old_site_length << " bp at " << variable_start
-                    << " with " << new_site_length << " bp" << endl;
+                    cerr << "Replacing " << old_site_length << " bp at " << variable_start
+                        << " with " << new_site_length << " bp" << endl;
 #endif
-
-                // Actually update any BED features
-                features.on_path_edit(path_name, variable_start, old_site_length, new_site_length);
-                
-                // Where will we insert the new site traversal into the path?
-                list<mapping_t>::iterator insert_position;
-                
-                if (!existing_mappings.empty()) {
-                    // If there are existing internal mappings, we'll insert right where they were
                     
-                    for (auto* mapping : existing_mappings) {
-                        // Remove each mapping from left to right along the
-                        // path, saving the position after the mapping we just
-                        // removed. At the end we'll have the position of the
-                        // mapping to the end of the site.
-                        
+                    // Remember to update any BED features. Positions past
+                    // this edit may still be looked up in the index, so we
+                    // leave them in the original coordinates until we are done.
+                    pending_edits[path_name].emplace_back(variable_start, old_site_length, new_site_length);
+                }
+                
+                // The mappings inside the site go, and the new traversal goes
+                // in right before the mapping to the start or end of the site
+                // (whichever occurs last along the path).
+                for (auto* mapping : existing_mappings) {
 #ifdef debug
-                        cerr << path_name << ": Drop mapping " << pb2json(*mapping) << endl;
+                    cerr << path_name << ": Drop mapping " << pb2json(*mapping) << endl;
 #endif
-                        
-                        insert_position = graph.paths.remove_mapping(mapping);
-                    }
-                } else {
-                    // Otherwise we'll insert right before the mapping to
-                    // the start or end of the site (whichever occurs last
-                    // along the path)
-                    insert_position = graph.paths.find_mapping(backward ? start_mapping : here);
+                    mappings_to_remove[path_name].push_back(mapping);
                 }
+                mapping_t* insert_before = backward ? start_mapping : end_mapping;
                 
                 // Make sure we're going to insert starting from the correct end of the site.
                 if (backward) {
-                    assert(insert_position->node_id() == leaf->start().node_id());
+                    assert(insert_before->node_id() == leaf->start().node_id());
                 } else {
-                    assert(insert_position->node_id() == leaf->end().node_id());
+                    assert(insert_before->node_id() == leaf->end().node_id());
                 }
                 
+                mappings_to_insert[path_name].emplace_back(insert_before, vector<mapping_t>());
+                auto& new_mappings = mappings_to_insert[path_name].back().second;
+                
                 // Loop through the internal visits in the canonical
                 // traversal backwards along the path we are splicing. If
                 // it's a forward path this is just right to left, but if
@@ -552,20 +602,16 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
                     cerr << path_name << ": Add mapping " << pb2json(new_mapping) << endl;
 #endif
                     
-                    // Insert the mapping in the path, moving right to left
-                    insert_position = graph.paths.insert_mapping(insert_position, path_name, new_mapping);
+                    // Queue the mapping up to go in the path, moving right to left
+                    new_mappings.push_back(new_mapping);
                     
                 }
-                
-                // Now we've corrected this site on this path. Update its index.
-                // TODO: right now this means retracing the entire path.
-                path_indexes[path_name].get()->update_mapping_positions(graph, path_name);
             }
             
             if (kill_path) {
                 // Destroy the path completely, because it needs to reverse
                 // inside a site that we have popped.
-                graph.paths.remove_path(path_name);
+                site_paths_to_kill.insert(path_name);
             }
             
         }
@@ -576,6 +622,11 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
             // Unpack the name
             auto& path_name = kv.first;
             
+            if (site_paths_to_kill.count(path_name)) {
+                // We're dropping this path anyway
+                continue;
+            }
+            
             // We might have to kill the path, if it reverses inside a
             // bubble we're popping
             bool kill_path = false;
@@ -632,7 +683,8 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
                 
                 for (auto* mapping: to_remove) {
                     // Get rid of all the mappings once we're done tracing them out.
-                    graph.paths.remove_mapping(mapping);
+                    mappings_to_remove[path_name].push_back(mapping);
+                    site_trimmed_mappings.insert(mapping);
                 }
                 
             }
@@ -640,7 +692,7 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
             if (kill_path) {
                 // Destroy the path completely, because it needs to reverse
                 // inside a site that we have popped.
-                graph.paths.remove_path(path_name);
+                site_paths_to_kill.insert(path_name);
             }
         }
         
@@ -651,7 +703,7 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
             // For each node and the next node (which won't be the end)
             
             const Visit visit = traversal.visit(i);
-            const Visit next = traversal.visit(i);
+            const Visit next = traversal.visit(i + 1);
             
             // Find the edge between them
             NodeTraversal here(graph.get_node(visit.node_id()), visit.backward());
@@ -685,7 +737,7 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
                      << to_node_traversal(leaf->end(), graph) << ": Delete edge: "
                      << pb2json(*edge) << endl;
 #endif
-                graph.destroy_edge(edge);
+                edges_to_destroy.push_back(edge);
                 deleted_edges++;
             }
         }
@@ -712,34 +764,95 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
                 // There may be paths still touching this node, if they
                 // managed to get into the site without touching the start
                 // node. We'll delete those paths.
-                set<string> paths_to_kill;
                 for (auto& kv : graph.paths.get_node_mapping_by_path_name(node)) {
                 
-                    if (mappings_by_path.count(kv.first)) {
-                        // We've already actually updated this path; the
-                        // node_mapping data is just out of date.
+                    if (mappings_by_path.count(kv.first) || paths_to_kill.count(kv.first)
+                        || site_paths_to_kill.count(kv.first)) {
+                        // We've already dealt with this path
                         continue;
                     }
-                
-                    paths_to_kill.insert(kv.first);
-                }
-                for (auto& path : paths_to_kill) {
-                    graph.paths.remove_path(path);
-                    cerr << "warning:[vg simplify] Path " << path << " removed" << endl;
+                    
+                    // Mappings that we are already trimming off don't count
+                    bool still_touches = false;
+                    for (mapping_t* mapping : kv.second) {
+                        if (!site_trimmed_mappings.count(mapping)) {
+                            still_touches = true;
+                            break;
+                        }
+                    }
+                    
+                    if (still_touches) {
+                        site_paths_to_kill.insert(kv.first);
+                        cerr << "warning:[vg simplify] Path " << kv.first << " removed" << endl;
+                    }
                 }
 
-                graph.destroy_node(node);
+                nodes_to_destroy.push_back(node);
                 
                 deleted_nodes++;
             }
         }
         
+        paths_to_kill.insert(site_paths_to_kill.begin(), site_paths_to_kill.end());
+        
+        if (deleted_nodes + deleted_edges == deleted_before) {
+            settled_leaves.insert(leaf);
+        }
+        
         // OK we finished a leaf
         increment_progress();
     }
     
     destroy_progress();
     
+    // Bring the features up to date with all the edits, from the end of each
+    // path backward, so that none of them moves the coordinates of the ones
+    // still to come.
+    for (auto& kv : pending_edits) {
+        auto& edits = kv.second;
+        sort(edits.begin(), edits.end(), greater<tuple<size_t, size_t, size_t>>());
+        for (auto& edit : edits) {
+            features.on_path_edit(kv.first, get<0>(edit), get<1>(edit), get<2>(edit));
+        }
+    }
+    
+    // Splice the new traversals into the paths we are keeping, while the
+    // mappings they go before still exist, and then drop the old mappings.
+    for (auto& kv : mappings_to_insert) {
+        if (paths_to_kill.count(kv.first)) {
+            continue;
+        }
+        for (auto& insertion : kv.second) {
+            auto insert_position = graph.paths.find_mapping(insertion.first);
+            for (auto& new_mapping : insertion.second) {
+                insert_position = graph.paths.insert_mapping(insert_position, kv.first, new_mapping);
+            }
+        }
+    }
+    for (auto& kv : mappings_to_remove) {
+        if (paths_to_kill.count(kv.first)) {
+            continue;
+        }
+        auto& mappings = kv.second;
+        sort(mappings.begin(), mappings.end());
+        mappings.erase(unique(mappings.begin(), mappings.end()), mappings.end());
+        for (mapping_t* mapping : mappings) {
+            graph.paths.remove_mapping(mapping);
+        }
+    }
+    for (auto& path_name : paths_to_kill) {
+        graph.paths.remove_path(path_name);
+    }
+    
+    // Now that no path visits them, delete the edges and nodes off the chosen
+    // traversals (the edges before their nodes)
+    for (Edge* edge : edges_to_destroy) {
+        graph.destroy_edge(edge);
+    }
+    for (Node* node : nodes_to_destroy) {
+        graph.destroy_node(node);
+    }
+    
     // Reset the ranks in the graph, since we rewrote paths
     graph.paths.clear_mapping_ranks();
     
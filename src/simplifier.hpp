@@ -68,6 +68,13 @@ protected:
     /// This is used to find traversals of those sites
     TrivialTraversalFinder traversal_finder;
     
+    /// Leaves that no later iteration can change, because they are the wrong
+    /// size, have no traversal, or were already popped without deleting
+    /// anything. The snarls are fixed and leaves are disjoint, so these can be
+    /// skipped, and each iteration only revisits the leaves that the previous
+    /// one touched.
+    unordered_set<const Snarl*> settled_leaves;
+    
     
 };
 
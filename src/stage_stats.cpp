@@ -0,0 +1,208 @@
+#include "stage_stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+
+/**
+ * \file stage_stats.cpp: implementations of mapping stage statistics
+ */
+
+#ifdef VG_STAGE_STATS
+
+// Count the bytes each thread allocates, by replacing the global allocation
+// functions. The array and nothrow forms are implemented in terms of these.
+static thread_local uint64_t stage_stats_bytes_allocated = 0;
+
+void* operator new(size_t size) {
+    stage_stats_bytes_allocated += size;
+    void* ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+#endif
+
+namespace vg {
+
+using namespace std;
+
+atomic<bool> StageStats::enabled(false);
+mutex StageStats::registry_mutex;
+vector<unique_ptr<StageStats::ThreadStats>> StageStats::registry;
+
+bool StageStats::available() {
+#ifdef VG_STAGE_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void StageStats::enable() {
+    enabled.store(true);
+}
+
+uint64_t StageStats::thread_bytes_allocated() {
+#ifdef VG_STAGE_STATS
+    return stage_stats_bytes_allocated;
+#else
+    return 0;
+#endif
+}
+
+StageStats::ThreadStats& StageStats::thread_stats() {
+    static thread_local ThreadStats* stats = nullptr;
+    if (stats == nullptr) {
+        // The registry owns the slot, so it outlives the thread
+        lock_guard<mutex> lock(registry_mutex);
+        registry.emplace_back(new ThreadStats());
+        stats = registry.back().get();
+    }
+    return *stats;
+}
+
+size_t StageStats::bin_of(uint64_t nanoseconds) {
+    if (nanoseconds < 8) {
+        return nanoseconds;
+    }
+    // find the power of 2, then use the next 3 bits for the bin within it
+    size_t exponent = 63 - __builtin_clzll(nanoseconds);
+    size_t sub_bin = (nanoseconds >> (exponent - 3)) & 7;
+    return (exponent - 2) * 8 + sub_bin;
+}
+
+uint64_t StageStats::bin_upper_bound(size_t bin) {
+    if (bin < 8) {
+        return bin;
+    }
+    size_t exponent = bin / 8 + 2;
+    uint64_t sub_bin = bin % 8;
+    return ((9 + sub_bin) << (exponent - 3)) - 1;
+}
+
+void StageStats::record(MappingStage stage, uint64_t nanoseconds, uint64_t bytes) {
+    ThreadStats& stats = thread_stats();
+    stats.calls[stage]++;
+    stats.total_ns[stage] += nanoseconds;
+    stats.max_ns[stage] = max(stats.max_ns[stage], nanoseconds);
+    stats.bytes[stage] += bytes;
+    stats.histogram[stage][bin_of(nanoseconds)]++;
+}
+
+void StageStats::reset() {
+    lock_guard<mutex> lock(registry_mutex);
+    for (auto& stats : registry) {
+        *stats = ThreadStats();
+    }
+}
+
+const char* StageStats::stage_name(MappingStage stage) {
+    switch (stage) {
+    case STAGE_MEM_FINDING:
+        return "mem_finding";
+    case STAGE_SUBMEM_RESEEDING:
+        return "submem_reseeding";
+    case STAGE_CLUSTERING:
+        return "clustering";
+    case STAGE_SUBGRAPH_EXTRACTION:
+        return "subgraph_extraction";
+    case STAGE_ALIGNMENT:
+        return "alignment";
+    case STAGE_RESCUE:
+        return "rescue";
+    case STAGE_MAPQ:
+        return "mapq";
+    case STAGE_OUTPUT:
+        return "output";
+    default:
+        return "unknown";
+    }
+}
+
+void StageStats::write_report(ostream& out, bool json) {
+
+    // combine the threads' stats
+    ThreadStats combined;
+    {
+        lock_guard<mutex> lock(registry_mutex);
+        for (auto& stats : registry) {
+            for (size_t i = 0; i < NUM_MAPPING_STAGES; i++) {
+                combined.calls[i] += stats->calls[i];
+                combined.total_ns[i] += stats->total_ns[i];
+                combined.max_ns[i] = max(combined.max_ns[i], stats->max_ns[i]);
+                combined.bytes[i] += stats->bytes[i];
+                for (size_t j = 0; j < NUM_BINS; j++) {
+                    combined.histogram[i][j] += stats->histogram[i][j];
+                }
+            }
+        }
+    }
+
+    // find the upper bound of the bin containing a quantile, capped at the max
+    auto percentile = [&](size_t stage, double fraction) -> uint64_t {
+        uint64_t rank = (uint64_t) ceil(fraction * combined.calls[stage]);
+        uint64_t seen = 0;
+        for (size_t j = 0; j < NUM_BINS; j++) {
+            seen += combined.histogram[stage][j];
+            if (seen >= rank && seen > 0) {
+                return min(bin_upper_bound(j), combined.max_ns[stage]);
+            }
+        }
+        return 0;
+    };
+
+    if (json) {
+        out << "{\"stages\":[";
+    } else {
+        out << "#stage\tcalls\ttotal_ns\tmean_ns\tp50_ns\tp90_ns\tp99_ns\tmax_ns\tbytes_allocated" << endl;
+    }
+    for (size_t i = 0; i < NUM_MAPPING_STAGES; i++) {
+        uint64_t calls = combined.calls[i];
+        uint64_t mean = calls ? combined.total_ns[i] / calls : 0;
+        if (json) {
+            out << (i ? "," : "") << "{\"stage\":\"" << stage_name((MappingStage) i) << "\""
+                << ",\"calls\":" << calls
+                << ",\"total_ns\":" << combined.total_ns[i]
+                << ",\"mean_ns\":" << mean
+                << ",\"p50_ns\":" << percentile(i, 0.5)
+                << ",\"p90_ns\":" << percentile(i, 0.9)
+                << ",\"p99_ns\":" << percentile(i, 0.99)
+                << ",\"max_ns\":" << combined.max_ns[i]
+                << ",\"bytes_allocated\":" << combined.bytes[i] << "}";
+        } else {
+            out << stage_name((MappingStage) i)
+                << "\t" << calls
+                << "\t" << combined.total_ns[i]
+                << "\t" << mean
+                << "\t" << percentile(i, 0.5)
+                << "\t" << percentile(i, 0.9)
+                << "\t" << percentile(i, 0.99)
+                << "\t" << combined.max_ns[i]
+                << "\t" << combined.bytes[i] << endl;
+        }
+    }
+    if (json) {
+        out << "]}" << endl;
+    }
+}
+
+void StageStats::write_report(const string& filename) {
+    ofstream out(filename);
+    if (!out) {
+        cerr << "error:[vg::StageStats] could not open " << filename << " to write stage statistics" << endl;
+        exit(1);
+    }
+    bool json = filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".json") == 0;
+    write_report(out, json);
+}
+
+}
@@ -0,0 +1,147 @@
+#ifndef VG_STAGE_STATS_HPP_INCLUDED
+#define VG_STAGE_STATS_HPP_INCLUDED
+
+/** \file stage_stats.hpp
+ * Per-thread call counts, latencies, and allocation totals for the stages of
+ * read mapping.
+ *
+ * The timers are only compiled in when VG_STAGE_STATS is defined (build with
+ * "make STAGE_STATS=1"). Otherwise VG_TIME_STAGE expands to nothing.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace vg {
+
+using namespace std;
+
+/// The stages of mapping a read that we time. Stages nest, so an outer
+/// stage's time includes the time of any stages it calls.
+enum MappingStage {
+    STAGE_MEM_FINDING = 0,
+    STAGE_SUBMEM_RESEEDING,
+    STAGE_CLUSTERING,
+    STAGE_SUBGRAPH_EXTRACTION,
+    STAGE_ALIGNMENT,
+    STAGE_RESCUE,
+    STAGE_MAPQ,
+    STAGE_OUTPUT,
+    NUM_MAPPING_STAGES
+};
+
+/**
+ * Collects stage timings. Each thread records into its own slot without
+ * locking, and the slots are combined when the report is written, after the
+ * mapping threads are done.
+ */
+class StageStats {
+public:
+
+    /// Were the stage timers compiled in?
+    static bool available();
+
+    /// Start recording. Until this is called, timers record nothing.
+    static void enable();
+
+    /// Are we recording?
+    static inline bool is_enabled();
+
+    /// Record one call of a stage on the calling thread
+    static void record(MappingStage stage, uint64_t nanoseconds, uint64_t bytes);
+
+    /// How many bytes has the calling thread allocated with operator new? Only
+    /// counted when the timers are compiled in.
+    static uint64_t thread_bytes_allocated();
+
+    /// Write the combined call counts, total and percentile latencies, and
+    /// bytes allocated for each stage, as TSV or as JSON
+    static void write_report(ostream& out, bool json);
+
+    /// Write the report to a file, as JSON if its name ends in ".json" and
+    /// as TSV otherwise
+    static void write_report(const string& filename);
+
+    /// Forget everything recorded so far, on all threads. Must not be called
+    /// while other threads are recording.
+    static void reset();
+
+    /// Get the name of a stage
+    static const char* stage_name(MappingStage stage);
+
+    /// Latencies are binned in a log-linear histogram, with 8 bins for
+    /// each power of 2
+    static const size_t NUM_BINS = 496;
+
+    /// Get the histogram bin that a latency falls in
+    static size_t bin_of(uint64_t nanoseconds);
+
+    /// Get the largest latency that falls in a histogram bin
+    static uint64_t bin_upper_bound(size_t bin);
+
+private:
+
+    struct ThreadStats {
+        uint64_t calls[NUM_MAPPING_STAGES] = {};
+        uint64_t total_ns[NUM_MAPPING_STAGES] = {};
+        uint64_t max_ns[NUM_MAPPING_STAGES] = {};
+        uint64_t bytes[NUM_MAPPING_STAGES] = {};
+        uint64_t histogram[NUM_MAPPING_STAGES][NUM_BINS] = {};
+    };
+
+    /// Get the calling thread's slot, registering it on first use
+    static ThreadStats& thread_stats();
+
+    static atomic<bool> enabled;
+    static mutex registry_mutex;
+    static vector<unique_ptr<ThreadStats>> registry;
+};
+
+/**
+ * Times the enclosing scope as a call of a stage.
+ */
+class StageTimer {
+public:
+    StageTimer(MappingStage stage) : stage(stage), active(StageStats::is_enabled()) {
+        if (active) {
+            bytes_start = StageStats::thread_bytes_allocated();
+            start = chrono::steady_clock::now();
+        }
+    }
+
+    ~StageTimer() {
+        if (active) {
+            auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start);
+            StageStats::record(stage, elapsed.count(), StageStats::thread_bytes_allocated() - bytes_start);
+        }
+    }
+
+private:
+    MappingStage stage;
+    bool active;
+    uint64_t bytes_start = 0;
+    chrono::steady_clock::time_point start;
+};
+
+inline bool StageStats::is_enabled() {
+    return enabled.load(memory_order_relaxed);
+}
+
+#ifdef VG_STAGE_STATS
+#define VG_STAGE_TIMER_NAME_CONCAT(line) stage_timer_ ## line
+#define VG_STAGE_TIMER_NAME(line) VG_STAGE_TIMER_NAME_CONCAT(line)
+/// Time the rest of the enclosing scope as a call of the given stage
+#define VG_TIME_STAGE(stage) StageTimer VG_STAGE_TIMER_NAME(__LINE__)(stage)
+#else
+#define VG_TIME_STAGE(stage)
+#endif
+
+}
+
+#endif
@@ -4,7 +4,9 @@
 // de/serialization of protobuf objects from/to a length-prefixed, gzipped binary stream
 // from http://www.mail-archive.com/protobuf@googlegroups.com/msg03417.html
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <iostream>
 #include <istream>
 #include <fstream>
@@ -382,41 +384,100 @@ void for_each(std::istream& in,
 
 // Parallelized versions of for_each
 
+/// Statistics about how a parallel read of a stream kept its worker threads
+/// supplied with batches of messages
+struct ParallelStreamStats {
+    /// How many batches the messages were divided into
+    size_t batches = 0;
+    /// How many messages were read
+    size_t messages = 0;
+    /// How many bytes of serialized messages were read
+    size_t bytes = 0;
+    /// The most batches waiting for or undergoing processing at once
+    size_t max_batches_outstanding = 0;
+    /// The most bytes held in such batches at once
+    size_t max_bytes_outstanding = 0;
+    /// The most bytes held in one batch
+    size_t max_batch_bytes = 0;
+    /// The limit on bytes held in batches that the reading thread ended up
+    /// with. The limit only grows, and the reading thread only adds a batch
+    /// while it is under the limit, so max_bytes_outstanding is always less
+    /// than this plus max_batch_bytes.
+    size_t bytes_outstanding_limit = 0;
+    /// How many times the buffer of batches was full, so that the reading
+    /// thread had to process a batch itself instead of reading ahead
+    size_t stalls = 0;
+    /// How many seconds the reading thread spent processing batches in stalls
+    double stall_seconds = 0.0;
+};
+
 // First, an internal implementation underlying several variants below.
 // lambda2 is invoked on interleaved pairs of elements from the stream. The
 // elements of each pair are in order, but the overall order in which lambda2
 // is invoked on pairs is undefined (concurrent). lambda1 is invoked on an odd
-// last element of the stream, if any.
+// last element of the stream, if any. If stats is not null, it is filled in
+// with statistics about the batches.
+//
+// Batches are sized by their serialized bytes, so that a batch of long reads
+// holds only a few of them and is about as much work as a batch of many short
+// reads, and the memory held in batches is bounded in bytes.
+//
+// The limits on bytes held in batches start at 256 and grow to at most 8192
+// full-sized batches, the same numbers of batches as the old limits counted
+// in batches of 256 messages. A mapped 150 bp read serializes to about 450
+// bytes, so 256 batches of them held about 29 MiB, under the new 64 MiB
+// start. A mapped 10 kbp read with qualities is about 26 KB, so 256 batches
+// of 256 of them held about 1.6 GiB, while 64 MiB still holds 256 batches of
+// about 10 reads each to keep the worker threads busy.
 template <typename T>
 void for_each_parallel_impl(std::istream& in,
                             const std::function<void(T&,T&)>& lambda2,
                             const std::function<void(T&)>& lambda1,
                             const std::function<void(size_t)>& handle_count,
-                            const std::function<bool(void)>& single_threaded_until_true) {
+                            const std::function<bool(void)>& single_threaded_until_true,
+                            ParallelStreamStats* stats = nullptr) {
 
-    // objects will be handed off to worker threads in batches of this many
+    // objects will be handed off to worker threads in batches of at most this many
     const size_t batch_size = 256;
     static_assert(batch_size % 2 == 0, "stream::for_each_parallel::batch_size must be even");
-    // max # of such batches to be holding in memory
-    size_t max_batches_outstanding = 256;
+    // or fewer, once a batch holds this many bytes
+    const size_t batch_bytes_target = 1 << 18; // 256 KiB
+    // max # of bytes to be holding in batches in memory
+    size_t max_bytes_outstanding = 1 << 26; // 64 MiB
     // max # we will ever increase the batch buffer to
-    const size_t max_max_batches_outstanding = 1 << 13; // 8192
-    // number of batches currently being processed
+    const size_t max_max_bytes_outstanding = 1ull << 31; // 2 GiB
+    // number of batches and bytes currently being processed
     size_t batches_outstanding = 0;
+    size_t bytes_outstanding = 0;
+    
+    ParallelStreamStats local_stats;
 
     // this loop handles a chunked file with many pieces
     // such as we might write in a multithreaded process
-    #pragma omp parallel default(none) shared(in, lambda1, lambda2, handle_count, batches_outstanding, max_batches_outstanding, single_threaded_until_true)
+    #pragma omp parallel default(none) shared(in, lambda1, lambda2, handle_count, batches_outstanding, bytes_outstanding, max_bytes_outstanding, single_threaded_until_true, local_stats)
     #pragma omp single
     {
         auto handle = [](bool retval) -> void {
             if (!retval) throw std::runtime_error("obsolete, invalid, or corrupt protobuf input");
         };
+        
+        // parse the objects in a batch and invoke lambda2 on each pair
+        auto process_batch = [&](const std::vector<std::string>& batch) {
+            T obj1, obj2;
+            for (size_t i = 0; i < batch.size(); i += 2) {
+                // parse protobuf objects and invoke lambda on the pair
+                handle(obj1.ParseFromString(batch[i]));
+                handle(obj2.ParseFromString(batch[i + 1]));
+                lambda2(obj1, obj2);
+            }
+        };
 
         BlockedGzipInputStream bgzip_in(in);
         ::google::protobuf::io::CodedInputStream coded_in(&bgzip_in);
 
         std::vector<std::string> *batch = nullptr;
+        // the memory the batch takes up, counting the strings themselves so empty messages count too
+        size_t batch_bytes = 0;
         
         // process chunks prefixed by message count
         size_t count;
@@ -426,6 +487,7 @@ void for_each_parallel_impl(std::istream& in,
                 if (!batch) {
                      batch = new std::vector<std::string>();
                      batch->reserve(batch_size);
+                     batch_bytes = 0;
                 }
                 
                 // Reconstruct the CodedInputStream in place to reset its maximum-
@@ -455,58 +517,63 @@ void for_each_parallel_impl(std::istream& in,
                     // Even empty messages need to be handled; they are all-default Protobuf objects.
                     batch->push_back(std::move(s));
                 }
+                batch_bytes += msgSize + sizeof(std::string);
+                local_stats.messages++;
+                local_stats.bytes += msgSize;
 
-                if (batch->size() == batch_size) {
+                // batches can only end between pairs
+                if (batch->size() % 2 == 0 && (batch->size() == batch_size || batch_bytes >= batch_bytes_target)) {
                     // time to enqueue this batch for processing. first, block if
-                    // we've hit max_batches_outstanding.
-                    size_t b;
+                    // we've hit max_bytes_outstanding.
+                    size_t b, bytes;
 #pragma omp atomic capture
                     b = ++batches_outstanding;
+#pragma omp atomic capture
+                    bytes = bytes_outstanding += batch_bytes;
+                    
+                    local_stats.batches++;
+                    local_stats.max_batches_outstanding = std::max(local_stats.max_batches_outstanding, b);
+                    local_stats.max_bytes_outstanding = std::max(local_stats.max_bytes_outstanding, bytes);
+                    local_stats.max_batch_bytes = std::max(local_stats.max_batch_bytes, batch_bytes);
                     
                     bool do_single_threaded = !single_threaded_until_true();
-                    if (b >= max_batches_outstanding || do_single_threaded) {
+                    if (bytes >= max_bytes_outstanding || do_single_threaded) {
                         
                         // process this batch in the current thread
-                        {
-                            T obj1, obj2;
-                            for (int i = 0; i<batch_size; i+=2) {
-                                // parse protobuf objects and invoke lambda on the pair
-                                handle(obj1.ParseFromString(batch->at(i)));
-                                handle(obj2.ParseFromString(batch->at(i+1)));
-                                lambda2(obj1,obj2);
-                            }
-                        } // scope obj1 & obj2
+                        auto start = std::chrono::steady_clock::now();
+                        process_batch(*batch);
                         delete batch;
+                        if (!do_single_threaded) {
+                            // we should have been reading ahead instead
+                            local_stats.stalls++;
+                            local_stats.stall_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                        }
+#pragma omp atomic update
+                        batches_outstanding--;
 #pragma omp atomic capture
-                        b = --batches_outstanding;
+                        bytes = bytes_outstanding -= batch_bytes;
                         
-                        if (4 * b / 3 < max_batches_outstanding
-                            && max_batches_outstanding < max_max_batches_outstanding
+                        if (4 * bytes / 3 < max_bytes_outstanding
+                            && max_bytes_outstanding < max_max_bytes_outstanding
                             && !do_single_threaded) {
                             // we went through at least 1/4 of the batch buffer while we were doing this thread's batch
                             // this looks risky, since we want the batch buffer to stay populated the entire time we're
                             // occupying this thread on compute, so let's increase the batch buffer size
                             // (skip this adjustment if you're in single-threaded mode and thus expect the buffer to be
                             // empty)
-                            max_batches_outstanding *= 2;
+                            max_bytes_outstanding *= 2;
                         }
                     }
                     else {
                         // spawn a task in another thread to process this batch
-#pragma omp task default(none) firstprivate(batch) shared(batches_outstanding, lambda2, handle, single_threaded_until_true)
+#pragma omp task default(none) firstprivate(batch, batch_bytes) shared(batches_outstanding, bytes_outstanding, process_batch)
                         {
-                            {
-                                T obj1, obj2;
-                                for (int i = 0; i<batch_size; i+=2) {
-                                    // parse protobuf objects and invoke lambda on the pair
-                                    handle(obj1.ParseFromString(batch->at(i)));
-                                    handle(obj2.ParseFromString(batch->at(i+1)));
-                                    lambda2(obj1,obj2);
-                                }
-                            } // scope obj1 & obj2
+                            process_batch(*batch);
                             delete batch;
 #pragma omp atomic update
                             batches_outstanding--;
+#pragma omp atomic update
+                            bytes_outstanding -= batch_bytes;
                         }
                     }
 
@@ -518,6 +585,11 @@ void for_each_parallel_impl(std::istream& in,
         #pragma omp taskwait
         // process final batch
         if (batch) {
+            // all the other batches are done, so this is the only one outstanding
+            local_stats.batches++;
+            local_stats.max_batches_outstanding = std::max<size_t>(local_stats.max_batches_outstanding, 1);
+            local_stats.max_bytes_outstanding = std::max(local_stats.max_bytes_outstanding, batch_bytes);
+            local_stats.max_batch_bytes = std::max(local_stats.max_batch_bytes, batch_bytes);
             {
                 T obj1, obj2;
                 int i = 0;
@@ -534,39 +606,47 @@ void for_each_parallel_impl(std::istream& in,
             delete batch;
         }
     }
+    
+    if (stats) {
+        local_stats.bytes_outstanding_limit = max_bytes_outstanding;
+        *stats = local_stats;
+    }
 }
 
 // parallel iteration over interleaved pairs of elements; error out if there's an odd number of elements
 template <typename T>
 void for_each_interleaved_pair_parallel(std::istream& in,
-                                        const std::function<void(T&,T&)>& lambda2) {
+                                        const std::function<void(T&,T&)>& lambda2,
+                                        ParallelStreamStats* stats = nullptr) {
     std::function<void(T&)> err1 = [](T&){
         throw std::runtime_error("stream::for_each_interleaved_pair_parallel: expected input stream of interleaved pairs, but it had odd number of elements");
     };
     std::function<void(size_t)> no_count = [](size_t i) {};
     std::function<bool(void)> no_wait = [](void) {return true;};
-    for_each_parallel_impl(in, lambda2, err1, no_count, no_wait);
+    for_each_parallel_impl(in, lambda2, err1, no_count, no_wait, stats);
 }
     
 template <typename T>
 void for_each_interleaved_pair_parallel_after_wait(std::istream& in,
                                                    const std::function<void(T&,T&)>& lambda2,
-                                                   const std::function<bool(void)>& single_threaded_until_true) {
+                                                   const std::function<bool(void)>& single_threaded_until_true,
+                                                   ParallelStreamStats* stats = nullptr) {
     std::function<void(T&)> err1 = [](T&){
         throw std::runtime_error("stream::for_each_interleaved_pair_parallel: expected input stream of interleaved pairs, but it had odd number of elements");
     };
     std::function<void(size_t)> no_count = [](size_t i) {};
-    for_each_parallel_impl(in, lambda2, err1, no_count, single_threaded_until_true);
+    for_each_parallel_impl(in, lambda2, err1, no_count, single_threaded_until_true, stats);
 }
 
 // parallelized for each individual element
 template <typename T>
 void for_each_parallel(std::istream& in,
                        const std::function<void(T&)>& lambda1,
-                       const std::function<void(size_t)>& handle_count) {
+                       const std::function<void(size_t)>& handle_count,
+                       ParallelStreamStats* stats = nullptr) {
     std::function<void(T&,T&)> lambda2 = [&lambda1](T& o1, T& o2) { lambda1(o1); lambda1(o2); };
     std::function<bool(void)> no_wait = [](void) {return true;};
-    for_each_parallel_impl(in, lambda2, lambda1, handle_count, no_wait);
+    for_each_parallel_impl(in, lambda2, lambda1, handle_count, no_wait, stats);
 }
 
 template <typename T>
@@ -0,0 +1,147 @@
+#include "sub_handle_graph.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+/** \file sub_handle_graph.cpp
+ * Implement the SubHandleGraph view.
+ */
+
+namespace vg {
+
+using namespace std;
+
+SubHandleGraph::SubHandleGraph(const HandleGraph* super) : super(super) {
+    // nothing to do
+}
+
+SubHandleGraph::SubHandleGraph(const HandleGraph* super, vector<id_t> node_ids) : super(super), ids(move(node_ids)) {
+    sort(ids.begin(), ids.end());
+    ids.erase(unique(ids.begin(), ids.end()), ids.end());
+}
+
+SubHandleGraph::SubHandleGraph(const HandleGraph* super, vector<id_t> node_ids, const unordered_set<edge_t>& edges)
+    : SubHandleGraph(super, move(node_ids)) {
+    edges_given = true;
+    for (const edge_t& edge : edges) {
+        // store the edges in one canonical orientation so either side can look them up
+        if (has_node(super->get_id(edge.first)) && has_node(super->get_id(edge.second))) {
+            edge_set.insert(super->edge_handle(edge.first, edge.second));
+        }
+    }
+}
+
+handle_t SubHandleGraph::get_handle(const id_t& node_id, bool is_reverse) const {
+    return super->get_handle(node_id, is_reverse);
+}
+
+id_t SubHandleGraph::get_id(const handle_t& handle) const {
+    return super->get_id(handle);
+}
+
+bool SubHandleGraph::get_is_reverse(const handle_t& handle) const {
+    return super->get_is_reverse(handle);
+}
+
+handle_t SubHandleGraph::flip(const handle_t& handle) const {
+    return super->flip(handle);
+}
+
+size_t SubHandleGraph::get_length(const handle_t& handle) const {
+    return super->get_length(handle);
+}
+
+string SubHandleGraph::get_sequence(const handle_t& handle) const {
+    return super->get_sequence(handle);
+}
+
+bool SubHandleGraph::follow_edges(const handle_t& handle, bool go_left,
+                                  const function<bool(const handle_t&)>& iteratee) const {
+    // only pass along the edges that stay inside the subgraph
+    return super->follow_edges(handle, go_left, [&](const handle_t& other) {
+        bool in_subgraph = go_left ? has_edge(other, handle) : has_edge(handle, other);
+        return in_subgraph ? iteratee(other) : true;
+    });
+}
+
+void SubHandleGraph::for_each_handle(const function<bool(const handle_t&)>& iteratee, bool parallel) const {
+    if (parallel) {
+        // The lambda function will let us know if we're bailing early.
+        bool stop_early = false;
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t i = 0; i < ids.size(); i++) {
+            bool stop;
+#pragma omp atomic read
+            stop = stop_early;
+            if (stop) {
+                continue;
+            }
+            if (!iteratee(super->get_handle(ids[i]))) {
+#pragma omp atomic write
+                stop_early = true;
+            }
+        }
+    }
+    else {
+        for (const id_t& node_id : ids) {
+            if (!iteratee(super->get_handle(node_id))) {
+                break;
+            }
+        }
+    }
+}
+
+size_t SubHandleGraph::node_size() const {
+    return ids.size();
+}
+
+bool SubHandleGraph::has_node(id_t node_id) const {
+    return binary_search(ids.begin(), ids.end(), node_id);
+}
+
+bool SubHandleGraph::has_edge(const handle_t& left, const handle_t& right) const {
+    if (edges_given) {
+        return edge_set.count(super->edge_handle(left, right));
+    }
+    return has_node(super->get_id(left)) && has_node(super->get_id(right));
+}
+
+void SubHandleGraph::extend(const SubHandleGraph& other) {
+    vector<id_t> merged;
+    merged.reserve(ids.size() + other.ids.size());
+    set_union(ids.begin(), ids.end(), other.ids.begin(), other.ids.end(), back_inserter(merged));
+    ids = move(merged);
+    
+    if (edges_given && other.edges_given) {
+        edge_set.insert(other.edge_set.begin(), other.edge_set.end());
+    }
+    else {
+        edges_given = false;
+        edge_set.clear();
+    }
+}
+
+SubHandleGraph SubHandleGraph::subgraph(vector<id_t> node_ids) const {
+    if (edges_given) {
+        return SubHandleGraph(super, move(node_ids), edge_set);
+    }
+    return SubHandleGraph(super, move(node_ids));
+}
+
+const vector<id_t>& SubHandleGraph::node_ids() const {
+    return ids;
+}
+
+id_t SubHandleGraph::min_node_id() const {
+    return ids.empty() ? 0 : ids.front();
+}
+
+id_t SubHandleGraph::max_node_id() const {
+    return ids.empty() ? 0 : ids.back();
+}
+
+const HandleGraph* SubHandleGraph::get_super() const {
+    return super;
+}
+
+}
@@ -0,0 +1,135 @@
+#ifndef VG_SUB_HANDLE_GRAPH_HPP_INCLUDED
+#define VG_SUB_HANDLE_GRAPH_HPP_INCLUDED
+
+/** \file sub_handle_graph.hpp
+ * A lightweight view of a subgraph of another HandleGraph.
+ */
+
+#include <vector>
+#include <unordered_set>
+
+#include "handle.hpp"
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * A HandleGraph that presents a subgraph of a backing ("super") graph. By
+ * default this is the subgraph induced by a set of node IDs, and nothing but
+ * the sorted node IDs is stored: handles, sequences and edges all come
+ * straight from the super graph, and edges are only reported if both of their
+ * nodes are in the subgraph. A view can instead be given the set of edges it
+ * contains (e.g. the edges a search actually traversed), in which case other
+ * edges between its nodes are hidden.
+ *
+ * Handles of the view are the handles of the super graph, so they can be
+ * passed back and forth freely. The super graph must outlive the view.
+ */
+class SubHandleGraph : public HandleGraph {
+public:
+    
+    /// Make an empty view of the given graph
+    SubHandleGraph(const HandleGraph* super);
+    
+    /// Make a view of the given graph containing the nodes with these IDs,
+    /// which need not be sorted or unique
+    SubHandleGraph(const HandleGraph* super, vector<id_t> node_ids);
+    
+    /// Make a view of the given graph containing the nodes with these IDs and
+    /// only the given edges of the super graph between them
+    SubHandleGraph(const HandleGraph* super, vector<id_t> node_ids, const unordered_set<edge_t>& edges);
+    
+    //////////////////////////
+    /// HandleGraph interface
+    //////////////////////////
+    
+    /// Look up the handle for the node with the given ID in the given orientation
+    virtual handle_t get_handle(const id_t& node_id, bool is_reverse = false) const;
+    // Copy over the visit version which would otherwise be shadowed.
+    using HandleGraph::get_handle;
+    
+    /// Get the ID from a handle
+    virtual id_t get_id(const handle_t& handle) const;
+    
+    /// Get the orientation of a handle
+    virtual bool get_is_reverse(const handle_t& handle) const;
+    
+    /// Invert the orientation of a handle (potentially without getting its ID)
+    virtual handle_t flip(const handle_t& handle) const;
+    
+    /// Get the length of a node
+    virtual size_t get_length(const handle_t& handle) const;
+    
+    /// Get the sequence of a node, presented in the handle's local forward
+    /// orientation.
+    virtual string get_sequence(const handle_t& handle) const;
+    
+    /// Loop over all the handles to next/previous (right/left) nodes that are
+    /// in the subgraph. Passes them to a callback which returns false to stop
+    /// iterating and true to continue. Returns true if we finished and false
+    /// if we stopped early.
+    virtual bool follow_edges(const handle_t& handle, bool go_left, const function<bool(const handle_t&)>& iteratee) const;
+    
+    // Copy over the template for nice calls
+    using HandleGraph::follow_edges;
+    
+    /// Loop over all the nodes in the subgraph in their local forward
+    /// orientations, in ascending order of ID. Stop if the iteratee returns false.
+    virtual void for_each_handle(const function<bool(const handle_t&)>& iteratee, bool parallel = false) const;
+    
+    // Copy over the template for nice calls
+    using HandleGraph::for_each_handle;
+    
+    /// Return the number of nodes in the subgraph
+    virtual size_t node_size() const;
+    
+    //////////////////////////
+    /// Subgraph methods
+    //////////////////////////
+    
+    /// Is the node with this ID in the subgraph?
+    bool has_node(id_t node_id) const;
+    
+    /// Is the edge between these handles in the subgraph?
+    bool has_edge(const handle_t& left, const handle_t& right) const;
+    
+    /// Add the nodes of another view of the same super graph to this one. The
+    /// edges are merged if both views were given their edges, otherwise the
+    /// result is the induced subgraph.
+    void extend(const SubHandleGraph& other);
+    
+    /// Make a view of some of the nodes of this one, with the edges of this
+    /// view between them
+    SubHandleGraph subgraph(vector<id_t> node_ids) const;
+    
+    /// The IDs of the nodes in the subgraph, in ascending order
+    const vector<id_t>& node_ids() const;
+    
+    /// The smallest node ID in the subgraph, or 0 if it is empty
+    id_t min_node_id() const;
+    
+    /// The largest node ID in the subgraph, or 0 if it is empty
+    id_t max_node_id() const;
+    
+    /// The graph this is a view of
+    const HandleGraph* get_super() const;
+    
+private:
+    
+    /// The graph we are a view of
+    const HandleGraph* super;
+    
+    /// The sorted, deduplicated IDs of the nodes in the view
+    vector<id_t> ids;
+    
+    /// Was the view given its edges, rather than taking all of them between its nodes?
+    bool edges_given = false;
+    
+    /// If the edges were given, the edges in the view, as the super graph's edge_handle makes them
+    unordered_set<edge_t> edge_set;
+};
+
+}
+
+#endif
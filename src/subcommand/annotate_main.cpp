@@ -1,7 +1,8 @@
 #include "subcommand.hpp"
 #include "../vg.hpp"
 #include "../utility.hpp"
-#include "../mapper.hpp"
+#include "../xg_position.hpp"
+#include "../interval_index.hpp"
 #include "../stream.hpp"
 #include "../alignment.hpp"
 #include "../annotation.hpp"
@@ -50,27 +51,6 @@ static pair<size_t, size_t> mapping_to_range(const xg::XG* xg_index, const Mappi
     return node_range;
 }
 
-using feature_t = pair<pair<size_t, size_t>, const string*>;
-
-/// Look up all ranges in the vector of features that overlap the start to past-end search interval.
-/// Return their unique string* interned feature names.
-static unordered_set<const string*> find_overlapping(const vector<feature_t>& ranges, pair<size_t, size_t> search_interval) {
-    // TODO: We expect at most a few features per node, so just do a linear scan
-    
-    unordered_set<const string*> to_return;
-    
-    for (auto& feature : ranges) {
-        auto& feature_range = feature.first;
-        
-        if (feature_range.second > search_interval.first && feature_range.first < search_interval.second) {
-            // There is overlap
-            to_return.insert(feature.second);
-        }
-    }
-    
-    return to_return;
-}
-
 int main_annotate(int argc, char** argv) {
     
     if (argc == 2) {
@@ -160,8 +140,6 @@ int main_annotate(int argc, char** argv) {
         return 1;
     }
     
-    Mapper mapper(xg_index, nullptr, nullptr);
-    
     if (!gam_name.empty()) {
         vector<Alignment> buffer;
         
@@ -215,6 +193,10 @@ int main_annotate(int argc, char** argv) {
             vector<vector<Alignment>> buffers;
             buffers.resize(get_thread_count());
             
+            // And per-thread batches of reads to annotate together
+            vector<vector<Alignment>> batches;
+            batches.resize(get_thread_count());
+            
             // We will need to track mappings from graph node regions to BED features.
             // We don't want each of those mappings to have a copy of the feature name, because that could be big.
             // So we intern the feature name strings.
@@ -233,10 +215,9 @@ int main_annotate(int argc, char** argv) {
             
             // This will hold, for each graph node, the start to past-end
             // regions occupied by BED features, and the names of those
-            // features.
-            // TODO: To enable better than linear search within a node, we ought to sort these.
-            unordered_map<vg::id_t, vector<feature_t>> features_on_node;
+            // features. It is built once and then shared by all the threads.
             // TODO: We can't use a Paths object because we lack unique names 
+            IntervalIndex<vg::id_t, const string*> feature_index;
             
             for (auto& bed_name : bed_names) {
                 // If there are BED files, load them up
@@ -256,37 +237,44 @@ int main_annotate(int argc, char** argv) {
                             // Scan the Mappings. We know each Mapping will be all perfect matches.
                             
                             // Record that the alignment covers the given region on the given node.
-                            features_on_node[mapping.position().node_id()].emplace_back(mapping_to_range(xg_index, mapping), interned_name);
+                            auto range = mapping_to_range(xg_index, mapping);
+                            feature_index.add(mapping.position().node_id(), range.first, range.second, interned_name);
                         }
                     }
                 });
             }
+            feature_index.index();
             
-            get_input_file(gam_name, [&](istream& in) {
-                stream::for_each_parallel<Alignment>(in, [&](Alignment& aln) {
-                    // For each read
-                    
-                    if (add_positions) {
-                        // Annotate it with its initial position on each path it touches
+            // Annotate a batch of reads and send them to the output buffer
+            auto annotate_batch = [&](vector<Alignment>& batch, vector<Alignment>& buffer) {
+                if (add_positions) {
+                    // Annotate them with their initial positions on each path they touch
+                    for (auto& aln : batch) {
                         aln.clear_refpos();
-                        mapper.annotate_with_initial_path_positions(aln);
                     }
-                    
-                    if (!features_on_node.empty()) {
+                    xg_annotate_with_initial_path_positions(batch, true, xg_index);
+                }
+                
+                for (auto& aln : batch) {
+                    if (!feature_index.empty()) {
                         // We want to annotate with BED feature overlaps as well.
                         unordered_set<const string*> touched_features;
                         
                         for (auto& mapping : aln.path().mapping()) {
                             // For each mapping
                             
-                            auto node_id = mapping.position().node_id();
-                            auto features = features_on_node.find(node_id);
-                            if (features != features_on_node.end()) {
-                                // Some things occur on this node. Find the overlaps with the part of the node touched by this read.
-                                auto overlapping = find_overlapping(features->second, mapping_to_range(xg_index, mapping));
-                                // Save them all to the set (to remove duplicates)
-                                copy(overlapping.begin(), overlapping.end(), inserter(touched_features, touched_features.begin()));
+                            if (!feature_index.has_contig(mapping.position().node_id())) {
+                                // Nothing occurs on this node
+                                continue;
                             }
+                            
+                            // Find the overlaps with the part of the node touched by this read.
+                            auto range = mapping_to_range(xg_index, mapping);
+                            // Save them all to the set (to remove duplicates)
+                            feature_index.for_each_overlap(mapping.position().node_id(), range.first, range.second,
+                                                           [&](const string* const& name) {
+                                touched_features.insert(name);
+                            });
                         }
                         
                         // Convert the string pointers to actual string copies, for annotation API.
@@ -301,12 +289,28 @@ int main_annotate(int argc, char** argv) {
                     }
                     
                     // Output the alignment
-                    auto& buffer = buffers.at(omp_get_thread_num());
                     buffer.emplace_back(std::move(aln));
                     stream::write_buffered(cout, buffer, 1000);
+                }
+                batch.clear();
+            };
+            
+            get_input_file(gam_name, [&](istream& in) {
+                stream::for_each_parallel<Alignment>(in, [&](Alignment& aln) {
+                    // For each read, add it to this thread's batch
+                    auto& batch = batches.at(omp_get_thread_num());
+                    batch.emplace_back(std::move(aln));
+                    if (batch.size() >= 256) {
+                        annotate_batch(batch, buffers.at(omp_get_thread_num()));
+                    }
                 });
             });
         
+            for (size_t i = 0; i < batches.size(); i++) {
+                // Finish each batch
+                annotate_batch(batches[i], buffers[i]);
+            }
+            
             for (auto& buffer : buffers) {
                 // Finish each buffer
                 stream::write_buffered(cout, buffer, 0);
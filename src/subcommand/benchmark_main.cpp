@@ -8,6 +8,9 @@
 #include <getopt.h>
 
 #include <iostream>
+#include <fstream>
+#include <random>
+#include <sstream>
 
 #include "subcommand.hpp"
 
@@ -16,9 +19,18 @@
 
 #include "../vg.hpp"
 #include "../xg.hpp"
+#include "../build_index.hpp"
+#include "../mapper.hpp"
+#include "../sampler.hpp"
+#include "../stream.hpp"
+#include "../gamsorter.hpp"
+#include "../packer.hpp"
+#include "../surjector.hpp"
+#include "../utility.hpp"
 #include "../algorithms/extract_connecting_graph.hpp"
 #include "../algorithms/topological_sort.hpp"
 #include "../algorithms/weakly_connected_components.hpp"
+#include "../random_graph.hpp"
 
 
 
@@ -29,12 +41,275 @@ using namespace vg::subcommand;
 void help_benchmark(char** argv) {
     cerr << "usage: " << argv[0] << " benchmark [options] >report.tsv" << endl
          << "options:" << endl
-         << "    -p, --progress         show progress" << endl;
+         << "    -p, --progress         show progress" << endl
+         << "    -e, --end-to-end       run the end-to-end workload suite instead of the microbenchmarks" << endl
+         << "    -b, --baseline FILE    compare scores against this earlier report" << endl
+         << "end-to-end options:" << endl
+         << "    -s, --seed N           seed for generating the graph and reads (default 1)" << endl
+         << "    -l, --length N         length of the generated reference (default 100000)" << endl
+         << "    -r, --reads N          number of reads to simulate (default 5000)" << endl
+         << "    -i, --iterations N     runs of each workload (default 5)" << endl
+         << "    -t, --threads N        measure mapping throughput with up to N threads (default all)" << endl;
+}
+
+/**
+ * Run the end-to-end workloads on inputs generated from the given seed. The
+ * mapping workloads run through the command line of the given vg binary.
+ */
+vector<WorkloadResult> run_workloads(const string& vg_binary, size_t seed, size_t ref_length, size_t num_reads,
+                                     size_t iterations, int max_threads, bool show_progress) {
+    
+    // Generate a graph with a reference path, chopped so GCSA2 can index it
+    if (show_progress) {
+        cerr << "[vg benchmark] generating graph and indexes" << endl;
+    }
+    string ref_name = "ref";
+    default_random_engine graph_generator(seed);
+    VG graph = random_graph(ref_length, 20, ref_length / 100, graph_generator, true, ref_name);
+    graph.dice_nodes(32);
+    graph.paths.to_graph(graph.graph);
+    
+    xg::XG xg_index(graph.graph);
+    
+    gcsa::TempFile::setDirectory(temp_file::get_dir());
+    gcsa::Verbosity::set(gcsa::Verbosity::SILENT);
+    gcsa::GCSA* gcsa_index = nullptr;
+    gcsa::LCPArray* lcp_array = nullptr;
+    build_gcsa_lcp(graph, gcsa_index, lcp_array, 16, 3);
+    
+    // Save the indexes for the mapping commands
+    string xg_name = temp_file::create();
+    {
+        ofstream xg_out(xg_name);
+        xg_index.serialize(xg_out);
+    }
+    string gcsa_name = temp_file::create();
+    sdsl::store_to_file(*gcsa_index, gcsa_name);
+    sdsl::store_to_file(*lcp_array, gcsa_name + ".lcp");
+    
+    // Simulate reads with an error profile learned from a generated FASTQ
+    if (show_progress) {
+        cerr << "[vg benchmark] simulating " << num_reads << " reads" << endl;
+    }
+    string training_fastq = temp_file::create();
+    {
+        default_random_engine generator(seed);
+        uniform_int_distribution<int> quality_distribution(20, 40);
+        ofstream training(training_fastq);
+        for (size_t i = 0; i < 1000; i++) {
+            string quality(100, '\0');
+            for (size_t j = 0; j < quality.size(); j++) {
+                // qualities fall off along the read
+                quality[j] = (char) (33 + max<int>(2, quality_distribution(generator) - j / 10));
+            }
+            training << "@train" << i << endl << string(100, 'A') << endl << "+" << endl << quality << endl;
+        }
+    }
+    NGSSimulator simulator(xg_index, training_fastq, false, {ref_name}, 0.001, 0.0002, 0.01,
+                           1000.0, 75.0, 1.0, true, seed);
+    temp_file::remove(training_fastq);
+    
+    vector<Alignment> reads(num_reads);
+    size_t read_bases = 0;
+    for (size_t i = 0; i < num_reads; i++) {
+        Alignment simulated = simulator.sample_read();
+        reads[i].set_name("read" + to_string(i));
+        reads[i].set_sequence(simulated.sequence());
+        reads[i].set_quality(simulated.quality());
+        read_bases += reads[i].sequence().size();
+    }
+    string reads_name = temp_file::create();
+    {
+        ofstream reads_out(reads_name);
+        stream::write_buffered(reads_out, reads, 0);
+    }
+    
+    vector<WorkloadResult> results;
+    
+    // Measure a workload that runs in this process. Its peak memory use
+    // includes the inputs that we hold.
+    auto measure = [&](const string& name, size_t threads, size_t items, size_t bytes,
+                       const function<void(void)>& setup, const function<void(void)>& under_test) {
+        if (show_progress) {
+            cerr << "[vg benchmark] running " << name << endl;
+        }
+        WorkloadResult result;
+        bool rss_reset = reset_peak_rss();
+        result.timing = run_benchmark(name, iterations, setup, under_test);
+        result.threads = threads;
+        result.items = items;
+        result.bytes = bytes;
+        result.peak_rss_kb = rss_reset ? peak_rss_kb() : 0;
+        results.push_back(result);
+    };
+    auto no_setup = []() {};
+    
+    // Run a vg command, and stop if it fails. Returns its peak memory use.
+    auto run_command = [&](const vector<string>& args, const string& out_file) -> size_t {
+        size_t command_peak_rss_kb;
+        if (run_benchmark_command(args, out_file, command_peak_rss_kb) != 0) {
+            cerr << "error:[vg benchmark] command failed:";
+            for (auto& arg : args) {
+                cerr << " " << arg;
+            }
+            cerr << endl;
+            exit(1);
+        }
+        return command_peak_rss_kb;
+    };
+    
+    // Measure a workload that runs as a vg command, with the peak memory use
+    // of the command itself.
+    auto measure_command = [&](const string& name, size_t threads, size_t items, size_t bytes,
+                               const vector<string>& args) {
+        if (show_progress) {
+            cerr << "[vg benchmark] running " << name << endl;
+        }
+        WorkloadResult result;
+        result.peak_rss_kb = 0;
+        result.timing = run_benchmark(name, iterations, [&]() {
+            result.peak_rss_kb = max(result.peak_rss_kb, run_command(args, "/dev/null"));
+        });
+        result.threads = threads;
+        result.items = items;
+        result.bytes = bytes;
+        results.push_back(result);
+    };
+    
+    // XG load and traversal
+    stringstream xg_stream;
+    xg_index.serialize(xg_stream);
+    string xg_data = xg_stream.str();
+    measure("end-to-end xg load and traversal", 1, xg_index.node_count, xg_data.size(), no_setup, [&]() {
+        stringstream in(xg_data);
+        xg::XG loaded;
+        loaded.load(in);
+        size_t edges_seen = 0;
+        loaded.for_each_handle([&](const handle_t& handle) {
+            loaded.follow_edges(handle, false, [&](const handle_t& next) {
+                edges_seen++;
+            });
+            return true;
+        });
+    });
+    
+    // GCSA MEM finding
+    Mapper mapper(&xg_index, gcsa_index, lcp_array);
+    measure("end-to-end gcsa mem finding", 1, num_reads, read_bases, no_setup, [&]() {
+        double lcp_avg, fraction_filtered;
+        for (auto& read : reads) {
+            auto mems = mapper.find_mems_deep(read.sequence().begin(), read.sequence().end(),
+                                              lcp_avg, fraction_filtered, 0,
+                                              mapper.min_mem_length, mapper.mem_reseed_length,
+                                              false, true, true, false);
+        }
+    });
+    
+    // Mapping throughput for increasing thread counts, including index loading
+    vector<int> thread_counts;
+    for (int threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+    
+    for (string mapper_name : {"map", "mpmap"}) {
+        for (int threads : thread_counts) {
+            measure_command("end-to-end vg " + mapper_name + " " + to_string(threads) + " threads", threads,
+                            num_reads, read_bases,
+                            {vg_binary, mapper_name, "-x", xg_name, "-g", gcsa_name, "-G", reads_name,
+                             "-t", to_string(threads)});
+        }
+    }
+    
+    // Map the reads once more for the workloads that consume alignments
+    string mapped_name = temp_file::create();
+    run_command({vg_binary, "map", "-x", xg_name, "-g", gcsa_name, "-G", reads_name,
+                 "-t", to_string(max_threads)}, mapped_name);
+    vector<Alignment> mapped;
+    {
+        ifstream mapped_in(mapped_name);
+        function<void(Alignment&)> lambda = [&](Alignment& aln) {
+            mapped.push_back(aln);
+        };
+        stream::for_each(mapped_in, lambda);
+    }
+    temp_file::remove(mapped_name);
+    
+    // GAM streaming
+    string gam_data;
+    {
+        stringstream gam_stream;
+        stream::write<Alignment>(gam_stream, mapped.size(), [&](size_t i) {
+            return mapped[i];
+        });
+        gam_data = gam_stream.str();
+    }
+    measure("end-to-end gam write", 1, num_reads, gam_data.size(), no_setup, [&]() {
+        stringstream out;
+        stream::write<Alignment>(out, mapped.size(), [&](size_t i) {
+            return mapped[i];
+        });
+    });
+    measure("end-to-end gam read", 1, num_reads, gam_data.size(), no_setup, [&]() {
+        stringstream in(gam_data);
+        size_t read_count = 0;
+        function<void(Alignment&)> lambda = [&](Alignment& aln) {
+            read_count++;
+        };
+        stream::for_each(in, lambda);
+    });
+    
+    // GAM sorting
+    measure("end-to-end gamsort", 1, num_reads, gam_data.size(), no_setup, [&]() {
+        stringstream in(gam_data);
+        stringstream out;
+        GAMSorter sorter;
+        sorter.stream_sort(in, out);
+    });
+    
+    // Packing
+    unique_ptr<Packer> packer;
+    measure("end-to-end pack", 1, num_reads, gam_data.size(), [&]() {
+        packer.reset(new Packer(&xg_index));
+    }, [&]() {
+        for (auto& aln : mapped) {
+            packer->add(aln);
+        }
+    });
+    packer.reset();
+    
+    // Surjection
+    Surjector surjector(&xg_index);
+    set<string> surject_paths{ref_name};
+    measure("end-to-end surject", 1, num_reads, gam_data.size(), no_setup, [&]() {
+        for (auto& aln : mapped) {
+            string path_name;
+            int64_t path_pos;
+            bool path_rev;
+            auto surjected = surjector.surject(aln, surject_paths, path_name, path_pos, path_rev);
+        }
+    });
+    
+    delete gcsa_index;
+    delete lcp_array;
+    temp_file::remove(xg_name);
+    temp_file::remove(gcsa_name);
+    temp_file::remove(gcsa_name + ".lcp");
+    temp_file::remove(reads_name);
+    
+    return results;
 }
 
 int main_benchmark(int argc, char** argv) {
 
     bool show_progress = false;
+    bool end_to_end = false;
+    string baseline_name;
+    size_t seed = 1;
+    size_t ref_length = 100000;
+    size_t num_reads = 5000;
+    size_t iterations = 5;
+    int max_threads = omp_get_max_threads();
     
     int c;
     optind = 2; // force optind past command positional argument
@@ -42,12 +317,19 @@ int main_benchmark(int argc, char** argv) {
         static struct option long_options[] =
             {
                 {"progress",  no_argument, 0, 'p'},
+                {"end-to-end", no_argument, 0, 'e'},
+                {"baseline", required_argument, 0, 'b'},
+                {"seed", required_argument, 0, 's'},
+                {"length", required_argument, 0, 'l'},
+                {"reads", required_argument, 0, 'r'},
+                {"iterations", required_argument, 0, 'i'},
+                {"threads", required_argument, 0, 't'},
                 {"help", no_argument, 0, 'h'},
                 {0, 0, 0, 0}
             };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "ph?",
+        c = getopt_long (argc, argv, "peb:s:l:r:i:t:h?",
                          long_options, &option_index);
 
         /* Detect the end of the options. */
@@ -61,6 +343,34 @@ int main_benchmark(int argc, char** argv) {
             show_progress = true;
             break;
             
+        case 'e':
+            end_to_end = true;
+            break;
+            
+        case 'b':
+            baseline_name = optarg;
+            break;
+            
+        case 's':
+            seed = parse<size_t>(optarg);
+            break;
+            
+        case 'l':
+            ref_length = parse<size_t>(optarg);
+            break;
+            
+        case 'r':
+            num_reads = parse<size_t>(optarg);
+            break;
+            
+        case 'i':
+            iterations = parse<size_t>(optarg);
+            break;
+            
+        case 't':
+            max_threads = parse<int>(optarg);
+            break;
+            
         case 'h':
         case '?':
             /* getopt_long already printed an error message. */
@@ -80,6 +390,60 @@ int main_benchmark(int argc, char** argv) {
         exit(1);
     }
     
+    if (ref_length < 1000 || num_reads == 0 || iterations == 0 || max_threads <= 0) {
+        cerr << "error:[vg benchmark] reference length must be at least 1000, and reads, iterations, and threads must be positive" << endl;
+        exit(1);
+    }
+    
+    BenchmarkBaseline baseline;
+    if (!baseline_name.empty()) {
+        ifstream baseline_stream(baseline_name);
+        if (!baseline_stream) {
+            cerr << "error:[vg benchmark] could not open baseline report " << baseline_name << endl;
+            exit(1);
+        }
+        baseline = load_benchmark_baseline(baseline_stream);
+    }
+    
+    // Report how a score compares to the baseline, if we have one
+    auto compare = [&](const BenchmarkResult& result) {
+        if (baseline.empty()) {
+            return;
+        }
+        auto found = baseline.find(result.name);
+        if (found == baseline.end()) {
+            cout << "\t.\t.\t.\tnew";
+            return;
+        }
+        double sigma = score_significance(result, found->second);
+        cout << "\t" << found->second.first << "\t" << found->second.second << "\t" << sigma << "\t"
+             << (sigma <= -2.0 ? "slower" : (sigma >= 2.0 ? "faster" : "same"));
+    };
+    
+    if (end_to_end) {
+        // Let the workloads pick their own thread counts
+        omp_set_num_threads(max_threads);
+        
+        vector<WorkloadResult> results = run_workloads(argv[0], seed, ref_length, num_reads, iterations,
+                                                       max_threads, show_progress);
+        
+        cout << "# End-to-end benchmark results for vg " << Version::get_short()
+             << " (seed " << seed << ", length " << ref_length << ", " << num_reads << " reads)" << endl;
+        cout << "# runs\ttest(us)\tstddev(us)\tcontrol(us)\tstddev(us)\tscore\terr\tname"
+             << "\tthreads\titems/s\tbytes/s\tpeak_rss(kb)";
+        if (!baseline.empty()) {
+            cout << "\tbaseline\tbaseline_err\tsigma\tchange";
+        }
+        cout << endl;
+        for (auto& result : results) {
+            cout << result;
+            compare(result.timing);
+            cout << endl;
+        }
+        
+        return 0;
+    }
+    
     // Do all benchmarking on one thread
     omp_set_num_threads(1);
     
@@ -171,9 +535,15 @@ int main_benchmark(int argc, char** argv) {
     results.push_back(run_benchmark("control", 1000, benchmark_control));
 
     cout << "# Benchmark results for vg " << Version::get_short() << endl;
-    cout << "# runs\ttest(us)\tstddev(us)\tcontrol(us)\tstddev(us)\tscore\terr\tname" << endl;
+    cout << "# runs\ttest(us)\tstddev(us)\tcontrol(us)\tstddev(us)\tscore\terr\tname";
+    if (!baseline.empty()) {
+        cout << "\tbaseline\tbaseline_err\tsigma\tchange";
+    }
+    cout << endl;
     for (auto& result : results) {
-        cout << result << endl;
+        cout << result;
+        compare(result);
+        cout << endl;
     }
 
     return 0;
@@ -65,7 +65,10 @@ void help_chunk(char** argv) {
          << "    -l, --context-length N   expand the context of the chunk by this many bp [0]" << endl
          << "    -T, --trace              trace haplotype threads in chunks (and only expand forward from input coordinates)." << endl
          << "                             Produces a .annotate.txt file with haplotype frequencies for each chunk." << endl 
+         << "    -O, --one-pass-trace     with -T and -G, trace all chunks together in parallel before writing them," << endl
+         << "                             searching each distinct trace query once" << endl
          << "    -f, --fully-contained    only return GAM alignments that are fully contained within chunk" << endl
+         << "    -X, --xg-out             write graph chunks as their own xg indexes (.xg) instead of .vg files" << endl
          << "    -t, --threads N          for tasks that can be done in parallel, use this many threads [1]" << endl
          << "    -h, --help" << endl;
 }
@@ -98,6 +101,8 @@ int main_chunk(int argc, char** argv) {
     bool fully_contained = false;
     int n_chunks = 0;
     size_t gam_split_size = 0;
+    bool xg_out = false;
+    bool one_pass_trace = false;
     
     int c;
     optind = 2; // force optind past command positional argument
@@ -125,11 +130,13 @@ int main_chunk(int argc, char** argv) {
             {"n-chunks", required_argument, 0, 'n'},
             {"context-length", required_argument, 0, 'l'},
             {"gam-split-size", required_argument, 0, 'm'},
+            {"xg-out", no_argument, 0, 'X'},
+            {"one-pass-trace", no_argument, 0, 'O'},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hx:G:a:gp:P:s:o:e:E:b:c:r:R:Tft:n:l:m:",
+        c = getopt_long (argc, argv, "hx:G:a:gp:P:s:o:e:E:b:c:r:R:Tft:n:l:m:XO",
                 long_options, &option_index);
 
 
@@ -224,6 +231,14 @@ int main_chunk(int argc, char** argv) {
             threads = parse<int>(optarg);
             break;
 
+        case 'X':
+            xg_out = true;
+            break;
+
+        case 'O':
+            one_pass_trace = true;
+            break;
+
         case 'h':
         case '?':
             help_chunk(argv);
@@ -243,6 +258,11 @@ int main_chunk(int argc, char** argv) {
         cerr << "error:[vg chunk] at most one of {-n, -p, -P, -e, -r, -R, m} required to specify input regions" << endl;
         return 1;
     }
+    // one-pass tracing works on the GBWT
+    if (one_pass_trace && (!trace || gbwt_file.empty())) {
+        cerr << "error:[vg chunk] -O requires -T and a GBWT index (-G)" << endl;
+        return 1;
+    }
     // need -a if using -f
     if ((gam_split_size != 0 || fully_contained) && gam_file.empty()) {
         cerr << "error:[vg chunk] gam file must be specified with -a when using -f or -m" << endl;
@@ -462,6 +482,7 @@ int main_chunk(int argc, char** argv) {
     };
 
     int num_regions = regions.size();
+    string graph_ext = xg_out ? ".xg" : ".vg";
 
     // because we are expanding context, and not cutting nodes, our output
     // chunks are going to cover larger regions that what was asked for.
@@ -494,49 +515,43 @@ int main_chunk(int argc, char** argv) {
     }
     
 
-    // extract chunks in parallel
-#pragma omp parallel for
-    for (int i = 0; i < num_regions; ++i) {
+    // where does haplotype tracing start for a chunk, and how far does it go?
+    auto get_trace_query = [&](const Region& output_region) -> pair<vg::id_t, int> {
+        int64_t trace_start;
+        int64_t trace_end;
+        if (id_range) {
+            trace_start = output_region.start;
+            trace_end = output_region.end;
+        } else {
+            trace_start = xindex.node_at_path_position(output_region.seq,
+                                                       output_region.start);
+            trace_end = xindex.node_at_path_position(output_region.seq,
+                                                     output_region.end);
+        }
+        int64_t trace_steps = trace_end - trace_start;
+        return make_pair(trace_start, trace_steps);
+    };
+
+    // haplotypes for each chunk, when they are all traced in one pass
+    vector<vector<pair<thread_t, int>>> chunk_haplotypes;
+
+    // write out everything for chunk i, given its subgraph (if we made one)
+    function<void(int, VG*)> write_chunk = [&](int i, VG* subgraph) {
         int tid = omp_get_thread_num();
         Region& region = regions[i];
-        PathChunker& chunker = chunkers[tid];
-        VG* subgraph = NULL;
         map<string, int> trace_thread_frequencies;
-        if (id_range == false) {
-            subgraph = new VG();
-            chunker.extract_subgraph(region, context_steps, context_length,
-                                     trace, *subgraph, output_regions[i]);
-        } else {
-            if (chunk_graph || context_steps > 0) {
-                subgraph = new VG();
-                output_regions[i].seq = region.seq;
-                chunker.extract_id_range(region.start, region.end,
-                                         context_steps, context_length, trace,
-                                         *subgraph, output_regions[i]);
-            } else {
-                // in this case, there's no need to actually build the subgraph, so we don't
-                // in order to save time.
-                output_regions[i] = region;
-            }
-        }
 
         // optionally trace our haplotypes
         if (trace && subgraph) {
-            int64_t trace_start;
-            int64_t trace_end;
-            if (id_range) {
-                trace_start = output_regions[i].start;
-                trace_end = output_regions[i].end;
+            Graph g;
+            if (one_pass_trace) {
+                embed_haplotypes(xindex, chunk_haplotypes[i], g, trace_thread_frequencies);
+                chunk_haplotypes[i].clear();
             } else {
-                trace_start = xindex.node_at_path_position(output_regions[i].seq,
-                                                           output_regions[i].start);
-                trace_end = xindex.node_at_path_position(output_regions[i].seq,
-                                                         output_regions[i].end);
+                pair<vg::id_t, int> trace_query = get_trace_query(output_regions[i]);
+                trace_haplotypes_and_paths(xindex, gbwt_index.get(), trace_query.first, trace_query.second,
+                                           g, trace_thread_frequencies, false);
             }
-            int64_t trace_steps = trace_end - trace_start;
-            Graph g;
-            trace_haplotypes_and_paths(xindex, gbwt_index.get(), trace_start, trace_steps,
-                                       g, trace_thread_frequencies, false);
             subgraph->paths.for_each([&trace_thread_frequencies](const Path& path) {
                     trace_thread_frequencies[path.name()] = 1;});            
             subgraph->extend(g);
@@ -553,7 +568,7 @@ int main_chunk(int argc, char** argv) {
             } else {
                 // Otherwise, we write files under the specified prefix, using
                 // a prefix-i-seq-start-end convention.
-                string name = chunk_name(i, output_regions[i], ".vg");
+                string name = chunk_name(i, output_regions[i], graph_ext);
                 out_file.open(name);
                 if (!out_file) {
                     cerr << "error[vg chunk]: can't open output chunk file " << name << endl;
@@ -562,7 +577,15 @@ int main_chunk(int argc, char** argv) {
                 out_stream = &out_file;
             }
             
-            subgraph->serialize_to_ostream(*out_stream);
+            if (xg_out) {
+                // index the chunk on its own
+                subgraph->graph.clear_path();
+                subgraph->paths.to_graph(subgraph->graph);
+                xg::XG chunk_index(subgraph->graph);
+                chunk_index.serialize(*out_stream);
+            } else {
+                subgraph->serialize_to_ostream(*out_stream);
+            }
         }
         
         // optional gam chunking
@@ -604,8 +627,65 @@ int main_chunk(int argc, char** argv) {
                 out_annot_file << tf.first << "\t" << tf.second << endl;
             }
         }
+    };
+
+    // do we need subgraphs at all?
+    bool need_subgraphs = !id_range || chunk_graph || context_steps > 0;
+
+    if (need_subgraphs && (num_regions > 1 || one_pass_trace)) {
+        // find all the chunks together, so that their paths can be extracted
+        // in one pass over each path
+        auto lambda = [&](size_t i, VG& subgraph, Region& out_region) {
+            output_regions[i] = out_region;
+            write_chunk(i, &subgraph);
+        };
+        function<void(const vector<Region>&)> before_chunks = nullptr;
+        if (one_pass_trace) {
+            // trace the haplotypes of all the chunks before writing any of them
+            before_chunks = [&](const vector<Region>& out_regions) {
+                vector<pair<vg::id_t, int>> trace_queries(out_regions.size());
+#pragma omp parallel for
+                for (size_t i = 0; i < out_regions.size(); ++i) {
+                    trace_queries[i] = get_trace_query(out_regions[i]);
+                }
+                chunk_haplotypes = list_haplotypes(xindex, *gbwt_index, trace_queries);
+            };
+        }
+        if (id_range) {
+            chunkers[0].extract_id_ranges(regions, context_steps, context_length, trace, lambda, before_chunks);
+        } else {
+            chunkers[0].extract_subgraphs(regions, context_steps, context_length, trace, lambda, before_chunks);
+        }
+    } else {
+        // extract chunks in parallel
+#pragma omp parallel for
+        for (int i = 0; i < num_regions; ++i) {
+            int tid = omp_get_thread_num();
+            Region& region = regions[i];
+            PathChunker& chunker = chunkers[tid];
+            VG* subgraph = NULL;
+            if (id_range == false) {
+                subgraph = new VG();
+                chunker.extract_subgraph(region, context_steps, context_length,
+                                         trace, *subgraph, output_regions[i]);
+            } else {
+                if (need_subgraphs) {
+                    subgraph = new VG();
+                    output_regions[i].seq = region.seq;
+                    chunker.extract_id_range(region.start, region.end,
+                                             context_steps, context_length, trace,
+                                             *subgraph, output_regions[i]);
+                } else {
+                    // in this case, there's no need to actually build the subgraph, so we don't
+                    // in order to save time.
+                    output_regions[i] = region;
+                }
+            }
 
-        delete subgraph;
+            write_chunk(i, subgraph);
+
+            delete subgraph;
+        }
     }
         
     // write a bed file if asked giving a more explicit linking of chunks to files
@@ -618,7 +698,7 @@ int main_chunk(int argc, char** argv) {
             const Region& oregion = output_regions[i];
             string seq = id_range ? "ids" : oregion.seq;
             obed << seq << "\t" << oregion.start << "\t" << (oregion.end + 1)
-                 << "\t" << chunk_name(i, oregion, chunk_gam ? ".gam" : ".vg");
+                 << "\t" << chunk_name(i, oregion, chunk_gam ? ".gam" : graph_ext);
             if (trace) {
                 obed << "\t" << chunk_name(i, oregion, ".annotate.txt");
             }
@@ -640,16 +640,33 @@ int main_find(int argc, char** argv) {
             vgg.serialize_to_ostream(cout);
         }
         if(!haplotype_alignments.empty()) {
+            // We count matches for the alignments' paths in batches, so
+            // stretches of haplotype that many of them share are searched
+            // once per batch.
+            vector<xg::XG::thread_t> batch;
+            auto count_batch = [&]() {
+                // A path might be empty, in which case it will yield the
+                // biggest size_t you can have.
+                for (size_t matches : xindex.count_matches(batch)) {
+                    // We do this single-threaded, at least for now, so we don't
+                    // need to worry about coordinating output, and we can just
+                    // spit out the counts as bare numbers.
+                    cout << matches << endl;
+                }
+                batch.clear();
+            };
+            
             // What should we do with each alignment?
-            function<void(Alignment&)> lambda = [&xindex](Alignment& aln) {
-                // Count the amtches to the path. The path might be empty, in
-                // which case it will yield the biggest size_t you can have.
-                size_t matches = xindex.count_matches(aln.path());
-
-                // We do this single-threaded, at least for now, so we don't
-                // need to worry about coordinating output, and we can just
-                // spit out the counts as bare numbers.
-                cout << matches << endl;
+            function<void(Alignment&)> lambda = [&](Alignment& aln) {
+                // We assume the path is a thread and convert.
+                batch.emplace_back();
+                for (size_t i = 0; i < aln.path().mapping_size(); i++) {
+                    auto& position = aln.path().mapping(i).position();
+                    batch.back().push_back({position.node_id(), position.is_reverse()});
+                }
+                if (batch.size() >= 10000) {
+                    count_batch();
+                }
             };
             if (haplotype_alignments == "-") {
                 stream::for_each(std::cin, lambda);
@@ -662,7 +679,7 @@ int main_find(int argc, char** argv) {
                 }
                 stream::for_each(in, lambda);
             }
-
+            count_batch();
         }
         if (extract_threads) {
             bool extract_reverse = false;
@@ -118,12 +118,14 @@ int main_gamsort(int argc, char **argv)
             }
 
             // Index the alignments in RocksDB
-            rocks.open_for_bulk_load(rocksdb_filename);
+            rocks.open_for_ingest(rocksdb_filename);
             int64_t aln_idx = 0;
             function<void(Alignment&)> lambda_reader = [&rocks](Alignment& aln) {
                     rocks.put_alignment(aln);
             };
             stream::for_each_parallel(gam_in, lambda_reader);
+            // the alignments aren't in the database until they are ingested
+            rocks.flush();
             
             // Set up the emitter
             stream::ProtobufEmitter<Alignment> output(cout);
@@ -7,13 +7,17 @@
 #include <omp.h>
 #include <unistd.h>
 #include <getopt.h>
+#include <sys/stat.h>
 
 #include <iostream>
+#include <fstream>
 
 #include "subcommand.hpp"
 
 #include "../vg.hpp"
 #include "../vg_set.hpp"
+#include "../stream.hpp"
+#include "../topology_graph.hpp"
 #include "../algorithms/topological_sort.hpp"
 
 #include <gcsa/support.h>
@@ -32,7 +36,35 @@ void help_ids(char** argv) {
         << "                         by iterating through the supplied graphs and incrementing" << endl
         << "                         their ids to be non-conflicting (modifies original files)" << endl
         << "    -m, --mapping FILE   create an empty node mapping for vg prune" << endl
-        << "    -s, --sort           assign new node IDs in (generalized) topological sort order" << endl;
+        << "    -s, --sort           assign new node IDs in (generalized) topological sort order" << endl
+        << "sort options:" << endl
+        << "    -T, --translation FILE     write the old and new ID of each node to FILE as TSV" << endl
+        << "    -a, --alignments FILE      renumber the nodes in the alignments in this GAM too" << endl
+        << "    -A, --alignments-out FILE  write the renumbered alignments here" << endl
+        << "    -t, --threads N            number of threads to use" << endl;
+}
+
+/// Read the items in a stream in batches of the given number of chunks, modify
+/// them in parallel, and write them back out in their original order.
+template<typename T>
+void rewrite_in_batches(istream& in, ostream& out, size_t batch_size, const function<void(T&)>& modify) {
+    vector<T> batch;
+    auto rewrite_batch = [&]() {
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t i = 0; i < batch.size(); i++) {
+            modify(batch[i]);
+        }
+        stream::write_buffered(out, batch, 1);
+    };
+    stream::for_each<T>(in, [&](T& item) {
+        batch.emplace_back();
+        swap(batch.back(), item);
+        if (batch.size() >= batch_size) {
+            rewrite_batch();
+        }
+    });
+    rewrite_batch();
+    stream::finish(out);
 }
 
 int main_ids(int argc, char** argv) {
@@ -48,6 +80,9 @@ int main_ids(int argc, char** argv) {
     int64_t increment = 0;
     int64_t decrement = 0;
     std::string mapping_name;
+    std::string translation_name;
+    std::string alignments_name;
+    std::string alignments_out_name;
 
     int c;
     optind = 2; // force optind past command positional argument
@@ -60,12 +95,16 @@ int main_ids(int argc, char** argv) {
             {"join", no_argument, 0, 'j'},
             {"mapping", required_argument, 0, 'm'},
             {"sort", no_argument, 0, 's'},
+            {"translation", required_argument, 0, 'T'},
+            {"alignments", required_argument, 0, 'a'},
+            {"alignments-out", required_argument, 0, 'A'},
+            {"threads", required_argument, 0, 't'},
             {"help", no_argument, 0, 'h'},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hci:d:jm:s",
+        c = getopt_long (argc, argv, "hci:d:jm:sT:a:A:t:",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -98,6 +137,22 @@ int main_ids(int argc, char** argv) {
                 sort = true;
                 break;
 
+            case 'T':
+                translation_name = optarg;
+                break;
+
+            case 'a':
+                alignments_name = optarg;
+                break;
+
+            case 'A':
+                alignments_out_name = optarg;
+                break;
+
+            case 't':
+                omp_set_num_threads(parse<int>(optarg));
+                break;
+
             case 'h':
             case '?':
                 help_ids(argv);
@@ -109,19 +164,99 @@ int main_ids(int argc, char** argv) {
         }
     }
 
-    if (!join && mapping_name.empty()) {
+    if ((!translation_name.empty() || !alignments_name.empty()) && !sort) {
+        cerr << "error:[vg ids] a translation or alignments to renumber can only be used with --sort" << endl;
+        return 1;
+    }
+    if (alignments_name.empty() != alignments_out_name.empty()) {
+        cerr << "error:[vg ids] alignments to renumber need both --alignments and --alignments-out" << endl;
+        return 1;
+    }
+
+    if (sort && !join && mapping_name.empty()) {
+        // Work out the order on just the topology of the graph, and then
+        // renumber the graph a batch of chunks at a time, so we never need to
+        // hold the node sequences or paths of more than one batch of chunks.
+        // What we do hold for the whole graph is the TopologyGraph (a few
+        // words per node and edge), the working set of topological_order (a
+        // map entry for every node and a set entry for every edge it masks),
+        // and then the translation table (two IDs per node).
+        string graph_name = get_input_file_name(optind, argc, argv);
+
+        // We have to read the graph twice, so if it comes from something we
+        // can't read twice, like standard input or a pipe, we copy it to a
+        // temporary file first.
+        string buffer_name;
+        struct stat graph_stat;
+        if (graph_name == "-" || stat(graph_name.c_str(), &graph_stat) != 0 || !S_ISREG(graph_stat.st_mode)) {
+            buffer_name = temp_file::create("ids");
+            ofstream buffer(buffer_name, ios::binary);
+            get_input_file(graph_name, [&](istream& in) {
+                copy(istreambuf_iterator<char>(in), istreambuf_iterator<char>(), ostreambuf_iterator<char>(buffer));
+            });
+            buffer.close();
+            if (!buffer) {
+                cerr << "error:[vg ids] could not buffer " << graph_name << " in temporary file " << buffer_name << endl;
+                return 1;
+            }
+            graph_name = buffer_name;
+        }
+
+        TopologyGraph topology;
+        get_input_file(graph_name, [&](istream& in) {
+            topology = TopologyGraph(in);
+        });
+
+        NodeIdTranslation translation(topology, algorithms::topological_order(&topology), increment - decrement);
+        // We don't need the graph anymore.
+        topology = TopologyGraph();
+
+        if (!translation_name.empty()) {
+            ofstream translation_file(translation_name);
+            if (!translation_file) {
+                cerr << "error:[vg ids] could not open translation file " << translation_name << endl;
+                return 1;
+            }
+            translation.write_tsv(translation_file);
+        }
+
+        function<void(Graph&)> renumber_chunk = [&](Graph& chunk) {
+            translation.apply(chunk);
+        };
+        get_input_file(graph_name, [&](istream& in) {
+            rewrite_in_batches<Graph>(in, cout, 256, renumber_chunk);
+        });
+        if (!buffer_name.empty()) {
+            temp_file::remove(buffer_name);
+        }
+
+        if (!alignments_name.empty()) {
+            ofstream alignments_out(alignments_out_name);
+            if (!alignments_out) {
+                cerr << "error:[vg ids] could not open alignment output file " << alignments_out_name << endl;
+                return 1;
+            }
+            size_t unrenumbered = 0;
+            function<void(Alignment&)> renumber_alignment = [&](Alignment& aln) {
+                if (!translation.apply(aln)) {
+#pragma omp atomic
+                    unrenumbered++;
+                }
+            };
+            get_input_file(alignments_name, [&](istream& in) {
+                rewrite_in_batches<Alignment>(in, alignments_out, 10000, renumber_alignment);
+            });
+            if (unrenumbered) {
+                cerr << "warning:[vg ids] " << unrenumbered << " alignments visit nodes not in the graph and were not renumbered" << endl;
+            }
+        }
+    } else if (!join && mapping_name.empty()) {
         VG* graph;
         get_input_file(optind, argc, argv, [&](istream& in) {
             graph = new VG(in);
         });
 
-        if (sort) {
-            // Set up the nodes so we go through them in topological order
-            algorithms::sort(graph);
-        }
-
-        if (compact || sort) {
-            // Compact only, or compact to re-assign IDs after sort
+        if (compact) {
             graph->compact_ids();
         }
 
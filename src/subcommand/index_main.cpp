@@ -1002,7 +1002,7 @@ int main_index(int argc, char** argv) {
         }
 
         if (store_node_alignments && file_names.size() > 0) {
-            index.open_for_bulk_load(rocksdb_name);
+            index.open_for_ingest(rocksdb_name);
             int64_t aln_idx = 0;
             function<void(Alignment&)> lambda = [&index,&aln_idx](Alignment& aln) {
                 index.cross_alignment(aln_idx++, aln);
@@ -1017,7 +1017,7 @@ int main_index(int argc, char** argv) {
         }
 
         if (store_alignments && file_names.size() > 0) {
-            index.open_for_bulk_load(rocksdb_name);
+            index.open_for_ingest(rocksdb_name);
             function<void(Alignment&)> lambda = [&index](Alignment& aln) {
                 index.put_alignment(aln);
             };
@@ -1043,7 +1043,7 @@ int main_index(int argc, char** argv) {
         }
 
         if (store_mappings && file_names.size() > 0) {
-            index.open_for_bulk_load(rocksdb_name);
+            index.open_for_ingest(rocksdb_name);
             function<void(Alignment&)> lambda = [&index](Alignment& aln) {
                 const Path& path = aln.path();
                 for (int i = 0; i < path.mapping_size(); ++i) {
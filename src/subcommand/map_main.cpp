@@ -4,6 +4,8 @@
 #include "../mapper.hpp"
 #include "../surjector.hpp"
 #include "../stream.hpp"
+#include "../json_writer.hpp"
+#include "../stage_stats.hpp"
 
 #include <unistd.h>
 #include <getopt.h>
@@ -84,7 +86,9 @@ void help_map(char** argv) {
          << "    -K, --keep-secondary          produce alignments for secondary input alignments in addition to primary ones" << endl
          << "    -M, --max-multimaps INT       produce up to INT alignments for each read [1]" << endl
          << "    -Q, --mq-max INT              cap the mapping quality at INT [60]" << endl
-         << "    -D, --debug                   print debugging information about alignment to stderr" << endl;
+         << "    -D, --debug                   print debugging information about alignment to stderr" << endl
+         << "    --stage-stats FILE            write call counts, latencies, and allocations for each mapping stage to FILE" << endl
+         << "                                  (as JSON if FILE ends in .json; needs vg built with STAGE_STATS=1)" << endl;
 
 }
 
@@ -97,6 +101,8 @@ int main_map(int argc, char** argv) {
 
     #define OPT_SCORE_MATRIX 1000
     #define OPT_RECOMBINATION_PENALTY 1001
+    #define OPT_STAGE_STATS 1002
+    string stage_stats_name;
     string matrix_file_name;
     string seq;
     string qual;
@@ -229,6 +235,7 @@ int main_map(int argc, char** argv) {
                 {"full-l-bonus", required_argument, 0, 'L'},
                 {"hap-exp", required_argument, 0, 'a'},
                 {"recombination-penalty", required_argument, 0, OPT_RECOMBINATION_PENALTY},
+                {"stage-stats", required_argument, 0, OPT_STAGE_STATS},
                 {"acyclic-graph", no_argument, 0, 'm'},
                 {"mem-chance", required_argument, 0, 'e'},
                 {"drop-chain", required_argument, 0, 'C'},
@@ -321,6 +328,10 @@ int main_map(int argc, char** argv) {
         case OPT_RECOMBINATION_PENALTY:
             recombination_penalty = parse<double>(optarg);
             break;
+            
+        case OPT_STAGE_STATS:
+            stage_stats_name = optarg;
+            break;
         
         case 'm':
             acyclic_graph = true;
@@ -672,6 +683,14 @@ int main_map(int argc, char** argv) {
           exit(1);
       }
     }
+    
+    if (!stage_stats_name.empty()) {
+        if (!StageStats::available()) {
+            cerr << "error:[vg map] --stage-stats requires vg to be built with STAGE_STATS=1" << endl;
+            exit(1);
+        }
+        StageStats::enable();
+    }
 
     thread_count = get_thread_count();
 
@@ -879,11 +898,18 @@ int main_map(int argc, char** argv) {
         }
     };
 
-    auto write_json = [](const vector<Alignment>& alns) {
-        for(auto& alignment : alns) {
-            string json = pb2json(alignment);
-            cout << json << "\n";
+    auto write_json = [](const vector<Alignment>& alns1, const vector<Alignment>& alns2) {
+        // Each thread renders into its own reused buffer, outside the output lock
+        thread_local ProtoJSONWriter writer;
+        writer.clear();
+        for (auto alns : {&alns1, &alns2}) {
+            for(auto& alignment : *alns) {
+                writer.write(alignment);
+                writer.newline();
+            }
         }
+#pragma omp critical (cout)
+        cout << writer.str();
     };
 
     auto write_refpos = [](const vector<Alignment>& alns) {
@@ -910,13 +936,10 @@ int main_map(int argc, char** argv) {
                               &refpos_table,
                               &write_json,
                               &write_refpos](const vector<Alignment>& alns1, const vector<Alignment>& alns2) {
+        VG_TIME_STAGE(STAGE_OUTPUT);
         if (output_json) {
             // If we want to convert to JSON, convert them all to JSON and dump them to cout.
-#pragma omp critical (cout)
-            {
-                write_json(alns1);
-                write_json(alns2);
-            }
+            write_json(alns1, alns2);
         } else if (refpos_table) {
             // keep multi alignments ordered appropriately
 #pragma omp critical (cout)
@@ -1406,6 +1429,10 @@ int main_map(int argc, char** argv) {
         cout.flush();
     }
     
+    if (!stage_stats_name.empty()) {
+        StageStats::write_report(stage_stats_name);
+    }
+    
     if (haplo_score_provider) {
         delete haplo_score_provider;
         haplo_score_provider = nullptr;
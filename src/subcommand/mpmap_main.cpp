@@ -9,6 +9,7 @@
 #include "subcommand.hpp"
 
 #include "../multipath_mapper.hpp"
+#include "../stage_stats.hpp"
 #include "../path.hpp"
 
 //#define record_read_run_times
@@ -58,6 +59,8 @@ void help_mpmap(char** argv) {
     << "  -I, --frag-mean               mean for fixed fragment length distribution" << endl
     << "  -D, --frag-stddev             standard deviation for fixed fragment length distribution" << endl
     << "  -B, --no-calibrate            do not auto-calibrate mismapping dectection" << endl
+    << "  --calibration FILE            load startup calibration from a profile written by --write-calibration" << endl
+    << "  --write-calibration FILE      write the startup calibration (loaded or computed) to a profile (reads are optional with this option)" << endl
     << "  -P, --max-p-val FLOAT         background model p value must be less than this to avoid mismapping detection [0.00001]" << endl
     << "  -v, --mq-method OPT           mapping quality method: 0 - none, 1 - fast approximation, 2 - adaptive, 3 - exact [2]" << endl
     << "  -Q, --mq-max INT              cap mapping quality estimates at this much [60]" << endl
@@ -86,7 +89,9 @@ void help_mpmap(char** argv) {
     << "  -m, --remove-bonuses          remove full length alignment bonuses in reported scores" << endl
     << "computational parameters:" << endl
     << "  -t, --threads INT             number of compute threads to use" << endl
-    << "  -Z, --buffer-size INT         buffer this many alignments together (per compute thread) before outputting to stdout [100]" << endl;
+    << "  -Z, --buffer-size INT         buffer this many alignments together (per compute thread) before outputting to stdout [100]" << endl
+    << "  --stage-stats FILE            write call counts, latencies, and allocations for each mapping stage to FILE" << endl
+    << "                                (as JSON if FILE ends in .json; needs vg built with STAGE_STATS=1)" << endl;
     
 }
 
@@ -101,6 +106,10 @@ int main_mpmap(int argc, char** argv) {
     #define OPT_SCORE_MATRIX 1000
     #define OPT_RECOMBINATION_PENALTY 1001
     #define OPT_ALWAYS_CHECK_POPULATION 1002
+    #define OPT_CALIBRATION 1003
+    #define OPT_WRITE_CALIBRATION 1004
+    #define OPT_STAGE_STATS 1005
+    string stage_stats_name;
     string matrix_file_name;
     string xg_name;
     string gcsa_name;
@@ -111,6 +120,8 @@ int main_mpmap(int argc, char** argv) {
     string fastq_name_1;
     string fastq_name_2;
     string gam_file_name;
+    string calibration_in_name;
+    string calibration_out_name;
     int match_score = default_match;
     int mismatch_score = default_mismatch;
     int gap_open_score = default_gap_open;
@@ -210,6 +221,9 @@ int main_mpmap(int argc, char** argv) {
             {"frag-mean", required_argument, 0, 'I'},
             {"frag-stddev", required_argument, 0, 'D'},
             {"no-calibrate", no_argument, 0, 'B'},
+            {"calibration", required_argument, 0, OPT_CALIBRATION},
+            {"write-calibration", required_argument, 0, OPT_WRITE_CALIBRATION},
+            {"stage-stats", required_argument, 0, OPT_STAGE_STATS},
             {"max-p-val", required_argument, 0, 'P'},
             {"mq-method", required_argument, 0, 'v'},
             {"mq-max", required_argument, 0, 'Q'},
@@ -374,6 +388,26 @@ int main_mpmap(int argc, char** argv) {
                 auto_calibrate_mismapping_detection = false;
                 break;
                 
+            case OPT_CALIBRATION:
+                calibration_in_name = optarg;
+                if (calibration_in_name.empty()) {
+                    cerr << "error:[vg mpmap] Must provide calibration profile with --calibration." << endl;
+                    exit(1);
+                }
+                break;
+                
+            case OPT_WRITE_CALIBRATION:
+                calibration_out_name = optarg;
+                if (calibration_out_name.empty()) {
+                    cerr << "error:[vg mpmap] Must provide calibration profile with --write-calibration." << endl;
+                    exit(1);
+                }
+                break;
+                
+            case OPT_STAGE_STATS:
+                stage_stats_name = optarg;
+                break;
+                
             case 'P':
                 max_mapping_p_value = parse<double>(optarg);
                 break;
@@ -559,7 +593,7 @@ int main_mpmap(int argc, char** argv) {
         exit(1);
     }
     
-    if (fastq_name_1.empty() && gam_file_name.empty()) {
+    if (fastq_name_1.empty() && gam_file_name.empty() && calibration_out_name.empty()) {
         cerr << "error:[vg mpmap] Must designate reads to map from either FASTQ (-f) or GAM (-G) file." << endl;
         exit(1);
     }
@@ -803,6 +837,14 @@ int main_mpmap(int argc, char** argv) {
           exit(1);
       }
     }
+    
+    if (!stage_stats_name.empty()) {
+        if (!StageStats::available()) {
+            cerr << "error:[vg mpmap] --stage-stats requires vg to be built with STAGE_STATS=1" << endl;
+            exit(1);
+        }
+        StageStats::enable();
+    }
 
     // Configure GCSA2 verbosity so it doesn't spit out loads of extra info
     gcsa::Verbosity::set(gcsa::Verbosity::SILENT);
@@ -864,7 +906,6 @@ int main_mpmap(int argc, char** argv) {
     multipath_mapper.adjust_alignments_for_base_quality = qual_adjusted;
     multipath_mapper.strip_bonuses = strip_full_length_bonus;
     multipath_mapper.band_padding_multiplier = band_padding_multiplier;
-    multipath_mapper.init_band_padding_memo();
     
     // set mem finding parameters
     multipath_mapper.hit_max = hit_max;
@@ -882,12 +923,7 @@ int main_mpmap(int argc, char** argv) {
     multipath_mapper.precollapse_order_length_hits = precollapse_order_length_hits;
     multipath_mapper.max_sub_mem_recursion_depth = max_sub_mem_recursion_depth;
     multipath_mapper.max_mapping_p_value = max_mapping_p_value;
-    if (min_clustering_mem_length) {
-        multipath_mapper.min_clustering_mem_length = min_clustering_mem_length;
-    }
-    else {
-        multipath_mapper.set_automatic_min_clustering_length();
-    }
+    multipath_mapper.min_clustering_mem_length = min_clustering_mem_length;
     
     // set mapping quality parameters
     multipath_mapper.mapping_quality_method = mapq_method;
@@ -923,9 +959,55 @@ int main_mpmap(int argc, char** argv) {
     multipath_mapper.simplify_topologies = simplify_topologies;
     multipath_mapper.max_suboptimal_path_score_ratio = suboptimal_path_exponent;
     
-    // if directed to, auto calibrate the mismapping detection to the graph
-    if (auto_calibrate_mismapping_detection) {
-        multipath_mapper.calibrate_mismapping_detection(num_calibration_simulations, calibration_read_length);
+    // identify the indexes and parameters that the startup calibration depends on (must come before any
+    // automatic parameter settings)
+    size_t calibration_checksum = multipath_mapper.calibration_checksum(auto_calibrate_mismapping_detection,
+                                                                        num_calibration_simulations,
+                                                                        calibration_read_length);
+    
+    bool loaded_calibration = false;
+    if (!calibration_in_name.empty()) {
+        ifstream calibration_stream(calibration_in_name);
+        if (!calibration_stream) {
+            cerr << "error:[vg mpmap] Cannot open calibration profile " << calibration_in_name << endl;
+            exit(1);
+        }
+        loaded_calibration = multipath_mapper.load_calibration(calibration_stream, calibration_checksum);
+        if (!loaded_calibration) {
+            cerr << "warning:[vg mpmap] Calibration profile " << calibration_in_name << " does not match these indexes and parameters, recalibrating." << endl;
+        }
+    }
+    
+    if (!loaded_calibration) {
+        multipath_mapper.init_band_padding_memo();
+        
+        if (!min_clustering_mem_length) {
+            multipath_mapper.set_automatic_min_clustering_length();
+        }
+        
+        // if directed to, auto calibrate the mismapping detection to the graph
+        if (auto_calibrate_mismapping_detection) {
+            multipath_mapper.calibrate_mismapping_detection(num_calibration_simulations, calibration_read_length);
+        }
+    }
+    
+    if (!calibration_out_name.empty()) {
+        if (!std::isnan(frag_length_mean) && !std::isnan(frag_length_stddev)) {
+            // include the fixed fragment length distribution in the profile
+            multipath_mapper.force_fragment_length_distr(frag_length_mean, frag_length_stddev);
+        }
+        
+        ofstream calibration_stream(calibration_out_name);
+        if (!calibration_stream) {
+            cerr << "error:[vg mpmap] Cannot open calibration profile " << calibration_out_name << " for writing" << endl;
+            exit(1);
+        }
+        multipath_mapper.save_calibration(calibration_stream, calibration_checksum);
+        
+        if (fastq_name_1.empty() && gam_file_name.empty()) {
+            // we were only asked to calibrate
+            return 0;
+        }
     }
     
     // set computational paramters
@@ -943,6 +1025,9 @@ int main_mpmap(int argc, char** argv) {
             // Force a fragment length distribution
             multipath_mapper.force_fragment_length_distr(frag_length_mean, frag_length_stddev);
         }
+        else if (multipath_mapper.has_fixed_fragment_length_distr()) {
+            // we loaded a fixed fragment length distribution from the calibration profile
+        }
         else {
             // choose the sample size and tail-fraction for estimating the fragment length distribution
             multipath_mapper.set_fragment_length_distr_params(frag_length_sample_size, frag_length_sample_size,
@@ -966,6 +1051,7 @@ int main_mpmap(int argc, char** argv) {
     
     // write unpaired multipath alignments to stdout buffer
     auto output_multipath_alignments = [&](vector<MultipathAlignment>& mp_alns) {
+        VG_TIME_STAGE(STAGE_OUTPUT);
         auto& output_buf = multipath_output_buffer[omp_get_thread_num()];
         
         // move all the alignments over to the output buffer
@@ -986,6 +1072,7 @@ int main_mpmap(int argc, char** argv) {
     
     // convert to unpaired single path alignments and write stdout buffer
     auto output_single_path_alignments = [&](vector<MultipathAlignment>& mp_alns) {
+        VG_TIME_STAGE(STAGE_OUTPUT);
         auto& output_buf = single_path_output_buffer[omp_get_thread_num()];
         // add optimal alignments to the output buffer
         for (MultipathAlignment& mp_aln : mp_alns) {
@@ -1020,6 +1107,7 @@ int main_mpmap(int argc, char** argv) {
     
     // write paired multipath alignments to stdout buffer
     auto output_multipath_paired_alignments = [&](vector<pair<MultipathAlignment, MultipathAlignment>>& mp_aln_pairs) {
+        VG_TIME_STAGE(STAGE_OUTPUT);
         auto& output_buf = multipath_output_buffer[omp_get_thread_num()];
         
         // move all the alignments over to the output buffer
@@ -1059,6 +1147,7 @@ int main_mpmap(int argc, char** argv) {
     
     // convert to paired single path alignments and write stdout buffer
     auto output_single_path_paired_alignments = [&](vector<pair<MultipathAlignment, MultipathAlignment>>& mp_aln_pairs) {
+        VG_TIME_STAGE(STAGE_OUTPUT);
         auto& output_buf = single_path_output_buffer[omp_get_thread_num()];
         
         // add optimal alignments to the output buffer
@@ -1298,6 +1387,10 @@ int main_mpmap(int argc, char** argv) {
     read_time_file.close();
 #endif
     
+    if (!stage_stats_name.empty()) {
+        StageStats::write_report(stage_stats_name);
+    }
+    
     //cerr << "MEM length filtering efficiency: " << ((double) OrientedDistanceClusterer::MEM_FILTER_COUNTER) / OrientedDistanceClusterer::MEM_TOTAL << " (" << OrientedDistanceClusterer::MEM_FILTER_COUNTER << "/" << OrientedDistanceClusterer::MEM_TOTAL << ")" << endl;
     //cerr << "MEM cluster filtering efficiency: " << ((double) OrientedDistanceClusterer::PRUNE_COUNTER) / OrientedDistanceClusterer::CLUSTER_TOTAL << " (" << OrientedDistanceClusterer::PRUNE_COUNTER << "/" << OrientedDistanceClusterer::CLUSTER_TOTAL << ")" << endl;
     //cerr << "subgraph filtering efficiency: " << ((double) MultipathMapper::PRUNE_COUNTER) / MultipathMapper::SUBGRAPH_TOTAL << " (" << MultipathMapper::PRUNE_COUNTER << "/" << MultipathMapper::SUBGRAPH_TOTAL << ")" << endl;
@@ -5,6 +5,7 @@
 #include "../stream.hpp"
 #include "../kmer.hpp"
 #include "../build_index.hpp"
+#include "../translator.hpp"
 #include "../algorithms/topological_sort.hpp"
 
 #include <unistd.h>
@@ -13,6 +14,138 @@
 using namespace vg;
 using namespace vg::subcommand;
 
+/**
+ * Follows the nodes of the graph that the GCSA index was built from as later
+ * edits divide them, so that hits in the index can be moved into the current
+ * graph without rebuilding the index. Sequence added since the index was built
+ * is on novel nodes, which get their own smaller index to seed from until the
+ * main index is rebuilt.
+ */
+class GCSAOverlay {
+public:
+    /// Start over from a graph that has just been indexed
+    void reset(VG& graph) {
+        indexed_node_length.clear();
+        pieces.clear();
+        origin.clear();
+        novel_nodes.clear();
+        indexed_length = 0;
+        novel_length = 0;
+        graph.for_each_node([&](Node* node) {
+            indexed_node_length[node->id()] = node->sequence().size();
+            indexed_length += node->sequence().size();
+        });
+    }
+    
+    /// Account for an edit of the graph, given the Translations it returned
+    void apply(const vector<Translation>& translations) {
+        // collect the pieces each divided node was cut into
+        unordered_map<id_t, vector<pair<size_t, id_t>>> divided;
+        for (auto& translation : translations) {
+            if (!is_match(translation)) {
+                continue;
+            }
+            const Position& from = translation.from().mapping(0).position();
+            divided[from.node_id()].emplace_back(from.offset(), translation.to().mapping(0).position().node_id());
+        }
+        
+        unordered_set<id_t> touched;
+        for (auto& division : divided) {
+            id_t prev_id = division.first;
+            auto& new_pieces = division.second;
+            if (new_pieces.size() == 1 && new_pieces.front().second == prev_id) {
+                // unchanged
+                continue;
+            }
+            
+            // find where the divided node lies in an indexed node, if it does
+            id_t indexed_id;
+            size_t indexed_offset;
+            auto found = origin.find(prev_id);
+            if (found != origin.end()) {
+                tie(indexed_id, indexed_offset) = found->second;
+            } else if (indexed_node_length.count(prev_id) && !pieces.count(prev_id)) {
+                indexed_id = prev_id;
+                indexed_offset = 0;
+            } else {
+                // it's novel since the index was built
+                continue;
+            }
+            
+            // replace its piece with the new ones
+            auto& indexed_pieces = pieces[indexed_id];
+            if (indexed_pieces.empty()) {
+                indexed_pieces.emplace_back(0, indexed_id);
+            }
+            indexed_pieces.erase(remove(indexed_pieces.begin(), indexed_pieces.end(), make_pair(indexed_offset, prev_id)),
+                                 indexed_pieces.end());
+            for (auto& piece : new_pieces) {
+                indexed_pieces.emplace_back(indexed_offset + piece.first, piece.second);
+                origin[piece.second] = make_pair(indexed_id, indexed_offset + piece.first);
+            }
+            touched.insert(indexed_id);
+        }
+        
+        for (id_t indexed_id : touched) {
+            sort(pieces[indexed_id].begin(), pieces[indexed_id].end());
+        }
+    }
+    
+    /// Find the nodes of the current graph that the GCSA index doesn't cover
+    void find_novel(VG& graph) {
+        novel_nodes.clear();
+        novel_length = 0;
+        graph.for_each_node([&](Node* node) {
+            if (!is_indexed(node->id())) {
+                novel_nodes.push_back(node->id());
+                novel_length += node->sequence().size();
+            }
+        });
+    }
+    
+    /// Is the node with this ID in the current graph covered by the GCSA index?
+    bool is_indexed(id_t node_id) const {
+        return origin.count(node_id) || (indexed_node_length.count(node_id) && !pieces.count(node_id));
+    }
+    
+    /// Move a GCSA hit from the indexed graph into the current graph
+    gcsa::node_type translate(gcsa::node_type hit) const {
+        auto found = pieces.find(gcsa::Node::id(hit));
+        if (found == pieces.end()) {
+            // the node hasn't been divided
+            return hit;
+        }
+        auto& node_pieces = found->second;
+        size_t length = indexed_node_length.at(found->first);
+        bool is_rev = gcsa::Node::rc(hit);
+        // work in forward strand coordinates on the indexed node
+        size_t offset = is_rev ? length - 1 - gcsa::Node::offset(hit) : gcsa::Node::offset(hit);
+        auto piece = upper_bound(node_pieces.begin(), node_pieces.end(), make_pair(offset, numeric_limits<id_t>::max()));
+        size_t piece_end = (piece == node_pieces.end()) ? length : piece->first;
+        --piece;
+        size_t piece_offset = offset - piece->first;
+        if (is_rev) {
+            piece_offset = piece_end - piece->first - 1 - piece_offset;
+        }
+        return gcsa::Node::encode(piece->second, piece_offset, is_rev);
+    }
+    
+    /// Length of the graph when it was indexed
+    size_t indexed_length = 0;
+    /// The nodes added since then, as of the last find_novel
+    vector<id_t> novel_nodes;
+    /// Their total length
+    size_t novel_length = 0;
+    
+private:
+    /// Lengths of the indexed nodes
+    unordered_map<id_t, size_t> indexed_node_length;
+    /// For each divided indexed node, the offset and current ID of each of its pieces
+    unordered_map<id_t, vector<pair<size_t, id_t>>> pieces;
+    /// For each current node that is a piece of a divided indexed node, which node and where in it
+    unordered_map<id_t, pair<id_t, size_t>> origin;
+};
+
 
 void help_msga(char** argv) {
     cerr << "usage: " << argv[0] << " msga [options] >graph.vg" << endl
@@ -62,6 +195,10 @@ void help_msga(char** argv) {
          << "    -Q, --idx-prune-subs N  prune subgraphs shorter than this length from input graph to GCSA (default: off)" << endl
          << "    -m, --node-max N        chop nodes to be shorter than this length (default: 2* --idx-kmer-size)" << endl
          << "    -X, --idx-doublings N   use this many doublings when building the GCSA indexes [2]" << endl
+         << "    --incremental FLOAT     only rebuild the GCSA index once the sequence added since it was built exceeds" << endl
+         << "                            FLOAT times the indexed length; in between, rebuild the xg index and a small" << endl
+         << "                            GCSA index of just the added sequence" << endl
+         << "                            (ignored with -N) [always rebuild]" << endl
          << "graph normalization:" << endl
          << "    -N, --normalize         normalize the graph after assembly" << endl
          << "    -Z, --circularize       the input sequences are from circular genomes, circularize them after inclusion" << endl
@@ -136,6 +273,7 @@ int main_msga(int argc, char** argv) {
     int max_sub_mem_recursion_depth = 2;
     bool xdrop_alignment = false;
     uint32_t max_gap_length = 40;
+    double incremental_threshold = 0;
 
     int c;
     optind = 2; // force optind past command positional argument
@@ -187,6 +325,7 @@ int main_msga(int argc, char** argv) {
                 {"no-patch-aln", no_argument, 0, '8'},
                 {"max-gap-length", required_argument, 0, 1},
                 {"xdrop-alignment", no_argument, 0, 2},
+                {"incremental", required_argument, 0, 3},
                 {0, 0, 0, 0}
             };
 
@@ -373,6 +512,10 @@ int main_msga(int argc, char** argv) {
             xdrop_alignment = true;
             break;
 
+        case 3:
+            incremental_threshold = parse<double>(optarg);
+            break;
+
         case 'h':
         case '?':
             help_msga(argv);
@@ -515,23 +658,45 @@ int main_msga(int argc, char** argv) {
     gcsa::GCSA* gcsaidx = nullptr;
     gcsa::LCPArray* lcpidx = nullptr;
     xg::XG* xgidx = nullptr;
+    GCSAOverlay overlay;
+    // seeds the novel nodes of the overlay
+    BaseMapper* overlay_mapper = nullptr;
+    gcsa::GCSA* overlay_gcsaidx = nullptr;
+    gcsa::LCPArray* overlay_lcpidx = nullptr;
     size_t iter = 0;
     
     // Configure GCSA temp directory to the system temp directory
     gcsa::TempFile::setDirectory(temp_file::get_dir());
 
+    auto clear_overlay_index = [&]() {
+        delete overlay_mapper;
+        delete overlay_gcsaidx;
+        delete overlay_lcpidx;
+        overlay_mapper = nullptr;
+        overlay_gcsaidx = nullptr;
+        overlay_lcpidx = nullptr;
+    };
+
     auto rebuild = [&](VG* graph) {
+        clear_overlay_index();
         if (mapper) delete mapper;
         if (xgidx) delete xgidx;
         if (gcsaidx) delete gcsaidx;
         if (lcpidx) delete lcpidx;
     
         //stringstream s; s << iter++ << ".vg";
+        if (incremental_threshold > 0) {
+            // later dicing must only touch novel nodes, which the overlay doesn't need to follow
+            graph->dice_nodes(node_max);
+        }
         algorithms::sort(graph);
         graph->sync_paths();
         graph->graph.clear_path();
         graph->paths.to_graph(graph->graph);
         graph->rebuild_indexes();
+        if (incremental_threshold > 0) {
+            overlay.reset(*graph);
+        }
 
         if (debug) cerr << "building xg index" << endl;
         xgidx = new xg::XG(graph->graph);
@@ -613,8 +778,64 @@ int main_msga(int argc, char** argv) {
             mapper->set_alignment_threads(alignment_threads);
             mapper->show_progress = show_align_progress;
             mapper->patch_alignments = patch_alignments;
+            if (incremental_threshold > 0) {
+                mapper->translate_gcsa_hit = [&overlay](gcsa::node_type hit) {
+                    return overlay.translate(hit);
+                };
+            }
         }
     };
+    
+    // rebuild the xg index and a small GCSA index of the novel nodes, leaving the rest
+    // of the graph to the overlay of the main GCSA index
+    auto rebuild_xg = [&](VG* graph) {
+        algorithms::sort(graph);
+        graph->sync_paths();
+        graph->graph.clear_path();
+        graph->paths.to_graph(graph->graph);
+        graph->rebuild_indexes();
+        
+        if (debug) cerr << "building xg index, reusing GCSA2 index with "
+                        << overlay.novel_length << "bp added since it was built" << endl;
+        delete xgidx;
+        xgidx = new xg::XG(graph->graph);
+        mapper->set_xg(xgidx);
+        
+        clear_overlay_index();
+        mapper->overlay_mapper = nullptr;
+        if (overlay.novel_nodes.empty()) {
+            return;
+        }
+        
+        // take the novel nodes, and enough of their context to index the kmers that
+        // run from them into the rest of the graph
+        VG novel_graph;
+        for (id_t node_id : overlay.novel_nodes) {
+            novel_graph.add_node(*graph->get_node(node_id));
+        }
+        for (id_t node_id : overlay.novel_nodes) {
+            for (Edge* edge : graph->edges_of(graph->get_node(node_id))) {
+                if (novel_graph.has_node(edge->from()) && novel_graph.has_node(edge->to())) {
+                    novel_graph.add_edge(*edge);
+                }
+            }
+        }
+        graph->expand_context_by_length(novel_graph, idx_kmer_size, false);
+        if (edge_max) {
+            novel_graph.prune_complex_with_head_tail(idx_kmer_size, edge_max);
+            if (subgraph_prune) novel_graph.prune_short_subgraphs(subgraph_prune);
+        }
+        
+        if (debug) cerr << "building GCSA2 index of " << novel_graph.length() << "bp around the novel nodes" << endl;
+        build_gcsa_lcp(novel_graph, overlay_gcsaidx, overlay_lcpidx, idx_kmer_size, doubling_steps);
+        overlay_mapper = new BaseMapper(xgidx, overlay_gcsaidx, overlay_lcpidx);
+        overlay_mapper->hit_max = mapper->hit_max;
+        overlay_mapper->min_mem_length = mapper->min_mem_length;
+        overlay_mapper->mem_reseed_length = mapper->mem_reseed_length;
+        overlay_mapper->fast_reseed = mapper->fast_reseed;
+        overlay_mapper->max_sub_mem_recursion_depth = mapper->max_sub_mem_recursion_depth;
+        mapper->overlay_mapper = overlay_mapper;
+    };
 
     // set up the graph for mapping
     rebuild(graph);
@@ -685,7 +906,12 @@ int main_msga(int argc, char** argv) {
             if (debug) cerr << name << ": editing graph" << endl;
             //graph->serialize_to_file(name + "-pre-edit.vg");
             // Modify graph and embed paths
-            graph->edit(paths, true);
+            vector<Translation> translations = graph->edit(paths, true);
+            // normalization merges nodes, which the overlay can't follow
+            bool use_overlay = incremental_threshold > 0 && !normalize;
+            if (use_overlay) {
+                overlay.apply(translations);
+            }
             //if (!graph->is_valid()) cerr << "invalid after edit" << endl;
             //graph->serialize_to_file(name + "-immed-post-edit.vg");
             if (normalize) graph->normalize(10, debug);
@@ -695,7 +921,15 @@ int main_msga(int argc, char** argv) {
             if (debug) cerr << name << ": sorting and compacting ids" << endl;
             algorithms::sort(graph);
             //if (!graph->is_valid()) cerr << "invalid after sort" << endl;
-            graph->compact_ids(); // xg can't work unless IDs are compacted.
+            if (use_overlay) {
+                // can we keep using the GCSA index?
+                overlay.find_novel(*graph);
+                use_overlay = overlay.novel_length <= incremental_threshold * overlay.indexed_length;
+            }
+            if (!use_overlay) {
+                // compacting would renumber the nodes the overlay is following
+                graph->compact_ids(); // xg can't work unless IDs are compacted.
+            }
             //if (!graph->is_valid()) cerr << "invalid after compact" << endl;
             if (circularize) {
                 if (debug) cerr << name << ": circularizing" << endl;
@@ -712,7 +946,11 @@ int main_msga(int argc, char** argv) {
             graph->graph.clear_path();
             graph->paths.to_graph(graph->graph);
             // and rebuild the indexes
-            rebuild(graph);
+            if (use_overlay) {
+                rebuild_xg(graph);
+            } else {
+                rebuild(graph);
+            }
             //graph->serialize_to_file(convert(i) + "-" + name + "-post.vg");
 
             // verfy validity of path
@@ -763,6 +1001,11 @@ int main_msga(int argc, char** argv) {
     //          }
     //      };
 
+    if (incremental_threshold > 0 && !normalize) {
+        // the last sequences may have been added without compacting the IDs
+        graph->compact_ids();
+    }
+
     if (normalize) {
         if (debug) cerr << "normalizing graph" << endl;
         graph->remove_non_path();
@@ -4,6 +4,9 @@
 #include <unistd.h>
 #include <getopt.h>
 
+#include <algorithm>
+#include <memory>
+#include <random>
 #include <string>
 #include <sstream>
 
@@ -12,8 +15,7 @@
 #include "../alignment.hpp"
 #include "../vg.hpp"
 #include "../stream.hpp"
-
-#include <vowpalwabbit/vw.h>
+#include "../recalibration.hpp"
 
 using namespace std;
 using namespace vg;
@@ -26,47 +28,13 @@ void help_recalibrate(char** argv) {
          << "options:" << endl
          << "    -T, --train              read the input GAM file, and use the mapped_correctly flags from vg gamcompare to train a model" << endl
          << "    -m, --model FILE         load/save the model to/from the given file" << endl
+         << "    -s, --sample FLOAT       train on only this fraction of the alignments, chosen at random [1.0]" << endl
+         << "    -b, --shuffle-buffer N   train on alignments in random order within a window of N alignments [0]" << endl
+         << "    -r, --seed N             seed for sampling and shuffling [0]" << endl
+         << "    -c, --batch-size N       process alignments in batches of N [10000]" << endl
          << "    -t, --threads N          number of threads to use" << endl;
 }
 
-/// Turn an Alignment into a Vowpal Wabbit format example line.
-/// If train is true, give it a label so that VW will train on it.
-/// If train is false, do not label the data.
-string alignment_to_example_string(const Alignment& aln, bool train) {
-    // We will dump it to a string stream
-    stringstream s;
-    
-    if (train) {
-        // First is the class; 1 for correct or -1 for wrong
-        s << (aln.correctly_mapped() ? "1 " : "-1 ");
-    }
-    
-    // Drop all the features into the mepty-string namespace
-    s << "| ";
-    
-    // Original MAPQ is a feature
-    s << "origMapq:" << to_string(aln.mapping_quality()) << " ";
-    
-    // As is score
-    s << "score:" << to_string(aln.score()) << " ";
-    
-    // And the top secondary alignment score
-    double secondary_score = 0;
-    if (aln.secondary_score_size() > 0) {
-        secondary_score = aln.secondary_score(0);
-    }
-    s << "secondaryScore:" << to_string(secondary_score) << " ";
-    
-    // Count the secondary alignments
-    s << "secondaryCount:" << aln.secondary_score_size() << " ";
-    
-    // Also do the identity
-    s << "identity:" << aln.identity() << " ";
-    
-    // TODO: more features
-    return s.str();
-}
-
 int main_recalibrate(int argc, char** argv) {
 
     if (argc == 2) {
@@ -77,6 +45,10 @@ int main_recalibrate(int argc, char** argv) {
     int threads = 1;
     bool train = false;
     string model_filename;
+    double sample_fraction = 1.0;
+    size_t shuffle_buffer_size = 0;
+    int seed = 0;
+    size_t batch_size = 10000;
 
     int c;
     optind = 2;
@@ -86,12 +58,16 @@ int main_recalibrate(int argc, char** argv) {
             {"help", no_argument, 0, 'h'},
             {"train", no_argument, 0, 'T'},
             {"model", required_argument, 0, 'm'},
+            {"sample", required_argument, 0, 's'},
+            {"shuffle-buffer", required_argument, 0, 'b'},
+            {"seed", required_argument, 0, 'r'},
+            {"batch-size", required_argument, 0, 'c'},
             {"threads", required_argument, 0, 't'},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hTm:t:",
+        c = getopt_long (argc, argv, "hTm:s:b:r:c:t:",
                          long_options, &option_index);
 
         // Detect the end of the options.
@@ -107,6 +83,22 @@ int main_recalibrate(int argc, char** argv) {
         case 'm':
             model_filename = optarg;
             break;
+            
+        case 's':
+            sample_fraction = parse<double>(optarg);
+            break;
+            
+        case 'b':
+            shuffle_buffer_size = parse<size_t>(optarg);
+            break;
+            
+        case 'r':
+            seed = parse<int>(optarg);
+            break;
+            
+        case 'c':
+            batch_size = parse<size_t>(optarg);
+            break;
 
         case 't':
             threads = parse<int>(optarg);
@@ -123,6 +115,19 @@ int main_recalibrate(int argc, char** argv) {
             abort ();
         }
     }
+    
+    if (sample_fraction <= 0.0 || sample_fraction > 1.0) {
+        cerr << "error:[vg recalibrate] Sample fraction must be in (0, 1]" << endl;
+        exit(1);
+    }
+    if (batch_size == 0) {
+        cerr << "error:[vg recalibrate] Batch size must be positive" << endl;
+        exit(1);
+    }
+    if (!train && (sample_fraction != 1.0 || shuffle_buffer_size != 0)) {
+        cerr << "error:[vg recalibrate] Sampling and shuffling only apply when training" << endl;
+        exit(1);
+    }
 
     get_input_file(optind, argc, argv, [&](istream& gam_stream) {
         // With the GAM input
@@ -159,30 +164,69 @@ int main_recalibrate(int argc, char** argv) {
             // TODO: what do any of the other parameters do?
             // TODO: Note that vw defines a VW namespace but dumps its vw type into the global namespace.
             vw* model = VW::initialize(vw_args);
+            ExampleBuilder builder(*model);
             
-            function<void(Alignment&)> train_on = [&](Alignment& aln) {
-                
-                // Turn each Alignment into a VW-format string
-                string example_string = alignment_to_example_string(aln, true);
-                
-                // Load an example for each Alignment.
-                // You can apparently only have so many examples at a time because they live in a ring buffer of unspecified size.
-                // TODO: There are non-string-parsing-based ways to do this too.
-                // TODO: Why link against vw at all if we're just going to shuffle strings around? We could pipe to it.
-                // TODO: vw alo dumps "example" into the global namespace...
-                example* example = VW::read_example(*model, example_string);
-                
-                // Now we call the learn method, defined in vowpalwabbit/global_data.h.
-                // It's not clear what it does but it is probably training.
-                // If we didn't label the data, this would just predict instead.
+            default_random_engine random(seed);
+            bernoulli_distribution keep(sample_fraction);
+            
+            // Learning is inherently serial, so it happens on this thread, in
+            // the order that the shuffle buffer releases examples.
+            vector<AlignmentFeatures> shuffle_buffer;
+            shuffle_buffer.reserve(shuffle_buffer_size);
+            auto learn = [&](const AlignmentFeatures& features) {
+                example* example = builder.make_example(features, true);
+                // Labeled data makes this train
                 model->learn(example);
-                
-                // Clean up the example
                 VW::finish_example(*model, example);
             };
+            auto shuffle_and_learn = [&](const AlignmentFeatures& features) {
+                if (shuffle_buffer_size == 0) {
+                    learn(features);
+                } else if (shuffle_buffer.size() < shuffle_buffer_size) {
+                    shuffle_buffer.push_back(features);
+                } else {
+                    // Swap a random buffered example out for the new one
+                    size_t i = uniform_int_distribution<size_t>(0, shuffle_buffer_size - 1)(random);
+                    learn(shuffle_buffer[i]);
+                    shuffle_buffer[i] = features;
+                }
+            };
             
-            // TODO: We have to go in serial because vw isn't thread safe I think.
-            stream::for_each(gam_stream, train_on);
+            // Features are extracted in parallel, a batch at a time
+            vector<Alignment> batch;
+            vector<AlignmentFeatures> batch_features;
+            batch.reserve(batch_size);
+            auto process_batch = [&]() {
+                batch_features.resize(batch.size());
+#pragma omp parallel for
+                for (size_t i = 0; i < batch.size(); i++) {
+                    batch_features[i] = alignment_to_features(batch[i]);
+                }
+                for (auto& features : batch_features) {
+                    shuffle_and_learn(features);
+                }
+                batch.clear();
+            };
+            
+            function<void(Alignment&)> add_to_batch = [&](Alignment& aln) {
+                // Decide to sample in input order, so the subsample only
+                // depends on the seed
+                if (sample_fraction == 1.0 || keep(random)) {
+                    batch.emplace_back(std::move(aln));
+                    if (batch.size() >= batch_size) {
+                        process_batch();
+                    }
+                }
+            };
+            
+            stream::for_each(gam_stream, add_to_batch);
+            process_batch();
+            
+            // Drain the shuffle buffer
+            shuffle(shuffle_buffer.begin(), shuffle_buffer.end(), random);
+            for (auto& features : shuffle_buffer) {
+                learn(features);
+            }
             
             // Now we want to output the model.
             // TODO: We had to specify that already. I think it is magic?
@@ -200,25 +244,27 @@ int main_recalibrate(int argc, char** argv) {
                 vw_args += " -i " + model_filename;
             }
             
-            // Make the model
-            vw* model = VW::initialize(vw_args);
+            // VW models aren't thread safe, so give each thread its own copy,
+            // and only let the first one report to stderr.
+            int thread_count = omp_get_max_threads();
+            vector<vw*> models;
+            vector<unique_ptr<ExampleBuilder>> builders;
+            for (int i = 0; i < thread_count; i++) {
+                models.push_back(VW::initialize(i == 0 ? vw_args : vw_args + " --quiet"));
+                builders.emplace_back(new ExampleBuilder(*models.back()));
+            }
        
             // Define a buffering emitter to print the alignments
             stream::ProtobufEmitter<Alignment> buf(cout);
             
             // Specify how to recalibrate an alignment
-            function<void(Alignment&)> recalibrate = [&](Alignment& aln) {
-                
-                // Turn each Alignment into a VW-format string
-                string example_string = alignment_to_example_string(aln, false);
+            auto recalibrate = [&](Alignment& aln, int thread_num) {
                 
-                // Load an example for each Alignment.
-                example* example = VW::read_example(*model, example_string);
+                vw& model = *models[thread_num];
+                example* example = builders[thread_num]->make_example(alignment_to_features(aln), false);
                 
-                // Now we call the learn method, defined in vowpalwabbit/global_data.h.
-                // It's not clear what it does but it is probably training.
-                // If we didn't label the data, this would just predict instead.
-                model->learn(example);
+                // Unlabeled data makes this just predict
+                model.learn(example);
                 
                 // Get the correctness prediction from -1 to 1
                 double prob = example->pred.prob;
@@ -228,29 +274,45 @@ int main_recalibrate(int argc, char** argv) {
                 double clamped = max(0.0, min(60.0, guess));
                
 #ifdef debug
-                cerr << example_string << " -> " << prob << " -> " << guess << " -> " << clamped << endl;
+#pragma omp critical (cerr)
+                cerr << alignment_to_example_string(aln, false) << " -> " << prob << " -> " << guess << " -> " << clamped << endl;
 #endif
                 
                 // Set the MAPQ to output.
                 aln.set_mapping_quality(clamped);
                 
                 // Clean up the example
-                VW::finish_example(*model, example);
-                
-                
-                
-#pragma omp critical (buf)
-                {
-                    // Save to the buffer
+                VW::finish_example(model, example);
+            };
+            
+            // Recalibrate a batch at a time in parallel, and emit each batch
+            // in input order
+            vector<Alignment> batch;
+            batch.reserve(batch_size);
+            auto process_batch = [&]() {
+#pragma omp parallel for
+                for (size_t i = 0; i < batch.size(); i++) {
+                    recalibrate(batch[i], omp_get_thread_num());
+                }
+                for (auto& aln : batch) {
                     buf.write(std::move(aln));
                 }
+                batch.clear();
             };
             
-            // For each read, recalibrate and buffer and maybe print it.
-            // TODO: It would be nice if this could be parallel...
-            stream::for_each(gam_stream, recalibrate);
+            function<void(Alignment&)> add_to_batch = [&](Alignment& aln) {
+                batch.emplace_back(std::move(aln));
+                if (batch.size() >= batch_size) {
+                    process_batch();
+                }
+            };
             
-            VW::finish(*model);
+            stream::for_each(gam_stream, add_to_batch);
+            process_batch();
+            
+            for (vw* model : models) {
+                VW::finish(*model);
+            }
             
         }
         
@@ -10,6 +10,9 @@
 
 #include <list>
 #include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <tuple>
 
 #include "subcommand.hpp"
 #include "../algorithms/distance_to_head.hpp"
@@ -24,6 +27,141 @@ using namespace vg;
 using namespace vg::subcommand;
 using namespace vg::algorithms;
 
+/// A histogram over nonnegative values, with bins of a fixed width. Values past
+/// the last bin are counted in it.
+struct StatsHistogram {
+    StatsHistogram(double bin_width, size_t max_bins) : bin_width(bin_width), max_bins(max_bins) {
+        // Nothing to do
+    }
+    
+    double bin_width;
+    size_t max_bins;
+    vector<size_t> counts;
+    
+    void add(double value) {
+        size_t bin = value > 0 ? min((size_t) (value / bin_width), max_bins - 1) : 0;
+        if (bin >= counts.size()) {
+            counts.resize(bin + 1, 0);
+        }
+        counts[bin]++;
+    }
+    
+    void merge(const StatsHistogram& other) {
+        if (other.counts.size() > counts.size()) {
+            counts.resize(other.counts.size(), 0);
+        }
+        for (size_t i = 0; i < other.counts.size(); i++) {
+            counts[i] += other.counts[i];
+        }
+    }
+    
+    void write_json(ostream& out) const {
+        out << "{\"bin_width\":" << bin_width << ",\"counts\":[";
+        for (size_t i = 0; i < counts.size(); i++) {
+            out << (i ? "," : "") << counts[i];
+        }
+        out << "]}";
+    }
+};
+
+/// The statistics gathered from a set of alignments, which one thread can
+/// accumulate on its own and then merge with the other threads' statistics.
+struct AlignmentStats {
+    AlignmentStats(size_t allele_count) : reads_on_allele(allele_count, 0) {
+        // Nothing to do
+    }
+    
+    // These are the general stats we will compute.
+    size_t total_alignments = 0;
+    size_t total_aligned = 0;
+    size_t total_primary = 0;
+    size_t total_secondary = 0;
+    
+    // And for counting indels
+    // Inserted bases also counts softclips
+    size_t total_insertions = 0;
+    size_t total_inserted_bases = 0;
+    size_t total_deletions = 0;
+    size_t total_deleted_bases = 0;
+    // And substitutions
+    size_t total_substitutions = 0;
+    size_t total_substituted_bases = 0;
+    // And softclips
+    size_t total_softclips = 0;
+    size_t total_softclipped_bases = 0;
+    
+    // In verbose mode we want to report details of insertions, deletions,
+    // and substitutions, and soft clips.
+    vector<pair<vg::id_t, Edit>> insertions;
+    vector<pair<vg::id_t, Edit>> deletions;
+    vector<pair<vg::id_t, Edit>> substitutions;
+    vector<pair<vg::id_t, Edit>> softclips;
+    
+    // How many primary reads support each allele, by allele number
+    vector<size_t> reads_on_allele;
+    
+    // Distributions over primary alignments
+    StatsHistogram mapping_quality{1, 256};
+    StatsHistogram score{1, 10000};
+    StatsHistogram identity{0.01, 101};
+    StatsHistogram softclipped_bases{1, 10000};
+    StatsHistogram insert_size{10, 10000};
+    
+    /// Add in the statistics from another set of alignments.
+    void merge(const AlignmentStats& other) {
+        total_alignments += other.total_alignments;
+        total_aligned += other.total_aligned;
+        total_primary += other.total_primary;
+        total_secondary += other.total_secondary;
+        total_insertions += other.total_insertions;
+        total_inserted_bases += other.total_inserted_bases;
+        total_deletions += other.total_deletions;
+        total_deleted_bases += other.total_deleted_bases;
+        total_substitutions += other.total_substitutions;
+        total_substituted_bases += other.total_substituted_bases;
+        total_softclips += other.total_softclips;
+        total_softclipped_bases += other.total_softclipped_bases;
+        insertions.insert(insertions.end(), other.insertions.begin(), other.insertions.end());
+        deletions.insert(deletions.end(), other.deletions.begin(), other.deletions.end());
+        substitutions.insert(substitutions.end(), other.substitutions.begin(), other.substitutions.end());
+        softclips.insert(softclips.end(), other.softclips.begin(), other.softclips.end());
+        for (size_t i = 0; i < reads_on_allele.size(); i++) {
+            reads_on_allele[i] += other.reads_on_allele[i];
+        }
+        mapping_quality.merge(other.mapping_quality);
+        score.merge(other.score);
+        identity.merge(other.identity);
+        softclipped_bases.merge(other.softclipped_bases);
+        insert_size.merge(other.insert_size);
+    }
+};
+
+/// Put edits found in parallel into an order that doesn't depend on the
+/// threads that found them.
+static void sort_edits(vector<pair<vg::id_t, Edit>>& edits) {
+    std::sort(edits.begin(), edits.end(), [](const pair<vg::id_t, Edit>& a, const pair<vg::id_t, Edit>& b) {
+        return make_tuple(a.first, a.second.from_length(), a.second.to_length(), a.second.sequence()) <
+            make_tuple(b.first, b.second.from_length(), b.second.to_length(), b.second.sequence());
+    });
+}
+
+/// Quote a string for JSON output.
+static string json_quote(const string& text) {
+    stringstream quoted;
+    quoted << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted << '\\' << c;
+        } else if ((unsigned char) c < 0x20) {
+            quoted << "\\u" << hex << setw(4) << setfill('0') << (int) c << dec;
+        } else {
+            quoted << c;
+        }
+    }
+    quoted << '"';
+    return quoted.str();
+}
+
 void help_stats(char** argv) {
     cerr << "usage: " << argv[0] << " stats [options] <graph.vg>" << endl
          << "options:" << endl
@@ -41,6 +179,7 @@ void help_stats(char** argv) {
          << "    -d, --to-head         show distance to head for each provided node" << endl
          << "    -t, --to-tail         show distance to head for each provided node" << endl
          << "    -a, --alignments FILE compute stats for reads aligned to the graph" << endl
+         << "    -j, --json            with -a, report alignment stats, histograms and path coverage as JSON" << endl
          << "    -r, --node-id-range   X:Y where X and Y are the smallest and largest "
         "node id in the graph, respectively" << endl
          << "    -o, --overlap PATH    for each overlapping path mapping in the graph write a table:" << endl
@@ -76,6 +215,8 @@ int main_stats(int argc, char** argv) {
     // What alignments GAM file should we read and compute stats on with the
     // graph?
     string alignments_filename;
+    // Should we report the alignment stats as JSON?
+    bool json_output = false;
     vector<string> paths_to_overlap;
     bool overlap_all_paths = false;
     bool snarl_stats = false;
@@ -99,6 +240,7 @@ int main_stats(int argc, char** argv) {
             {"to-tail", no_argument, 0, 't'},
             {"node", required_argument, 0, 'n'},
             {"alignments", required_argument, 0, 'a'},
+            {"json", no_argument, 0, 'j'},
             {"is-acyclic", no_argument, 0, 'A'},
             {"node-id-range", no_argument, 0, 'r'},
             {"verbose", no_argument, 0, 'v'},
@@ -109,7 +251,7 @@ int main_stats(int argc, char** argv) {
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hzlsHTScdtn:NEa:vAro:OR",
+        c = getopt_long (argc, argv, "hzlsHTScdtn:NEa:jvAro:OR",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -174,6 +316,10 @@ int main_stats(int argc, char** argv) {
             alignments_filename = optarg;
             break;
 
+        case 'j':
+            json_output = true;
+            break;
+
         case 'r':
             stats_range = true;
             break;
@@ -205,6 +351,11 @@ int main_stats(int argc, char** argv) {
         }
     }
 
+    if (json_output && alignments_filename.empty()) {
+        cerr << "error:[vg stats] JSON output (-j) requires alignments to report on (-a)" << endl;
+        exit(1);
+    }
+
     VG graph;
     get_input_file(optind, argc, argv, [&](istream& in) {
             graph.from_istream(in);
@@ -409,25 +560,10 @@ int main_stats(int argc, char** argv) {
             return path_name.substr(last_underscore + 1);
         };
 
-        // Before we go over the reads, we need to make a map that tells us what
-        // nodes are unique to what allele paths. Stores site and allele parts
-        // separately.
-        map<vg::id_t, pair<string, string>> allele_path_for_node;
-
-        // This is what we really care about: for each pair of allele paths in
-        // the graph, we need to find out whether the coverage imbalance between
-        // them among primary alignments is statistically significant. For this,
-        // we need to track how many reads overlap the distinct parts of allele
-        // paths.
-
-        // This is going to be indexed by site
-        // ("_alt_f6d951572f9c664d5d388375aa8b018492224533") and then by allele
-        // ("0"). A read only counts if it visits a node that's on one allele
-        // and not any others in that site.
-
-        // We need to pre-populate it with 0s so we know which sites actually
-        // have 2 alleles and which only have 1 in the graph.
-        map<string, map<string, size_t>> reads_on_allele;
+        // Before we go over the reads, we need to find what nodes are unique
+        // to what allele paths. Alleles are numbered in order of site and
+        // allele name, and each node gets the number of its allele, or -1.
+        vector<pair<vg::id_t, pair<string, string>>> node_alleles;
 
         graph.for_each_node_parallel([&](Node* node) {
             // For every node
@@ -465,93 +601,104 @@ int main_stats(int argc, char** argv) {
                 auto site = path_name_to_site(allele_path);
                 auto allele = path_name_to_allele(allele_path);
 
-
-                #pragma omp critical (allele_path_for_node)
-                allele_path_for_node[node->id()] = make_pair(site, allele);
-
-                #pragma omp critical (reads_on_allele)
-                reads_on_allele[site][allele] = 0;
+                #pragma omp critical (node_alleles)
+                node_alleles.emplace_back(node->id(), make_pair(site, allele));
             }
         });
+        
+        // Number the alleles
+        vector<pair<string, string>> alleles;
+        for (auto& node_and_allele : node_alleles) {
+            alleles.push_back(node_and_allele.second);
+        }
+        std::sort(alleles.begin(), alleles.end());
+        alleles.erase(std::unique(alleles.begin(), alleles.end()), alleles.end());
+        
+        // Index nodes by their rank among the sorted node IDs, so we can
+        // count visits in flat arrays even if the IDs are sparse.
+        vector<vg::id_t> node_ids;
+        node_ids.reserve(graph.node_count());
+        graph.for_each_node([&](Node* node) {
+            node_ids.push_back(node->id());
+        });
+        std::sort(node_ids.begin(), node_ids.end());
+        // Get the rank of a node, or -1 if it isn't in the graph
+        auto node_rank = [&](vg::id_t node_id) -> int64_t {
+            auto found = std::lower_bound(node_ids.begin(), node_ids.end(), node_id);
+            return (found != node_ids.end() && *found == node_id) ? found - node_ids.begin() : -1;
+        };
+        
+        vector<int64_t> allele_for_node(node_ids.size(), -1);
+        for (auto& node_and_allele : node_alleles) {
+            allele_for_node[node_rank(node_and_allele.first)] = std::lower_bound(alleles.begin(), alleles.end(),
+                                                                                 node_and_allele.second) - alleles.begin();
+        }
+        node_alleles.clear();
+        
+        // These are for tracking which nodes are covered and which are not,
+        // and how many read bases cover them.
+        vector<size_t> node_visit_counts(node_ids.size(), 0);
+        vector<size_t> node_aligned_bases(node_ids.size(), 0);
 
-
-        // These are the general stats we will compute.
-        size_t total_alignments = 0;
-        size_t total_aligned = 0;
-        size_t total_primary = 0;
-        size_t total_secondary = 0;
-
-        // These are for counting significantly allele-biased hets
-        size_t total_hets = 0;
-        size_t significantly_biased_hets = 0;
-
-        // These are for tracking which nodes are covered and which are not
-        map<vg::id_t, size_t> node_visit_counts;
-
-        // And for counting indels
-        // Inserted bases also counts softclips
-        size_t total_insertions = 0;
-        size_t total_inserted_bases = 0;
-        size_t total_deletions = 0;
-        size_t total_deleted_bases = 0;
-        // And substitutions
-        size_t total_substitutions = 0;
-        size_t total_substituted_bases = 0;
-        // And softclips
-        size_t total_softclips = 0;
-        size_t total_softclipped_bases = 0;
-
-        // In verbose mode we want to report details of insertions, deletions,
-        // and substitutions, and soft clips.
-        vector<pair<vg::id_t, Edit>> insertions;
-        vector<pair<vg::id_t, Edit>> deletions;
-        vector<pair<vg::id_t, Edit>> substitutions;
-        vector<pair<vg::id_t, Edit>> softclips;
+        // Each thread gathers its own stats, to be merged when we are done.
+        vector<AlignmentStats> thread_stats(omp_get_max_threads(), AlignmentStats(alleles.size()));
 
         function<void(Alignment&)> lambda = [&](Alignment& aln) {
-            int tid = omp_get_thread_num();
+            AlignmentStats& stats = thread_stats[omp_get_thread_num()];
 
             // We ought to be able to do many stats on the alignments.
 
             // Now do all the non-mapping stats
-            #pragma omp critical (total_alignments)
-            total_alignments++;
+            stats.total_alignments++;
             if(aln.is_secondary()) {
-                #pragma omp critical (total_secondary)
-                total_secondary++;
+                stats.total_secondary++;
             } else {
-                #pragma omp critical (total_primary)
-                total_primary++;
+                stats.total_primary++;
                 if(aln.score() > 0) {
                     // We only count aligned primary reads in "total aligned";
                     // the primary can't be unaligned if the secondary is
                     // aligned.
-                    #pragma omp critical (total_aligned)
-                    total_aligned++;
+                    stats.total_aligned++;
+                }
+                
+                stats.mapping_quality.add(aln.mapping_quality());
+                stats.score.add(aln.score());
+                stats.identity.add(aln.identity());
+                if(aln.fragment_size() > 0) {
+                    stats.insert_size.add(abs(aln.fragment(0).length()));
                 }
 
-                // Which sites and alleles does this read support. TODO: if we hit
+                // Which alleles does this read support. TODO: if we hit
                 // unique nodes from multiple alleles of the same site, we should...
                 // do something. Discard the read? Not just count it on both sides
                 // like we do now.
-                set<pair<string, string>> alleles_supported;
+                vector<int64_t> alleles_supported;
+                
+                // How many bases are softclipped off the read
+                size_t read_softclipped_bases = 0;
 
                 for(size_t i = 0; i < aln.path().mapping_size(); i++) {
                     // For every mapping...
                     auto& mapping = aln.path().mapping(i);
                     vg::id_t node_id = mapping.position().node_id();
+                    int64_t node_index = node_rank(node_id);
+                    
+                    if(node_index != -1) {
+                        
+                        if(allele_for_node[node_index] != -1) {
+                            // We hit a unique node for this allele.
+                            alleles_supported.push_back(allele_for_node[node_index]);
+                        }
 
-                    if(allele_path_for_node.count(node_id)) {
-                        // We hit a unique node for this allele. Add it to the set,
-                        // in case we hit another unique node for it later in the
-                        // read.
-                        alleles_supported.insert(allele_path_for_node.at(node_id));
+                        // Record that there was a visit to this node.
+                        #pragma omp atomic
+                        node_visit_counts[node_index]++;
+                        
+                        size_t aligned_bases = mapping_from_length(mapping);
+                        #pragma omp atomic
+                        node_aligned_bases[node_index] += aligned_bases;
                     }
 
-                    // Record that there was a visit to this node.
-                    #pragma omp critical (node_visit_counts)
-                    node_visit_counts[node_id]++;
-
                     for(size_t j = 0; j < mapping.edit_size(); j++) {
                         // Go through edits and look for each type.
                         auto& edit = mapping.edit(j);
@@ -559,61 +706,54 @@ int main_stats(int argc, char** argv) {
                         if(edit.to_length() > edit.from_length()) {
                             if((j == 0 && i == 0) || (j == mapping.edit_size() - 1 && i == aln.path().mapping_size() - 1)) {
                                 // We're at the very end of the path, so this is a soft clip.
-                                #pragma omp critical (total_softclipped_bases)
-                                total_softclipped_bases += edit.to_length() - edit.from_length();
-                                #pragma omp critical (total_softclips)
-                                total_softclips++;
+                                stats.total_softclipped_bases += edit.to_length() - edit.from_length();
+                                read_softclipped_bases += edit.to_length() - edit.from_length();
+                                stats.total_softclips++;
                                 if(verbose) {
                                     // Record the actual insertion
-                                    #pragma omp critical (softclips)
-                                    softclips.push_back(make_pair(node_id, edit));
+                                    stats.softclips.push_back(make_pair(node_id, edit));
                                 }
                             } else {
                                 // Record this insertion
-                                #pragma omp critical (total_inserted_bases)
-                                total_inserted_bases += edit.to_length() - edit.from_length();
-                                #pragma omp critical (total_insertions)
-                                total_insertions++;
+                                stats.total_inserted_bases += edit.to_length() - edit.from_length();
+                                stats.total_insertions++;
                                 if(verbose) {
                                     // Record the actual insertion
-                                    #pragma omp critical (insertions)
-                                    insertions.push_back(make_pair(node_id, edit));
+                                    stats.insertions.push_back(make_pair(node_id, edit));
                                 }
                             }
 
                         } else if(edit.from_length() > edit.to_length()) {
                             // Record this deletion
-                            #pragma omp critical (total_deleted_bases)
-                            total_deleted_bases += edit.from_length() - edit.to_length();
-                            #pragma omp critical (total_deletions)
-                            total_deletions++;
+                            stats.total_deleted_bases += edit.from_length() - edit.to_length();
+                            stats.total_deletions++;
                             if(verbose) {
                                 // Record the actual deletion
-                                #pragma omp critical (deletions)
-                                deletions.push_back(make_pair(node_id, edit));
+                                stats.deletions.push_back(make_pair(node_id, edit));
                             }
                         } else if(!edit.sequence().empty()) {
                             // Record this substitution
                             // TODO: a substitution might also occur as part of a deletion/insertion above!
-                            #pragma omp critical (total_substituted_bases)
-                            total_substituted_bases += edit.from_length();
-                            #pragma omp critical (total_substitutions)
-                            total_substitutions++;
+                            stats.total_substituted_bases += edit.from_length();
+                            stats.total_substitutions++;
                             if(verbose) {
                                 // Record the actual substitution
-                                #pragma omp critical (substitutions)
-                                substitutions.push_back(make_pair(node_id, edit));
+                                stats.substitutions.push_back(make_pair(node_id, edit));
                             }
                         }
 
                     }
                 }
-
-                for(auto& site_and_allele : alleles_supported) {
-                    // This read is informative for an allele of a site.
+                
+                stats.softclipped_bases.add(read_softclipped_bases);
+
+                // This read is informative for each allele it hit, once.
+                std::sort(alleles_supported.begin(), alleles_supported.end());
+                alleles_supported.erase(std::unique(alleles_supported.begin(), alleles_supported.end()),
+                                        alleles_supported.end());
+                for(auto& allele : alleles_supported) {
                     // Up the reads on that allele of that site.
-                    #pragma omp critical (reads_on_allele)
-                    reads_on_allele[site_and_allele.first][site_and_allele.second]++;
+                    stats.reads_on_allele[allele]++;
                 }
             }
 
@@ -621,6 +761,39 @@ int main_stats(int argc, char** argv) {
 
         // Actually go through all the reads and count stuff up.
         stream::for_each_parallel(alignment_stream, lambda);
+        
+        // Merge the threads' stats in thread order, and put the edits in a
+        // fixed order, so the output doesn't depend on scheduling.
+        AlignmentStats& stats = thread_stats.front();
+        for (size_t i = 1; i < thread_stats.size(); i++) {
+            stats.merge(thread_stats[i]);
+        }
+        thread_stats.erase(thread_stats.begin() + 1, thread_stats.end());
+        sort_edits(stats.insertions);
+        sort_edits(stats.deletions);
+        sort_edits(stats.substitutions);
+        sort_edits(stats.softclips);
+        
+        // This is what we really care about: for each pair of allele paths in
+        // the graph, we need to find out whether the coverage imbalance between
+        // them among primary alignments is statistically significant. For this,
+        // we need to track how many reads overlap the distinct parts of allele
+        // paths.
+
+        // This is going to be indexed by site
+        // ("_alt_f6d951572f9c664d5d388375aa8b018492224533") and then by allele
+        // ("0"). A read only counts if it visits a node that's on one allele
+        // and not any others in that site. Every allele with unique nodes is
+        // present, so we know which sites actually have 2 alleles and which
+        // only have 1 in the graph.
+        map<string, map<string, size_t>> reads_on_allele;
+        for (size_t i = 0; i < alleles.size(); i++) {
+            reads_on_allele[alleles[i].first][alleles[i].second] = stats.reads_on_allele[i];
+        }
+
+        // These are for counting significantly allele-biased hets
+        size_t total_hets = 0;
+        size_t significantly_biased_hets = 0;
 
         // Calculate stats about the reads per allele data
         for(auto& site_and_alleles : reads_on_allele) {
@@ -681,7 +854,8 @@ int main_stats(int argc, char** argv) {
         // visit the whole node.
         graph.for_each_node_parallel([&](Node* node) {
             // For every node
-            if(!node_visit_counts.count(node->id()) || node_visit_counts.at(node->id()) == 0) {
+            size_t visit_count = node_visit_counts[node_rank(node->id())];
+            if(visit_count == 0) {
                 // If we never visited it with a read, count it.
                 #pragma omp critical (unvisited_nodes)
                 unvisited_nodes++;
@@ -691,7 +865,7 @@ int main_stats(int argc, char** argv) {
                     #pragma omp critical (unvisited_ids)
                     unvisited_ids.insert(node->id());
                 }
-            } else if(node_visit_counts.at(node->id()) == 1) {
+            } else if(visit_count == 1) {
                 // If we visited it with only one read, count it.
                 #pragma omp critical (single_visited_nodes)
                 single_visited_nodes++;
@@ -704,61 +878,118 @@ int main_stats(int argc, char** argv) {
             }
         });
 
-        cout << "Total alignments: " << total_alignments << endl;
-        cout << "Total primary: " << total_primary << endl;
-        cout << "Total secondary: " << total_secondary << endl;
-        cout << "Total aligned: " << total_aligned << endl;
-
-        cout << "Insertions: " << total_inserted_bases << " bp in " << total_insertions << " read events" << endl;
-        if(verbose) {
-            for(auto& id_and_edit : insertions) {
-                cout << "\t" << id_and_edit.second.from_length() << " -> " << id_and_edit.second.sequence()
-                    << " on " << id_and_edit.first << endl;
+        if (json_output) {
+            // Report everything as one JSON object, for other tools to read.
+            cout << "{\"alignments\":{\"total\":" << stats.total_alignments
+                << ",\"primary\":" << stats.total_primary
+                << ",\"secondary\":" << stats.total_secondary
+                << ",\"aligned\":" << stats.total_aligned << "}"
+                << ",\"insertions\":{\"bases\":" << stats.total_inserted_bases << ",\"events\":" << stats.total_insertions << "}"
+                << ",\"deletions\":{\"bases\":" << stats.total_deleted_bases << ",\"events\":" << stats.total_deletions << "}"
+                << ",\"substitutions\":{\"bases\":" << stats.total_substituted_bases << ",\"events\":" << stats.total_substitutions << "}"
+                << ",\"softclips\":{\"bases\":" << stats.total_softclipped_bases << ",\"events\":" << stats.total_softclips << "}"
+                << ",\"nodes\":{\"total\":" << graph.node_count()
+                << ",\"unvisited\":" << unvisited_nodes
+                << ",\"unvisited_bases\":" << unvisited_node_bases
+                << ",\"single_visited\":" << single_visited_nodes
+                << ",\"single_visited_bases\":" << single_visited_node_bases << "}"
+                << ",\"heterozygous_sites\":{\"total\":" << total_hets
+                << ",\"significantly_biased\":" << significantly_biased_hets << "}";
+            
+            cout << ",\"histograms\":{\"mapping_quality\":";
+            stats.mapping_quality.write_json(cout);
+            cout << ",\"score\":";
+            stats.score.write_json(cout);
+            cout << ",\"identity\":";
+            stats.identity.write_json(cout);
+            cout << ",\"softclipped_bases\":";
+            stats.softclipped_bases.write_json(cout);
+            cout << ",\"insert_size\":";
+            stats.insert_size.write_json(cout);
+            cout << "}";
+            
+            // Work out how deeply the reads cover each path, from the bases
+            // aligned to its nodes. Paths come out in name order.
+            cout << ",\"paths\":[";
+            bool first_path = true;
+            graph.paths.for_each([&](const Path& path) {
+                size_t path_length = 0;
+                size_t aligned_bases = 0;
+                size_t covered_bases = 0;
+                for (size_t i = 0; i < path.mapping_size(); i++) {
+                    vg::id_t node_id = path.mapping(i).position().node_id();
+                    size_t node_length = graph.get_node(node_id)->sequence().size();
+                    size_t node_index = node_rank(node_id);
+                    path_length += node_length;
+                    aligned_bases += node_aligned_bases[node_index];
+                    if (node_visit_counts[node_index] > 0) {
+                        covered_bases += node_length;
+                    }
+                }
+                cout << (first_path ? "" : ",") << "{\"name\":" << json_quote(path.name())
+                    << ",\"length\":" << path_length
+                    << ",\"mean_depth\":" << (path_length ? (double) aligned_bases / path_length : 0.0)
+                    << ",\"covered_fraction\":" << (path_length ? (double) covered_bases / path_length : 0.0) << "}";
+                first_path = false;
+            });
+            cout << "]}" << endl;
+        } else {
+            cout << "Total alignments: " << stats.total_alignments << endl;
+            cout << "Total primary: " << stats.total_primary << endl;
+            cout << "Total secondary: " << stats.total_secondary << endl;
+            cout << "Total aligned: " << stats.total_aligned << endl;
+
+            cout << "Insertions: " << stats.total_inserted_bases << " bp in " << stats.total_insertions << " read events" << endl;
+            if(verbose) {
+                for(auto& id_and_edit : stats.insertions) {
+                    cout << "\t" << id_and_edit.second.from_length() << " -> " << id_and_edit.second.sequence()
+                        << " on " << id_and_edit.first << endl;
+                }
             }
-        }
-        cout << "Deletions: " << total_deleted_bases << " bp in " << total_deletions << " read events" << endl;
-        if(verbose) {
-            for(auto& id_and_edit : deletions) {
-                cout << "\t" << id_and_edit.second.from_length() << " -> " << id_and_edit.second.to_length()
-                    << " on " << id_and_edit.first << endl;
+            cout << "Deletions: " << stats.total_deleted_bases << " bp in " << stats.total_deletions << " read events" << endl;
+            if(verbose) {
+                for(auto& id_and_edit : stats.deletions) {
+                    cout << "\t" << id_and_edit.second.from_length() << " -> " << id_and_edit.second.to_length()
+                        << " on " << id_and_edit.first << endl;
+                }
             }
-        }
-        cout << "Substitutions: " << total_substituted_bases << " bp in " << total_substitutions << " read events" << endl;
-        if(verbose) {
-            for(auto& id_and_edit : substitutions) {
-                cout << "\t" << id_and_edit.second.from_length() << " -> " << id_and_edit.second.sequence()
-                    << " on " << id_and_edit.first << endl;
+            cout << "Substitutions: " << stats.total_substituted_bases << " bp in " << stats.total_substitutions << " read events" << endl;
+            if(verbose) {
+                for(auto& id_and_edit : stats.substitutions) {
+                    cout << "\t" << id_and_edit.second.from_length() << " -> " << id_and_edit.second.sequence()
+                        << " on " << id_and_edit.first << endl;
+                }
             }
-        }
-        cout << "Softclips: " << total_softclipped_bases << " bp in " << total_softclips << " read events" << endl;
-        if(verbose) {
-            for(auto& id_and_edit : softclips) {
-                cout << "\t" << id_and_edit.second.from_length() << " -> " << id_and_edit.second.sequence()
-                    << " on " << id_and_edit.first << endl;
+            cout << "Softclips: " << stats.total_softclipped_bases << " bp in " << stats.total_softclips << " read events" << endl;
+            if(verbose) {
+                for(auto& id_and_edit : stats.softclips) {
+                    cout << "\t" << id_and_edit.second.from_length() << " -> " << id_and_edit.second.sequence()
+                        << " on " << id_and_edit.first << endl;
+                }
             }
-        }
 
-        cout << "Unvisited nodes: " << unvisited_nodes << "/" << graph.node_count()
-            << " (" << unvisited_node_bases << " bp)" << endl;
-        if(verbose) {
-            for(auto& id : unvisited_ids) {
-                cout << "\t" << id << endl;
+            cout << "Unvisited nodes: " << unvisited_nodes << "/" << graph.node_count()
+                << " (" << unvisited_node_bases << " bp)" << endl;
+            if(verbose) {
+                for(auto& id : unvisited_ids) {
+                    cout << "\t" << id << endl;
+                }
             }
-        }
 
-        cout << "Single-visited nodes: " << single_visited_nodes << "/" << graph.node_count()
-            << " (" << single_visited_node_bases << " bp)" << endl;
-        if(verbose) {
-            for(auto& id : single_visited_ids) {
-                cout << "\t" << id << endl;
+            cout << "Single-visited nodes: " << single_visited_nodes << "/" << graph.node_count()
+                << " (" << single_visited_node_bases << " bp)" << endl;
+            if(verbose) {
+                for(auto& id : single_visited_ids) {
+                    cout << "\t" << id << endl;
+                }
             }
-        }
 
-        cout << "Significantly biased heterozygous sites: " << significantly_biased_hets << "/" << total_hets;
-        if(total_hets > 0) {
-            cout << " (" << (double)significantly_biased_hets / total_hets * 100 << "%)";
+            cout << "Significantly biased heterozygous sites: " << significantly_biased_hets << "/" << total_hets;
+            if(total_hets > 0) {
+                cout << " (" << (double)significantly_biased_hets / total_hets * 100 << "%)";
+            }
+            cout << endl;
         }
-        cout << endl;
 
 
     }
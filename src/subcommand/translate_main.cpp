@@ -30,7 +30,38 @@ void help_translate(char** argv) {
          << "    -l, --loci FILE       project the input locus descriptions into the from-graph" << endl
          << "    -m, --mapping JSON    print the from-mapping corresponding to the given JSON mapping" << endl
          << "    -P, --position JSON   print the from-position corresponding to the given JSON position" << endl
-         << "    -o, --overlay FILE    overlay this translation on top of the one we are given" << endl;
+         << "    -o, --overlay FILE    overlay this translation on top of the one we are given" << endl
+         << "    -t, --threads N       number of threads to use for projecting paths, alignments, and loci" << endl;
+}
+
+/// Translate a stream of messages in parallel batches, writing them to cout
+/// in their input order
+template<typename Message>
+void translate_stream(const string& filename, Translator& translator, size_t batch_size = 1000) {
+    stream::ProtobufEmitter<Message> emitter(cout);
+    vector<Message> batch;
+    batch.reserve(batch_size);
+    
+    auto translate_batch = [&]() {
+#pragma omp parallel for
+        for (size_t i = 0; i < batch.size(); i++) {
+            batch[i] = translator.translate(batch[i]);
+        }
+        for (auto& message : batch) {
+            emitter.write(std::move(message));
+        }
+        batch.clear();
+    };
+    
+    function<void(Message&)> lambda = [&](Message& message) {
+        batch.emplace_back(std::move(message));
+        if (batch.size() >= batch_size) {
+            translate_batch();
+        }
+    };
+    ifstream in(filename);
+    stream::for_each(in, lambda);
+    translate_batch();
 }
 
 int main_translate(int argc, char** argv) {
@@ -59,11 +90,12 @@ int main_translate(int argc, char** argv) {
             {"alns", required_argument, 0, 'a'},
             {"loci", required_argument, 0, 'l'},
             {"overlay", required_argument, 0, 'o'},
+            {"threads", required_argument, 0, 't'},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hp:m:P:a:o:l:",
+        c = getopt_long (argc, argv, "hp:m:P:a:o:l:t:",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -96,6 +128,10 @@ int main_translate(int argc, char** argv) {
             overlay_file = optarg;
             break;
 
+        case 't':
+            omp_set_num_threads(parse<int>(optarg));
+            break;
+
         case 'h':
         case '?':
             help_translate(argv);
@@ -127,32 +163,11 @@ int main_translate(int argc, char** argv) {
     }
 
     if (!path_file.empty()) {
-        vector<Path> buffer;
-        function<void(Path&)> lambda = [&](Path& path) {
-            buffer.push_back(translator->translate(path));
-            stream::write_buffered(cout, buffer, 100);
-        };
-        ifstream path_in(path_file);
-        stream::for_each(path_in, lambda);
-        stream::write_buffered(cout, buffer, 0);
+        translate_stream<Path>(path_file, *translator);
     } else if (!aln_file.empty()) {
-        vector<Alignment> buffer;
-        function<void(Alignment&)> lambda = [&](Alignment& aln) {
-            buffer.push_back(translator->translate(aln));
-            stream::write_buffered(cout, buffer, 100);
-        };
-        ifstream aln_in(aln_file);
-        stream::for_each(aln_in, lambda);
-        stream::write_buffered(cout, buffer, 0);
+        translate_stream<Alignment>(aln_file, *translator);
     } else if (!loci_file.empty()) {
-        vector<Locus> buffer;
-        function<void(Locus&)> lambda = [&](Locus& locus) {
-            buffer.push_back(translator->translate(locus));
-            stream::write_buffered(cout, buffer, 100);
-        };
-        ifstream loci_in(loci_file);
-        stream::for_each(loci_in, lambda);
-        stream::write_buffered(cout, buffer, 0);
+        translate_stream<Locus>(loci_file, *translator);
     }
 
     if (!overlay_file.empty()) {
@@ -17,6 +17,7 @@
 #include "../vg.hpp"
 #include "../gfa.hpp"
 #include "../json_stream_helper.hpp"
+#include "../json_writer.hpp"
 
 using namespace std;
 using namespace vg;
@@ -436,9 +437,8 @@ int main_view(int argc, char** argv) {
     string file_name = get_input_file_name(optind, argc, argv);
     if (input_type == "vg") {
         if (output_type == "stream") {
-            function<void(Graph&)> lambda = [&](Graph& g) { cout << pb2json(g) << endl; };
             get_input_file(file_name, [&](istream& in) {
-                stream::for_each(in, lambda);
+                stream_to_json<Graph>(in, cout);
             });
             return 0;
         } else {
@@ -450,6 +450,19 @@ int main_view(int argc, char** argv) {
     } else if (input_type == "gfa") {
         get_input_file(file_name, [&](istream& in) {
             graph = new VG;
+            // Blunt-ended GFAs can be streamed in without building a pinch graph
+            streampos start = in.tellg();
+            if (start != streampos(-1) && blunt_gfa_to_graph(in, graph)) {
+                return;
+            }
+            if (start != streampos(-1)) {
+                // Overlaps need to be resolved, so start over from the beginning.
+                // (We can't rewind a pipe, so those go straight to the general importer.)
+                delete graph;
+                graph = new VG;
+                in.clear();
+                in.seekg(start);
+            }
             if (!gfa_to_graph(in, graph)) {
                 // GFA loading has failed because the file is invalid
                 exit(1);
@@ -473,17 +486,16 @@ int main_view(int argc, char** argv) {
         if (!input_json) {
             if (output_type == "json") {
                 // convert values to printable ones
-                function<void(Alignment&)> lambda = [](Alignment& a) {
+                function<void(Alignment&)> fixup = [](Alignment& a) {
                     if(std::isnan(a.identity())) {
                         // Fix up NAN identities that can't be serialized in
                         // JSON. We shouldn't generate these any more, and they
                         // are out of spec, but they can be in files.
                         a.set_identity(0);
                     }
-                    cout << pb2json(a) << "\n";
                 };
                 get_input_file(file_name, [&](istream& in) {
-                    stream::for_each(in, lambda);
+                    stream_to_json<Alignment>(in, cout, fixup);
                 });
             } else if (output_type == "fastq") {
                 function<void(Alignment&)> lambda = [](Alignment& a) {
@@ -634,11 +646,8 @@ int main_view(int argc, char** argv) {
                 stream::write_buffered(std::cout, buf, 0);
             }
             else if (output_type == "json") {
-                function<void(MultipathAlignment&)> lambda = [&](MultipathAlignment& mp_aln) {
-                    cout << pb2json(mp_aln) << endl;
-                };
                 get_input_file(file_name, [&](istream& in) {
-                    stream::for_each(in, lambda);
+                    stream_to_json<MultipathAlignment>(in, cout);
                 });
             }
             else {
@@ -724,11 +733,8 @@ int main_view(int argc, char** argv) {
         if (!input_json) {
             if (output_type == "json") {
                 // convert values to printable ones
-                function<void(Locus&)> lambda = [](Locus& l) {
-                    cout << pb2json(l) << "\n";
-                };
                 get_input_file(file_name, [&](istream& in) {
-                    stream::for_each(in, lambda);
+                    stream_to_json<Locus>(in, cout);
                 });
             } else {
                 // todo
@@ -748,11 +754,8 @@ int main_view(int argc, char** argv) {
         return 0;
     } else if (input_type == "snarls") {
         if (output_type == "json") {
-            function<void(Snarl&)> lambda = [](Snarl& s) {
-                cout << pb2json(s) << "\n";
-            };
             get_input_file(file_name, [&](istream& in) {
-                stream::for_each(in, lambda);
+                stream_to_json<Snarl>(in, cout);
             });
         } else {
             cerr << "[vg view] error: (binary) Snarls can only be converted to JSON" << endl;
@@ -805,7 +808,9 @@ int main_view(int argc, char** argv) {
                       ascii_labels,
                       seed_val);
     } else if (output_type == "json") {
-        cout << pb2json(graph->graph) << endl;
+        ProtoJSONWriter writer;
+        writer.write(graph->graph);
+        cout << writer.str() << endl;
     } else if (output_type == "gfa") {
         graph_to_gfa(graph, std::cout);
     } else if (output_type == "turtle") {
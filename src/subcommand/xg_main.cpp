@@ -20,6 +20,7 @@
 #include "../xg.hpp"
 #include "../region.hpp"
 #include "../handle_to_vg.hpp"
+#include "../gfa.hpp"
 
 using namespace std;
 using namespace vg;
@@ -32,10 +33,12 @@ void help_xg(char** argv) {
          << endl
          << "options:" << endl
          << "    -v, --vg FILE              compress graph in vg FILE" << endl
+         << "    -g, --gfa-in FILE          compress graph in blunt-ended GFA FILE, streaming it in one pass" << endl
          << "    -V, --validate             validate compression" << endl
          << "    -o, --out FILE             serialize graph to FILE in xg format" << endl
          << "    -i, --in FILE              use index in FILE" << endl
          << "    -X, --extract-vg FILE      serialize graph to FILE in vg format" << endl
+         << "    -G, --gfa-out FILE         serialize graph to FILE in GFA format" << endl
          << "    -n, --node ID              graph neighborhood around node with ID" << endl
          << "    -c, --context N            steps of context to extract when building neighborhood" << endl
          << "    -s, --node-seq ID          provide node sequence for ID" << endl
@@ -66,6 +69,8 @@ int main_xg(int argc, char** argv) {
 
     string vg_in;
     string vg_out;
+    string gfa_in;
+    string gfa_out;
     string out_name;
     string in_name;
     int64_t node_id;
@@ -99,6 +104,8 @@ int main_xg(int argc, char** argv) {
                 {"out", required_argument, 0, 'o'},
                 {"in", required_argument, 0, 'i'},
                 {"extract-vg", required_argument, 0, 'X'},
+                {"gfa-in", required_argument, 0, 'g'},
+                {"gfa-out", required_argument, 0, 'G'},
                 {"node", required_argument, 0, 'n'},
                 {"char", required_argument, 0, 'P'},
                 {"substr", required_argument, 0, 'F'},
@@ -123,7 +130,7 @@ int main_xg(int argc, char** argv) {
             };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hv:o:i:X:f:t:s:c:n:p:DxrdTO:S:E:VR:P:F:b:",
+        c = getopt_long (argc, argv, "hv:o:i:X:g:G:f:t:s:c:n:p:DxrdTO:S:E:VR:P:F:b:",
                          long_options, &option_index);
 
         // Detect the end of the options.
@@ -232,6 +239,14 @@ int main_xg(int argc, char** argv) {
             b_array_name = optarg;
             break;
             
+        case 'g':
+            gfa_in = optarg;
+            break;
+            
+        case 'G':
+            gfa_out = optarg;
+            break;
+            
         case 'h':
         case '?':
             help_xg(argv);
@@ -245,8 +260,32 @@ int main_xg(int argc, char** argv) {
 
     XG* graph = nullptr;
     //string file_name = argv[optind];
-    if (in_name.empty()) assert(!vg_in.empty());
-    if (vg_in == "-") {
+    if (in_name.empty() && gfa_in.empty()) assert(!vg_in.empty());
+    if (!gfa_in.empty()) {
+        // Stream the GFA straight into the index without building a VG
+        function<void(istream&)> build_from_gfa = [&](istream& in) {
+            graph = new XG;
+            graph->from_callback([&](function<void(Graph&)> callback) {
+                if (!gfa_for_each_chunk(in, callback)) {
+                    cerr << "error [vg xg] GFA " << gfa_in << " is malformed, is not blunt-ended, refers to "
+                         << "missing segments, or has non-numeric segment names and is not a file; "
+                         << "convert it with vg view -Fv first" << endl;
+                    exit(1);
+                }
+            }, validate_graph, print_graph, store_threads, is_sorted_dag);
+        };
+        if (gfa_in == "-") {
+            build_from_gfa(std::cin);
+        } else {
+            ifstream in;
+            in.open(gfa_in.c_str());
+            if (!in) {
+                cerr << "error [vg xg] could not open " << gfa_in << endl;
+                return 1;
+            }
+            build_from_gfa(in);
+        }
+    } else if (vg_in == "-") {
         graph = new XG;
         graph->from_stream(std::cin, validate_graph, print_graph, store_threads, is_sorted_dag);
     } else if (vg_in.size()) {
@@ -307,6 +346,22 @@ int main_xg(int argc, char** argv) {
         }
     }
 
+    if (!gfa_out.empty()) {
+        if (graph == nullptr) {
+             cerr << "error [vg xg] no xg graph exists to convert; Try: vg xg -i graph.xg -G graph.gfa" << endl;
+             return 1;
+        }
+        if (gfa_out == "-") {
+            graph_to_gfa(graph, std::cout);
+            std::cout.flush();
+        } else {
+            ofstream out;
+            out.open(gfa_out.c_str());
+            graph_to_gfa(graph, out);
+            out.flush();
+        }
+    }
+
     if (!out_name.empty()) {
         if (out_name == "-") {
             graph->serialize(std::cout, structure.get(), "xg");
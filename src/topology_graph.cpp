@@ -0,0 +1,250 @@
+#include "topology_graph.hpp"
+#include "stream.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <omp.h>
+
+/** \file topology_graph.cpp
+ * Implement the TopologyGraph and NodeIdTranslation.
+ */
+
+namespace vg {
+
+using namespace std;
+
+TopologyGraph::TopologyGraph(istream& in) {
+    // Each thread collects the chunks it reads, and then we put them together.
+    vector<TopologyGraph> thread_graphs(omp_get_max_threads());
+    stream::for_each_parallel<Graph>(in, [&](Graph& chunk) {
+        thread_graphs[omp_get_thread_num()].add_chunk(chunk);
+    });
+    for (auto& thread_graph : thread_graphs) {
+        merge(thread_graph);
+        thread_graph = TopologyGraph();
+    }
+    finish();
+}
+
+void TopologyGraph::add_chunk(const Graph& chunk) {
+    for (auto& node : chunk.node()) {
+        pending_nodes.emplace_back(node.id(), node.sequence().size());
+    }
+    for (auto& edge : chunk.edge()) {
+        // Leaving from the start of a node is like leaving the end of its
+        // reverse, and arriving at its end is like arriving at the start of
+        // its reverse.
+        pending_edges.push_back(PendingEdge{edge.from() << 1 | edge.from_start(), edge.to() << 1 | edge.to_end()});
+    }
+}
+
+void TopologyGraph::merge(const TopologyGraph& other) {
+    pending_nodes.insert(pending_nodes.end(), other.pending_nodes.begin(), other.pending_nodes.end());
+    pending_edges.insert(pending_edges.end(), other.pending_edges.begin(), other.pending_edges.end());
+}
+
+void TopologyGraph::finish() {
+    // Index the nodes
+    sort(pending_nodes.begin(), pending_nodes.end());
+    pending_nodes.erase(unique(pending_nodes.begin(), pending_nodes.end(), [](const pair<id_t, size_t>& a,
+                                                                             const pair<id_t, size_t>& b) {
+        return a.first == b.first;
+    }), pending_nodes.end());
+    ids.clear();
+    lengths.clear();
+    ids.reserve(pending_nodes.size());
+    lengths.reserve(pending_nodes.size());
+    for (auto& node : pending_nodes) {
+        ids.push_back(node.first);
+        lengths.push_back(node.second);
+    }
+    vector<pair<id_t, size_t>>().swap(pending_nodes);
+
+    // Turn the edge ends into handles, and store each edge from both of the
+    // handles it leaves the right side of.
+    vector<pair<int64_t, int64_t>> right_edges;
+    right_edges.reserve(pending_edges.size() * 2);
+    for (auto& edge : pending_edges) {
+        size_t from_index = index_of(edge.from >> 1);
+        size_t to_index = index_of(edge.to >> 1);
+        if (from_index == ids.size() || to_index == ids.size()) {
+            // The edge dangles off the graph
+            continue;
+        }
+        int64_t from = from_index << 1 | (edge.from & 1);
+        int64_t to = to_index << 1 | (edge.to & 1);
+        right_edges.emplace_back(from, to);
+        right_edges.emplace_back(to ^ 1, from ^ 1);
+    }
+    vector<PendingEdge>().swap(pending_edges);
+
+    // Deduplicate, which also takes care of reversing self loops that we got
+    // from both ends.
+    sort(right_edges.begin(), right_edges.end());
+    right_edges.erase(unique(right_edges.begin(), right_edges.end()), right_edges.end());
+
+    right_offsets.assign(ids.size() * 2 + 1, 0);
+    right_neighbors.resize(right_edges.size());
+    for (size_t i = 0; i < right_edges.size(); i++) {
+        right_offsets[right_edges[i].first + 1]++;
+        right_neighbors[i] = right_edges[i].second;
+    }
+    for (size_t i = 1; i < right_offsets.size(); i++) {
+        right_offsets[i] += right_offsets[i - 1];
+    }
+}
+
+size_t TopologyGraph::index_of(id_t node_id) const {
+    auto found = lower_bound(ids.begin(), ids.end(), node_id);
+    if (found == ids.end() || *found != node_id) {
+        return ids.size();
+    }
+    return found - ids.begin();
+}
+
+handle_t TopologyGraph::get_handle(const id_t& node_id, bool is_reverse) const {
+    return as_handle((int64_t) (index_of(node_id) << 1 | is_reverse));
+}
+
+id_t TopologyGraph::get_id(const handle_t& handle) const {
+    return ids[as_integer(handle) >> 1];
+}
+
+bool TopologyGraph::get_is_reverse(const handle_t& handle) const {
+    return as_integer(handle) & 1;
+}
+
+handle_t TopologyGraph::flip(const handle_t& handle) const {
+    return as_handle(as_integer(handle) ^ 1);
+}
+
+size_t TopologyGraph::get_length(const handle_t& handle) const {
+    return lengths[as_integer(handle) >> 1];
+}
+
+string TopologyGraph::get_sequence(const handle_t& handle) const {
+    throw runtime_error("TopologyGraph does not store node sequences");
+}
+
+bool TopologyGraph::follow_edges(const handle_t& handle, bool go_left,
+                                 const function<bool(const handle_t&)>& iteratee) const {
+    // Going left from a handle is going right from its reverse, and flipping
+    // what we find.
+    int64_t start = go_left ? as_integer(handle) ^ 1 : as_integer(handle);
+    for (size_t i = right_offsets[start]; i < right_offsets[start + 1]; i++) {
+        int64_t other = go_left ? right_neighbors[i] ^ 1 : right_neighbors[i];
+        if (!iteratee(as_handle(other))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TopologyGraph::for_each_handle(const function<bool(const handle_t&)>& iteratee, bool parallel) const {
+    if (parallel) {
+        // The lambda function will let us know if we're bailing early.
+        bool stop_early = false;
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t i = 0; i < ids.size(); i++) {
+            bool stop;
+#pragma omp atomic read
+            stop = stop_early;
+            if (stop) {
+                continue;
+            }
+            if (!iteratee(as_handle((int64_t) (i << 1)))) {
+#pragma omp atomic write
+                stop_early = true;
+            }
+        }
+    }
+    else {
+        for (size_t i = 0; i < ids.size(); i++) {
+            if (!iteratee(as_handle((int64_t) (i << 1)))) {
+                break;
+            }
+        }
+    }
+}
+
+size_t TopologyGraph::node_size() const {
+    return ids.size();
+}
+
+bool TopologyGraph::has_node(id_t node_id) const {
+    return binary_search(ids.begin(), ids.end(), node_id);
+}
+
+const vector<id_t>& TopologyGraph::node_ids() const {
+    return ids;
+}
+
+NodeIdTranslation::NodeIdTranslation(const TopologyGraph& graph, const vector<handle_t>& order, id_t offset) :
+    old_ids(graph.node_ids()), new_ids(old_ids.size(), 0) {
+
+    if (order.size() != old_ids.size()) {
+        throw runtime_error("NodeIdTranslation: order has " + to_string(order.size()) + " nodes but graph has "
+                            + to_string(old_ids.size()));
+    }
+
+    for (size_t i = 0; i < order.size(); i++) {
+        // Handles in a TopologyGraph are node indexes and orientations
+        new_ids[as_integer(order[i]) >> 1] = i + 1 + offset;
+    }
+}
+
+id_t NodeIdTranslation::translate(id_t old_id) const {
+    auto found = lower_bound(old_ids.begin(), old_ids.end(), old_id);
+    if (found == old_ids.end() || *found != old_id) {
+        return 0;
+    }
+    return new_ids[found - old_ids.begin()];
+}
+
+void NodeIdTranslation::apply(Graph& chunk) const {
+    // Renumber everything that we can
+    auto renumber = [&](id_t old_id) {
+        id_t new_id = translate(old_id);
+        return new_id ? new_id : old_id;
+    };
+    for (auto& node : *chunk.mutable_node()) {
+        node.set_id(renumber(node.id()));
+    }
+    for (auto& edge : *chunk.mutable_edge()) {
+        edge.set_from(renumber(edge.from()));
+        edge.set_to(renumber(edge.to()));
+    }
+    for (auto& path : *chunk.mutable_path()) {
+        for (auto& mapping : *path.mutable_mapping()) {
+            mapping.mutable_position()->set_node_id(renumber(mapping.position().node_id()));
+        }
+    }
+
+    // And put the nodes in their new order
+    sort(chunk.mutable_node()->begin(), chunk.mutable_node()->end(), [](const Node& a, const Node& b) {
+        return a.id() < b.id();
+    });
+}
+
+bool NodeIdTranslation::apply(Alignment& aln) const {
+    // Check every node first, so we don't half-renumber anything
+    for (auto& mapping : aln.path().mapping()) {
+        if (mapping.position().node_id() != 0 && translate(mapping.position().node_id()) == 0) {
+            return false;
+        }
+    }
+    for (auto& mapping : *aln.mutable_path()->mutable_mapping()) {
+        if (mapping.position().node_id() != 0) {
+            mapping.mutable_position()->set_node_id(translate(mapping.position().node_id()));
+        }
+    }
+    return true;
+}
+
+void NodeIdTranslation::write_tsv(ostream& out) const {
+    for (size_t i = 0; i < old_ids.size(); i++) {
+        out << old_ids[i] << "\t" << new_ids[i] << "\n";
+    }
+}
+
+}
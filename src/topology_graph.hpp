@@ -0,0 +1,166 @@
+#ifndef VG_TOPOLOGY_GRAPH_HPP_INCLUDED
+#define VG_TOPOLOGY_GRAPH_HPP_INCLUDED
+
+/** \file topology_graph.hpp
+ * A compact, sequence-free HandleGraph for working out node orders on graphs
+ * too big to load as a VG, and a table for renumbering nodes to match.
+ */
+
+#include <vector>
+#include <iostream>
+
+#include "handle.hpp"
+#include "vg.pb.h"
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * A read-only HandleGraph holding only the topology of a graph: node IDs,
+ * node lengths, and edges. Edges live in one flat adjacency array, indexed by
+ * handle, so the whole thing takes a few machine words per node and edge.
+ * Node sequences are not kept, so get_sequence() throws.
+ *
+ * Build it by adding Graph chunks and then calling finish(), or straight from
+ * a stream of Graph chunks. Edges to nodes that never appear are dropped.
+ */
+class TopologyGraph : public HandleGraph {
+public:
+
+    /// Make an empty graph, to add chunks to
+    TopologyGraph() = default;
+
+    /// Read the topology from a stream of Graph chunks, in parallel
+    TopologyGraph(istream& in);
+
+    /// Add the nodes and edges of a chunk of a graph. Edges may refer to
+    /// nodes in other chunks. Must be called before finish().
+    void add_chunk(const Graph& chunk);
+
+    /// Add all the nodes and edges added to another unfinished graph. Must be
+    /// called before finish().
+    void merge(const TopologyGraph& other);
+
+    /// Index the nodes and edges added so far. Must be called once, before
+    /// the graph is used.
+    void finish();
+
+    //////////////////////////
+    /// HandleGraph interface
+    //////////////////////////
+
+    /// Look up the handle for the node with the given ID in the given orientation
+    virtual handle_t get_handle(const id_t& node_id, bool is_reverse = false) const;
+    // Copy over the visit version which would otherwise be shadowed.
+    using HandleGraph::get_handle;
+
+    /// Get the ID from a handle
+    virtual id_t get_id(const handle_t& handle) const;
+
+    /// Get the orientation of a handle
+    virtual bool get_is_reverse(const handle_t& handle) const;
+
+    /// Invert the orientation of a handle (potentially without getting its ID)
+    virtual handle_t flip(const handle_t& handle) const;
+
+    /// Get the length of a node
+    virtual size_t get_length(const handle_t& handle) const;
+
+    /// Sequences are not stored, so this throws.
+    virtual string get_sequence(const handle_t& handle) const;
+
+    /// Loop over all the handles to next/previous (right/left) nodes. Passes
+    /// them to a callback which returns false to stop iterating and true to
+    /// continue. Returns true if we finished and false if we stopped early.
+    virtual bool follow_edges(const handle_t& handle, bool go_left, const function<bool(const handle_t&)>& iteratee) const;
+
+    // Copy over the template for nice calls
+    using HandleGraph::follow_edges;
+
+    /// Loop over all the nodes in their local forward orientations, in
+    /// ascending order of ID. Stop if the iteratee returns false.
+    virtual void for_each_handle(const function<bool(const handle_t&)>& iteratee, bool parallel = false) const;
+
+    // Copy over the template for nice calls
+    using HandleGraph::for_each_handle;
+
+    /// Return the number of nodes in the graph
+    virtual size_t node_size() const;
+
+    //////////////////////////
+    /// Topology methods
+    //////////////////////////
+
+    /// Is there a node with this ID?
+    bool has_node(id_t node_id) const;
+
+    /// The IDs of the nodes, in ascending order
+    const vector<id_t>& node_ids() const;
+
+private:
+
+    /// An edge as it was added, with each end as an ID shifted left by one
+    /// with the orientation in the low bit
+    struct PendingEdge {
+        int64_t from;
+        int64_t to;
+    };
+
+    /// Nodes and edges added but not yet indexed
+    vector<pair<id_t, size_t>> pending_nodes;
+    vector<PendingEdge> pending_edges;
+
+    /// The sorted, deduplicated IDs of the nodes
+    vector<id_t> ids;
+    /// The lengths of the nodes, in the same order
+    vector<size_t> lengths;
+
+    /// For each handle (node index * 2 + orientation), where its handles to
+    /// the right start in right_neighbors. Has one extra entry at the end.
+    vector<size_t> right_offsets;
+    /// The handles to the right of each handle
+    vector<int64_t> right_neighbors;
+
+    /// Get the index of the node with the given ID, or ids.size() if there is
+    /// no such node
+    size_t index_of(id_t node_id) const;
+};
+
+/**
+ * A table of new IDs for the nodes of a graph, to renumber a graph (and the
+ * alignments to it) one chunk at a time. Applying it is thread-safe.
+ */
+class NodeIdTranslation {
+public:
+
+    /// Number the nodes of the graph 1, 2, 3, ... plus the given offset, in
+    /// the given order, which must include every node once.
+    NodeIdTranslation(const TopologyGraph& graph, const vector<handle_t>& order, id_t offset = 0);
+
+    /// Get the new ID for a node, or 0 if the node isn't in the table
+    id_t translate(id_t old_id) const;
+
+    /// Renumber the nodes, edges and path mappings in a chunk of the graph,
+    /// and order its nodes by their new IDs. Anything on nodes not in the
+    /// table is left alone.
+    void apply(Graph& chunk) const;
+
+    /// Renumber the nodes visited by an alignment. Returns false and leaves
+    /// the rest of the alignment alone if it visits a node not in the table.
+    bool apply(Alignment& aln) const;
+
+    /// Write the table as tab-separated old and new IDs, in order of old ID
+    void write_tsv(ostream& out) const;
+
+private:
+
+    /// The old IDs, in ascending order
+    vector<id_t> old_ids;
+    /// The new ID for each old ID
+    vector<id_t> new_ids;
+};
+
+}
+
+#endif
@@ -25,33 +25,95 @@ void Translator::load(const vector<Translation>& trans) {
 }
 
 void Translator::build_position_table(void) {
-    //map<pos_t, Translation*> pos_to_trans;
-    for (auto& t : translations) {
+    starts.clear();
+    node_strand_rank.clear();
+    starts.reserve(translations.size());
+    for (size_t i = 0; i < translations.size(); i++) {
         // map from the new positions to the corresponding translations
-        pos_to_trans[make_pos_t(t.to().mapping(0).position())] = &t;
+        auto& pos = translations[i].to().mapping(0).position();
+        starts.push_back(TranslationStart{pos.node_id(), pos.is_reverse(), (off_t) pos.offset(), i});
     }
+    
+    // sort by position, and when several translations start at the same
+    // position let the last one win
+    auto key_less = [](const TranslationStart& a, const TranslationStart& b) {
+        return make_tuple(a.node_id, a.is_reverse, a.offset) < make_tuple(b.node_id, b.is_reverse, b.offset);
+    };
+    stable_sort(starts.begin(), starts.end(), key_less);
+    size_t kept = 0;
+    for (size_t i = 0; i < starts.size(); i++) {
+        if (kept > 0 && !key_less(starts[kept - 1], starts[i])) {
+            starts[kept - 1] = starts[i];
+        } else {
+            starts[kept++] = starts[i];
+        }
+    }
+    starts.resize(kept);
+    
+    if (starts.empty()) {
+        return;
+    }
+    
+    // build the rank table over the node strands, unless the IDs are so
+    // sparse that it would be much bigger than the starts themselves
+    min_id = starts.front().node_id;
+    id_t max_id = starts.back().node_id;
+    if (max_id - min_id > 4 * (id_t) starts.size() + 1024) {
+        return;
+    }
+    size_t slots = 2 * (max_id - min_id + 1);
+    node_strand_rank.resize(slots + 1);
+    size_t next = 0;
+    for (size_t slot = 0; slot <= slots; slot++) {
+        // advance past the starts that belong to earlier slots
+        while (next < starts.size() && 2 * (size_t) (starts[next].node_id - min_id) + starts[next].is_reverse < slot) {
+            next++;
+        }
+        node_strand_rank[slot] = next;
+    }
+}
+
+pair<size_t, size_t> Translator::node_strand_starts(id_t node_id, bool is_reverse) const {
+    if (!node_strand_rank.empty()) {
+        if (node_id < min_id || 2 * (size_t) (node_id - min_id) + 1 >= node_strand_rank.size() - 1) {
+            return make_pair(0, 0);
+        }
+        size_t slot = 2 * (node_id - min_id) + is_reverse;
+        return make_pair(node_strand_rank[slot], node_strand_rank[slot + 1]);
+    }
+    auto range = equal_range(starts.begin(), starts.end(), TranslationStart{node_id, is_reverse, 0, 0},
+        [](const TranslationStart& a, const TranslationStart& b) {
+            return make_pair(a.node_id, a.is_reverse) < make_pair(b.node_id, b.is_reverse);
+        });
+    return make_pair(range.first - starts.begin(), range.second - starts.begin());
 }
 
 bool Translator::has_translation(const Position& position, bool ignore_strand) {
-    auto pos = make_pos_t(position);
-    pos_t node_only = pos;
-    get_offset(node_only) = 0;
-    get_is_rev(node_only) = ignore_strand ? false : position.is_reverse();
-    return pos_to_trans.find(node_only) != pos_to_trans.end();
+    auto range = node_strand_starts(position.node_id(), ignore_strand ? false : position.is_reverse());
+    return range.first != range.second && starts[range.first].offset == 0;
 }
 
-Translation Translator::get_translation(const Position& position) {
-    auto pos = make_pos_t(position);
+const Translation* Translator::find_translation(const Position& position) const {
     // check that the node is in the translation
-    pos_t node_only = pos;
-    get_offset(node_only) = 0;
-    get_is_rev(node_only) = position.is_reverse();
+    auto range = node_strand_starts(position.node_id(), position.is_reverse());
+    if (range.first == range.second || starts[range.first].offset != 0) {
+        return nullptr;
+    }
+    // find the last translation starting at or before the position
+    auto after = upper_bound(starts.begin() + range.first, starts.begin() + range.second, (off_t) position.offset(),
+        [](off_t offset, const TranslationStart& start) {
+            return offset < start.offset;
+        });
+    return &translations[(after - 1)->translation];
+}
+
+Translation Translator::get_translation(const Position& position) {
     Translation translation;
-    if (pos_to_trans.find(node_only) == pos_to_trans.end()) {
-        cerr << "WARNING: node " << id(pos) << " is not in the translation table" << endl;
+    const Translation* found = find_translation(position);
+    if (found == nullptr) {
+        cerr << "WARNING: node " << position.node_id() << " is not in the translation table" << endl;
     } else {
-        auto t = pos_to_trans.upper_bound(pos); --t;
-        translation = *t->second;
+        translation = *found;
     }
     return translation;
 }
@@ -82,7 +144,13 @@ Position Translator::translate(const Position& position, const Translation& tran
 Mapping Translator::translate(const Mapping& mapping) {
     Mapping translated = mapping;
     if (!mapping.has_position()) return mapping;
-    Translation translation = get_translation(mapping.position());
+    // look the translation up in place rather than copying it
+    const Translation* found = find_translation(mapping.position());
+    if (found == nullptr) {
+        cerr << "WARNING: node " << mapping.position().node_id() << " is not in the translation table" << endl;
+        found = &Translation::default_instance();
+    }
+    const Translation& translation = *found;
     *translated.mutable_position() = translate(mapping.position(), translation);
     if (is_match(translation)) {
         return translated;
@@ -29,12 +29,16 @@ class Translator {
 public:
 
     vector<Translation> translations;
-    map<pos_t, Translation*> pos_to_trans;
     Translator(void);
     Translator(istream& in);
     Translator(const vector<Translation>& trans);
     void load(const vector<Translation>& trans);
+    /// Index the translations by the positions they start at in the
+    /// to-graph. Must be called again if translations is modified.
     void build_position_table(void);
+    /// Find the translation covering the given to-graph position, or null
+    /// if the position's node is not in the table
+    const Translation* find_translation(const Position& position) const;
     Translation get_translation(const Position& position);
     bool has_translation(const Position& position, bool ignore_strand = true);
     Position translate(const Position& position);
@@ -45,6 +49,30 @@ public:
     Alignment translate(const Alignment& aln);
     Locus translate(const Locus& locus);
     Translation overlay(const Translation& trans);
+    
+private:
+
+    /// A translation, keyed by the to-graph position where it starts
+    struct TranslationStart {
+        id_t node_id;
+        bool is_reverse;
+        off_t offset;
+        size_t translation;
+    };
+    
+    /// The starts of all the translations, sorted by node ID, strand, and
+    /// offset, with one start per position
+    vector<TranslationStart> starts;
+    
+    /// When the node IDs are dense enough, entry 2 * (ID - min_id) + strand
+    /// is the index in starts of the first start on that node strand, and the
+    /// entry after it is the past-the-end index. This makes finding the
+    /// translations on a node constant time. Empty if the IDs are too sparse.
+    vector<size_t> node_strand_rank;
+    id_t min_id = 0;
+    
+    /// Get the range of starts on a node strand
+    pair<size_t, size_t> node_strand_starts(id_t node_id, bool is_reverse) const;
 };
 
 bool is_match(const Translation& translation);
@@ -0,0 +1,134 @@
+/**
+ * \file
+ * unittest/benchmark.cpp: test cases for comparing benchmark reports and running benchmark commands.
+ */
+
+#include "catch.hpp"
+
+#include "../benchmark.hpp"
+#include "../utility.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+namespace vg {
+namespace unittest {
+
+using namespace std;
+
+// make a result with the given test and control times, in microseconds
+static BenchmarkResult make_result(double test_mean, double test_stddev, double control_mean,
+                                   double control_stddev) {
+    BenchmarkResult result;
+    result.runs = 10;
+    result.test_mean = chrono::duration_cast<benchtime>(chrono::duration<double, micro>(test_mean));
+    result.test_stddev = chrono::duration_cast<benchtime>(chrono::duration<double, micro>(test_stddev));
+    result.control_mean = chrono::duration_cast<benchtime>(chrono::duration<double, micro>(control_mean));
+    result.control_stddev = chrono::duration_cast<benchtime>(chrono::duration<double, micro>(control_stddev));
+    result.name = "test";
+    return result;
+}
+
+TEST_CASE("Benchmark baselines are read from reports", "[benchmark]") {
+
+    SECTION("Scores and errors are found by name, for plain and end-to-end lines") {
+        stringstream report;
+        report << "# Benchmark results for vg v1.0" << endl;
+        report << "# runs\ttest(us)\tstddev(us)\tcontrol(us)\tstddev(us)\tscore\terr\tname" << endl;
+        report << "1000\t1.00e+01\t1.00e+00\t2.00e+01\t1.00e+00\t2000.00\t50.00\tVG::get_node" << endl;
+        report << endl;
+        report << "5\t1.00e+05\t1.00e+03\t2.00e+01\t1.00e+00\t0.20\t0.01\tend-to-end gam read"
+               << "\t1\t5000.0\t100000.0\t." << endl;
+        report << "5\t1.00e+05\t1.00e+03\t2.00e+01\t1.00e+00\t0.30\t0.02\tend-to-end vg map 2 threads"
+               << "\t2\t7000.0\t150000.0\t123456" << endl;
+
+        BenchmarkBaseline baseline = load_benchmark_baseline(report);
+        REQUIRE(baseline.size() == 3);
+        REQUIRE(baseline.at("VG::get_node") == make_pair(2000.0, 50.0));
+        REQUIRE(baseline.at("end-to-end gam read") == make_pair(0.2, 0.01));
+        REQUIRE(baseline.at("end-to-end vg map 2 threads") == make_pair(0.3, 0.02));
+    }
+
+    SECTION("A report written out can be read back") {
+        BenchmarkResult result = make_result(10.0, 1.0, 20.0, 2.0);
+        stringstream report;
+        report << result << endl;
+
+        BenchmarkBaseline baseline = load_benchmark_baseline(report);
+        REQUIRE(baseline.size() == 1);
+        REQUIRE(baseline.at("test").first == Approx(result.score()).epsilon(0.01));
+        REQUIRE(baseline.at("test").second == Approx(result.score_error()).epsilon(0.01));
+    }
+
+    SECTION("Lines with too few columns are rejected") {
+        stringstream report;
+        report << "1000\t1.00e+01\t1.00e+00\t2.00e+01\t1.00e+00\t2000.00\t50.00" << endl;
+        REQUIRE_THROWS(load_benchmark_baseline(report));
+    }
+}
+
+TEST_CASE("Score significance is measured in combined standard errors", "[benchmark]") {
+
+    // Twice as fast as the control scores 2000
+    BenchmarkResult result = make_result(10.0, 0.0, 20.0, 0.0);
+    REQUIRE(result.score() == Approx(2000.0));
+    REQUIRE(result.score_error() == 0.0);
+
+    SECTION("Errors on both sides add in quadrature") {
+        BenchmarkResult noisy = make_result(10.0, 1.0, 20.0, 0.0);
+        // Relative error of 10% on the test time
+        REQUIRE(noisy.score_error() == Approx(200.0));
+        // Combined error is sqrt(200^2 + 150^2) = 250
+        REQUIRE(score_significance(noisy, make_pair(1500.0, 150.0)) == Approx(2.0));
+        REQUIRE(score_significance(noisy, make_pair(2500.0, 150.0)) == Approx(-2.0));
+        REQUIRE(score_significance(noisy, make_pair(2000.0, 150.0)) == Approx(0.0));
+    }
+
+    SECTION("Differences without any error are infinitely significant") {
+        REQUIRE(score_significance(result, make_pair(1000.0, 0.0)) == numeric_limits<double>::infinity());
+        REQUIRE(score_significance(result, make_pair(3000.0, 0.0)) == -numeric_limits<double>::infinity());
+        REQUIRE(score_significance(result, make_pair(2000.0, 0.0)) == 0.0);
+    }
+}
+
+TEST_CASE("Benchmark commands run in their own process", "[benchmark]") {
+
+    string out_name = temp_file::create();
+    size_t child_peak_rss_kb = 0;
+
+    SECTION("Output and exit status come from the command") {
+        REQUIRE(run_benchmark_command({"sh", "-c", "echo hello; exit 3"}, out_name, child_peak_rss_kb) == 3);
+        REQUIRE(child_peak_rss_kb > 0);
+        ifstream out(out_name);
+        string line;
+        REQUIRE(getline(out, line));
+        REQUIRE(line == "hello");
+    }
+
+    SECTION("Commands that can't run fail") {
+        REQUIRE(run_benchmark_command({"/nonexistent/vg-benchmark-command"}, out_name, child_peak_rss_kb) != 0);
+    }
+
+    temp_file::remove(out_name);
+}
+
+TEST_CASE("Peak memory use can be measured again after a reset", "[benchmark]") {
+
+    // Use and then free 64 MiB
+    {
+        vector<char> buffer(64 << 20, 1);
+        REQUIRE(buffer.back() == 1);
+    }
+    size_t with_buffer = peak_rss_kb();
+    REQUIRE(with_buffer >= (64 << 10));
+    if (reset_peak_rss()) {
+        // The buffer no longer counts
+        REQUIRE(peak_rss_kb() + (32 << 10) < with_buffer);
+    }
+}
+
+}
+}
@@ -0,0 +1,113 @@
+/// \file fastq_reader.cpp
+///
+/// Unit tests for the buffered FASTQ reader
+///
+
+#include "../fastq_reader.hpp"
+#include "../utility.hpp"
+#include "catch.hpp"
+
+#include <htslib/bgzf.h>
+
+#include <fstream>
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+static const string fastq_data = "@read1 some comment\n"
+                                 "GATTACA\n"
+                                 "+\n"
+                                 "IIIIIII\n"
+                                 "@read2/1\n"
+                                 "ACGTACGTACGTACGTACGTACGTACGTACGT\n"
+                                 "+read2/1\n"
+                                 "!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!+\n";
+
+static void check_records(FastqReader& reader) {
+    Alignment aln;
+
+    REQUIRE(reader.next(aln));
+    REQUIRE(aln.name() == "read1");
+    REQUIRE(aln.sequence() == "GATTACA");
+    REQUIRE(aln.quality() == string(7, 40));
+
+    REQUIRE(reader.next(aln));
+    REQUIRE(aln.name() == "read2/1");
+    REQUIRE(aln.sequence() == "ACGTACGTACGTACGTACGTACGTACGTACGT");
+    string quality(32, 0);
+    quality.back() = 10;
+    REQUIRE(aln.quality() == quality);
+
+    REQUIRE(!reader.next(aln));
+}
+
+TEST_CASE("FastqReader reads uncompressed FASTQ", "[fastq]") {
+    string filename = temp_file::create();
+    {
+        ofstream out(filename);
+        out << fastq_data;
+    }
+
+    SECTION("with a large buffer") {
+        FastqReader reader(filename);
+        check_records(reader);
+    }
+
+    SECTION("with a buffer smaller than a line") {
+        FastqReader reader(filename, 1, 4);
+        check_records(reader);
+    }
+
+    temp_file::remove(filename);
+}
+
+TEST_CASE("FastqReader tolerates a missing final newline and DOS line endings", "[fastq]") {
+    string filename = temp_file::create();
+    {
+        ofstream out(filename);
+        out << "@read1\r\nGATTACA\r\n+\r\nIIIIIII\r\n>read2\nCAT";
+    }
+
+    FastqReader reader(filename, 1, 8);
+    Alignment aln;
+
+    REQUIRE(reader.next(aln));
+    REQUIRE(aln.name() == "read1");
+    REQUIRE(aln.sequence() == "GATTACA");
+    REQUIRE(aln.quality().size() == 7);
+
+    REQUIRE(reader.next(aln));
+    REQUIRE(aln.name() == "read2");
+    REQUIRE(aln.sequence() == "CAT");
+    REQUIRE(aln.quality().empty());
+
+    REQUIRE(!reader.next(aln));
+
+    temp_file::remove(filename);
+}
+
+TEST_CASE("FastqReader reads BGZF-compressed FASTQ with decompression threads", "[fastq][bgzip]") {
+    string filename = temp_file::create();
+    BGZF* out = bgzf_open(filename.c_str(), "w");
+    REQUIRE(out != nullptr);
+    // write enough copies to span several blocks
+    for (size_t i = 0; i < 2000; i++) {
+        REQUIRE((size_t) bgzf_write(out, fastq_data.c_str(), fastq_data.size()) == fastq_data.size());
+    }
+    REQUIRE(bgzf_close(out) == 0);
+
+    FastqReader reader(filename, 4);
+    Alignment aln;
+    size_t count = 0;
+    while (reader.next(aln)) {
+        REQUIRE(aln.name() == (count % 2 == 0 ? "read1" : "read2/1"));
+        count++;
+    }
+    REQUIRE(count == 4000);
+
+    temp_file::remove(filename);
+}
+
+}
+}
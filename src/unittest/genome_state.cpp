@@ -863,6 +863,54 @@ TEST_CASE("GenomeState can hold and manipulate haplotypes", "[genomestate]") {
             
         }
         
+        SECTION("Deleting the haplotype can be rolled back") {
+            state.start_recording();
+            size_t checkpoint = state.checkpoint();
+            
+            delete state.execute(undo);
+            REQUIRE(state.count_haplotypes(chromosome) == 0);
+            
+            state.rollback(checkpoint);
+            REQUIRE(state.count_haplotypes(chromosome) == 1);
+            
+            vector<handle_t> traced;
+            state.trace_haplotype(chromosome, 0, [&](const handle_t& visit) {
+                traced.push_back(visit);
+            });
+            REQUIRE(traced.size() == 6);
+            REQUIRE(traced[0] == graph.get_handle(1, false));
+            REQUIRE(traced[2] == graph.get_handle(3, false));
+            REQUIRE(traced[3] == graph.get_handle(5, false));
+            REQUIRE(traced[5] == graph.get_handle(8, false));
+            
+            state.stop_recording();
+        }
+        
+        SECTION("Proposed commands can be scored without being kept") {
+            vector<double> scores = state.score_commands({undo}, [&](const GenomeState& proposed) {
+                return (double) proposed.count_haplotypes(chromosome);
+            });
+            
+            REQUIRE(scores.size() == 1);
+            REQUIRE(scores[0] == 0.0);
+            REQUIRE(state.count_haplotypes(chromosome) == 1);
+        }
+        
+        SECTION("Alignments can be scored against the haplotype") {
+            MultipathAlignment on_haplotype;
+            json2pb(on_haplotype, R"({"sequence":"GCATG","subpath":[{"path":{"mapping":[)"
+                R"({"position":{"node_id":1},"edit":[{"from_length":3,"to_length":3}]},)"
+                R"({"position":{"node_id":2},"edit":[{"from_length":1,"to_length":1}]},)"
+                R"({"position":{"node_id":3},"edit":[{"from_length":1,"to_length":1}]}]},"score":5}],"start":[0]})");
+            REQUIRE(state.optimal_score_on_genome(on_haplotype) == 5);
+            
+            MultipathAlignment off_haplotype;
+            json2pb(off_haplotype, R"({"sequence":"GCTGA","subpath":[{"path":{"mapping":[)"
+                R"({"position":{"node_id":3},"edit":[{"from_length":1,"to_length":1}]},)"
+                R"({"position":{"node_id":4},"edit":[{"from_length":4,"to_length":4}]}]},"score":5}],"start":[0]})");
+            REQUIRE(state.optimal_score_on_genome(off_haplotype) == 0);
+        }
+        
         SECTION("The added haplotype can be deleted again") {
             GenomeStateCommand* undelete = state.execute(undo);
             
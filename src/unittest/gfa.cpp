@@ -596,5 +596,197 @@ P	2	ref	2	+	3M)";
 
 
         
+TEST_CASE("Can stream blunt-ended GFA 0.1 and GFA 1.0 into a graph", "[gfa]") {
+
+    const string graph_gfa_oneline = R"(H	VN:Z:1.0
+S	1	CAAATAAG
+S	2	A
+S	3	G
+P	x	1+,3-	8M,1M
+L	1	+	2	+	0M
+L	1	+	3	-	0M)";
+
+    const string graph_gfa_multiline = R"(H	VN:Z:0.1
+S	1	CAAATAAG
+S	2	A
+S	3	G
+P	3	x	2	-	1M
+P	1	x	1	+	8M
+L	1	+	2	+	*
+L	1	+	3	-	0M)";
+
+    for (auto& graph_gfa : {graph_gfa_oneline, graph_gfa_multiline}) {
+        
+        VG vg;
+        stringstream in(graph_gfa);
+        REQUIRE(blunt_gfa_to_graph(in, &vg));
+        
+        REQUIRE(vg.is_valid());
+        REQUIRE(vg.node_count() == 3);
+        REQUIRE(vg.edge_count() == 2);
+        REQUIRE(vg.get_node(1)->sequence() == "CAAATAAG");
+        REQUIRE(vg.has_edge(NodeSide(1, true), NodeSide(3, true)));
+        
+        REQUIRE(vg.paths.has_path("x"));
+        auto path = vg.paths.path("x");
+        REQUIRE(path.mapping_size() == 2);
+        
+        REQUIRE(path.mapping(0).position().node_id() == 1);
+        REQUIRE(mapping_from_length(path.mapping(0)) == 8);
+        REQUIRE(path.mapping(0).position().is_reverse() == false);
+        
+        REQUIRE(path.mapping(1).position().node_id() == 3);
+        REQUIRE(mapping_from_length(path.mapping(1)) == 1);
+        REQUIRE(path.mapping(1).position().is_reverse() == true);
+    }
+}
+
+TEST_CASE("Streaming GFA import emits chunks and names non-numeric segments", "[gfa]") {
+
+    const string graph_gfa = R"(H	VN:Z:1.0
+S	chr1.a	GAT
+S	chr1.b	TACA
+S	chr1.c	C
+L	chr1.a	+	chr1.b	+	0M
+L	chr1.b	+	chr1.c	+	0M
+P	ref	chr1.a+,chr1.b+,chr1.c+	*)";
+
+    stringstream in(graph_gfa);
+    size_t chunks = 0;
+    VG vg;
+    REQUIRE(gfa_for_each_chunk(in, [&](Graph& chunk) {
+        REQUIRE(chunk.node_size() + chunk.edge_size() + chunk.path_size() <= 2);
+        vg.extend(chunk);
+        chunks++;
+    }, 2));
+    
+    REQUIRE(chunks == 3);
+    REQUIRE(vg.node_count() == 3);
+    REQUIRE(vg.get_node(1)->sequence() == "GAT");
+    REQUIRE(vg.get_node(2)->sequence() == "TACA");
+    REQUIRE(vg.get_node(3)->sequence() == "C");
+    REQUIRE(vg.has_edge(NodeSide(1, true), NodeSide(2, false)));
+    REQUIRE(vg.has_edge(NodeSide(2, true), NodeSide(3, false)));
+}
+
+TEST_CASE("Streaming GFA import numbers non-numeric segments in sorted order", "[gfa]") {
+
+    // Links and paths come first, and the segments are out of order.
+    const string graph_gfa = R"(H	VN:Z:1.0
+L	chr1.c	+	chr1.a	+	0M
+P	ref	chr1.c+,chr1.a+,chr1.b-	*
+L	chr1.a	+	chr1.b	-	0M
+S	chr1.c	C
+S	chr1.a	GAT
+S	chr1.b	TACA)";
+
+    VG vg;
+    stringstream in(graph_gfa);
+    REQUIRE(blunt_gfa_to_graph(in, &vg));
+    
+    REQUIRE(vg.is_valid());
+    REQUIRE(vg.node_count() == 3);
+    REQUIRE(vg.get_node(1)->sequence() == "GAT");
+    REQUIRE(vg.get_node(2)->sequence() == "TACA");
+    REQUIRE(vg.get_node(3)->sequence() == "C");
+    REQUIRE(vg.has_edge(NodeSide(3, true), NodeSide(1, false)));
+    REQUIRE(vg.has_edge(NodeSide(1, true), NodeSide(2, true)));
+    
+    auto path = vg.paths.path("ref");
+    REQUIRE(path.mapping_size() == 3);
+    REQUIRE(path.mapping(0).position().node_id() == 3);
+    REQUIRE(path.mapping(1).position().node_id() == 1);
+    REQUIRE(path.mapping(2).position().node_id() == 2);
+    REQUIRE(path.mapping(2).position().is_reverse() == true);
+}
+
+TEST_CASE("Streaming GFA import refuses links and paths to missing segments", "[gfa]") {
+
+    const string numeric_link_gfa = R"(H	VN:Z:1.0
+S	1	GAT
+L	1	+	2	+	0M
+S	3	C)";
+
+    const string numeric_path_gfa = R"(H	VN:Z:1.0
+S	1	GAT
+P	x	1+,4+	*)";
+
+    const string named_link_gfa = R"(H	VN:Z:1.0
+S	a	GAT
+S	b	C
+L	a	+	c	+	0M)";
+
+    for (auto& graph_gfa : {numeric_link_gfa, numeric_path_gfa, named_link_gfa}) {
+        stringstream in(graph_gfa);
+        size_t nodes = 0;
+        bool dangling = false;
+        bool success = gfa_for_each_chunk(in, [&](Graph& chunk) {
+            nodes += chunk.node_size();
+            for (auto& edge : chunk.edge()) {
+                dangling = dangling || edge.to() == 2 || edge.to() == 0;
+            }
+        });
+        REQUIRE(!success);
+        // Nothing dangling may ever be handed out
+        REQUIRE(!dangling);
+    }
+}
+
+TEST_CASE("Streaming GFA import refuses GFAs that need overlap resolution", "[gfa]") {
+
+    const string graph_gfa = R"(H	VN:Z:0.1
+S	1	GATTAC
+S	2	ATTACA
+L	1	+	2	+	5M
+P	1	ref	1	+	6M
+P	2	ref	2	+	6M)";
+    
+    VG vg;
+    stringstream in(graph_gfa);
+    REQUIRE(!blunt_gfa_to_graph(in, &vg));
+}
+
+TEST_CASE("GFA export from a handle graph can be streamed back in", "[gfa]") {
+
+    const string graph_gfa = R"(H	VN:Z:1.0
+S	1	CAAATAAG
+S	2	A
+S	3	G
+S	4	TTG
+P	x	1+,3-,4+	*
+L	1	+	2	+	0M
+L	1	+	3	-	0M
+L	2	+	4	+	0M
+L	3	-	4	+	0M)";
+
+    VG vg;
+    stringstream in(graph_gfa);
+    REQUIRE(blunt_gfa_to_graph(in, &vg));
+    
+    xg::XG index(vg.graph);
+    
+    stringstream out;
+    graph_to_gfa(&index, out);
+    
+    VG round_trip;
+    REQUIRE(blunt_gfa_to_graph(out, &round_trip));
+    
+    REQUIRE(round_trip.is_valid());
+    REQUIRE(round_trip.node_count() == vg.node_count());
+    REQUIRE(round_trip.edge_count() == vg.edge_count());
+    for (id_t id = 1; id <= 4; id++) {
+        REQUIRE(round_trip.get_node(id)->sequence() == vg.get_node(id)->sequence());
+    }
+    vg.for_each_edge([&](Edge* edge) {
+        REQUIRE(round_trip.has_edge(*edge));
+    });
+    
+    auto path = round_trip.paths.path("x");
+    REQUIRE(path.mapping_size() == 3);
+    REQUIRE(path.mapping(1).position().node_id() == 3);
+    REQUIRE(path.mapping(1).position().is_reverse() == true);
+    REQUIRE(mapping_from_length(path.mapping(2)) == 3);
+}
+
 }
 }
@@ -8,6 +8,7 @@
 #include "../handle.hpp"
 #include "../vg.hpp"
 #include "../xg.hpp"
+#include "../sub_handle_graph.hpp"
 #include "../json2pb.h"
 
 #include <iostream>
@@ -749,5 +750,79 @@ TEST_CASE("VG and XG path handle implementations are correct", "[handle][vg][xg]
     }
 }
 
+TEST_CASE("SubHandleGraph presents the subgraph induced by its nodes", "[handle][vg]") {
+    
+    VG vg;
+    
+    handle_t h1 = vg.create_handle("GATT");
+    handle_t h2 = vg.create_handle("A");
+    handle_t h3 = vg.create_handle("CA");
+    handle_t h4 = vg.create_handle("TTA");
+    
+    vg.create_edge(h1, h2);
+    vg.create_edge(h1, h3);
+    vg.create_edge(h2, h4);
+    vg.create_edge(h3, vg.flip(h4));
+    
+    // leave out node 2, and list the rest out of order with a duplicate
+    SubHandleGraph subgraph(&vg, vector<id_t>{vg.get_id(h4), vg.get_id(h1), vg.get_id(h3), vg.get_id(h1)});
+    
+    SECTION("It contains only the nodes it was given, in ID order") {
+        REQUIRE(subgraph.node_size() == 3);
+        REQUIRE(subgraph.has_node(vg.get_id(h1)));
+        REQUIRE(!subgraph.has_node(vg.get_id(h2)));
+        REQUIRE(subgraph.has_node(vg.get_id(h3)));
+        REQUIRE(subgraph.has_node(vg.get_id(h4)));
+        
+        vector<id_t> seen;
+        subgraph.for_each_handle([&](const handle_t& handle) {
+            REQUIRE(!subgraph.get_is_reverse(handle));
+            seen.push_back(subgraph.get_id(handle));
+        });
+        REQUIRE(seen == subgraph.node_ids());
+        REQUIRE(is_sorted(seen.begin(), seen.end()));
+        REQUIRE(subgraph.min_node_id() == seen.front());
+        REQUIRE(subgraph.max_node_id() == seen.back());
+    }
+    
+    SECTION("Its handles are the handles of the backing graph") {
+        REQUIRE(subgraph.get_handle(vg.get_id(h3), true) == vg.flip(h3));
+        REQUIRE(subgraph.get_sequence(subgraph.flip(h4)) == "TAA");
+        REQUIRE(subgraph.get_length(h1) == 4);
+    }
+    
+    SECTION("It only follows edges between its nodes") {
+        vector<handle_t> nexts;
+        subgraph.follow_edges(h1, false, [&](const handle_t& next) {
+            nexts.push_back(next);
+        });
+        REQUIRE(nexts.size() == 1);
+        REQUIRE(nexts.front() == h3);
+        
+        vector<handle_t> prevs;
+        subgraph.follow_edges(h4, true, [&](const handle_t& prev) {
+            prevs.push_back(prev);
+        });
+        REQUIRE(prevs.empty());
+        
+        subgraph.follow_edges(vg.flip(h4), true, [&](const handle_t& prev) {
+            prevs.push_back(prev);
+        });
+        REQUIRE(prevs.size() == 1);
+        REQUIRE(prevs.front() == h3);
+    }
+    
+    SECTION("It can be extended with another view") {
+        subgraph.extend(SubHandleGraph(&vg, vector<id_t>{vg.get_id(h2), vg.get_id(h3)}));
+        REQUIRE(subgraph.node_size() == 4);
+        
+        vector<handle_t> nexts;
+        subgraph.follow_edges(h1, false, [&](const handle_t& next) {
+            nexts.push_back(next);
+        });
+        REQUIRE(nexts.size() == 2);
+    }
+}
+
 }
 }
@@ -0,0 +1,151 @@
+/** \file
+ *
+ * Unit tests for listing the sub-haplotypes that start at a node.
+ */
+
+#include <algorithm>
+
+#include <gbwt/dynamic_gbwt.h>
+
+#include "../haplotype_extracter.hpp"
+#include "../json2pb.h"
+#include "../utility.hpp"
+
+#include "catch.hpp"
+
+namespace vg {
+namespace unittest {
+
+using namespace std;
+
+// build a GBWT with both orientations of the given paths of (forward) node IDs
+static gbwt::GBWT build_gbwt(const vector<vector<vg::id_t>>& paths) {
+    gbwt::size_type node_width = 1, total_length = 0;
+    for (auto& path : paths) {
+        for (auto node : path) {
+            node_width = max(node_width, gbwt::bit_length(gbwt::Node::encode(node, true)));
+        }
+        total_length += 2 * (path.size() + 1);
+    }
+
+    gbwt::Verbosity::set(gbwt::Verbosity::SILENT);
+    gbwt::GBWTBuilder builder(node_width, total_length);
+    for (auto& path : paths) {
+        gbwt::vector_type encoded;
+        for (auto node : path) {
+            encoded.push_back(gbwt::Node::encode(node, false));
+        }
+        builder.insert(encoded, true);
+    }
+    builder.finish();
+
+    string filename = temp_file::create("gbwt");
+    sdsl::store_to_file(builder.index, filename);
+    gbwt::GBWT gbwt_index;
+    sdsl::load_from_file(gbwt_index, filename);
+    temp_file::remove(filename);
+
+    return gbwt_index;
+}
+
+typedef vector<pair<vector<pair<int64_t, bool>>, int>> haplotype_counts;
+
+// put listed haplotypes in a comparable form
+static haplotype_counts sorted_counts(const vector<pair<thread_t, int>>& haplotypes) {
+    haplotype_counts counts;
+    for (auto& haplotype : haplotypes) {
+        vector<pair<int64_t, bool>> nodes;
+        for (auto& mapping : haplotype.first) {
+            nodes.emplace_back(mapping.node_id, mapping.is_reverse);
+        }
+        counts.emplace_back(nodes, haplotype.second);
+    }
+    sort(counts.begin(), counts.end());
+    return counts;
+}
+
+TEST_CASE("Batched haplotype listing matches one query at a time", "[haplotype-extracter][gbwt]") {
+
+    // 1 -> {2, 3} -> 4 -> {5, 6, direct} -> 7 -> 8
+    string graph_json = R"(
+    {
+        "node": [
+            {"id": 1, "sequence": "GATT"},
+            {"id": 2, "sequence": "A"},
+            {"id": 3, "sequence": "C"},
+            {"id": 4, "sequence": "CA"},
+            {"id": 5, "sequence": "G"},
+            {"id": 6, "sequence": "T"},
+            {"id": 7, "sequence": "TACA"},
+            {"id": 8, "sequence": "GG"}
+        ],
+        "edge": [
+            {"from": 1, "to": 2},
+            {"from": 1, "to": 3},
+            {"from": 2, "to": 4},
+            {"from": 3, "to": 4},
+            {"from": 4, "to": 5},
+            {"from": 4, "to": 6},
+            {"from": 4, "to": 7},
+            {"from": 5, "to": 7},
+            {"from": 6, "to": 7},
+            {"from": 7, "to": 8}
+        ]
+    }
+    )";
+    Graph graph;
+    json2pb(graph, graph_json.c_str(), graph_json.size());
+    xg::XG xg_index(graph);
+
+    // including haplotypes that end before the graph does
+    gbwt::GBWT gbwt_index = build_gbwt({
+        {1, 2, 4, 5, 7, 8},
+        {1, 2, 4, 5, 7, 8},
+        {1, 2, 4, 5, 7, 8},
+        {1, 3, 4, 6, 7, 8},
+        {1, 3, 4, 6, 7, 8},
+        {1, 2, 4, 7, 8},
+        {1, 2, 4},
+        {1, 3},
+        {2, 4, 5, 7},
+        {4, 6, 7, 8}
+    });
+
+    vector<pair<vg::id_t, int>> queries{{1, 3}, {1, 4}, {1, 5}, {1, 10}, {2, 3}, {3, 2},
+                                        {4, 4}, {4, 4}, {4, 1}, {7, 5}, {8, 4}};
+    auto batched = list_haplotypes(xg_index, gbwt_index, queries);
+    REQUIRE(batched.size() == queries.size());
+
+    SECTION("Every query gets the same sub-haplotypes and counts as when searched alone") {
+        for (size_t i = 0; i < queries.size(); i++) {
+            xg::XG::ThreadMapping start_node = {queries[i].first, false};
+            auto single = list_haplotypes(xg_index, gbwt_index, start_node, queries[i].second);
+            REQUIRE(sorted_counts(batched[i]) == sorted_counts(single));
+        }
+    }
+
+    SECTION("Haplotypes that end inside a window are only reported where nothing continues") {
+        // 1 2 4 and 1 3 end inside the window, but others go on from them
+        haplotype_counts from_1{
+            {{{1, false}, {2, false}, {4, false}, {5, false}}, 3},
+            {{{1, false}, {2, false}, {4, false}, {7, false}}, 1},
+            {{{1, false}, {3, false}, {4, false}, {6, false}}, 2}
+        };
+        REQUIRE(sorted_counts(batched[1]) == from_1);
+
+        // 4 7 8 stops a node short, but so does the graph; 4 5 7 doesn't
+        haplotype_counts from_4{
+            {{{4, false}, {5, false}, {7, false}, {8, false}}, 3},
+            {{{4, false}, {6, false}, {7, false}, {8, false}}, 3},
+            {{{4, false}, {7, false}, {8, false}}, 1}
+        };
+        REQUIRE(sorted_counts(batched[6]) == from_4);
+        REQUIRE(sorted_counts(batched[7]) == from_4);
+
+        // nothing follows the last node
+        REQUIRE(batched[10].empty());
+    }
+}
+
+}
+}
@@ -0,0 +1,109 @@
+/**
+ * \file
+ * unittest/index.cpp: test cases for loading the RocksDB index through SST file ingestion.
+ */
+
+#include "catch.hpp"
+
+#include "../index.hpp"
+#include "../utility.hpp"
+
+#include <cstdlib>
+#include <unistd.h>
+
+namespace vg {
+namespace unittest {
+
+using namespace std;
+
+// make a new empty directory to hold a database
+static string make_index_dir() {
+    string dir = temp_file::get_dir() + "/vg-index-test-XXXXXX";
+    REQUIRE(mkdtemp(&dir[0]) != nullptr);
+    return dir;
+}
+
+// get everything in the database, in key order
+static vector<pair<string, string>> read_all(rocksdb::DB* db) {
+    vector<pair<string, string>> entries;
+    unique_ptr<rocksdb::Iterator> it(db->NewIterator(rocksdb::ReadOptions()));
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        entries.emplace_back(it->key().ToString(), it->value().ToString());
+    }
+    return entries;
+}
+
+TEST_CASE("SSTIngester keeps the last value put for each key", "[index][rocksdb]") {
+
+    string dir = make_index_dir();
+    Index index;
+    index.open_for_write(dir);
+    size_t before = read_all(index.db).size();
+
+    {
+        // a tiny buffer spills every entry as its own run, so the merge sees
+        // the duplicates in different runs
+        SSTIngester ingester(index.db, index.db_options, dir + ".ingest", 1);
+        ingester.put("+b3", "first");
+        ingester.put("+a2", "a2");
+        ingester.put("+b1", "b1");
+        ingester.put("+b3", "second");
+        ingester.put("+a1", "a1");
+        ingester.put("+a2", "a2 again");
+        ingester.put("+b3", "third");
+
+        SECTION("nothing is visible before ingesting") {
+            REQUIRE(read_all(index.db).size() == before);
+        }
+
+        SECTION("entries come back sorted, with repeated keys taking their last value") {
+            ingester.ingest();
+            typedef vector<pair<string, string>> entry_list;
+            entry_list expected{{"+a1", "a1"}, {"+a2", "a2 again"}, {"+b1", "b1"}, {"+b3", "third"}};
+            entry_list found;
+            for (auto& entry : read_all(index.db)) {
+                if (entry.first.size() == 3 && entry.first[0] == '+') {
+                    found.push_back(entry);
+                }
+            }
+            REQUIRE(found == expected);
+        }
+    }
+
+    index.close();
+    REQUIRE(rocksdb::DestroyDB(dir, rocksdb::Options()).ok());
+    rmdir(dir.c_str());
+}
+
+TEST_CASE("An index opened for ingest reads back its graph after flushing", "[index][rocksdb]") {
+
+    string dir = make_index_dir();
+    Index index;
+    index.open_for_ingest(dir);
+
+    vector<pair<int64_t, string>> nodes{{5, "CCC"}, {2, "A"}, {9, "T"}, {2, "GG"}};
+    for (auto& id_and_sequence : nodes) {
+        Node node;
+        node.set_id(id_and_sequence.first);
+        node.set_sequence(id_and_sequence.second);
+        index.put_node(&node);
+    }
+    index.flush();
+
+    Node found;
+    REQUIRE(index.get_node(5, found).ok());
+    REQUIRE(found.sequence() == "CCC");
+    REQUIRE(index.get_node(9, found).ok());
+    REQUIRE(found.sequence() == "T");
+    // node 2 was put twice, and the second one wins
+    REQUIRE(index.get_node(2, found).ok());
+    REQUIRE(found.sequence() == "GG");
+    REQUIRE(index.get_node(3, found).IsNotFound());
+
+    index.close();
+    REQUIRE(rocksdb::DestroyDB(dir, rocksdb::Options()).ok());
+    rmdir(dir.c_str());
+}
+
+}
+}
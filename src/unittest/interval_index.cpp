@@ -0,0 +1,100 @@
+/**
+ * \file 
+ * unittest/interval_index.cpp: test cases for the IntervalIndex overlap index.
+ */
+
+#include "catch.hpp"
+
+#include "../interval_index.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <algorithm>
+
+namespace vg {
+namespace unittest {
+
+using namespace std;
+
+TEST_CASE("IntervalIndex finds overlapping intervals", "[interval_index]") {
+
+    IntervalIndex<string, int> index;
+    index.add("chr1", 10, 20, 0);
+    index.add("chr1", 15, 16, 1);
+    index.add("chr1", 0, 100, 2);
+    index.add("chr2", 10, 20, 3);
+    index.add("chr1", 20, 30, 4);
+    index.index();
+    
+    REQUIRE(index.size() == 5);
+    REQUIRE(!index.empty());
+    REQUIRE(index.has_contig("chr1"));
+    REQUIRE(!index.has_contig("chr3"));
+    
+    SECTION("Overlaps are found on the right contig") {
+        auto found = index.find_overlapping("chr1", 12, 18);
+        sort(found.begin(), found.end());
+        REQUIRE(found == vector<int>({0, 1, 2}));
+        
+        found = index.find_overlapping("chr2", 12, 18);
+        REQUIRE(found == vector<int>({3}));
+    }
+    
+    SECTION("Intervals are half-open") {
+        auto found = index.find_overlapping("chr1", 20, 21);
+        sort(found.begin(), found.end());
+        REQUIRE(found == vector<int>({2, 4}));
+        
+        found = index.find_overlapping("chr2", 0, 10);
+        REQUIRE(found.empty());
+    }
+    
+    SECTION("Contigs without intervals have no overlaps") {
+        REQUIRE(index.find_overlapping("chr3", 0, 1000).empty());
+    }
+}
+
+TEST_CASE("IntervalIndex agrees with a linear scan", "[interval_index]") {
+
+    mt19937 generator(1000);
+    
+    for (size_t trial = 0; trial < 100; trial++) {
+        IntervalIndex<int64_t, size_t> index;
+        vector<tuple<int64_t, size_t, size_t>> intervals;
+        
+        // Make some long and some short intervals on a few contigs
+        size_t count = uniform_int_distribution<size_t>(0, 500)(generator);
+        size_t max_length = trial % 2 ? 10 : 300;
+        for (size_t i = 0; i < count; i++) {
+            int64_t contig = uniform_int_distribution<int64_t>(1, 4)(generator);
+            size_t start = uniform_int_distribution<size_t>(0, 1000)(generator);
+            size_t end = start + uniform_int_distribution<size_t>(0, max_length)(generator);
+            index.add(contig, start, end, i);
+            intervals.emplace_back(contig, start, end);
+        }
+        index.index();
+        
+        for (size_t query = 0; query < 50; query++) {
+            int64_t contig = uniform_int_distribution<int64_t>(0, 5)(generator);
+            size_t start = uniform_int_distribution<size_t>(0, 1100)(generator);
+            size_t end = start + uniform_int_distribution<size_t>(0, 50)(generator);
+            
+            auto found = index.find_overlapping(contig, start, end);
+            sort(found.begin(), found.end());
+            
+            vector<size_t> expected;
+            for (size_t i = 0; i < intervals.size(); i++) {
+                if (get<0>(intervals[i]) == contig && get<1>(intervals[i]) < end && start < get<2>(intervals[i])) {
+                    expected.push_back(i);
+                }
+            }
+            
+            REQUIRE(found == expected);
+        }
+    }
+}
+
+}
+}
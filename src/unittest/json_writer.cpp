@@ -0,0 +1,101 @@
+/// \file json_writer.cpp
+///
+/// Unit tests for the reflection-free JSON writer
+///
+
+#include "../json_writer.hpp"
+#include "../json2pb.h"
+#include "catch.hpp"
+
+#include <cmath>
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("ProtoJSONWriter matches pb2json for alignments", "[json]") {
+    Alignment aln;
+    json2pb(aln, R"({"sequence":"GATTACA","name":"read<1>\"\t","quality":"KCgnKCgoKA==",)"
+                 R"("path":{"mapping":[{"position":{"node_id":"1","offset":"2","is_reverse":true},)"
+                 R"("edit":[{"from_length":3,"to_length":3},{"to_length":2,"sequence":"CA"}],"rank":"1"},{"position":{"node_id":"2"},"rank":"2"}]},)"
+                 R"("mapping_quality":60,"score":-3,"identity":0.85714285714285721,"secondary_score":[5,-2],)"
+                 R"("refpos":[{"name":"x","offset":"100"}],"read_paired":true,"fragment_prev":{"name":"read<2>"},)"
+                 R"("annotation":{"tags":[1.5,"a",true,null]}})");
+
+    ProtoJSONWriter writer;
+
+    SECTION("a full alignment") {
+        writer.write(aln);
+        REQUIRE(writer.str() == pb2json(aln));
+    }
+
+    SECTION("an empty alignment") {
+        Alignment empty;
+        writer.write(empty);
+        REQUIRE(writer.str() == "{}");
+        REQUIRE(writer.str() == pb2json(empty));
+    }
+
+    SECTION("special floating point values") {
+        aln.set_identity(NAN);
+        aln.set_uniqueness(-INFINITY);
+        aln.set_correct(1e-300);
+        writer.write(aln);
+        REQUIRE(writer.str() == pb2json(aln));
+    }
+
+    SECTION("several messages in a reused buffer") {
+        writer.write(aln);
+        writer.newline();
+        writer.clear();
+        writer.write(aln);
+        writer.newline();
+        writer.write(aln);
+        REQUIRE(writer.str() == pb2json(aln) + "\n" + pb2json(aln));
+    }
+}
+
+TEST_CASE("ProtoJSONWriter matches pb2json for multipath alignments", "[json]") {
+    MultipathAlignment mp_aln;
+    json2pb(mp_aln, R"({"sequence":"GA","quality":"KCg=","name":"r","mapping_quality":7,"start":[0],)"
+                    R"("subpath":[{"path":{"mapping":[{"position":{"node_id":"4"}}]},"next":[1],"score":2},)"
+                    R"({"path":{"mapping":[{"position":{"node_id":"5"},"edit":[{"from_length":1}]}]}}]})");
+
+    ProtoJSONWriter writer;
+    writer.write(mp_aln);
+    REQUIRE(writer.str() == pb2json(mp_aln));
+}
+
+TEST_CASE("ProtoJSONWriter matches pb2json for graphs, snarls, and loci", "[json]") {
+    ProtoJSONWriter writer;
+
+    SECTION("a graph") {
+        Graph graph;
+        json2pb(graph, R"({"node":[{"id":"1","sequence":"GATT"},{"id":"2","sequence":"A","name":"n"}],)"
+                       R"("edge":[{"from":"1","to":"2","from_start":true},{"from":"2","to":"2","to_end":true,"overlap":1}],)"
+                       R"("path":[{"name":"ref","is_circular":true,"length":"5","mapping":[{"position":{"node_id":"1"},"rank":"1"}]}]})");
+        writer.write(graph);
+        REQUIRE(writer.str() == pb2json(graph));
+    }
+
+    SECTION("a snarl") {
+        Snarl snarl;
+        json2pb(snarl, R"({"type":"ULTRABUBBLE","start":{"node_id":"1"},"end":{"node_id":"6","backward":true},)"
+                       R"("parent":{"start":{"node_id":"0"},"end":{"node_id":"9"}},"start_end_reachable":true,)"
+                       R"("directed_acyclic_net_graph":true})");
+        writer.write(snarl);
+        REQUIRE(writer.str() == pb2json(snarl));
+    }
+
+    SECTION("a locus") {
+        Locus locus;
+        json2pb(locus, R"({"name":"l","allele":[{"name":"a0"},{}],"support":[{"forward":3,"reverse":2.5}],)"
+                       R"("genotype":[{"allele":[0,1],"is_phased":true,"log_likelihood":-0.25}],)"
+                       R"("overall_support":{"quality":1e+20},"allele_log_likelihood":[-1,0.1]})");
+        writer.write(locus);
+        REQUIRE(writer.str() == pb2json(locus));
+    }
+}
+
+}
+}
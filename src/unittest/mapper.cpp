@@ -297,6 +297,270 @@ TEST_CASE( "Mapper finds optimal mapping for read starting with node-border MEM"
     
 }
 
+TEST_CASE( "Backward search cache shares LF steps between overlapping searches", "[mapping][mapper][mem]" ) {
+    
+    string graph_json = R"({
+        "node": [
+            {"id": 1, "sequence": "CATTAGGACTTGACCAGTACGATC"},
+            {"id": 2, "sequence": "GACCAGTACG"},
+            {"id": 3, "sequence": "TTGAGCAGGTCAATCGTCCA"}
+        ],
+        "edge": [
+            {"from": 1, "to": 2},
+            {"from": 2, "to": 3}
+        ]
+    })";
+    
+    // Load the JSON
+    Graph proto_graph;
+    json2pb(proto_graph, graph_json.c_str(), graph_json.size());
+    
+    // Make it into a VG
+    VG graph;
+    graph.extend(proto_graph);
+    
+    // Configure GCSA temp directory to the system temp directory
+    gcsa::TempFile::setDirectory(temp_file::get_dir());
+    // And make it quiet
+    gcsa::Verbosity::set(gcsa::Verbosity::SILENT);
+    
+    // Make pointers to fill in
+    gcsa::GCSA* gcsaidx = nullptr;
+    gcsa::LCPArray* lcpidx = nullptr;
+    
+    // Build the GCSA index
+    build_gcsa_lcp(graph, gcsaidx, lcpidx, 16, 3);
+    
+    string read = "CATTAGGACTTGACCAGTACGATCGACCAGTACG";
+    BackwardSearchCache search_cache(gcsaidx, read.begin(), read.end());
+    
+    // search without the cache, counting the LF steps
+    size_t uncached_lf = 0;
+    auto uncached_range = [&](string::const_iterator begin, string::const_iterator end) {
+        gcsa::range_type range(0, gcsaidx->size() - 1);
+        for (auto cursor = end; cursor != begin; ) {
+            --cursor;
+            range = gcsaidx->LF(range, gcsaidx->alpha.char2comp[*cursor]);
+            uncached_lf++;
+        }
+        return range;
+    };
+    
+    // the searches reseeding makes: nested substrings ending at the same places, and
+    // overlapping ones ending at different places
+    vector<pair<size_t, size_t>> searches{{20, 34}, {14, 34}, {8, 34}, {0, 34}, {10, 24}, {4, 24},
+                                          {0, 24}, {16, 24}, {12, 30}, {2, 30}, {12, 34}};
+    for (auto& search : searches) {
+        auto begin = read.begin() + search.first;
+        auto end = read.begin() + search.second;
+        gcsa::range_type range = uncached_range(begin, end);
+        REQUIRE(!gcsa::Range::empty(range));
+        REQUIRE(search_cache.range(begin, end) == range);
+        REQUIRE(search_cache.count(begin, end) == gcsaidx->count(range));
+    }
+    
+    // each end only pays for its longest search
+    REQUIRE(search_cache.lf_operations() == 34 + 24 + 28);
+    REQUIRE(search_cache.lf_operations() < uncached_lf);
+    
+    // repeating the searches is free
+    size_t lf_before = search_cache.lf_operations();
+    for (auto& search : searches) {
+        search_cache.range(read.begin() + search.first, read.begin() + search.second);
+    }
+    REQUIRE(search_cache.lf_operations() == lf_before);
+    
+    // Clean up the GCSA/LCP index
+    delete gcsaidx;
+    delete lcpidx;
+}
+
+TEST_CASE( "Mapper locates reseeded MEM hits in a batch", "[mapping][mapper][mem]" ) {
+    
+    string graph_json = R"({
+        "node": [
+            {"id": 1, "sequence": "CATTAGGACTTGACCAGTACGATC"},
+            {"id": 2, "sequence": "GACCAGTACG"},
+            {"id": 3, "sequence": "TTGAGCAGGTCAATCGTCCA"},
+            {"id": 4, "sequence": "GGACTTGACC"},
+            {"id": 5, "sequence": "AATCGTCCATTAGGACTTG"}
+        ],
+        "edge": [
+            {"from": 1, "to": 2},
+            {"from": 2, "to": 3},
+            {"from": 3, "to": 4},
+            {"from": 4, "to": 5}
+        ]
+    })";
+    
+    // Load the JSON
+    Graph proto_graph;
+    json2pb(proto_graph, graph_json.c_str(), graph_json.size());
+    
+    // Make it into a VG
+    VG graph;
+    graph.extend(proto_graph);
+    
+    // Configure GCSA temp directory to the system temp directory
+    gcsa::TempFile::setDirectory(temp_file::get_dir());
+    // And make it quiet
+    gcsa::Verbosity::set(gcsa::Verbosity::SILENT);
+    
+    // Make pointers to fill in
+    gcsa::GCSA* gcsaidx = nullptr;
+    gcsa::LCPArray* lcpidx = nullptr;
+    
+    // Build the GCSA index
+    build_gcsa_lcp(graph, gcsaidx, lcpidx, 16, 3);
+    
+    // Build the xg index
+    xg::XG xg_index(proto_graph);
+    
+    Mapper mapper(&xg_index, gcsaidx, lcpidx);
+    // keep all of the hits so we can compare them to the index
+    mapper.prefilter_redundant_hits = false;
+    
+    // the read repeats sequences from nodes 2 and 4, so reseeding finds sub-MEMs
+    string read = "CATTAGGACTTGACCAGTACGATCGACCAGTACGTTGAGCAGG";
+    
+    for (bool fast_reseed : {false, true}) {
+        
+        mapper.fast_reseed = fast_reseed;
+        
+        double lcp_avg, fraction_filtered;
+        vector<MaximalExactMatch> mems = mapper.find_mems_deep(read.begin(), read.end(), lcp_avg, fraction_filtered,
+                                                               0, 4, 8, false, fast_reseed);
+        
+        REQUIRE(!mems.empty());
+        
+        for (const MaximalExactMatch& mem : mems) {
+            if (mem.primary) {
+                // SMEMs always have hits
+                REQUIRE(!mem.nodes.empty());
+            }
+            if (!mem.nodes.empty()) {
+                // the hits from the batch are the ones the index gives for the MEM alone
+                vector<gcsa::node_type> hits;
+                gcsaidx->locate(mem.range, hits);
+                REQUIRE(mem.nodes == hits);
+                REQUIRE(mem.queried_count == hits.size());
+            }
+        }
+    }
+    
+    // Clean up the GCSA/LCP index
+    delete gcsaidx;
+    delete lcpidx;
+}
+
+TEST_CASE( "Mapper keeps only the overlay MEM hits that place the read somewhere new", "[mapping][mapper][mem]" ) {
+    
+    // node 2 was added after the main GCSA index was built
+    string graph_json = R"({
+        "node": [
+            {"id": 1, "sequence": "CATTAGGACTTGACC"},
+            {"id": 2, "sequence": "AGTACGATCGGTCAA"},
+            {"id": 3, "sequence": "TTGAGCAGGTCAATCG"}
+        ],
+        "edge": [
+            {"from": 1, "to": 2},
+            {"from": 2, "to": 3}
+        ]
+    })";
+    
+    // Load the JSON
+    Graph proto_graph;
+    json2pb(proto_graph, graph_json.c_str(), graph_json.size());
+    
+    // the main index covers nodes 1 and 2, the overlay covers node 3 and node 2 as context
+    VG base_graph;
+    base_graph.add_node(proto_graph.node(0));
+    base_graph.add_node(proto_graph.node(1));
+    base_graph.add_edge(proto_graph.edge(0));
+    VG overlay_graph;
+    overlay_graph.add_node(proto_graph.node(1));
+    overlay_graph.add_node(proto_graph.node(2));
+    overlay_graph.add_edge(proto_graph.edge(1));
+    
+    // Configure GCSA temp directory to the system temp directory
+    gcsa::TempFile::setDirectory(temp_file::get_dir());
+    // And make it quiet
+    gcsa::Verbosity::set(gcsa::Verbosity::SILENT);
+    
+    // Make pointers to fill in
+    gcsa::GCSA* gcsaidx = nullptr;
+    gcsa::LCPArray* lcpidx = nullptr;
+    gcsa::GCSA* overlay_gcsaidx = nullptr;
+    gcsa::LCPArray* overlay_lcpidx = nullptr;
+    
+    // Build the GCSA indexes
+    build_gcsa_lcp(base_graph, gcsaidx, lcpidx, 16, 3);
+    build_gcsa_lcp(overlay_graph, overlay_gcsaidx, overlay_lcpidx, 16, 3);
+    
+    // Build the xg index of the whole graph
+    xg::XG xg_index(proto_graph);
+    
+    Mapper mapper(&xg_index, gcsaidx, lcpidx);
+    BaseMapper overlay_mapper(&xg_index, overlay_gcsaidx, overlay_lcpidx);
+    mapper.overlay_mapper = &overlay_mapper;
+    
+    auto hits_on_node = [](const vector<MaximalExactMatch>& mems, id_t node_id) {
+        size_t count = 0;
+        for (const MaximalExactMatch& mem : mems) {
+            for (auto node : mem.nodes) {
+                if (id(make_pos_t(node)) == node_id) {
+                    count++;
+                }
+            }
+        }
+        return count;
+    };
+    
+    double lcp_avg, fraction_filtered;
+    
+    SECTION( "An overlay hit in the context of the novel nodes is dropped even with different MEM bounds" ) {
+        
+        // matches from node 1 into node 2, which the overlay only sees from the start of node 2
+        string read = "GGACTTGACCAGTACGATCGGTCAACCCC";
+        
+        vector<MaximalExactMatch> mems = mapper.find_mems_deep(read.begin(), read.end(), lcp_avg, fraction_filtered,
+                                                               0, 8);
+        
+        REQUIRE(mems.size() == 1);
+        REQUIRE(mems[0].begin == read.begin());
+        REQUIRE(mems[0].end == read.begin() + 25);
+        REQUIRE(mems[0].nodes.size() == 1);
+        REQUIRE(make_pos_t(mems[0].nodes[0]) == make_pos_t(1, false, 5));
+        REQUIRE(hits_on_node(mems, 2) == 0);
+    }
+    
+    SECTION( "An overlay hit running into the novel nodes is kept" ) {
+        
+        string read = "TTGACCAGTACGATCGGTCAATTGAGCAGG";
+        
+        vector<MaximalExactMatch> mems = mapper.find_mems_deep(read.begin(), read.end(), lcp_avg, fraction_filtered,
+                                                               0, 8);
+        
+        bool found_novel = false;
+        for (const MaximalExactMatch& mem : mems) {
+            if (mem.begin == read.begin() + 6 && mem.end == read.end()) {
+                REQUIRE(mem.nodes.size() == 1);
+                REQUIRE(make_pos_t(mem.nodes[0]) == make_pos_t(2, false, 0));
+                REQUIRE(mem.match_count == 1);
+                found_novel = true;
+            }
+        }
+        REQUIRE(found_novel);
+        REQUIRE(hits_on_node(mems, 2) == 1);
+    }
+    
+    // Clean up the GCSA/LCP indexes
+    delete gcsaidx;
+    delete lcpidx;
+    delete overlay_gcsaidx;
+    delete overlay_lcpidx;
+}
+
 }
 
 }
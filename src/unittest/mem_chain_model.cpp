@@ -0,0 +1,82 @@
+/// \file mem_chain_model.cpp
+///
+/// Unit tests for the MEMChainModel
+///
+
+#include "../cluster.hpp"
+#include "catch.hpp"
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("MEMChainModel chains colinear MEMs and reuses its storage", "[cluster][mem]") {
+
+    string read = "GATTACACATTAGGACCAGATTAC";
+
+    // three MEMs in read order, and a fourth that goes backward in the graph
+    vector<MaximalExactMatch> mems;
+    mems.emplace_back(read.begin(), read.begin() + 6, gcsa::range_type(0, 0), 1);
+    mems.back().nodes.push_back(gcsa::Node::encode(1, 0, false));
+    mems.emplace_back(read.begin() + 8, read.begin() + 14, gcsa::range_type(0, 0), 1);
+    mems.back().nodes.push_back(gcsa::Node::encode(2, 0, false));
+    mems.emplace_back(read.begin() + 16, read.begin() + 24, gcsa::range_type(0, 0), 1);
+    mems.back().nodes.push_back(gcsa::Node::encode(3, 0, false));
+    mems.emplace_back(read.begin() + 18, read.begin() + 22, gcsa::range_type(0, 0), 1);
+    mems.back().nodes.push_back(gcsa::Node::encode(1, 2, false));
+
+    // nodes are 8 bp long and laid out in order
+    auto approx_position = [](pos_t pos) -> int64_t {
+        return (id(pos) - 1) * 8 + offset(pos);
+    };
+    auto path_position = [&](pos_t pos) -> map<string, vector<pair<size_t, bool> > > {
+        return map<string, vector<pair<size_t, bool> > >();
+    };
+    auto transition_weight = [&](const MEMChainModel& chainer, size_t v1, size_t v2) -> double {
+        auto& m1 = chainer.mem_of(v1);
+        auto& m2 = chainer.mem_of(v2);
+        int64_t graph_dist = approx_position(chainer.position_of(v2)) - approx_position(chainer.position_of(v1));
+        if (graph_dist < 0) {
+            return -std::numeric_limits<double>::max();
+        }
+        return -abs(graph_dist - (m2.begin - m1.begin));
+    };
+
+    auto chain = [&](void) {
+        MEMChainModel chainer({ read.size() }, { mems }, approx_position, path_position,
+                              transition_weight, read.size());
+        REQUIRE(chainer.model.size() == 4);
+        return chainer.traceback(2, false, false);
+    };
+
+    auto traces = chain();
+    REQUIRE(traces.size() == 2);
+    REQUIRE(traces[0].size() == 3);
+    REQUIRE(traces[0][0].begin == mems[0].begin);
+    REQUIRE(traces[0][1].begin == mems[1].begin);
+    REQUIRE(traces[0][2].begin == mems[2].begin);
+    REQUIRE(traces[1].size() == 1);
+    REQUIRE(traces[1][0].begin == mems[3].begin);
+    
+    // the chained MEMs get back their own hit and its positions
+    REQUIRE(traces[0][1].nodes.size() == 1);
+    REQUIRE(traces[0][1].nodes.front() == mems[1].nodes.front());
+    REQUIRE(traces[0][1].fragment == 1);
+    REQUIRE(traces[0][1].positions.at("").size() == 1);
+    REQUIRE(traces[0][1].positions.at("").front().first == 8);
+
+    SECTION("A second model on the same thread gives the same chains") {
+        auto again = chain();
+        REQUIRE(again.size() == traces.size());
+        for (size_t i = 0; i < traces.size(); i++) {
+            REQUIRE(again[i].size() == traces[i].size());
+            for (size_t j = 0; j < traces[i].size(); j++) {
+                REQUIRE(again[i][j].begin == traces[i][j].begin);
+                REQUIRE(again[i][j].nodes == traces[i][j].nodes);
+            }
+        }
+    }
+}
+
+}
+}
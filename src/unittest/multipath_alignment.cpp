@@ -620,6 +620,76 @@ namespace vg {
                 SECTION("Quinary alignment does not exist") {
                     REQUIRE(top10.size() < 5);
                 }
+                
+                SECTION("A cache resumes the enumeration and gives the same alignments") {
+                    MultipathAlignmentCache cache(multipath_aln);
+                    
+                    // start with fewer alignments than there are
+                    vector<Alignment> top2 = cache.optimal_alignments(2);
+                    REQUIRE(top2.size() == 2);
+                    
+                    // then ask for more
+                    vector<Alignment> more = cache.optimal_alignments(10);
+                    REQUIRE(more.size() == top10.size());
+                    for (size_t i = 0; i < top10.size(); i++) {
+                        REQUIRE(more[i].SerializeAsString() == top10[i].SerializeAsString());
+                    }
+                    for (size_t i = 0; i < top2.size(); i++) {
+                        REQUIRE(top2[i].SerializeAsString() == top10[i].SerializeAsString());
+                    }
+                    
+                    // and the optimal alignment agrees
+                    Alignment opt_aln;
+                    cache.optimal_alignment(opt_aln);
+                    REQUIRE(cache.optimal_alignment_score() == top10[0].score());
+                    REQUIRE(opt_aln.SerializeAsString() == top10[0].SerializeAsString());
+                }
+                
+                SECTION("A cache fills the DP once and does not repeat traceback steps") {
+                    MultipathAlignmentCache fresh(multipath_aln);
+                    fresh.optimal_alignments(10);
+                    size_t fresh_steps = fresh.traceback_step_count();
+                    REQUIRE(fresh.dp_fill_count() == 1);
+                    
+                    // leave room for the 10 alignments we will end up asking for
+                    MultipathAlignmentCache cache(multipath_aln, 10);
+                    REQUIRE(cache.optimal_alignment_score() == top10[0].score());
+                    Alignment opt_aln;
+                    cache.optimal_alignment(opt_aln);
+                    cache.optimal_alignments(2);
+                    size_t first_steps = cache.traceback_step_count();
+                    REQUIRE(first_steps > 0);
+                    
+                    // asking for more picks up where the first query stopped
+                    cache.optimal_alignments(10);
+                    REQUIRE(cache.traceback_step_count() == fresh_steps);
+                    REQUIRE(cache.traceback_step_count() - first_steps < fresh_steps);
+                    
+                    // asking for fewer does no work at all
+                    cache.optimal_alignments(3);
+                    REQUIRE(cache.traceback_step_count() == fresh_steps);
+                    REQUIRE(cache.dp_fill_count() == 1);
+                }
+                
+                SECTION("A cache only queues tracebacks that can be among the alignments asked for") {
+                    MultipathAlignmentCache unbounded(multipath_aln, 10);
+                    unbounded.optimal_alignments(1);
+                    REQUIRE(unbounded.queued_traceback_count() > 0);
+                    
+                    MultipathAlignmentCache bounded(multipath_aln);
+                    vector<Alignment> top1 = bounded.optimal_alignments(1);
+                    REQUIRE(top1.size() == 1);
+                    REQUIRE(top1[0].SerializeAsString() == top10[0].SerializeAsString());
+                    REQUIRE(bounded.queued_traceback_count() == 0);
+                    
+                    // growing past what was kept starts over and still finds them all
+                    vector<Alignment> more = bounded.optimal_alignments(10);
+                    REQUIRE(more.size() == top10.size());
+                    for (size_t i = 0; i < top10.size(); i++) {
+                        REQUIRE(more[i].SerializeAsString() == top10[i].SerializeAsString());
+                    }
+                    REQUIRE(bounded.dp_fill_count() == 1);
+                }
             }
         
         }
@@ -156,7 +156,7 @@ TEST_CASE( "MultipathMapper::query_cluster_graphs works", "[multipath][mapping][
 
     // Remember the important types:
     // vector<clustergraph_t>
-    // using clustergraph_t = tuple<VG*, memcluster_t, size_t>;
+    // using clustergraph_t = tuple<SubHandleGraph*, memcluster_t, size_t>;
     // using memcluster_t = vector<pair<const MaximalExactMatch*, pos_t>>;
     
     SECTION("no MEMs produce no graphs") {
@@ -191,7 +191,7 @@ TEST_CASE( "MultipathMapper::query_cluster_graphs works", "[multipath][mapping][
         // We have one graph
         REQUIRE(results.size() == 1);
         // It has one node
-        REQUIRE(get<0>(results[0])->node_count() == 1);
+        REQUIRE(get<0>(results[0])->node_size() == 1);
         // It contains the one MEM we fed in
         REQUIRE(get<1>(results[0]).size() == 1);
         MultipathMapper::memcluster_t& assigned_mems = get<1>(results[0]);
@@ -228,7 +228,7 @@ TEST_CASE( "MultipathMapper::query_cluster_graphs works", "[multipath][mapping][
         // We have one graph
         REQUIRE(results.size() == 1);
         // It has one node
-        REQUIRE(get<0>(results[0])->node_count() == 1);
+        REQUIRE(get<0>(results[0])->node_size() == 1);
         // It came from two MEM hits
         REQUIRE(get<1>(results[0]).size() == 2);
         // They are hits of the two MEMs we fed in at the right places
@@ -265,7 +265,7 @@ TEST_CASE( "MultipathMapper::query_cluster_graphs works", "[multipath][mapping][
         // We have one graph
         REQUIRE(results.size() == 1);
         // It has one node
-        REQUIRE(get<0>(results[0])->node_count() == 1);
+        REQUIRE(get<0>(results[0])->node_size() == 1);
         // It came from two MEM hits
         REQUIRE(get<1>(results[0]).size() == 2);
         // They are hits of the two MEMs we fed in at the right places
@@ -433,9 +433,49 @@ TEST_CASE( "MultipathMapper can map to a one-node graph", "[multipath][mapping][
                 }
             }
         }
-    
+
     }
-    
+
+    SECTION( "MultipathMapper can save and reload its calibration" ) {
+
+        size_t checksum = mapper.calibration_checksum();
+
+        mapper.init_band_padding_memo();
+        mapper.set_automatic_min_clustering_length();
+        mapper.pseudo_length_multiplier = 2.5;
+        mapper.force_fragment_length_distr(300.0, 25.0);
+
+        stringstream strm;
+        mapper.save_calibration(strm, checksum);
+
+        MultipathMapper other_mapper(&xg_index, gcsaidx, lcpidx);
+        other_mapper.max_mapping_quality = 10;
+
+        SECTION("the profile is loaded when the checksum matches") {
+            REQUIRE(other_mapper.calibration_checksum() == checksum);
+            REQUIRE(other_mapper.load_calibration(strm, checksum));
+            REQUIRE(other_mapper.pseudo_length_multiplier == 2.5);
+            REQUIRE(other_mapper.min_clustering_mem_length == mapper.min_clustering_mem_length);
+            REQUIRE(other_mapper.band_padding_memo == mapper.band_padding_memo);
+            REQUIRE(other_mapper.has_fixed_fragment_length_distr());
+        }
+
+        SECTION("the profile is rejected when the parameters differ") {
+            other_mapper.band_padding_multiplier = 2.0;
+            REQUIRE(!other_mapper.load_calibration(strm, other_mapper.calibration_checksum()));
+            REQUIRE(other_mapper.band_padding_memo.empty());
+            REQUIRE(!other_mapper.has_fixed_fragment_length_distr());
+        }
+
+        SECTION("the profile is rejected when the calibration settings differ") {
+            REQUIRE(other_mapper.calibration_checksum(false) != checksum);
+            REQUIRE(other_mapper.calibration_checksum(true, 250) != checksum);
+            REQUIRE(other_mapper.calibration_checksum(true, 1000, 100) != checksum);
+            REQUIRE(!other_mapper.load_calibration(strm, other_mapper.calibration_checksum(false)));
+            REQUIRE(!other_mapper.has_fixed_fragment_length_distr());
+        }
+    }
+
     // Clean up the GCSA/LCP index
     delete gcsaidx;
     delete lcpidx;
@@ -1,4 +1,5 @@
 #include "vg.hpp"
+#include "../random_graph.hpp"
 #include <random>
 #include <time.h>
 
@@ -0,0 +1,102 @@
+/**
+ * \file
+ * unittest/recalibration.cpp: test cases for building mapping quality recalibration examples.
+ */
+
+#include "catch.hpp"
+
+#include "../recalibration.hpp"
+
+#include <vector>
+
+namespace vg {
+namespace unittest {
+
+using namespace std;
+
+// make an alignment with the given features
+static Alignment make_alignment(int mapq, int score, const vector<int>& secondary_scores, double identity,
+                                bool correct) {
+    Alignment aln;
+    aln.set_mapping_quality(mapq);
+    aln.set_score(score);
+    for (auto& secondary_score : secondary_scores) {
+        aln.add_secondary_score(secondary_score);
+    }
+    aln.set_identity(identity);
+    aln.set_correctly_mapped(correct);
+    return aln;
+}
+
+TEST_CASE("Recalibration features come from the alignment", "[recalibrate]") {
+    Alignment aln = make_alignment(42, 96, {80, 75}, 0.875, true);
+    AlignmentFeatures features = alignment_to_features(aln);
+    REQUIRE(features.values[0] == 42);
+    REQUIRE(features.values[1] == 96);
+    REQUIRE(features.values[2] == 80);
+    REQUIRE(features.values[3] == 2);
+    REQUIRE(features.values[4] == 0.875);
+    REQUIRE(features.correct);
+
+    AlignmentFeatures unique = alignment_to_features(make_alignment(60, 100, {}, 1.0, false));
+    REQUIRE(unique.values[2] == 0);
+    REQUIRE(unique.values[3] == 0);
+    REQUIRE(!unique.correct);
+}
+
+TEST_CASE("Examples built from features score the same as examples parsed from text", "[recalibrate]") {
+
+    vector<Alignment> alns{
+        make_alignment(60, 100, {}, 1.0, true),
+        make_alignment(60, 92, {40}, 0.96875, true),
+        make_alignment(3, 50, {50, 48}, 0.75, false),
+        make_alignment(0, 30, {30, 30, 29}, 0.5, false),
+        make_alignment(20, 80, {70}, 0.9375, true),
+        make_alignment(10, 60, {58}, 0.8125, false)
+    };
+
+    // The options vg recalibrate trains with
+    string vw_args = "--no_stdin --quiet --link=logistic --loss_function=logistic -q :: --l2 0.000001";
+    vw* text_model = VW::initialize(vw_args);
+    vw* built_model = VW::initialize(vw_args);
+    ExampleBuilder builder(*built_model);
+
+    // Learn or predict with both models, and get both predictions
+    auto run_both = [&](const Alignment& aln, bool train) {
+        example* text_example = VW::read_example(*text_model, alignment_to_example_string(aln, train));
+        text_model->learn(text_example);
+        double text_prediction = text_example->pred.prob;
+        VW::finish_example(*text_model, text_example);
+
+        example* built_example = builder.make_example(alignment_to_features(aln), train);
+        built_model->learn(built_example);
+        double built_prediction = built_example->pred.prob;
+        VW::finish_example(*built_model, built_example);
+
+        return make_pair(text_prediction, built_prediction);
+    };
+
+    SECTION("Training gives the same predictions along the way") {
+        for (size_t pass = 0; pass < 10; pass++) {
+            for (auto& aln : alns) {
+                auto predictions = run_both(aln, true);
+                REQUIRE(predictions.second == Approx(predictions.first));
+            }
+        }
+
+        SECTION("And the trained models predict the same afterwards") {
+            for (auto& aln : alns) {
+                auto predictions = run_both(aln, false);
+                REQUIRE(predictions.second == Approx(predictions.first));
+            }
+            // The model has learned something
+            REQUIRE(run_both(alns[0], false).second > run_both(alns[3], false).second);
+        }
+    }
+
+    VW::finish(*text_model);
+    VW::finish(*built_model);
+}
+
+}
+}
@@ -0,0 +1,147 @@
+/** \file
+ *
+ * Unit tests for the Simplifier, which pops small bubbles and keeps paths and
+ * BED features up to date.
+ */
+
+#include <sstream>
+
+#include "../simplifier.hpp"
+#include "../json2pb.h"
+
+#include "catch.hpp"
+
+namespace vg {
+namespace unittest {
+
+using namespace std;
+
+TEST_CASE("Simplifier pops several sites on a path with features", "[simplify]") {
+
+    // 1 -> {2, 3} -> 4 -> {5, 6} -> 7 -> {8, 9} -> 10, with the ref path
+    // through 3, 6 and 9, and the alt path through the others
+    string graph_json = R"(
+    {
+        "node": [
+            {"id": 1, "sequence": "GATTACA"},
+            {"id": 2, "sequence": "A"},
+            {"id": 3, "sequence": "CCC"},
+            {"id": 4, "sequence": "GGGG"},
+            {"id": 5, "sequence": "G"},
+            {"id": 6, "sequence": "TTTT"},
+            {"id": 7, "sequence": "CATCAT"},
+            {"id": 8, "sequence": "TTTTT"},
+            {"id": 9, "sequence": "AC"},
+            {"id": 10, "sequence": "ACGT"}
+        ],
+        "edge": [
+            {"from": 1, "to": 2},
+            {"from": 1, "to": 3},
+            {"from": 2, "to": 4},
+            {"from": 3, "to": 4},
+            {"from": 4, "to": 5},
+            {"from": 4, "to": 6},
+            {"from": 5, "to": 7},
+            {"from": 6, "to": 7},
+            {"from": 7, "to": 8},
+            {"from": 7, "to": 9},
+            {"from": 8, "to": 10},
+            {"from": 9, "to": 10}
+        ],
+        "path": [
+            {"name": "ref", "mapping": [
+                {"position": {"node_id": 1}, "edit": [{"from_length": 7, "to_length": 7}], "rank": 1},
+                {"position": {"node_id": 3}, "edit": [{"from_length": 3, "to_length": 3}], "rank": 2},
+                {"position": {"node_id": 4}, "edit": [{"from_length": 4, "to_length": 4}], "rank": 3},
+                {"position": {"node_id": 6}, "edit": [{"from_length": 4, "to_length": 4}], "rank": 4},
+                {"position": {"node_id": 7}, "edit": [{"from_length": 6, "to_length": 6}], "rank": 5},
+                {"position": {"node_id": 9}, "edit": [{"from_length": 2, "to_length": 2}], "rank": 6},
+                {"position": {"node_id": 10}, "edit": [{"from_length": 4, "to_length": 4}], "rank": 7}
+            ]},
+            {"name": "alt", "mapping": [
+                {"position": {"node_id": 1}, "edit": [{"from_length": 7, "to_length": 7}], "rank": 1},
+                {"position": {"node_id": 2}, "edit": [{"from_length": 1, "to_length": 1}], "rank": 2},
+                {"position": {"node_id": 4}, "edit": [{"from_length": 4, "to_length": 4}], "rank": 3},
+                {"position": {"node_id": 5}, "edit": [{"from_length": 1, "to_length": 1}], "rank": 4},
+                {"position": {"node_id": 7}, "edit": [{"from_length": 6, "to_length": 6}], "rank": 5},
+                {"position": {"node_id": 8}, "edit": [{"from_length": 5, "to_length": 5}], "rank": 6},
+                {"position": {"node_id": 10}, "edit": [{"from_length": 4, "to_length": 4}], "rank": 7}
+            ]}
+        ]
+    }
+    )";
+    Graph proto;
+    json2pb(proto, graph_json.c_str(), graph_json.size());
+    VG graph(proto);
+
+    // On the ref path, node 3 is at 7-9, node 6 at 14-17 and node 9 at 24-25
+    string bed = "ref\t2\t4\tbefore\n"
+                 "ref\t5\t19\tspanning\n"
+                 "ref\t10\t13\tbetween\n"
+                 "ref\t24\t25\tinside\n"
+                 "ref\t26\t29\tafter\n";
+
+    Simplifier simplifier(graph);
+    simplifier.min_size = 10;
+    stringstream bed_in(bed);
+    simplifier.features.load_bed(bed_in);
+    simplifier.simplify();
+
+    REQUIRE(graph.is_valid());
+
+    // Each site keeps whichever of its alleles the traversal finder picked
+    vector<pair<id_t, id_t>> alleles{{2, 3}, {5, 6}, {8, 9}};
+    vector<id_t> kept;
+    for (auto& allele_pair : alleles) {
+        REQUIRE(graph.has_node(allele_pair.first) != graph.has_node(allele_pair.second));
+        kept.push_back(graph.has_node(allele_pair.first) ? allele_pair.first : allele_pair.second);
+    }
+    REQUIRE(graph.node_count() == 7);
+    REQUIRE(graph.edge_count() == 6);
+
+    SECTION("Both paths follow the kept alleles") {
+        vector<id_t> expected{1, kept[0], 4, kept[1], 7, kept[2], 10};
+        for (string path_name : {"ref", "alt"}) {
+            Path path = graph.paths.path(path_name);
+            vector<id_t> visited;
+            for (auto& mapping : path.mapping()) {
+                visited.push_back(mapping.position().node_id());
+                REQUIRE(!mapping.position().is_reverse());
+            }
+            REQUIRE(visited == expected);
+        }
+    }
+
+    SECTION("Features end up where popping one site at a time would put them") {
+        // Pop the sites left to right, moving the features in the
+        // coordinates of the path as it is after each pop
+        FeatureSet one_at_a_time;
+        stringstream expected_in(bed);
+        one_at_a_time.load_bed(expected_in);
+        vector<pair<size_t, size_t>> ref_alleles{{7, 3}, {14, 4}, {24, 2}};
+        int64_t offset = 0;
+        for (size_t i = 0; i < ref_alleles.size(); i++) {
+            size_t new_length = graph.get_node(kept[i])->sequence().size();
+            one_at_a_time.on_path_edit("ref", ref_alleles[i].first + offset, ref_alleles[i].second, new_length);
+            offset += (int64_t) new_length - (int64_t) ref_alleles[i].second;
+        }
+
+        stringstream expected_out;
+        one_at_a_time.save_bed(expected_out);
+        stringstream found_out;
+        simplifier.features.save_bed(found_out);
+        REQUIRE(found_out.str() == expected_out.str());
+
+        // Features off the sites just shift
+        auto& features = simplifier.features.get_features("ref");
+        REQUIRE(features.front().feature_name == "before");
+        REQUIRE(features.front().first == 2);
+        REQUIRE(features.front().last == 4);
+        REQUIRE(features.back().feature_name == "after");
+        REQUIRE((int64_t) features.back().first == 26 + offset);
+        REQUIRE((int64_t) features.back().last == 29 + offset);
+    }
+}
+
+}
+}
@@ -0,0 +1,113 @@
+/**
+ * \file
+ * unittest/stage_stats.cpp: test cases for the mapping stage latency histograms and reports.
+ */
+
+#include "catch.hpp"
+
+#include "../stage_stats.hpp"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace vg {
+namespace unittest {
+
+using namespace std;
+
+TEST_CASE("Stage latency bins cover every latency exactly once", "[stage_stats]") {
+
+    SECTION("Small latencies get a bin each") {
+        for (uint64_t i = 0; i < 16; i++) {
+            REQUIRE(StageStats::bin_of(i) == i);
+            REQUIRE(StageStats::bin_upper_bound(i) == i);
+        }
+    }
+
+    SECTION("Each power of 2 is split in 8 bins") {
+        REQUIRE(StageStats::bin_of(16) == 16);
+        REQUIRE(StageStats::bin_of(17) == 16);
+        REQUIRE(StageStats::bin_of(18) == 17);
+        REQUIRE(StageStats::bin_upper_bound(16) == 17);
+        REQUIRE(StageStats::bin_of(1000) == 63);
+        REQUIRE(StageStats::bin_upper_bound(63) == 1023);
+        REQUIRE(StageStats::bin_of(1024) == 64);
+    }
+
+    SECTION("Each bin ends just before the next one starts") {
+        for (size_t bin = 0; bin + 1 < StageStats::NUM_BINS; bin++) {
+            uint64_t upper = StageStats::bin_upper_bound(bin);
+            REQUIRE(StageStats::bin_of(upper) == bin);
+            REQUIRE(StageStats::bin_of(upper + 1) == bin + 1);
+        }
+    }
+
+    SECTION("The largest latency fits in the last bin") {
+        REQUIRE(StageStats::bin_of(UINT64_MAX) == StageStats::NUM_BINS - 1);
+        REQUIRE(StageStats::bin_upper_bound(StageStats::NUM_BINS - 1) == UINT64_MAX);
+    }
+}
+
+TEST_CASE("Stage reports give percentiles at bin resolution", "[stage_stats]") {
+
+    StageStats::reset();
+
+    // 1 to 100 ns
+    for (uint64_t i = 1; i <= 100; i++) {
+        StageStats::record(STAGE_MAPQ, i, 10);
+    }
+    // One call at the top of a bin and one at the bottom of the next
+    StageStats::record(STAGE_RESCUE, 17, 0);
+    StageStats::record(STAGE_RESCUE, 18, 0);
+
+    SECTION("TSV reports have a header and a line for each stage") {
+        stringstream out;
+        StageStats::write_report(out, false);
+
+        vector<string> lines;
+        string line;
+        while (getline(out, line)) {
+            lines.push_back(line);
+        }
+        REQUIRE(lines.size() == NUM_MAPPING_STAGES + 1);
+        REQUIRE(lines[0] == "#stage\tcalls\ttotal_ns\tmean_ns\tp50_ns\tp90_ns\tp99_ns\tmax_ns\tbytes_allocated");
+        REQUIRE(lines[1 + STAGE_MEM_FINDING] == "mem_finding\t0\t0\t0\t0\t0\t0\t0\t0");
+        // The 50th call, 50 ns, is in the bin ending at 51; the 90th is in
+        // the bin ending at 95; the 99th is in the bin ending at 103, which
+        // is capped at the maximum.
+        REQUIRE(lines[1 + STAGE_MAPQ] == "mapq\t100\t5050\t50\t51\t95\t100\t100\t1000");
+        // The median is at the top of its bin
+        REQUIRE(lines[1 + STAGE_RESCUE] == "rescue\t2\t35\t17\t17\t18\t18\t18\t0");
+    }
+
+    SECTION("JSON reports have an object for each stage") {
+        stringstream out;
+        StageStats::write_report(out, true);
+        string report = out.str();
+
+        REQUIRE(report.substr(0, 23) == "{\"stages\":[{\"stage\":\"me");
+        REQUIRE(report.substr(report.size() - 3) == "]}\n");
+        REQUIRE(report.find("{\"stage\":\"mapq\",\"calls\":100,\"total_ns\":5050,\"mean_ns\":50,"
+                            "\"p50_ns\":51,\"p90_ns\":95,\"p99_ns\":100,\"max_ns\":100,"
+                            "\"bytes_allocated\":1000}") != string::npos);
+        REQUIRE(report.find("},{\"stage\":\"output\",\"calls\":0,") != string::npos);
+    }
+
+    SECTION("Resetting forgets recorded calls") {
+        StageStats::reset();
+        stringstream out;
+        StageStats::write_report(out, false);
+        string line;
+        for (size_t i = 0; i <= STAGE_MAPQ; i++) {
+            getline(out, line);
+        }
+        getline(out, line);
+        REQUIRE(line == "mapq\t0\t0\t0\t0\t0\t0\t0\t0");
+    }
+
+    StageStats::reset();
+}
+
+}
+}
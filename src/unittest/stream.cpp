@@ -219,6 +219,58 @@ static pair<size_t, size_t> unvo(int64_t virtual_offset) {
     return to_return;
 }
 
+TEST_CASE("Protobuf messages of mixed sizes can be read back in parallel", "[stream]") {
+    stringstream datastream;
+    
+    // Mostly short reads, with some long ones mixed in
+    using message_t = Alignment;
+    size_t count = 2001;
+    auto get_message = [&](size_t index) {
+        message_t item;
+        item.set_name(to_string(index));
+        item.set_sequence(string(index % 100 == 0 ? 100000 : 150, 'A'));
+        return item;
+    };
+    
+    REQUIRE(stream::write<message_t>(datastream, count, get_message));
+    stream::finish(datastream);
+    
+    // Catch assertions aren't thread safe, so just record what we see
+    vector<int> times_seen(count, 0);
+    size_t wrong_length = 0;
+    std::function<void(message_t&)> check_message = [&](message_t& item) {
+        size_t index = stoull(item.name());
+        if (item.sequence().size() != (index % 100 == 0 ? 100000 : 150)) {
+#pragma omp atomic update
+            wrong_length++;
+        }
+#pragma omp atomic update
+        times_seen[index]++;
+    };
+    std::function<void(size_t)> no_count = [](size_t) {};
+    
+    stream::ParallelStreamStats stats;
+    stream::for_each_parallel<message_t>(datastream, check_message, no_count, &stats);
+    
+    REQUIRE(wrong_length == 0);
+    for (size_t i = 0; i < count; i++) {
+        REQUIRE(times_seen[i] == 1);
+    }
+    
+    REQUIRE(stats.messages == count);
+    // the long reads are split across batches by size rather than all landing in a few
+    REQUIRE(stats.batches > count / 256 + 1);
+    
+    // batches close at the first pair boundary at or past 256 KiB, counting each message's string
+    size_t max_message_bytes = get_message(0).ByteSize() + sizeof(string);
+    REQUIRE(stats.max_batch_bytes < (1 << 18) + 2 * max_message_bytes);
+    // the reading thread only reads ahead while the batches are under the limit
+    REQUIRE(stats.max_batches_outstanding >= 1);
+    REQUIRE(stats.max_bytes_outstanding < stats.bytes_outstanding_limit + stats.max_batch_bytes);
+    REQUIRE(stats.bytes_outstanding_limit >= (1 << 26));
+    REQUIRE(stats.bytes_outstanding_limit <= (1ull << 31));
+}
+
 TEST_CASE("ProtobufIterator can read serialized data", "[stream]") {
     stringstream datastream;
 
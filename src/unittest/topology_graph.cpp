@@ -0,0 +1,202 @@
+/**
+ * \file
+ * unittest/topology_graph.cpp: test cases for the TopologyGraph and NodeIdTranslation.
+ */
+
+#include "catch.hpp"
+
+#include "../topology_graph.hpp"
+#include "../json2pb.h"
+#include "../stream.hpp"
+#include "../algorithms/topological_sort.hpp"
+
+#include <sstream>
+#include <unordered_map>
+#include <algorithm>
+
+namespace vg {
+namespace unittest {
+
+using namespace std;
+
+TEST_CASE("TopologyGraph holds the topology of a graph", "[topology_graph]") {
+
+    // 1 -> 3 -> 2, with 3 also reversing into 4 and an edge to a node that
+    // isn't there.
+    string graph_json = R"(
+    {
+        "node": [
+            {"id": 3, "sequence": "GATT"},
+            {"id": 1, "sequence": "A"},
+            {"id": 2, "sequence": "CA"}
+        ],
+        "edge": [
+            {"from": 1, "to": 3},
+            {"from": 3, "to": 2},
+            {"from": 3, "to": 2},
+            {"from": 3, "to": 4, "to_end": true},
+            {"from": 2, "to": 10}
+        ]
+    }
+    )";
+    Graph chunk;
+    json2pb(chunk, graph_json.c_str(), graph_json.size());
+
+    // Node 4 comes in another chunk
+    string other_json = R"({"node": [{"id": 4, "sequence": "CCC"}]})";
+    Graph other_chunk;
+    json2pb(other_chunk, other_json.c_str(), other_json.size());
+
+    TopologyGraph graph;
+    graph.add_chunk(chunk);
+    graph.add_chunk(other_chunk);
+    graph.finish();
+
+    REQUIRE(graph.node_size() == 4);
+    REQUIRE(graph.node_ids() == vector<id_t>({1, 2, 3, 4}));
+    REQUIRE(graph.has_node(4));
+    REQUIRE(!graph.has_node(10));
+
+    handle_t h3 = graph.get_handle(3, false);
+    REQUIRE(graph.get_id(h3) == 3);
+    REQUIRE(!graph.get_is_reverse(h3));
+    REQUIRE(graph.get_is_reverse(graph.flip(h3)));
+    REQUIRE(graph.get_length(h3) == 4);
+    REQUIRE(graph.get_length(graph.get_handle(2, true)) == 2);
+    REQUIRE_THROWS(graph.get_sequence(h3));
+
+    typedef vector<pair<id_t, bool>> neighbor_list;
+    auto neighbors = [&](id_t id, bool is_reverse, bool go_left) {
+        neighbor_list found;
+        graph.follow_edges(graph.get_handle(id, is_reverse), go_left, [&](const handle_t& other) {
+            found.emplace_back(graph.get_id(other), graph.get_is_reverse(other));
+        });
+        sort(found.begin(), found.end());
+        return found;
+    };
+
+    SECTION("Edges can be followed both ways, without duplicates or dangling edges") {
+        REQUIRE(neighbors(3, false, false) == neighbor_list({{2, false}, {4, true}}));
+        REQUIRE(neighbors(3, false, true) == neighbor_list({{1, false}}));
+        REQUIRE(neighbors(2, false, true) == neighbor_list({{3, false}}));
+        REQUIRE(neighbors(2, false, false).empty());
+        REQUIRE(neighbors(4, false, false) == neighbor_list({{3, true}}));
+        REQUIRE(neighbors(4, true, true) == neighbor_list({{3, false}}));
+        REQUIRE(neighbors(1, true, true) == neighbor_list({{3, true}}));
+    }
+
+    SECTION("Handles are visited in ID order") {
+        vector<id_t> seen;
+        graph.for_each_handle([&](const handle_t& handle) {
+            seen.push_back(graph.get_id(handle));
+        });
+        REQUIRE(seen == vector<id_t>({1, 2, 3, 4}));
+    }
+
+    SECTION("A topological order of the TopologyGraph is consistent") {
+        auto order = algorithms::topological_order(&graph);
+        REQUIRE(order.size() == 4);
+
+        unordered_map<id_t, handle_t> oriented;
+        for (auto& handle : order) {
+            graph.follow_edges(handle, true, [&](const handle_t& prev) {
+                REQUIRE(oriented.count(graph.get_id(prev)) != 0);
+                REQUIRE(oriented.at(graph.get_id(prev)) == prev);
+            });
+            oriented.insert(make_pair(graph.get_id(handle), handle));
+        }
+    }
+
+    SECTION("A graph read from a stream matches one built from chunks") {
+        stringstream stream_data;
+        vector<Graph> chunks{chunk, other_chunk};
+        stream::write_buffered(stream_data, chunks, 0);
+
+        TopologyGraph streamed(stream_data);
+        REQUIRE(streamed.node_ids() == graph.node_ids());
+        vector<id_t> right_of_3;
+        streamed.follow_edges(streamed.get_handle(3, false), false, [&](const handle_t& other) {
+            right_of_3.push_back(streamed.get_id(other));
+        });
+        sort(right_of_3.begin(), right_of_3.end());
+        REQUIRE(right_of_3 == vector<id_t>({2, 4}));
+    }
+}
+
+TEST_CASE("NodeIdTranslation renumbers graphs and alignments", "[topology_graph]") {
+
+    string graph_json = R"(
+    {
+        "node": [
+            {"id": 5, "sequence": "GATT"},
+            {"id": 7, "sequence": "A"},
+            {"id": 9, "sequence": "CA"}
+        ],
+        "edge": [
+            {"from": 7, "to": 9},
+            {"from": 9, "to": 5}
+        ],
+        "path": [
+            {"name": "p", "mapping": [
+                {"position": {"node_id": 7}, "edit": [{"from_length": 1, "to_length": 1}], "rank": 1},
+                {"position": {"node_id": 9}, "edit": [{"from_length": 2, "to_length": 2}], "rank": 2},
+                {"position": {"node_id": 5}, "edit": [{"from_length": 4, "to_length": 4}], "rank": 3}
+            ]}
+        ]
+    }
+    )";
+    Graph chunk;
+    json2pb(chunk, graph_json.c_str(), graph_json.size());
+
+    TopologyGraph graph;
+    graph.add_chunk(chunk);
+    graph.finish();
+
+    // Number in the order 7, 9, 5, after 100
+    vector<handle_t> order{graph.get_handle(7), graph.get_handle(9), graph.get_handle(5)};
+    NodeIdTranslation translation(graph, order, 100);
+
+    REQUIRE(translation.translate(7) == 101);
+    REQUIRE(translation.translate(9) == 102);
+    REQUIRE(translation.translate(5) == 103);
+    REQUIRE(translation.translate(6) == 0);
+
+    SECTION("A graph chunk is renumbered and its nodes put in order") {
+        translation.apply(chunk);
+        REQUIRE(chunk.node_size() == 3);
+        for (size_t i = 0; i < chunk.node_size(); i++) {
+            REQUIRE(chunk.node(i).id() == 101 + i);
+        }
+        REQUIRE(chunk.node(0).sequence() == "A");
+        REQUIRE(chunk.edge(0).from() == 101);
+        REQUIRE(chunk.edge(0).to() == 102);
+        REQUIRE(chunk.edge(1).from() == 102);
+        REQUIRE(chunk.edge(1).to() == 103);
+        REQUIRE(chunk.path(0).mapping(0).position().node_id() == 101);
+        REQUIRE(chunk.path(0).mapping(2).position().node_id() == 103);
+    }
+
+    SECTION("Alignments are renumbered only if all their nodes are known") {
+        Alignment aln;
+        aln.mutable_path()->add_mapping()->mutable_position()->set_node_id(9);
+        aln.mutable_path()->add_mapping()->mutable_position()->set_node_id(5);
+        REQUIRE(translation.apply(aln));
+        REQUIRE(aln.path().mapping(0).position().node_id() == 102);
+        REQUIRE(aln.path().mapping(1).position().node_id() == 103);
+
+        Alignment off_graph;
+        off_graph.mutable_path()->add_mapping()->mutable_position()->set_node_id(9);
+        off_graph.mutable_path()->add_mapping()->mutable_position()->set_node_id(6);
+        REQUIRE(!translation.apply(off_graph));
+        REQUIRE(off_graph.path().mapping(0).position().node_id() == 9);
+    }
+
+    SECTION("The table is written in order of old ID") {
+        stringstream out;
+        translation.write_tsv(out);
+        REQUIRE(out.str() == "5\t103\n7\t101\n9\t102\n");
+    }
+}
+
+}
+}
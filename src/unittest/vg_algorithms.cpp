@@ -24,6 +24,7 @@
 #include "algorithms/count_walks.hpp"
 #include "algorithms/strongly_connected_components.hpp"
 #include "vg.hpp"
+#include "sub_handle_graph.hpp"
 #include "json2pb.h"
 
 
@@ -2532,6 +2533,86 @@ namespace vg {
             }
         }
         
+        TEST_CASE( "Containing graph searches report only the edges they traverse", "[algorithms]" ) {
+            
+            VG vg;
+            
+            Node* n0 = vg.create_node("GATT");
+            Node* n1 = vg.create_node("ACAGATTACA");
+            Node* n2 = vg.create_node("CATTAGACAT");
+            
+            vg.create_edge(n0, n1);
+            vg.create_edge(n0, n2);
+            // a back edge between the two nodes the search stops at
+            vg.create_edge(n2, n1);
+            
+            handle_t h0 = vg.get_handle(n0->id());
+            handle_t h1 = vg.get_handle(n1->id());
+            handle_t h2 = vg.get_handle(n2->id());
+            
+            vector<pos_t> positions{make_pos_t(n0->id(), false, 0)};
+            vector<size_t> forward_max_lens{6};
+            vector<size_t> backward_max_lens{0};
+            
+            unordered_set<edge_t> edges;
+            vector<id_t> node_ids = algorithms::containing_graph_node_ids(&vg, positions, forward_max_lens,
+                                                                          backward_max_lens, &edges);
+            
+            SECTION( "The search reaches all the nodes but does not take the back edge" ) {
+                REQUIRE(node_ids == vector<id_t>({n0->id(), n1->id(), n2->id()}));
+                REQUIRE(edges.size() == 2);
+                REQUIRE(edges.count(vg.edge_handle(h0, h1)));
+                REQUIRE(edges.count(vg.edge_handle(h0, h2)));
+                
+                // the same as extracting the graph
+                VG extractor;
+                algorithms::extract_containing_graph(&vg, &extractor, positions, forward_max_lens, backward_max_lens);
+                REQUIRE(extractor.graph.node_size() == 3);
+                REQUIRE(extractor.graph.edge_size() == 2);
+            }
+            
+            SECTION( "A view given the traversed edges hides the back edge" ) {
+                SubHandleGraph subgraph(&vg, node_ids, edges);
+                REQUIRE(subgraph.has_edge(h0, h1));
+                REQUIRE(subgraph.has_edge(subgraph.flip(h1), subgraph.flip(h0)));
+                REQUIRE(!subgraph.has_edge(h2, h1));
+                
+                vector<handle_t> prevs;
+                subgraph.follow_edges(h1, true, [&](const handle_t& prev) {
+                    prevs.push_back(prev);
+                });
+                REQUIRE(prevs.size() == 1);
+                REQUIRE(prevs.front() == h0);
+                
+                size_t nexts = 0;
+                subgraph.follow_edges(h2, false, [&](const handle_t& next) {
+                    nexts++;
+                });
+                REQUIRE(nexts == 0);
+                
+                SECTION( "Views of parts of it keep hiding the back edge" ) {
+                    SubHandleGraph part = subgraph.subgraph(vector<id_t>{n1->id(), n2->id()});
+                    REQUIRE(part.node_size() == 2);
+                    REQUIRE(!part.has_edge(h2, h1));
+                    
+                    part.extend(subgraph);
+                    REQUIRE(part.has_edge(h0, h2));
+                    REQUIRE(!part.has_edge(h2, h1));
+                }
+            }
+            
+            SECTION( "The induced view has the back edge" ) {
+                SubHandleGraph subgraph(&vg, node_ids);
+                REQUIRE(subgraph.has_edge(h2, h1));
+                
+                vector<handle_t> prevs;
+                subgraph.follow_edges(h1, true, [&](const handle_t& prev) {
+                    prevs.push_back(prev);
+                });
+                REQUIRE(prevs.size() == 2);
+            }
+        }
+        
         TEST_CASE( "Extending graph extraction algorithm produces expected results", "[algorithms]" ) {
             
             VG vg;
@@ -678,5 +678,114 @@ TEST_CASE("Path component memoization produces expected results", "[xg]") {
     }
 }
 
+
+TEST_CASE("Threads can be stored in an xg index on a graph with a cycle and an inversion", "[xg]") {
+
+    // 2 and 3 form a cycle, and 3 connects to the end of 4
+    string graph_json = R"(
+    {"node":[{"id":1,"sequence":"GATT"},
+    {"id":2,"sequence":"ACA"},
+    {"id":3,"sequence":"CT"},
+    {"id":4,"sequence":"GGA"}],
+    "edge":[{"from":1,"to":2},
+    {"from":2,"to":3},
+    {"from":3,"to":2},
+    {"from":3,"to":4,"to_end":true}],
+    "path":[
+    {"name":"loop","mapping":[
+    {"position":{"node_id":1},"rank":1},
+    {"position":{"node_id":2},"rank":2},
+    {"position":{"node_id":3},"rank":3},
+    {"position":{"node_id":2},"rank":4},
+    {"position":{"node_id":3},"rank":5},
+    {"position":{"node_id":2},"rank":6},
+    {"position":{"node_id":3},"rank":7},
+    {"position":{"node_id":4,"is_reverse":true},"rank":8}]},
+    {"name":"straight","mapping":[
+    {"position":{"node_id":1},"rank":1},
+    {"position":{"node_id":2},"rank":2},
+    {"position":{"node_id":3},"rank":3},
+    {"position":{"node_id":4,"is_reverse":true},"rank":4}]},
+    {"name":"backward","mapping":[
+    {"position":{"node_id":4},"rank":1},
+    {"position":{"node_id":3,"is_reverse":true},"rank":2},
+    {"position":{"node_id":2,"is_reverse":true},"rank":3},
+    {"position":{"node_id":3,"is_reverse":true},"rank":4}]}
+    ]}
+    )";
+    
+    Graph proto_graph;
+    json2pb(proto_graph, graph_json.c_str(), graph_json.size());
+    
+    // Store the threads without claiming to be a sorted DAG
+    xg::XG xg_index;
+    xg_index.from_graph(proto_graph, false, false, true, false);
+    
+    map<string, vector<pair<int64_t, bool>>> expected {
+        {"loop", {{1, false}, {2, false}, {3, false}, {2, false}, {3, false}, {2, false}, {3, false}, {4, true}}},
+        {"straight", {{1, false}, {2, false}, {3, false}, {4, true}}},
+        {"backward", {{4, false}, {3, true}, {2, true}, {3, true}}}
+    };
+    
+    auto threads = xg_index.extract_threads(false);
+    REQUIRE(threads.size() == expected.size());
+    
+    for (auto& kv : expected) {
+        REQUIRE(threads.count(kv.first));
+        REQUIRE(threads[kv.first].size() == 1);
+        auto& thread = threads[kv.first].front();
+        REQUIRE(thread.size() == kv.second.size());
+        for (size_t i = 0; i < thread.size(); i++) {
+            REQUIRE(thread[i].node_id == kv.second[i].first);
+            REQUIRE(thread[i].is_reverse == kv.second[i].second);
+        }
+        
+        // The backward thread also appears in the reverse of the loop
+        REQUIRE(xg_index.count_matches(thread) == (kv.first == "backward" ? 2 : 1));
+    }
+    
+    SECTION("Shared stretches of threads are counted together") {
+        xg::XG::thread_t stretch {{2, false}, {3, false}};
+        // Three times around the loop, once straight through, and once in the
+        // reverse of the backward thread
+        REQUIRE(xg_index.count_matches(stretch) == 5);
+        
+        xg::XG::thread_t reverse_stretch {{3, true}, {2, true}};
+        // The reverse of all of those
+        REQUIRE(xg_index.count_matches(reverse_stretch) == 5);
+    }
+    
+    SECTION("Subthreads can be counted in a batch") {
+        vector<xg::XG::thread_t> batch {
+            {{2, false}, {3, false}, {2, false}},
+            {{2, false}, {3, false}},
+            {},
+            {{4, false}, {3, true}, {2, true}, {3, true}},
+            {{2, false}, {3, false}, {4, true}},
+            {{2, false}},
+            {{2, false}, {3, false}, {2, false}},
+            {{2, false}, {3, false}, {2, false}, {3, false}, {2, false}, {3, false}, {2, false}},
+            {{4, false}, {3, true}}
+        };
+        
+        auto counts = xg_index.count_matches(batch);
+        REQUIRE(counts.size() == batch.size());
+        for (size_t i = 0; i < batch.size(); i++) {
+            // Each count must match the count from searching alone
+            REQUIRE(counts[i] == xg_index.count_matches(batch[i]));
+        }
+        
+        REQUIRE(counts[0] == 2);
+        REQUIRE(counts[1] == 5);
+        // Nothing goes around the loop that many times
+        REQUIRE(counts[7] == 0);
+        
+        auto states = xg_index.extend_searches(batch);
+        REQUIRE(states[0].current_side == states[6].current_side);
+        REQUIRE(states[0].range_start == states[6].range_start);
+        REQUIRE(states[0].range_end == states[6].range_end);
+    }
+}
+
 }
 }
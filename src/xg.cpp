@@ -929,8 +929,7 @@ void XG::build(vector<pair<id_t, string> >& node_label,
         cerr << "storing threads" << endl;
 #endif
     
-        // If we're a sorted DAG we'll batch up the paths and use a batch
-        // insert.
+        // We'll batch up the paths and use a batch insert.
         vector<thread_t> batch;
         vector<string> batch_names;
     
@@ -948,12 +947,9 @@ void XG::build(vector<pair<id_t, string> >& node_label,
             }
             
 #if GPBWT_MODE == MODE_SDSL
-            if(is_sorted_dag) {
-                // Save for a batch insert
-                batch.push_back(reconstructed);
-                batch_names.push_back(pathpair.first);
-            }
-            // TODO: else case!
+            // Save for a batch insert
+            batch.push_back(reconstructed);
+            batch_names.push_back(pathpair.first);
 #elif GPBWT_MODE == MODE_DYNAMIC
             // Insert the thread right now
             insert_thread(reconstructed, pathpair.first);
@@ -965,8 +961,11 @@ void XG::build(vector<pair<id_t, string> >& node_label,
         if(is_sorted_dag) {
             // Do the batch insert
             insert_threads_into_dag(batch, batch_names);
+        } else {
+            // Threads can come back to nodes they have visited, so use the
+            // general batch insert.
+            insert_threads_into_graph(batch, batch_names);
         }
-        // TODO: else case!
 #endif
         util::assign(h_civ, h_iv);
         util::assign(ts_civ, ts_iv);
@@ -1120,11 +1119,7 @@ void XG::build(vector<pair<id_t, string> >& node_label,
         }
         node_label.clear();
         
-#if GPBWT_MODE == MODE_SDSL
-        if(store_threads && is_sorted_dag) {
-#elif GPBWT_MODE == MODE_DYNAMIC
         if(store_threads) {
-#endif
         
             cerr << "validating threads" << endl;
             
@@ -4477,6 +4472,258 @@ void XG::insert_threads_into_dag(const vector<thread_t>& t, const vector<string>
     construct_im(side_thread_wt, sides_ordered_by_thread_id);
 }
 
+void XG::insert_threads_into_graph(const vector<thread_t>& t, const vector<string>& names) {
+
+    util::assign(h_iv, int_vector<>(g_iv.size() * 2, 0));
+    util::assign(ts_iv, int_vector<>((node_count + 1) * 2, 0));
+
+    set_thread_names(names);
+    
+    // We insert every thread forward and then every thread in reverse, in the
+    // same order the DAG insert uses. Orientation o is thread o % t.size(),
+    // reversed if o >= t.size(). We number all the visits of all the
+    // orientations, with each orientation's visits numbered consecutively.
+    size_t orientation_count = t.size() * 2;
+    vector<size_t> orientation_start(orientation_count + 1, 0);
+    for (size_t o = 0; o < orientation_count; o++) {
+        orientation_start[o + 1] = orientation_start[o] + t[o % t.size()].size();
+    }
+    size_t visit_count = orientation_start.back();
+    
+    // Get the mapping for a step along a thread orientation
+    auto get_mapping = [&](size_t o, size_t step) -> ThreadMapping {
+        const thread_t& thread = t[o % t.size()];
+        if (o < t.size()) {
+            return thread[step];
+        } else {
+            ThreadMapping flipped = thread[thread.size() - 1 - step];
+            flipped.is_reverse = !flipped.is_reverse;
+            return flipped;
+        }
+    };
+    
+    // Find which edge, of the edges in the given order, a thread crosses
+    auto find_edge = [&](const vector<Edge>& edges, const Edge& wanted) -> int64_t {
+        for (size_t i = 0; i < edges.size(); i++) {
+            if (edges_equivalent(edges[i], wanted)) {
+                return (int64_t) i;
+            }
+        }
+        // We can't throw out of the parallel loop, so bail out here.
+#pragma omp critical (cerr)
+        cerr << "[xg] error: thread follows nonexistent edge " << wanted.from() << (wanted.from_start() ? "L" : "R")
+             << "-" << wanted.to() << (wanted.to_end() ? "R" : "L") << endl;
+        exit(1);
+        return (int64_t) -1;
+    };
+    
+    // For each visit, the side it visits, how far along its orientation it is,
+    // its B_s destination, and the oriented edge it leaves along (or -1)
+    vector<size_t> visit_side(visit_count);
+    vector<size_t> visit_step(visit_count);
+    vector<destination_t> visit_destination(visit_count);
+    vector<int64_t> visit_edge_out(visit_count);
+    // Visits are ordered on a side by whether they start there (0) or by the
+    // edge they arrived along (1 + its index among the edges into the side,
+    // in the order that where_to counts them)
+    vector<size_t> visit_arrival(visit_count);
+    
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t o = 0; o < orientation_count; o++) {
+        size_t length = orientation_start[o + 1] - orientation_start[o];
+        for (size_t step = 0; step < length; step++) {
+            size_t v = orientation_start[o] + step;
+            ThreadMapping here = get_mapping(o, step);
+            visit_side[v] = id_rev_to_side(here.node_id, here.is_reverse);
+            visit_step[v] = step;
+            
+            if (step == 0) {
+                visit_arrival[v] = 0;
+            } else {
+                ThreadMapping prev = get_mapping(o, step - 1);
+                vector<Edge> edges_in = here.is_reverse ? edges_on_end(here.node_id) : edges_on_start(here.node_id);
+                visit_arrival[v] = 1 + find_edge(edges_in, make_edge(prev.node_id, prev.is_reverse,
+                                                                     here.node_id, here.is_reverse));
+            }
+            
+            if (step + 1 == length) {
+                visit_destination[v] = BS_NULL;
+                visit_edge_out[v] = -1;
+            } else {
+                ThreadMapping next = get_mapping(o, step + 1);
+                vector<Edge> edges_out = here.is_reverse ? edges_on_start(here.node_id) : edges_on_end(here.node_id);
+                int64_t edge_taken_index = find_edge(edges_out, make_edge(here.node_id, here.is_reverse,
+                                                                          next.node_id, next.is_reverse));
+                // Leave room in the number space for the separators and null destinations.
+                visit_destination[v] = edge_taken_index + 2;
+                visit_edge_out[v] = edge_graph_idx(edges_out[edge_taken_index]) * 2
+                    + depart_by_reverse(edges_out[edge_taken_index], here.node_id, here.is_reverse);
+            }
+        }
+    }
+    
+    // Within a side, the visits are ordered by their arrival, and then, among
+    // those that arrived along the same edge, by the order of their previous
+    // visits on the side they came from. So a visit's place is determined by
+    // the whole history of its thread back to its start, and we can find all
+    // the places at once by prefix doubling, as in suffix array construction.
+    
+    // Bucket the visits by side
+    size_t side_count = (node_count + 1) * 2;
+    vector<size_t> side_start(side_count + 1, 0);
+    for (size_t v = 0; v < visit_count; v++) {
+        side_start[visit_side[v] + 1]++;
+    }
+    for (size_t side = 0; side < side_count; side++) {
+        side_start[side + 1] += side_start[side];
+    }
+    vector<size_t> order(visit_count);
+    {
+        vector<size_t> next_slot(side_start.begin(), side_start.end() - 1);
+        for (size_t v = 0; v < visit_count; v++) {
+            order[next_slot[visit_side[v]]++] = v;
+        }
+    }
+    
+    // Then sort each side by arrival. Starts are ordered by orientation, which
+    // is the order of their visit numbers.
+    auto arrival_less = [&](const size_t& a, const size_t& b) {
+        return visit_arrival[a] < visit_arrival[b] || (visit_arrival[a] == 0 && visit_arrival[b] == 0 && a < b);
+    };
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t side = 0; side < side_count; side++) {
+        std::sort(order.begin() + side_start[side], order.begin() + side_start[side + 1], arrival_less);
+    }
+    
+    // Each visit's rank is the index in order of the first visit that it
+    // can't yet be told apart from. Groups of more than one such visit are
+    // kept as [begin, end) ranges of order to refine.
+    vector<size_t> rank(visit_count);
+    vector<pair<size_t, size_t>> unresolved;
+    for (size_t side = 0; side < side_count; side++) {
+        for (size_t i = side_start[side]; i < side_start[side + 1];) {
+            size_t j = i + 1;
+            while (j < side_start[side + 1] && visit_arrival[order[j]] != 0 &&
+                   visit_arrival[order[j]] == visit_arrival[order[i]]) {
+                j++;
+            }
+            for (size_t k = i; k < j; k++) {
+                rank[order[k]] = i;
+            }
+            if (j - i > 1) {
+                unresolved.emplace_back(i, j);
+            }
+            i = j;
+        }
+    }
+    vector<size_t>().swap(visit_arrival);
+    
+    // Now double the length of thread history that the ranks account for
+    // until every visit has its own rank. The visits in a group share a rank
+    // for the last h steps of history, so they are ordered by the ranks of
+    // the visits h steps earlier.
+    vector<size_t> history_rank(visit_count);
+    for (size_t h = 1; !unresolved.empty(); h *= 2) {
+        
+        // Look up the earlier ranks before any of them change
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t g = 0; g < unresolved.size(); g++) {
+            for (size_t i = unresolved[g].first; i < unresolved[g].second; i++) {
+                size_t v = order[i];
+                // A visit with less than h steps of history would already be
+                // unique, since it includes its start
+                history_rank[v] = visit_step[v] >= h ? rank[v - h] : 0;
+            }
+        }
+        
+        vector<pair<size_t, size_t>> still_unresolved;
+#pragma omp parallel
+        {
+            vector<pair<size_t, size_t>> thread_unresolved;
+#pragma omp for schedule(dynamic, 1)
+            for (size_t g = 0; g < unresolved.size(); g++) {
+                size_t begin = unresolved[g].first, end = unresolved[g].second;
+                std::sort(order.begin() + begin, order.begin() + end, [&](const size_t& a, const size_t& b) {
+                    return history_rank[a] < history_rank[b];
+                });
+                for (size_t i = begin; i < end;) {
+                    size_t j = i + 1;
+                    while (j < end && history_rank[order[j]] == history_rank[order[i]]) {
+                        j++;
+                    }
+                    for (size_t k = i; k < j; k++) {
+                        rank[order[k]] = i;
+                    }
+                    if (j - i > 1) {
+                        thread_unresolved.emplace_back(i, j);
+                    }
+                    i = j;
+                }
+            }
+#pragma omp critical (xg_unresolved_visits)
+            still_unresolved.insert(still_unresolved.end(), thread_unresolved.begin(), thread_unresolved.end());
+        }
+        unresolved = std::move(still_unresolved);
+    }
+    vector<size_t>().swap(history_rank);
+    vector<size_t>().swap(visit_step);
+    
+    // Now order lists every side's visits in B_s order
+    for (size_t side = 2; side < side_count; side++) {
+        if (side_start[side] == side_start[side + 1]) {
+            continue;
+        }
+        vector<destination_t> destinations;
+        destinations.reserve(side_start[side + 1] - side_start[side]);
+        for (size_t i = side_start[side]; i < side_start[side + 1]; i++) {
+            destinations.push_back(visit_destination[order[i]]);
+        }
+        bs_set(side, destinations);
+        
+        // Set the number of total visits to this side.
+        h_iv[node_graph_idx(rank_to_id(side / 2)) * 2 + side % 2] = destinations.size();
+    }
+    
+    // Count the traversals of each oriented edge
+    for (size_t v = 0; v < visit_count; v++) {
+        if (visit_edge_out[v] != -1) {
+            h_iv[visit_edge_out[v]]++;
+        }
+    }
+    
+    // Record where each orientation starts: its node, and its place among the
+    // threads that start on that side
+    int_vector<> sides_ordered_by_thread_id(orientation_count);
+    int_vector<> tin_iv(orientation_count + 2);
+    int_vector<> tio_iv(orientation_count + 2);
+    size_t thread_count = 0;
+    for (size_t o = 0; o < orientation_count; o++) {
+        if (orientation_start[o] == orientation_start[o + 1]) {
+            continue;
+        }
+        size_t v = orientation_start[o];
+        size_t side = visit_side[v];
+        ts_iv[side]++;
+        sides_ordered_by_thread_id[thread_count++] = side;
+        
+        int k = 2 * (o % t.size() + 1) + (o >= t.size());
+        tin_iv[k] = rank_to_id(side / 2);
+        tio_iv[k] = rank[v] - side_start[side];
+    }
+    
+    // Actually build the B_s arrays for rank and select.
+    bs_bake();
+    // compress the visit counts
+    util::assign(h_civ, h_iv);
+    util::assign(ts_civ, ts_iv);
+    // compress the starts for the threads
+    util::assign(tin_civ, int_vector<>(tin_iv));
+    util::assign(tio_civ, int_vector<>(tio_iv));
+    util::bit_compress(sides_ordered_by_thread_id);
+    // and build up the side wt
+    construct_im(side_thread_wt, sides_ordered_by_thread_id);
+}
+
 void XG::insert_thread(const thread_t& t, const string& name) {
     // We're going to insert this thread
     
@@ -5118,6 +5365,15 @@ size_t XG::count_matches(const Path& t) const {
     return count_matches(thread);
 }
 
+vector<size_t> XG::count_matches(const vector<thread_t>& threads) const {
+    vector<size_t> counts;
+    counts.reserve(threads.size());
+    for (auto& state : extend_searches(threads)) {
+        counts.push_back(state.count());
+    }
+    return counts;
+}
+
 void XG::extend_search(ThreadSearchState& state, const thread_t& t) const {
     
 #ifdef VERBOSE_DEBUG
@@ -5148,50 +5404,113 @@ void XG::extend_search(ThreadSearchState& state, const thread_t& t) const {
             break;
         }
         
-        // TODO: make this mapping to side thing a function
-        int64_t next_id = mapping.node_id;
-        bool next_is_reverse = mapping.is_reverse;
-        int64_t next_side = id_to_rank(next_id) * 2 + next_is_reverse;
-        
+        extend_search_to_side(state, id_rev_to_side(mapping.node_id, mapping.is_reverse));
+    }
+}
+
+void XG::extend_search_to_side(ThreadSearchState& state, int64_t next_side) const {
+    if(state.is_empty()) {
+        // Don't bother trying to extend empty things.
+        return;
+    }
+    
+    if(next_side < 2) {
+        // The node isn't in the graph, so no threads can visit it.
+        state.range_end = state.range_start;
+        return;
+    }
+    
+    int64_t next_id = rank_to_id(next_side / 2);
+    bool next_is_reverse = next_side % 2;
+    
 #ifdef VERBOSE_DEBUG
-        cerr << "Extend mapping to " << state.current_side << " range " << state.range_start << " to " << state.range_end << " with " << next_side << endl;
+    cerr << "Extend mapping to " << state.current_side << " range " << state.range_start << " to " << state.range_end << " with " << next_side << endl;
 #endif
+    
+    if(state.current_side == 0) {
+        // If the state is a start state, just select the whole node using
+        // the node usage count in this orientation. TODO: orientation not
+        // really important unless we're going to search during a path
+        // addition.
+        state.range_start = 0;
+        state.range_end = h_civ.size() ? h_civ[node_graph_idx(next_id) * 2 + next_is_reverse] : 0;
         
-        if(state.current_side == 0) {
-            // If the state is a start state, just select the whole node using
-            // the node usage count in this orientation. TODO: orientation not
-            // really important unless we're going to search during a path
-            // addition.
-            state.range_start = 0;
-            state.range_end = h_civ.size() ? h_civ[node_graph_idx(next_id) * 2 + next_is_reverse] : 0;
-            
 #ifdef VERBOSE_DEBUG
-            cerr << "\tFound " << state.range_end << " threads present here." << endl;
-            
-            int64_t here = node_graph_idx(next_id) * 2 + next_is_reverse;
-            cerr << here << endl;
-            for(int64_t i = here - 5; i < here + 5; i++) {
-                if(i >= 0) {
-                    cerr << "\t\t" << (i == here ? "*" : " ") << "h_civ[" << i << "] = " << h_civ[i] << endl;
-                }
-            }
-            
+        cerr << "\tFound " << state.range_end << " threads present here." << endl;
 #endif
-            
-        } else {
-            // Else, look at where the path goes to and apply the where_to function to shrink the range down.
-            state.range_start = where_to(state.current_side, state.range_start, next_side);
-            state.range_end = where_to(state.current_side, state.range_end, next_side);
-            
+        
+    } else {
+        // Else, look at where the path goes to and apply the where_to function
+        // to shrink the range down. Both ends of the range cross the same
+        // edge, so we only need to look up the edges around it once.
+        int64_t old_id = rank_to_id(state.current_side / 2);
+        bool old_is_reverse = state.current_side % 2;
+        vector<Edge> edges_into_new = next_is_reverse ? edges_on_end(next_id) : edges_on_start(next_id);
+        vector<Edge> edges_out_of_old = old_is_reverse ? edges_on_start(old_id) : edges_on_end(old_id);
+        
+        state.range_start = where_to(state.current_side, state.range_start, next_side, edges_into_new, edges_out_of_old);
+        state.range_end = where_to(state.current_side, state.range_end, next_side, edges_into_new, edges_out_of_old);
+        
 #ifdef VERBOSE_DEBUG
-            cerr << "\tFound " << state.range_start << " to " << state.range_end << " threads continuing through." << endl;
+        cerr << "\tFound " << state.range_start << " to " << state.range_end << " threads continuing through." << endl;
 #endif
-            
+        
+    }
+    
+    // Update the side that the state is on
+    state.current_side = next_side;
+}
+
+vector<XG::ThreadSearchState> XG::extend_searches(const vector<thread_t>& threads) const {
+    // Work out the sides each subthread visits
+    vector<vector<int64_t>> thread_sides(threads.size());
+    for (size_t i = 0; i < threads.size(); i++) {
+        thread_sides[i].reserve(threads[i].size());
+        for (auto& mapping : threads[i]) {
+            thread_sides[i].push_back(id_rev_to_side(mapping.node_id, mapping.is_reverse));
+        }
+    }
+    
+    // Visit the subthreads in sorted order, which is a depth-first walk of the
+    // trie they make.
+    vector<size_t> order(threads.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](const size_t& a, const size_t& b) {
+        return thread_sides[a] < thread_sides[b];
+    });
+    
+    vector<ThreadSearchState> results(threads.size());
+    
+    // The search states for each prefix of the last subthread searched,
+    // starting with the un-started search for the empty prefix.
+    vector<ThreadSearchState> prefix_states(1);
+    const vector<int64_t>* previous = nullptr;
+    
+    for (size_t i : order) {
+        const vector<int64_t>& sides = thread_sides[i];
+        
+        // Keep the states for the prefix we share with the last subthread
+        size_t shared = 0;
+        if (previous != nullptr) {
+            while (shared < sides.size() && shared < previous->size() && sides[shared] == (*previous)[shared]) {
+                shared++;
+            }
         }
+        prefix_states.resize(shared + 1);
         
-        // Update the side that the state is on
-        state.current_side = next_side;
+        // And search the rest
+        for (size_t j = shared; j < sides.size(); j++) {
+            prefix_states.push_back(prefix_states.back());
+            extend_search_to_side(prefix_states.back(), sides[j]);
+        }
+        
+        results[i] = prefix_states.back();
+        previous = &sides;
     }
+    
+    return results;
 }
 
 void XG::extend_search(ThreadSearchState& state, const ThreadMapping& t) const {
@@ -97,7 +97,8 @@ public:
     // The function passed in here is responsible for looping.
     // If is_sorted_dag is true and store_threads is true, we store the threads
     // with an algorithm that only works on topologically sorted DAGs, but which
-    // is faster.
+    // is faster. Otherwise we store them with a batch insert that handles any
+    // graph.
     void from_callback(function<void(function<void(Graph&)>)> get_chunks,
         bool validate_graph = false, bool print_graph = false,
         bool store_threads = false, bool is_sorted_dag = false);
@@ -539,6 +540,13 @@ public:
     /// Otherwise the gPBWT data structures will be left in an inconsistent
     /// state.
     void insert_threads_into_dag(const vector<thread_t>& t, const vector<string>& names);
+    /// Insert a whole group of threads into a graph that may have cycles and
+    /// inversions, and threads that revisit nodes in either orientation. The
+    /// order of visits on each side is worked out for all threads at once, by
+    /// prefix doubling over the visits, in parallel. As with
+    /// insert_threads_into_dag(), this must be called only once, with no
+    /// threads inserted previously.
+    void insert_threads_into_graph(const vector<thread_t>& t, const vector<string>& names);
     /// Read all the threads embedded in the graph.
     map<string, list<thread_t> > extract_threads(bool extract_reverse) const;
     /// Extract a particular thread by name. Name may not be empty.
@@ -551,6 +559,9 @@ public:
     /// Count matches to a subthread among embedded threads
     size_t count_matches(const thread_t& t) const;
     size_t count_matches(const Path& t) const;
+    /// Count matches to many subthreads at once. Subthreads that share a prefix
+    /// share the search for it.
+    vector<size_t> count_matches(const vector<thread_t>& threads) const;
     
     /**
      * Represents the search state for the graph PBWT, so that you can continue
@@ -584,6 +595,16 @@ public:
     /// Extend a search with the given single ThreadMapping.
     void extend_search(ThreadSearchState& state, const ThreadMapping& t) const;
     
+    /// Extend a search by one step, to the given side. Leaves an empty search
+    /// unchanged.
+    void extend_search_to_side(ThreadSearchState& state, int64_t next_side) const;
+    
+    /// Search for many subthreads at once, each from an un-started search, and
+    /// return the search state for each. The subthreads are searched in sorted
+    /// order, as a walk over the trie of their sides, so a shared prefix is
+    /// searched only once and the B_s queries against a side are made together.
+    vector<ThreadSearchState> extend_searches(const vector<thread_t>& threads) const;
+    
     /// Select only the threads (if any) starting with a particular
     /// ThreadMapping, and not those continuing through it.
     ThreadSearchState select_starting(const ThreadMapping& start) const;
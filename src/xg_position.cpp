@@ -212,6 +212,31 @@ set<pos_t> xg_positions_bp_from(pos_t pos, int64_t distance, bool rev, const xg:
     }
 }
 
+/// Reduce the offsets on each path to just the smallest one.
+static void keep_min_offsets(map<string, vector<pair<size_t, bool> > >& offsets) {
+    for (auto& p : offsets) {
+        auto& v = p.second;
+        auto m = *min_element(v.begin(), v.end(),
+                              [](const pair<size_t, bool>& a,
+                                 const pair<size_t, bool>& b)
+                              { return a.first < b.first; });
+        v.clear();
+        v.push_back(m);
+    }
+}
+
+/// Record the given path offsets as reference positions on the Alignment.
+static void add_refpos(Alignment& aln, const map<string, vector<pair<size_t, bool> > >& offsets) {
+    for (const pair<string, vector<pair<size_t, bool> > >& pos_record : offsets) {
+        for (auto& pos : pos_record.second) {
+            Position* refpos = aln.add_refpos();
+            refpos->set_name(pos_record.first);
+            refpos->set_offset(pos.first);
+            refpos->set_is_reverse(pos.second);
+        }
+    }
+}
+
 map<string, vector<pair<size_t, bool> > > xg_alignment_path_offsets(const Alignment& aln, bool just_min, bool nearby, const xg::XG* xgidx) {
     map<string, vector<pair<size_t, bool> > > offsets;
     for (auto& mapping : aln.path().mapping()) {
@@ -230,31 +255,65 @@ map<string, vector<pair<size_t, bool> > > xg_alignment_path_offsets(const Alignm
         return xg_alignment_path_offsets(aln, just_min, true, xgidx);
     }
     if (just_min) {
-        // take the min offset in each path
-        for (auto& p : offsets) {
-            auto& v = p.second;
-            auto m = *min_element(v.begin(), v.end(),
-                                  [](const pair<size_t, bool>& a,
-                                     const pair<size_t, bool>& b)
-                                  { return a.first < b.first; });
-            v.clear();
-            v.push_back(m);
-        }
+        keep_min_offsets(offsets);
     }
     return offsets;
 }
 
 void xg_annotate_with_initial_path_positions(Alignment& aln, bool just_min, bool nearby, const xg::XG* xgidx) {
     if (!aln.refpos_size()) {
-        auto init_path_positions = xg_alignment_path_offsets(aln, just_min, nearby, xgidx);
-        for (const pair<string, vector<pair<size_t, bool> > >& pos_record : init_path_positions) {
-            for (auto& pos : pos_record.second) {
-                Position* refpos = aln.add_refpos();
-                refpos->set_name(pos_record.first);
-                refpos->set_offset(pos.first);
-                refpos->set_is_reverse(pos.second);
+        add_refpos(aln, xg_alignment_path_offsets(aln, just_min, nearby, xgidx));
+    }
+}
+
+void xg_annotate_with_initial_path_positions(vector<Alignment>& alns, bool just_min, const xg::XG* xgidx) {
+    // Find all the nodes the batch visits
+    vector<id_t> node_ids;
+    for (auto& aln : alns) {
+        if (aln.refpos_size()) {
+            continue;
+        }
+        for (auto& mapping : aln.path().mapping()) {
+            node_ids.push_back(mapping.position().node_id());
+        }
+    }
+    sort(node_ids.begin(), node_ids.end());
+    node_ids.erase(unique(node_ids.begin(), node_ids.end()), node_ids.end());
+    
+    // Look up where the start of each node's forward strand is in each path.
+    // Positions elsewhere on the node are just offset from there.
+    vector<map<string, vector<pair<size_t, bool> > > > node_offsets(node_ids.size());
+    for (size_t i = 0; i < node_ids.size(); i++) {
+        if (node_ids[i] != 0) {
+            node_offsets[i] = xgidx->offsets_in_paths(make_pos_t(node_ids[i], false, 0));
+        }
+    }
+    
+    for (auto& aln : alns) {
+        if (aln.refpos_size()) {
+            continue;
+        }
+        
+        map<string, vector<pair<size_t, bool> > > offsets;
+        for (auto& mapping : aln.path().mapping()) {
+            auto& position = mapping.position();
+            size_t i = lower_bound(node_ids.begin(), node_ids.end(), position.node_id()) - node_ids.begin();
+            for (auto& p : node_offsets[i]) {
+                auto& v = offsets[p.first];
+                for (auto& node_start : p.second) {
+                    v.emplace_back(node_start.first + position.offset(), node_start.second != position.is_reverse());
+                }
             }
         }
+        
+        if (offsets.empty()) {
+            // Find the nearest path positions instead
+            offsets = xg_alignment_path_offsets(aln, just_min, true, xgidx);
+        } else if (just_min) {
+            keep_min_offsets(offsets);
+        }
+        
+        add_refpos(aln, offsets);
     }
 }
 
@@ -38,6 +38,10 @@ vector<Edge> xg_edges_on_start(id_t id, const xg::XG* xgidx);
 vector<Edge> xg_edges_on_end(id_t id, const xg::XG* xgidx);
 map<string, vector<pair<size_t, bool> > > xg_alignment_path_offsets(const Alignment& aln, bool just_min, bool nearby, const xg::XG* xgidx);
 void xg_annotate_with_initial_path_positions(Alignment& aln, bool just_min, bool nearby, const xg::XG* xgidx);
+/// Annotate each Alignment in a batch with its initial path positions, as
+/// xg_annotate_with_initial_path_positions() would without nearby. Looks up the
+/// path positions of each node the batch visits only once.
+void xg_annotate_with_initial_path_positions(vector<Alignment>& alns, bool just_min, const xg::XG* xgidx);
 
 }
 
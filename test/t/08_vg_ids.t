@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 7
+plan tests 10
 
 num_nodes=$(vg construct -r small/x.fa -v small/x.vcf.gz | vg ids -c - | vg view -g - | grep ^S | wc -l)
 
@@ -38,6 +38,24 @@ rm sorted.vg
 
 is $(vg ids -s ids/unordered.vg | vg view -j - | jq -r -c '.node[1] == {"id":"2","sequence":"T"}') "true" "sorting assigns node IDs in topological order"
 
+vg ids -s -T translation.tsv ids/unordered.vg | vg view -j - | jq -r '.node[].id' | sort -n > sorted_ids.txt
+cut -f 2 translation.tsv | sort -n > translated_ids.txt
+diff sorted_ids.txt translated_ids.txt
+is $? 0 "sorting can write a translation table from old to new node IDs"
+
+rm -f translation.tsv sorted_ids.txt translated_ids.txt
+
+vg ids -s ids/unordered.vg > sorted.vg
+vg ids -s <(cat ids/unordered.vg) > piped.vg
+cmp sorted.vg piped.vg
+is $? 0 "sorting reads a graph from a pipe twice"
+
+cat ids/unordered.vg | vg ids -s - > piped.vg
+cmp sorted.vg piped.vg
+is $? 0 "sorting reads a graph from standard input twice"
+
+rm -f sorted.vg piped.vg
+
 # this test now breaks under the current VG.paths semantics, which require our paths to record the exact match lengths of the nodes
 #vg ids -s graphs/snp1kg-brca2-unsorted.vg | vg validate -
 #is $? 0 "can handle graphs with out-of-order mappings"
@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 10
+plan tests 15
 
 vg construct -r 1mb1kgp/z.fa -v 1mb1kgp/z.vcf.gz >z.vg
 #is $? 0 "construction of a 1 megabase graph from the 1000 Genomes succeeds"
@@ -40,8 +40,20 @@ vg construct -r small/x.fa -a -f -v small/x.vcf.gz >x.vg
 vg index -x x.xg -g x.gcsa -k 16 x.vg
 vg map -x x.xg -g x.gcsa -T small/x-s1337-n100.reads >x.gam
 is "$(vg stats -a x.gam x.vg | md5sum | cut -f 1 -d\ )" "$(md5sum correct/10_vg_stats/15.txt | cut -f 1 -d\ )" "aligned read stats are computed correctly"
+is "$(vg stats -a x.gam -j x.vg | jq '.alignments.total')" "$(vg stats -a x.gam x.vg | grep 'Total alignments' | cut -f 3 -d\ )" "aligned read stats can be reported as JSON"
 rm -f x.vg x.xg x.gcsa x.gam
 
+# a path over sparse node IDs, with one read across the first two nodes and one on the first
+echo '{"node": [{"id": 1, "sequence": "ACGT"}, {"id": 500000000, "sequence": "GGCC"}, {"id": 900000000, "sequence": "TA"}], "edge": [{"from": 1, "to": 500000000}, {"from": 500000000, "to": 900000000}], "path": [{"name": "ref", "mapping": [{"position": {"node_id": 1}, "edit": [{"from_length": 4, "to_length": 4}], "rank": 1}, {"position": {"node_id": 500000000}, "edit": [{"from_length": 4, "to_length": 4}], "rank": 2}, {"position": {"node_id": 900000000}, "edit": [{"from_length": 2, "to_length": 2}], "rank": 3}]}]}' | vg view -Jv - >s.vg
+(echo '{"name": "r1", "sequence": "ACGTGG", "path": {"mapping": [{"position": {"node_id": 1}, "edit": [{"from_length": 4, "to_length": 4}]}, {"position": {"node_id": 500000000}, "edit": [{"from_length": 2, "to_length": 2}]}]}, "score": 6, "mapping_quality": 60, "identity": 1}'
+ echo '{"name": "r2", "sequence": "ACGT", "path": {"mapping": [{"position": {"node_id": 1}, "edit": [{"from_length": 4, "to_length": 4}]}]}, "score": 4, "mapping_quality": 30, "identity": 1}') | vg view -JaG - >s.gam
+is "$(vg stats -a s.gam -j s.vg | jq -c '.histograms | [.mapping_quality.counts[30], .mapping_quality.counts[60], (.mapping_quality.counts | add), .score.counts[4], .score.counts[6], .softclipped_bases.counts]')" "[1,1,2,1,1,[2]]" "aligned read stats report histograms as JSON"
+is "$(vg stats -a s.gam -j s.vg | jq '.paths[0].mean_depth')" "1" "aligned read stats report the mean depth of a path"
+is "$(vg stats -a s.gam -j s.vg | jq '.paths[0].covered_fraction')" "0.8" "aligned read stats report the covered fraction of a path"
+vg stats -j s.vg 2>/dev/null
+is $? 1 "JSON output without alignments is an error"
+rm -f s.vg s.gam
+
 vg msga -g <(vg msga -f msgas/cycle.fa -b s1 -w 32 -t 1 | vg mod -D - | vg mod -U 10 -) -f msgas/cycle.fa -t 1 | vg mod -N - | vg mod -U 10 - >c.vg
 is $(vg stats -O c.vg | wc -l) 77 "a path overlap description of a cyclic graph built by msga has the expected length"
 rm -f c.vg
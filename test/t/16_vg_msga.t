@@ -6,7 +6,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 PATH=../bin:$PATH # for vg
 
 
-plan tests 13
+plan tests 15
 
 #is $(vg msga -f GRCh38_alts/FASTA/HLA/V-352962.fa -t 4 -k 16 | vg mod -U 10 - | vg mod -c - | vg view - | grep ^S | cut -f 3 | sort | md5sum | cut -f 1 -d\ ) $(vg msga -f GRCh38_alts/FASTA/HLA/V-352962.fa -t 1 -k 16 | vg mod -U 10 - | vg mod -c - | vg view - | grep ^S | cut -f 3 | sort | md5sum | cut -f 1 -d\ ) "graph for GRCh38 HLA-V is unaffected by the number of alignment threads"
 
@@ -56,3 +56,10 @@ is $? 0 "HLA B-3106 is assembled into a valid graph"
 
 vg msga -f msgas/inv.fa -w 16 -O 5 | vg validate -
 is $? 0 "odd-sized overlaps may be used for chunked alignment"
+
+vg msga -f GRCh38_alts/FASTA/HLA/K-3138.fa -w 256 -W 64 -E 4 --incremental 0.5 >k.vg
+vg validate k.vg
+is $? 0 "incremental index rebuilding produces a valid graph including all input paths"
+
+is $(vg paths -v k.vg -X | vg view -a - | jq -r '.name + " " + .sequence' | sort | md5sum | cut -f 1 -d\ ) $(awk '/^>/ { if (name) print name, seq; name = substr($1, 2); seq = ""; next } { seq = seq $0 } END { print name, seq }' GRCh38_alts/FASTA/HLA/K-3138.fa | sort | md5sum | cut -f 1 -d\ ) "incremental index rebuilding embeds every input sequence as a path"
+rm -f k.vg
@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 2
+plan tests 3
 
 vg construct -v tiny/tiny.vcf.gz -r tiny/tiny.fa > tiny.vg
 vg index -x tiny.xg -g tiny.gcsa -k 16 tiny.vg
@@ -18,6 +18,8 @@ vg mod -Z tiny.trans.1 -i tiny.paths.trans.gam tiny.vg >tiny.mod.vg.1
 
 is $(vg mod -U 10 tiny.mod.vg | vg mod -c - | vg view - | grep ^S | cut -f 3 | sort | md5sum | cut -f 1 -d\ ) $(vg mod -U 10 tiny.mod.vg.1 | vg mod -c - | vg view - | grep ^S | cut -f 3 | sort | md5sum | cut -f 1 -d\ ) "alignments used to modify a graph may be projected back to the original graph and used to regenerate the same graph"
 
+is $(vg translate -t 4 -a tiny.paths.gam tiny.trans | vg view -a - | md5sum | cut -f 1 -d\ ) $(vg translate -t 1 -a tiny.paths.gam tiny.trans | vg view -a - | md5sum | cut -f 1 -d\ ) "alignments are translated the same way and in the same order with multiple threads"
+
 rm -Rf tiny.vg tiny.xg tiny.gcsa tiny.gcsa.lcp tiny.sim tiny.gam tiny.trans tiny.mod.vg tiny.trans.1 tiny.paths.gam tiny.paths.trans.gam tiny.mod.vg.1
 
 vg construct -r tiny/tiny.fa >flat.vg
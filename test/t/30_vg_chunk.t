@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 17
+plan tests 21
 
 # Construct a graph with alt paths so we can make a gPBWT and later a GBWT
 vg construct -r small/x.fa -v small/x.vcf.gz -a >x.vg
@@ -26,6 +26,21 @@ vg chunk -x x.xg -p x -s 233 -o 50 -b _chunk_test -c 0 -t 1
 is $(ls -l _chunk_test*.vg | wc -l) 6 "-s produces correct number of chunks"
 rm -f _chunk_test*
 
+# chunks extracted together match chunks extracted one at a time
+printf "x:20-30\nx:100-200\n" > _chunk_test_regions.txt
+vg chunk -x x.xg -P _chunk_test_regions.txt -b _chunk_test -c 2 -t 2
+is "$(vg view _chunk_test_1_x_*.vg | sort | md5sum)" "$(vg chunk -x x.xg -p x:100-200 -c 2 | vg view - | sort | md5sum)" "chunks extracted together have the same paths as chunks extracted alone"
+rm -f _chunk_test*
+
+printf "1:3\n50:60\n" > _chunk_test_ranges.txt
+vg chunk -x x.xg -R _chunk_test_ranges.txt -b _chunk_test -c 2 -t 2
+is "$(vg view _chunk_test_1_*.vg | sort | md5sum)" "$(vg chunk -x x.xg -r 50:60 -c 2 | vg view - | sort | md5sum)" "id range chunks extracted together have the same nodes and edges as chunks extracted alone"
+rm -f _chunk_test*
+
+vg chunk -x x.xg -p x -s 233 -o 50 -b _chunk_test -c 0 -t 2 -X
+is $(ls -l _chunk_test*.xg | wc -l) 6 "-X writes chunks as xg indexes"
+rm -f _chunk_test*
+
 #check that gam chunker runs through without crashing
 vg gamsort small/x-l100-n1000-s10-e0.01-i0.01.gam -i x.sorted.gam.gai > x.sorted.gam
 printf "x\t2\t200\nx\t500\t600\n" > _chunk_test_bed.bed
@@ -50,6 +65,7 @@ vg index -x x.xg -G x.gbwt -v small/x.vcf.gz  x.vg
 is "$(vg chunk -x x.xg -r 1:1 -c 2 -T | vg view - -j | jq -c '.path[] | select(.name != "x")' | wc -l)" 0 "chunker extracts no threads from an empty gPBWT"
 is "$(vg chunk -x x.xg -G x.gbwt -r 1:1 -c 2 -T | vg view - -j | jq -c '.path[] | select(.name != "x")' | wc -l)" 2 "chunker extracts 2 local threads from a gBWT with 2 locally distinct threads in it"
 is "$(vg chunk -x x.xg -G x.gbwt -r 1:1 -c 2 -T | vg view - -j | jq -r '.path[] | select(.name == "thread_0") | .mapping | length')" 3 "chunker can extract a partial haplotype from a GBWT"
+is "$(vg chunk -x x.xg -G x.gbwt -r 1:1 -c 2 -T -O | vg view - -j | jq -c '.path[] | select(.name != "x")' | wc -l)" 2 "one-pass tracing extracts the same local threads from a GBWT"
 
 #check that n-chunking works
 # We know that it will drop _alt paths so we remake the graph without them for comparison.
@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 13
+plan tests 18
 
 
 # Exercise the GBWT
@@ -66,6 +66,23 @@ vg sim -x graphs/refonly-lrc_kir.vg.xg -n 1000 -p 500 -l 100 -a > input.gam
 vg mpmap -x graphs/refonly-lrc_kir.vg.xg -g graphs/refonly-lrc_kir.vg.gcsa -G input.gam -i --single-path-mode --no-qual-adjust > output.gam
 is "$(vg view -aj output.gam | jq -c 'select(.fragment_next == null and .fragment_prev == null)' | wc -l)" "0" "small batches are still all paired in the output"
 
+vg mpmap -x graphs/refonly-lrc_kir.vg.xg -g graphs/refonly-lrc_kir.vg.gcsa -I 100 -D 50 --write-calibration calib.tsv
+is "$(grep -c '^fragment_length_distr' calib.tsv)" "1" "calibration profile records a fixed fragment length distribution"
+
+vg mpmap -x graphs/refonly-lrc_kir.vg.xg -g graphs/refonly-lrc_kir.vg.gcsa -G input.gam -i --single-path-mode --no-qual-adjust --calibration calib.tsv > output.gam 2> calib.log
+is "$(grep -c 'does not match' calib.log)" "0" "calibration profile can be reloaded against the same indexes"
+
+# Plant a value that calibration would never produce, and see if it survives a reload
+sed 's/^pseudo_length_multiplier.*/pseudo_length_multiplier\t1.125/' calib.tsv > planted.tsv
+vg mpmap -x graphs/refonly-lrc_kir.vg.xg -g graphs/refonly-lrc_kir.vg.gcsa --calibration planted.tsv --write-calibration resaved.tsv 2> calib.log
+is "$(grep -c '^pseudo_length_multiplier.1.125$' resaved.tsv)" "1" "cached calibration parameters are reused"
+
+vg mpmap -B -x graphs/refonly-lrc_kir.vg.xg -g graphs/refonly-lrc_kir.vg.gcsa --calibration planted.tsv --write-calibration resaved.tsv 2> calib.log
+is "$(grep -c 'does not match' calib.log)" "1" "changing a calibration option invalidates the profile"
+is "$(grep -c '^pseudo_length_multiplier.1.125$' resaved.tsv)" "0" "an invalidated profile is recomputed"
+
+rm -f calib.tsv calib.log planted.tsv resaved.tsv
+
 rm -f graphs/refonly-lrc_kir.vg.xg graphs/refonly-lrc_kir.vg.gcsa graphs/refonly-lrc_kir.vg.gcsa.lcp input.gam output.gam
 
 
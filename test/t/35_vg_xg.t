@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 2
+plan tests 5
 
 vg construct -r small/x.fa -v small/x.vcf.gz >x.vg
 vg index -x x.xg x.vg
@@ -19,4 +19,14 @@ diff x.gfa y.gfa
 
 is $? 0 "files are the same"
 
-rm -f x.xg x.vg y.vg x.gfa y.gfa
+vg view x.vg > x.gfa
+vg xg -g x.gfa -X z.vg
+is "$(vg stats -zl z.vg)" "$(vg stats -zl x.vg)" "xg can be built directly from GFA"
+
+is "$(vg xg -i x.xg -G - | vg view -Fv - | vg stats -zl -)" "$(vg stats -zl x.vg)" "xg can be written as GFA"
+
+printf 'H\tVN:Z:1.0\nS\t1\tGATT\nL\t1\t+\t2\t+\t0M\n' > dangling.gfa
+vg xg -g dangling.gfa -o dangling.xg 2>/dev/null
+is $? 1 "xg refuses GFA links to segments that are not there"
+
+rm -f x.xg x.vg y.vg z.vg x.gfa y.gfa dangling.gfa dangling.xg
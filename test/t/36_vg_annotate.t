@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 7
+plan tests 8
 
 vg construct -r tiny/tiny.fa -v tiny/tiny.vcf.gz >t.vg
 
@@ -21,6 +21,7 @@ is "$(vg view -aj annotated.gam | grep feat1 | grep '"node_id":"1"' | wc -l)" "$
 is "$(vg view -aj annotated.gam | jq -c '.annotation.features' | grep feat1 | grep feat2 | wc -l)" 0 "vg annotate finds no reads touching both of two distant features"
 is "$(vg view -aj annotated.gam | jq -c '.annotation.features' | grep feat2 | grep feat3 | wc -l)" 2 "vg annotate shows reads having to go through one feature to get to another at the end"
 is "$(vg view -aj annotated.gam | jq -c '.annotation.features' | grep featAll | wc -l)" 30 "vg annotate shows all reads overlapping a whole-reference-covering feature"
+is "$(vg annotate -p -x t.xg -a tiny/tiny-s543-n30-l10.gam | vg view -aj - | jq -c '.refpos[0].name' | grep -c x)" 30 "vg annotate adds reference positions to all reads"
 
 rm -f t.vg t.ref.vg t.xg t.ref.xg annotated.gam
 
@@ -0,0 +1,41 @@
+#!/usr/bin/env bash
+
+BASH_TAP_ROOT=../deps/bash-tap
+. ../deps/bash-tap/bash-tap-bootstrap
+
+PATH=../bin:$PATH # for vg
+
+
+plan tests 8
+
+vg construct -r small/x.fa -v small/x.vcf.gz >x.vg
+vg index -x x.xg -g x.gcsa x.vg
+vg sim -n 1000 -l 100 -e 0.01 -i 0.005 -s 1 -x x.xg -a >x.sim
+vg map -x x.xg -g x.gcsa -G x.sim -t 1 | vg gamcompare - x.sim >x.compared.gam
+
+vg recalibrate -T -m x.model x.compared.gam
+is $? 0 "a recalibration model can be trained"
+
+vg recalibrate -m x.model x.compared.gam >x.recalibrated.gam
+is $(vg view -a x.recalibrated.gam | wc -l) 1000 "recalibration keeps every alignment"
+
+is $(vg recalibrate -m x.model -c 7 -t 4 x.compared.gam | md5sum | cut -f 1 -d " ") $(md5sum <x.recalibrated.gam | cut -f 1 -d " ") "recalibration output does not depend on batch size or threads"
+
+vg recalibrate -T -m x.sampled1.model -s 0.5 -b 100 -r 7 -c 10000 -t 1 x.compared.gam
+vg recalibrate -T -m x.sampled2.model -s 0.5 -b 100 -r 7 -c 13 -t 4 x.compared.gam
+is $(md5sum <x.sampled1.model | cut -f 1 -d " ") $(md5sum <x.sampled2.model | cut -f 1 -d " ") "sampled and shuffled training depends only on the seed"
+
+vg recalibrate -T -m x.sampled3.model -s 0.5 -b 100 -r 8 x.compared.gam
+isnt $(md5sum <x.sampled1.model | cut -f 1 -d " ") $(md5sum <x.sampled3.model | cut -f 1 -d " ") "different seeds sample differently"
+
+vg recalibrate -m x.sampled1.model x.compared.gam >x.sampled.gam
+is $(vg view -a x.sampled.gam | wc -l) 1000 "a model trained on a sample recalibrates every alignment"
+
+vg recalibrate -m x.model -s 0.5 x.compared.gam >/dev/null 2>&1
+is $? 1 "sampling is only allowed when training"
+
+vg recalibrate -T -m x.bad.model -c 0 x.compared.gam >/dev/null 2>&1
+is $? 1 "batch size must be positive"
+
+rm -f x.vg x.xg x.gcsa x.gcsa.lcp x.sim x.compared.gam x.recalibrated.gam x.sampled.gam
+rm -f x.model x.sampled1.model x.sampled2.model x.sampled3.model x.bad.model